@@ -0,0 +1,155 @@
+// benchLogger.cc
+//
+// Measures what logging costs per record at the default severity kRoutine:
+// a debug message, as the tree writers print for every record, which is
+// disabled and should cost next to nothing, a GetSeverity() check guarding
+// one, and for comparison a routine message that is printed, to a stream
+// that throws it away.  Each is timed in one thread and in several threads
+// at once, which used to contend for the lock of the logger.
+
+#include <stdlib.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+#include "ORLogger.hh"
+#include "TString.h"
+
+using namespace std;
+
+static const char Usage[] =
+"\n"
+"Usage: benchLogger [options]\n"
+"\n"
+"Logs a message per record at several severities, in one and in several\n"
+"threads, and prints the time taken per record.\n"
+"\n"
+"Available options:\n"
+"  --help : print this message and exit\n"
+"  --records [num] : records per thread, in millions (default 10)\n"
+"  --threads [num] : threads logging at once (default 4)\n"
+"\n";
+
+enum ECase { kDisabledDebug, kGuardedDebug, kPrintedRoutine, kNCases };
+static const char* CaseNames[kNCases] = {
+  "ORLog(kDebug)", "GetSeverity() check", "ORLog(kRoutine), printed"
+};
+
+struct Job {
+  ECase fCase;
+  size_t fNRecords;
+  UInt_t fSum;
+};
+
+static double Now()
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + 1.e-6*now.tv_usec;
+}
+
+/* Throws away whatever is written to it. */
+static struct NullStream: std::ostream {
+  struct NullBuffer: std::streambuf {
+    int overflow(int c) { return traits_type::not_eof(c); }
+  } fBuffer;
+  NullStream(): std::ios(&fBuffer), std::ostream(&fBuffer) {}
+} gNullStream;
+
+//! Stands in for the decoding that goes into a debug message.
+static UInt_t Decode(UInt_t word, UInt_t& sum)
+{
+  sum += word;
+  return word*2654435761U;
+}
+
+static void* LogRecords(void* argument)
+{
+  Job& job = *(Job*) argument;
+  ORLogger::SetOStream(&gNullStream);
+  ORLogger::SetSeverity(ORLogger::kRoutine);
+  UInt_t sum = 0;
+  for (size_t i = 0; i < job.fNRecords; i++) {
+    switch (job.fCase) {
+      case kDisabledDebug:
+        ORLog(kDebug) << "record " << i << ": " << Decode(i, sum) << endl;
+        break;
+      case kGuardedDebug:
+        if (ORLogger::GetSeverity() <= ORLogger::kDebug) {
+          ORLog(kDebug) << "record " << i << ": " << Decode(i, sum) << endl;
+        }
+        break;
+      default:
+        ORLog(kRoutine) << "record " << i << ": " << Decode(i, sum) << '\n';
+        break;
+    }
+  }
+  job.fSum = sum;
+  return NULL;
+}
+
+//! Nanoseconds per record of logging case in nThreads threads at once.
+static double TimeCase(ECase logCase, size_t nRecords, size_t nThreads)
+{
+  vector<pthread_t> threads(nThreads);
+  vector<Job> jobs(nThreads);
+  double start = Now();
+  for (size_t i = 0; i < nThreads; i++) {
+    jobs[i].fCase = logCase;
+    jobs[i].fNRecords = nRecords;
+    jobs[i].fSum = 0;
+    if (pthread_create(&threads[i], NULL, LogRecords, &jobs[i]) != 0) {
+      ORLog(kFatal) << "Could not start a thread" << endl;
+    }
+  }
+  for (size_t i = 0; i < nThreads; i++) pthread_join(threads[i], NULL);
+  return 1.e9*(Now() - start)/nRecords;
+}
+
+int main(int argc, char** argv)
+{
+  static struct option longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"records", required_argument, 0, 'r'},
+    {"threads", required_argument, 0, 't'},
+    {0, 0, 0, 0}
+  };
+
+  size_t nRecords = 10;
+  size_t nThreads = 4;
+  while (1) {
+    int optId = getopt_long(argc, argv, "", longOptions, NULL);
+    if (optId == -1) break;
+    switch (optId) {
+      case('h'):
+        cout << Usage;
+        return 0;
+      case('r'):
+        nRecords = abs(atoi(optarg));
+        break;
+      case('t'):
+        nThreads = abs(atoi(optarg));
+        break;
+      default:
+        ORLog(kError) << Usage;
+        return 1;
+    }
+  }
+  if (nRecords == 0) nRecords = 1;
+  if (nThreads == 0) nThreads = 1;
+  nRecords *= 1000000;
+
+  ORLog(kRoutine) << "Logging " << nRecords << " records per thread at kRoutine" << endl;
+  for (int i = 0; i < kNCases; i++) {
+    // the printed messages are much slower; don't wait for all of them
+    size_t n = (i == kPrintedRoutine) ? nRecords/10 : nRecords;
+    double oneThread = TimeCase((ECase) i, n, 1);
+    double manyThreads = TimeCase((ECase) i, n, nThreads);
+    ORLog(kRoutine) << ::Form("%-26s %8.2f ns/record, %8.2f ns/record in %d threads",
+                              CaseNames[i], oneThread, manyThreads, (int) nThreads)
+                    << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,240 @@
+// benchPlistParser.cc
+//
+// Measures how fast an Orca header is loaded into an ORDictionary, as it
+// is at every run and subrun start: with ROOT's TDOMParser, as ORXmlPlist
+// used to, and with the single pass ORPlistParser.  Also checks that both
+// give the same dictionary.  Headers of big hardware configurations are
+// several MB; a smaller header can be scaled up with --copies.
+
+#include <stdlib.h>
+#include <getopt.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <sys/time.h>
+
+#include "ORHeaderDecoder.hh"
+#include "ORLogger.hh"
+#include "ORPlistParser.hh"
+#include "ORUtils.hh"
+#include "ORXmlPlist.hh"
+#include "TString.h"
+
+using namespace std;
+
+static const char Usage[] =
+"\n"
+"Usage: benchPlistParser [options] file\n"
+"\n"
+"Loads the header in file, an xml plist or an Orca data file, with\n"
+"TDOMParser and with ORPlistParser, and prints the time taken by each.\n"
+"\n"
+"Available options:\n"
+"  --help : print this message and exit\n"
+"  --copies [num] : load a header with num copies of the contents of the\n"
+"    header in file, each in a dictionary of its own (default 1)\n"
+"  --repeat [num] : loads with each parser; the fastest counts (default 5)\n"
+"\n";
+
+static double Now()
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + 1.e-6*now.tv_usec;
+}
+
+//! Reads the header of the xml plist or Orca data file fileName.
+static bool ReadHeader(const char* fileName, string& header)
+{
+  ifstream file(fileName, ios::binary);
+  if (!file.good()) {
+    ORLog(kError) << "Error opening file: " << fileName << endl;
+    return false;
+  }
+  header.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+  if (header.size() < 8 || header[0] == '<') return true;
+
+  // an Orca data file: the header record has the length of the xml in
+  // its second word
+  UInt_t words[2];
+  header.copy((char*) words, sizeof(words));
+  ORHeaderDecoder headerDecoder;
+  ORHeaderDecoder::EOrcaStreamVersion version = headerDecoder.GetStreamVersion(words[0]);
+  if (version == ORHeaderDecoder::kNewSwapped) ORUtils::Swap(words[1]);
+  else if (version != ORHeaderDecoder::kNewUnswapped) {
+    ORLog(kError) << fileName << " is neither an xml plist nor an Orca data file" << endl;
+    return false;
+  }
+  if (words[1] > header.size() - 8) {
+    ORLog(kError) << "The header of " << fileName << " is truncated" << endl;
+    return false;
+  }
+  header = header.substr(8, words[1]);
+  // the header is padded to whole words
+  size_t end = header.rfind("</plist>");
+  if (end != string::npos) header.resize(end + 8);
+  return true;
+}
+
+//! Puts nCopies copies of the root dictionary of header into one.
+static bool CopyHeader(string& header, size_t nCopies)
+{
+  size_t begin = header.find("<dict>", header.find("<plist"));
+  size_t end = header.rfind("</dict>");
+  if (begin == string::npos || end == string::npos || end < begin) {
+    ORLog(kError) << "Could not find the root dictionary of the header" << endl;
+    return false;
+  }
+  begin += 6;
+  string contents = header.substr(begin, end - begin);
+  string copies;
+  for (size_t i = 0; i < nCopies; i++) {
+    copies += ::Form("\n<key>Copy %d</key>\n<dict>", (int) i) + contents + "</dict>";
+  }
+  header.replace(begin, end - begin, copies + "\n");
+  return true;
+}
+
+//! Returns the path of the first difference of value and other, "" if none.
+static string Compare(const ORVDictValue* value, const ORVDictValue* other,
+                      const string& path)
+{
+  if (value == NULL || other == NULL) {
+    return (value == other) ? "" : path;
+  }
+  if (value->GetValueType() != other->GetValueType()) return path;
+  if (value->IsA(ORVDictValue::kDict)) {
+    const ORDictionary::DictMap& map = ((const ORDictionary*) value)->GetDictMap();
+    const ORDictionary::DictMap& otherMap = ((const ORDictionary*) other)->GetDictMap();
+    if (map.size() != otherMap.size()) return path;
+    ORDictionary::DictMap::const_iterator entry, otherEntry = otherMap.begin();
+    for (entry = map.begin(); entry != map.end(); entry++, otherEntry++) {
+      if (entry->first != otherEntry->first) return path + ":" + entry->first;
+      string difference = Compare(entry->second, otherEntry->second,
+                                  path + ":" + entry->first);
+      if (difference != "") return difference;
+    }
+    return "";
+  }
+  if (value->IsA(ORVDictValue::kArray)) {
+    const ORDictValueA* array = (const ORDictValueA*) value;
+    const ORDictValueA* otherArray = (const ORDictValueA*) other;
+    if (array->GetNValues() != otherArray->GetNValues()) return path;
+    for (size_t i = 0; i < array->GetNValues(); i++) {
+      string difference = Compare(array->At(i), otherArray->At(i),
+                                  path + ::Form("[%d]", (int) i));
+      if (difference != "") return difference;
+    }
+    return "";
+  }
+  return (value->GetStringOfValue() == other->GetStringOfValue()) ? "" : path;
+}
+
+//! Seconds of the fastest of nRepeat loads of header into plist with TDOMParser.
+static double TimeDOMParser(ORXmlPlist& plist, const string& header, size_t nRepeat)
+{
+  // ORXmlPlist warns at every load that validation is disabled
+  ORLogger::SetSeverity(ORLogger::kError);
+  plist.UseDOMParser();
+  double best = 0;
+  for (size_t i = 0; i < nRepeat; i++) {
+    double start = Now();
+    bool isLoaded = plist.LoadXmlPlist(header.data(), header.size());
+    double seconds = Now() - start;
+    if (!isLoaded) {
+      best = 0;
+      break;
+    }
+    if (i == 0 || seconds < best) best = seconds;
+  }
+  ORLogger::SetSeverity(ORLogger::kRoutine);
+  return best;
+}
+
+//! Seconds of the fastest of nRepeat loads of header into dictionary with ORPlistParser.
+static double TimePlistParser(ORDictionary*& dictionary, const string& header, size_t nRepeat)
+{
+  double best = 0;
+  for (size_t i = 0; i < nRepeat; i++) {
+    delete dictionary;
+    double start = Now();
+    dictionary = new ORDictionary("rootDict");
+    ORPlistParser parser;
+    bool isLoaded = parser.Parse(header.data(), header.size(), dictionary);
+    double seconds = Now() - start;
+    if (!isLoaded) {
+      ORLog(kError) << parser.GetError() << endl;
+      return 0;
+    }
+    if (i == 0 || seconds < best) best = seconds;
+  }
+  return best;
+}
+
+int main(int argc, char** argv)
+{
+  static struct option longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"copies", required_argument, 0, 'c'},
+    {"repeat", required_argument, 0, 'r'},
+    {0, 0, 0, 0}
+  };
+
+  size_t nCopies = 1;
+  size_t nRepeat = 5;
+  while (1) {
+    int optId = getopt_long(argc, argv, "", longOptions, NULL);
+    if (optId == -1) break;
+    switch (optId) {
+      case('h'):
+        cout << Usage;
+        return 0;
+      case('c'):
+        nCopies = abs(atoi(optarg));
+        break;
+      case('r'):
+        nRepeat = abs(atoi(optarg));
+        break;
+      default:
+        ORLog(kError) << Usage;
+        return 1;
+    }
+  }
+  if (optind != argc - 1) {
+    ORLog(kError) << Usage;
+    return 1;
+  }
+  if (nRepeat == 0) nRepeat = 1;
+
+  string header;
+  if (!ReadHeader(argv[optind], header)) return 1;
+  if (nCopies > 1 && !CopyHeader(header, nCopies)) return 1;
+
+  ORXmlPlist domPlist;
+  ORDictionary* dictionary = NULL;
+  double domSeconds = TimeDOMParser(domPlist, header, nRepeat);
+  if (domSeconds == 0) {
+    ORLog(kError) << "TDOMParser could not load the header" << endl;
+    return 1;
+  }
+  double seconds = TimePlistParser(dictionary, header, nRepeat);
+  if (seconds == 0) {
+    ORLog(kError) << "ORPlistParser could not load the header" << endl;
+    return 1;
+  }
+
+  double nMB = header.size()/1.e6;
+  ORLog(kRoutine) << ::Form("Header of %.3f MB:", nMB) << endl;
+  ORLog(kRoutine) << ::Form("  TDOMParser    %8.2f ms, %7.1f MB/s",
+                            1.e3*domSeconds, nMB/domSeconds) << endl;
+  ORLog(kRoutine) << ::Form("  ORPlistParser %8.2f ms, %7.1f MB/s (x%.1f)",
+                            1.e3*seconds, nMB/seconds, domSeconds/seconds) << endl;
+
+  string difference = Compare(domPlist.GetDictionary(), dictionary, "");
+  delete dictionary;
+  if (difference != "") {
+    ORLog(kError) << "The parsers give different values for " << difference << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,359 @@
+// benchServerModes.cc
+//
+// Compares the two modes of ORStreamServer: starts a server in each mode,
+// streams data to it over a number of concurrent connections and reports
+// how long each connection takes to get its first record processed (from
+// connect() on) and the throughput of each stream.
+
+#include <stdlib.h>
+#include <getopt.h>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <pthread.h>
+
+#include "ORBasicDataDecoder.hh"
+#include "ORDataProcManager.hh"
+#include "ORHandlerThread.hh"
+#include "ORLogger.hh"
+#include "ORRunContext.hh"
+#include "ORSocketReader.hh"
+#include "ORStreamServer.hh"
+#include "TROOT.h"
+
+using namespace std;
+
+static const char Usage[] =
+"\n"
+"Usage: benchServerModes [options]\n"
+"\n"
+"Starts an orcaroot-like server in events and in fork mode, and streams\n"
+"records to it over several connections at once.\n"
+"\n"
+"Available options:\n"
+"  --help : print this message and exit\n"
+"  --port [port] : port to serve on (default 44600)\n"
+"  --streams [num] : number of concurrent connections (default 8)\n"
+"  --records [num] : records sent per connection (default 100000)\n"
+"  --length [num] : length of the records in long words (default 64)\n"
+"  --workers [num] : worker threads in events mode (default 4)\n"
+"\n";
+
+//! Counts the records of a stream, and tells the sender.
+/*!
+   Answers the first data record with a 1 and, once the stream is over,
+   sends the number of records it has seen.
+ */
+class ORCountingProcessor : public ORDataProcessor
+{
+  public:
+    ORCountingProcessor() : ORDataProcessor(new ORBasicDataDecoder) { fNRecords = 0; }
+    virtual ~ORCountingProcessor() { delete fDataDecoder; }
+
+    virtual void SetDataId() {}
+    virtual void SetDecoderDictionary() {}
+    virtual EReturnCode ProcessDataRecord(UInt_t* /*record*/)
+    {
+      fNRecords++;
+      if (fNRecords == 1) Acknowledge();
+      return kSuccess;
+    }
+    virtual EReturnCode EndProcessing()
+    {
+      Acknowledge();
+      return kSuccess;
+    }
+
+  protected:
+    virtual void Acknowledge()
+    {
+      UInt_t answer = fNRecords;
+      fRunContext->WriteBackToSocket(&answer, sizeof(answer));
+    }
+    UInt_t fNRecords;
+};
+
+class ORBenchServer : public ORStreamServer
+{
+  public:
+    ORBenchServer(int aPort, EMode mode) : ORStreamServer(aPort, mode)
+      { SetRunAsDaemon(); }
+  protected:
+    virtual void CreateProcessors(vector<ORDataProcessor*>& processors)
+      { processors.push_back(new ORCountingProcessor); }
+};
+
+/* Runs the server until it is killed (one more connection than there are
+   streams, for the probe of RunClients()); doesn't return. */
+static void RunServer(int port, ORStreamServer::EMode mode, size_t nStreams,
+                      size_t nWorkers)
+{
+  ORLogger::SetSeverity(ORLogger::kWarning);
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+  /* The headers are parsed with ROOT, by several workers at once. */
+  if (mode == ORStreamServer::kEventLoop && nWorkers > 1) {
+    ROOT::EnableThreadSafety();
+  }
+#endif
+  ORHandlerThread* handlerThread = new ORHandlerThread;
+  handlerThread->StartThread();
+  ORBenchServer* server = new ORBenchServer(port, mode);
+  if (!server->IsValid()) {
+    ORLog(kError) << "Error listening on port " << port << endl;
+    exit(1);
+  }
+  server->SetMaxConnections(nStreams + 1);
+  server->SetNWorkers(nWorkers);
+  TSocket* sock = server->Serve();
+  delete server;
+  if (sock == NULL) {
+    delete handlerThread;
+    exit(0);
+  }
+
+  /* Fork mode, child process: what orcaroot does. */
+  delete handlerThread;
+  handlerThread = new ORHandlerThread;
+  handlerThread->StartThread();
+  ORSocketReader reader(sock, true);
+  reader.SetOverflowPolicy(ORSocketReader::kBlock);
+  ORDataProcManager manager(&reader);
+  ORCountingProcessor counter;
+  manager.SetRunAsDaemon();
+  manager.AddProcessor(&counter);
+  manager.ProcessDataStream();
+  delete handlerThread;
+  exit(0);
+}
+
+struct StreamResult {
+  int fPort;
+  size_t fNRecords;
+  size_t fRecordLength;
+  double fFirstAckSec;    // connect() to the first record being processed
+  double fStreamSec;      // first record to the last one being processed
+  size_t fNBytes;
+  bool fOK;
+};
+
+static double Now()
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + 1e-6*now.tv_usec;
+}
+
+static int Connect(int port)
+{
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock < 0) return -1;
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(sock, (struct sockaddr*) &address, sizeof(address)) != 0) {
+    close(sock);
+    return -1;
+  }
+  int noDelay = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  return sock;
+}
+
+static bool SendAll(int sock, const void* buffer, size_t nBytes)
+{
+  const char* charBuffer = (const char*) buffer;
+  while (nBytes > 0) {
+    ssize_t nSent = send(sock, charBuffer, nBytes, 0);
+    if (nSent < 0 && errno == EINTR) continue;
+    if (nSent <= 0) return false;
+    charBuffer += nSent;
+    nBytes -= nSent;
+  }
+  return true;
+}
+
+static bool ReceiveAnswer(int sock, UInt_t& answer)
+{
+  char* buffer = (char*) &answer;
+  size_t nBytes = 0;
+  while (nBytes < sizeof(answer)) {
+    ssize_t nRead = recv(sock, buffer + nBytes, sizeof(answer) - nBytes, 0);
+    if (nRead < 0 && errno == EINTR) continue;
+    if (nRead <= 0) return false;
+    nBytes += nRead;
+  }
+  return true;
+}
+
+extern "C" void* StreamThread(void* input)
+{
+  StreamResult* result = (StreamResult*) input;
+  result->fOK = false;
+
+  /* A header with an empty dictionary, and records of data id 1. */
+  string plist = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<plist version=\"1.0\">\n<dict>\n</dict>\n</plist>\n";
+  size_t headerLength = 2 + (plist.size() + sizeof(UInt_t))/sizeof(UInt_t);
+  vector<UInt_t> header(headerLength, 0);
+  header[0] = headerLength;
+  header[1] = plist.size();
+  memcpy(&header[2], plist.c_str(), plist.size());
+
+  const size_t recordsPerSend = 64;
+  vector<UInt_t> records(recordsPerSend*result->fRecordLength, 0);
+  for (size_t i = 0; i < recordsPerSend; i++) {
+    records[i*result->fRecordLength] = (1 << 18) | result->fRecordLength;
+  }
+  size_t recordBytes = result->fRecordLength*sizeof(UInt_t);
+
+  double start = Now();
+  int sock = Connect(result->fPort);
+  if (sock < 0) return NULL;
+  UInt_t answer = 0;
+  if (!SendAll(sock, &header[0], header.size()*sizeof(UInt_t)) ||
+      !SendAll(sock, &records[0], recordBytes) ||
+      !ReceiveAnswer(sock, answer)) {
+    close(sock);
+    return NULL;
+  }
+  double firstAck = Now();
+  result->fFirstAckSec = firstAck - start;
+
+  size_t nLeft = result->fNRecords - 1;
+  while (nLeft > 0) {
+    size_t nRecords = (nLeft < recordsPerSend) ? nLeft : recordsPerSend;
+    if (!SendAll(sock, &records[0], nRecords*recordBytes)) break;
+    nLeft -= nRecords;
+  }
+  shutdown(sock, SHUT_WR);
+  if (nLeft == 0 && ReceiveAnswer(sock, answer)) {
+    result->fStreamSec = Now() - firstAck;
+    result->fNBytes = (result->fNRecords - 1)*recordBytes;
+    result->fOK = (answer == result->fNRecords);
+  }
+  close(sock);
+  return NULL;
+}
+
+static void RunClients(const char* modeName, int port, size_t nStreams,
+                       size_t nRecords, size_t recordLength)
+{
+  /* Wait for the server to come up. */
+  for (int i = 0; i < 100; i++) {
+    int sock = Connect(port);
+    if (sock >= 0) {
+      /* An empty stream: the server just closes it. */
+      close(sock);
+      break;
+    }
+    usleep(50000);
+  }
+  usleep(200000);
+
+  vector<StreamResult> results(nStreams);
+  vector<pthread_t> threads(nStreams);
+  for (size_t i = 0; i < nStreams; i++) {
+    results[i].fPort = port;
+    results[i].fNRecords = nRecords;
+    results[i].fRecordLength = recordLength;
+    results[i].fFirstAckSec = 0;
+    results[i].fStreamSec = 0;
+    results[i].fNBytes = 0;
+    pthread_create(&threads[i], NULL, StreamThread, &results[i]);
+  }
+  double start = Now();
+  for (size_t i = 0; i < nStreams; i++) pthread_join(threads[i], NULL);
+  double elapsed = Now() - start;
+
+  double sumLatency = 0, maxLatency = 0, sumRate = 0, minRate = -1;
+  double totalBytes = 0;
+  size_t nOK = 0;
+  for (size_t i = 0; i < nStreams; i++) {
+    if (!results[i].fOK) continue;
+    nOK++;
+    sumLatency += results[i].fFirstAckSec;
+    if (results[i].fFirstAckSec > maxLatency) maxLatency = results[i].fFirstAckSec;
+    double rate = (results[i].fStreamSec > 0) ?
+      results[i].fNBytes/results[i].fStreamSec/1e6 : 0;
+    sumRate += rate;
+    if (minRate < 0 || rate < minRate) minRate = rate;
+    totalBytes += results[i].fNBytes;
+  }
+  if (nOK != nStreams) {
+    ORLog(kError) << modeName << ": " << nStreams - nOK << " of " << nStreams
+                  << " streams failed" << endl;
+  }
+  if (nOK == 0) return;
+  ORLog(kRoutine) << modeName << ": first record processed after "
+                  << 1e3*sumLatency/nOK << " ms on average, "
+                  << 1e3*maxLatency << " ms at most" << endl;
+  ORLog(kRoutine) << modeName << ": " << sumRate/nOK
+                  << " MB/s per stream on average, " << minRate
+                  << " MB/s for the slowest, " << totalBytes/elapsed/1e6
+                  << " MB/s in total" << endl;
+}
+
+int main(int argc, char** argv)
+{
+  static struct option longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"port", required_argument, 0, 'p'},
+    {"streams", required_argument, 0, 's'},
+    {"records", required_argument, 0, 'r'},
+    {"length", required_argument, 0, 'l'},
+    {"workers", required_argument, 0, 'w'},
+    {0, 0, 0, 0}
+  };
+
+  int port = 44600;
+  size_t nStreams = 8;
+  size_t nRecords = 100000;
+  size_t recordLength = 64;
+  size_t nWorkers = 4;
+
+  while(1) {
+    char optId = getopt_long(argc, argv, "", longOptions, NULL);
+    if(optId == -1) break;
+    switch(optId) {
+      case('h'):
+        cout << Usage;
+        return 0;
+      case('p'): port = atoi(optarg); break;
+      case('s'): nStreams = abs(atoi(optarg)); break;
+      case('r'): nRecords = abs(atoi(optarg)); break;
+      case('l'): recordLength = abs(atoi(optarg)); break;
+      case('w'): nWorkers = abs(atoi(optarg)); break;
+      default:
+        ORLog(kError) << Usage;
+        return 1;
+    }
+  }
+  if (nStreams < 1 || nRecords < 1 || recordLength < 2 || recordLength > 0x3ffff) {
+    ORLog(kError) << "Invalid arguments" << endl << Usage;
+    return 1;
+  }
+
+  const char* modeNames[] = {"events", "fork"};
+  ORStreamServer::EMode modes[] = {ORStreamServer::kEventLoop, ORStreamServer::kFork};
+  for (size_t iMode = 0; iMode < 2; iMode++) {
+    pid_t serverPID = fork();
+    if (serverPID == 0) RunServer(port, modes[iMode], nStreams, nWorkers);
+    RunClients(modeNames[iMode], port, nStreams, nRecords, recordLength);
+    kill(serverPID, SIGINT);
+    waitpid(serverPID, NULL, 0);
+    port++; // don't wait for the old one to be released
+  }
+  return 0;
+}
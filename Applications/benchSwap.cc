@@ -0,0 +1,180 @@
+// benchSwap.cc
+//
+// Measures how fast records are byte swapped, as they are for streams from
+// machines of the other endianness: word by word with ORUtils::Swap(), as
+// ORVDataDecoder::Swap() used to, with ORUtils::SwapBlock(), and with each
+// of the SwapBlock() kernels the machine supports, for a range of record
+// lengths.  Also checks that they all give the same result.
+
+#include <stdlib.h>
+#include <getopt.h>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+#include "ORLogger.hh"
+#include "ORUtils.hh"
+#include "TString.h"
+
+using namespace std;
+
+static const char Usage[] =
+"\n"
+"Usage: benchSwap [options]\n"
+"\n"
+"Swaps a buffer of records of each length, word by word, with SwapBlock()\n"
+"and with each of its kernels, and prints the throughput of each.\n"
+"\n"
+"Available options:\n"
+"  --help : print this message and exit\n"
+"  --mbytes [num] : size of the buffer of records in MB (default 64)\n"
+"  --repeat [num] : passes over the buffer; the fastest counts (default 5)\n"
+"\n";
+
+static double Now()
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + 1.e-6*now.tv_usec;
+}
+
+//! Fills words with records of nWordsPerRecord words, and records with their starts.
+static void MakeRecords(vector<UInt_t>& words, size_t nWordsPerRecord,
+                        vector<UInt_t*>& records)
+{
+  records.clear();
+  for (size_t i = 0; i < words.size(); i++) words[i] = 0x01234567 * (i + 1);
+  for (size_t i = 0; i + nWordsPerRecord <= words.size(); i += nWordsPerRecord) {
+    words[i] = nWordsPerRecord;
+    records.push_back(&words[i]);
+  }
+}
+
+//! The way ORVDataDecoder::Swap() swapped records before SwapBlock().
+static void SwapWordByWord(const vector<UInt_t*>& records, size_t nWordsPerRecord)
+{
+  for (size_t i = 0; i < records.size(); i++) {
+    for (size_t j = 1; j < nWordsPerRecord; j++) ORUtils::Swap(records[i][j]);
+  }
+}
+
+static void SwapBlocks(const vector<UInt_t*>& records, size_t nWordsPerRecord)
+{
+  for (size_t i = 0; i < records.size(); i++) {
+    ORUtils::SwapBlock(records[i] + 1, nWordsPerRecord - 1);
+  }
+}
+
+static void SwapWithKernel(const vector<UInt_t*>& records, size_t nWordsPerRecord)
+{
+  for (size_t i = 0; i < records.size(); i++) {
+    ORUtils::SwapBlockWithKernel(records[i] + 1, records[i] + 1, nWordsPerRecord - 1);
+  }
+}
+
+//! Seconds of the fastest of nRepeat passes of swap.
+static double TimeSwap(void (*swap)(const vector<UInt_t*>&, size_t),
+                       const vector<UInt_t*>& records, size_t nWordsPerRecord, 
+                       size_t nRepeat)
+{
+  double best = 0;
+  for (size_t i = 0; i < nRepeat; i++) {
+    double start = Now();
+    swap(records, nWordsPerRecord);
+    double seconds = Now() - start;
+    if (i == 0 || seconds < best) best = seconds;
+  }
+  return best;
+}
+
+int main(int argc, char** argv)
+{
+  static struct option longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"mbytes", required_argument, 0, 'm'},
+    {"repeat", required_argument, 0, 'r'},
+    {0, 0, 0, 0}
+  };
+
+  size_t nMBytes = 64;
+  size_t nRepeat = 5;
+  while (1) {
+    int optId = getopt_long(argc, argv, "", longOptions, NULL);
+    if (optId == -1) break;
+    switch (optId) {
+      case('h'):
+        cout << Usage;
+        return 0;
+      case('m'):
+        nMBytes = abs(atoi(optarg));
+        break;
+      case('r'):
+        nRepeat = abs(atoi(optarg));
+        break;
+      default:
+        ORLog(kError) << Usage;
+        return 1;
+    }
+  }
+  if (nMBytes == 0) nMBytes = 1;
+  if (nRepeat == 0) nRepeat = 1;
+
+  vector<ORUtils::ESwapKernel> kernels;
+  string kernelNames;
+  for (int i = 0; i < ORUtils::kNSwapKernels; i++) {
+    ORUtils::ESwapKernel kernel = (ORUtils::ESwapKernel) i;
+    if (!ORUtils::IsSwapKernelSupported(kernel)) continue;
+    kernels.push_back(kernel);
+    kernelNames += string(" ") + ORUtils::GetSwapKernelName(kernel);
+  }
+  ORUtils::ESwapKernel defaultKernel = ORUtils::GetSwapKernel();
+  ORLog(kRoutine) << "Kernels:" << kernelNames << "; SwapBlock() uses "
+                  << ORUtils::GetSwapKernelName(defaultKernel) << " by default" << endl;
+
+  const size_t lengths[] = { 2, 4, 8, 16, 64, 256, 1024, 4096 };
+  const size_t nLengths = sizeof(lengths)/sizeof(lengths[0]);
+  vector<UInt_t> words(nMBytes*1024*1024/sizeof(UInt_t));
+  vector<UInt_t> reference;
+  vector<UInt_t*> records;
+  bool isOK = true;
+  for (size_t iLength = 0; iLength < nLengths; iLength++) {
+    size_t length = lengths[iLength];
+    MakeRecords(words, length, records);
+    double nMB = records.size()*length*sizeof(UInt_t)/1.e6;
+
+    // the word by word swap is the reference, for speed and for results
+    double seconds = TimeSwap(SwapWordByWord, records, length, nRepeat);
+    double wordByWordSeconds = seconds;
+    MakeRecords(words, length, records);
+    SwapWordByWord(records, length);
+    reference = words;
+    string line = ::Form("%5d words: word by word %6.0f MB/s", (int) length, nMB/seconds);
+
+    ORUtils::SetSwapKernel(defaultKernel);
+    MakeRecords(words, length, records);
+    SwapBlocks(records, length);
+    if (words != reference) {
+      ORLog(kError) << "SwapBlock() swaps records of " << length << " words wrong!" << endl;
+      isOK = false;
+    }
+    seconds = TimeSwap(SwapBlocks, records, length, nRepeat);
+    line += ::Form(", SwapBlock() %6.0f MB/s (x%.1f)", nMB/seconds, wordByWordSeconds/seconds);
+
+    for (size_t i = 0; i < kernels.size(); i++) {
+      ORUtils::SetSwapKernel(kernels[i]);
+      MakeRecords(words, length, records);
+      SwapWithKernel(records, length);
+      if (words != reference) {
+        ORLog(kError) << ORUtils::GetSwapKernelName(kernels[i]) << " swaps records of "
+                      << length << " words wrong!" << endl;
+        isOK = false;
+      }
+      seconds = TimeSwap(SwapWithKernel, records, length, nRepeat);
+      line += ::Form(", %s %6.0f MB/s (x%.1f)", ORUtils::GetSwapKernelName(kernels[i]),
+                     nMB/seconds, wordByWordSeconds/seconds);
+    }
+    ORLog(kRoutine) << line << endl;
+  }
+  ORUtils::SetSwapKernel(defaultKernel);
+  return isOK ? 0 : 1;
+}
@@ -5,21 +5,36 @@
 #include <sstream>
 #include <sys/wait.h>
 #include <sys/time.h>
-#include <sys/resource.h> 
-#include <set> 
+#include <vector> 
 
 #include "ORDataProcManager.hh"
+#include "ORFileJobs.hh"
 #include "ORFileReader.hh"
+#include "ORMappedFileReader.hh"
 #include "ORFileWriter.hh"
 #include "ORLogger.hh"
+#include "ORLogSink.hh"
 #include "ORSocketReader.hh"
 
 #include "OROrcaRequestProcessor.hh"
-#include "ORServer.hh"
+#include "ORStreamServer.hh"
+#include "ORThreadPlacement.hh"
 #include "ORHandlerThread.hh"
+#include "TROOT.h"
 
 using namespace std;
 
+//! Serves Orca's requests on each connection
+class ORDaemonServer : public ORStreamServer
+{
+  public:
+    ORDaemonServer(int aPort, EMode mode) : ORStreamServer(aPort, mode)
+      { SetRunAsDaemon(); }
+  protected:
+    virtual void CreateProcessors(vector<ORDataProcessor*>& processors)
+      { processors.push_back(new OROrcaRequestProcessor); }
+};
+
 static const char Usage[] =
 "\n"
 "\n"
@@ -29,6 +44,8 @@ static const char Usage[] =
 "a host and port of a socket from which to read data. For a file, you may\n"
 "enter a series of files to be processed, or use a wildcard like \"file*.dat\"\n"
 "For a socket, the argument should be formatted as host:port.\n"
+"Files compressed with gzip, zstd or xz are decompressed on the fly, provided\n"
+"the corresponding program is installed.\n"
 "\n"
 "Available options:\n"
 "  --help : print this message and exit\n"
@@ -41,6 +58,43 @@ static const char Usage[] =
 "    A [num] value of 0 sets this to infinity (i.e. no timeout).\n"
 "  --daemon [port] : Runs as a server accepting connections on [port]. \n" 
 "  --connections [num] : Maximum [num] connections accepted by server. \n" 
+"  --servermode [mode] : how the server handles connections: fork (default)\n"
+"    forks a process for each connection; events processes all of them in\n"
+"    this process, as soon as they come in, on a pool of worker threads.\n"
+"  --workers [num] : number of worker threads in events mode (default 1).\n"
+"  --mmap : read input files through a memory mapping instead of streaming\n"
+"    them; records are handed to the processors without being copied.\n"
+"  --readahead [num] : read input files in a background thread, keeping up\n"
+"    to [num] blocks ahead of the processing. \n"
+"  --readaheadblock [kB] : size of the read-ahead blocks (default 1024 kB).\n"
+"  --overflow [policy] : what to do with socket data arriving faster than it\n"
+"    is processed: drop (default), block (let TCP push back on the sender),\n"
+"    grow[:MB] (enlarge the buffer up to MB, default 1024, then block) or\n"
+"    spill[:dir] (buffer it in a file in dir, default /tmp).\n"
+"  --index : write a packet index (see orindex) next to each input file\n"
+"    that doesn't have one yet, while processing it.\n"
+"  --jobs [num] : process input files in up to [num] parallel processes,\n"
+"    one per run, each writing its own output file (default 1).\n"
+"  --shards [num] : split each run that is in a single file into up to [num]\n"
+"    pieces of at least 64 MB, processed in parallel like --jobs (which\n"
+"    defaults to [num] then), and merge their output files.\n"
+"  --pin [role=cpus] : pin the reader, worker, writer or handler threads\n"
+"    to cpus, a list like 0-3,8, nodeN for the CPUs of NUMA node N, or local\n"
+"    for those of the node of the input's disk or network interface; their\n"
+"    buffers are allocated on that node.  May be given once per role.\n"
+"  --span [num] : hand up to [num] consecutive records of one kind to each\n"
+"    processor at once, to be processed in one loop (default 1, one by one).\n"
+"  --timing[=file] : report at the end of each run the time each processor\n"
+"    took and the throughput of the input, and append it to file as JSON.\n"
+"  --checkpoint [file[:seconds]] : write a checkpoint to file every seconds\n"
+"    (default 600) of a run, saving the output files as they are, so that\n"
+"    the processing can be resumed from there with --resume.\n"
+"  --resume : go on from the checkpoint in the --checkpoint file, if there\n"
+"    is one, with the same input files; output files are appended to.\n"
+"  --asynclog[=json] : write the log messages from a thread of their own, so\n"
+"    that a slow terminal or pipe doesn't hold up the processing; repeated\n"
+"    messages are folded and at most 1000 are written per second.  With\n"
+"    json, each message is written as a line of JSON.\n"
 "\n"
 "Example usage:\n"
 "orcaroot run194ecpu\n"
@@ -51,11 +105,15 @@ static const char Usage[] =
 "  The same, but with example usage of the verbosity and mylabel options.\n"
 "  An output file will be created with name mylabel_run194.root, and lots\n"
 "  of debugging output will appear.\n"
+"orcaroot --jobs 8 run*\n"
+"  The same, with up to 8 runs processed at once.\n"
 "orcaroot 128.95.100.213:44666\n"
 "  Rootify orca stream on host 128.95.100.213, port 44666 with default verbosity,\n"
 "  output file label, etc.\n"
 "orcaroot --daemon 9090 --connections 10\n"
 "  Start orcaroot as a server on port 9090, accepting a maximum number of 10 connections.\n" 
+"orcaroot --daemon 9090 --connections 100 --servermode events --workers 4\n"
+"  The same, with up to 100 connections processed by 4 threads of one process.\n"
 "\n"
 "\n";
 
@@ -75,7 +133,23 @@ int main(int argc, char** argv)
     //{"keepalive", optional_argument, 0, 'k'},
     //{"maxreconnect", required_argument, 0, 'm'},
     {"daemon", required_argument, 0, 'd'},
-    {"connections", required_argument, 0, 'c'}
+    {"connections", required_argument, 0, 'c'},
+    {"mmap", no_argument, 0, 'M'},
+    {"readahead", required_argument, 0, 'r'},
+    {"readaheadblock", required_argument, 0, 'B'},
+    {"index", no_argument, 0, 'x'},
+    {"overflow", required_argument, 0, 'o'},
+    {"servermode", required_argument, 0, 's'},
+    {"workers", required_argument, 0, 'w'},
+    {"jobs", required_argument, 0, 'j'},
+    {"shards", required_argument, 0, 'S'},
+    {"pin", required_argument, 0, 'P'},
+    {"span", required_argument, 0, 'N'},
+    {"timing", optional_argument, 0, 'T'},
+    {"checkpoint", required_argument, 0, 'C'},
+    {"resume", no_argument, 0, 'R'},
+    {"asynclog", optional_argument, 0, 'A'},
+    {0, 0, 0, 0}
   };
 
   string label = "OR";
@@ -83,10 +157,32 @@ int main(int argc, char** argv)
 
   //bool keepAliveSocket = false;
   bool runAsDaemon = false;
+  bool useMappedReader = false;
+  size_t readAheadBlocks = 0;
+  size_t readAheadBlockSize = 1024*1024;
+  bool buildIndex = false;
+  ORSocketReader::EOverflowPolicy overflowPolicy = ORSocketReader::kDrop;
+  string overflowArg = "";
   //unsigned long timeToSleep = 10; //default sleep time for sockets.
   //unsigned int reconnectAttempts = 0; // default reconnect tries for sockets.
   unsigned int portToListenOn = 0;
   unsigned int maxConnections = 5; // default connections accepted by server
+  ORStreamServer::EMode serverMode = ORStreamServer::kFork;
+  unsigned int nWorkers = 1;
+  unsigned int nJobs = 1;
+  unsigned int nShards = 1;
+  int shard = -1;
+  ULong64_t firstPacket = 0;
+  ULong64_t lastPacket = 0;
+  bool doPlacement = false;
+  size_t maxSpanLength = 1;
+  bool doTiming = false;
+  string timingReportFile = "";
+  string checkpointFile = "";
+  unsigned int checkpointInterval = 600;
+  bool resume = false;
+  bool useLogSink = false;
+  ORLogSink::EFormat logSinkFormat = ORLogSink::kText;
 
   while(1) {
     char optId = getopt_long(argc, argv, "", longOptions, NULL);
@@ -132,18 +228,115 @@ int main(int argc, char** argv)
       case('c'):
         maxConnections = abs(atoi(optarg));
         break;
+      case('M'):
+        useMappedReader = true;
+        break;
+      case('r'):
+        readAheadBlocks = abs(atoi(optarg));
+        break;
+      case('B'):
+        readAheadBlockSize = abs(atoi(optarg))*1024;
+        break;
+      case('x'):
+        buildIndex = true;
+        break;
+      case('o'): {
+        string policy = optarg;
+        overflowArg = "";
+        size_t iColon = policy.find(":");
+        if (iColon != string::npos) {
+          overflowArg = policy.substr(iColon+1);
+          policy = policy.substr(0, iColon);
+        }
+        if (policy == "drop") overflowPolicy = ORSocketReader::kDrop;
+        else if (policy == "block") overflowPolicy = ORSocketReader::kBlock;
+        else if (policy == "grow") overflowPolicy = ORSocketReader::kGrow;
+        else if (policy == "spill") overflowPolicy = ORSocketReader::kSpill;
+        else {
+          ORLog(kError) << "Unknown overflow policy " << optarg << endl << Usage;
+          return 1;
+        }
+        break;
+      }
+      case('s'):
+        if (strcmp(optarg, "events") == 0) serverMode = ORStreamServer::kEventLoop;
+        else if (strcmp(optarg, "fork") == 0) serverMode = ORStreamServer::kFork;
+        else {
+          ORLog(kError) << "Unknown server mode " << optarg << endl << Usage;
+          return 1;
+        }
+        break;
+      case('w'):
+        nWorkers = abs(atoi(optarg));
+        break;
+      case('j'):
+        nJobs = abs(atoi(optarg));
+        break;
+      case('S'):
+        nShards = abs(atoi(optarg));
+        break;
+      case('P'):
+        if (!ORThreadPlacement::SetPlacement(optarg)) {
+          ORLog(kError) << "Bad thread placement " << optarg << endl << Usage;
+          return 1;
+        }
+        doPlacement = true;
+        break;
+      case('N'):
+        maxSpanLength = abs(atoi(optarg));
+        break;
+      case('T'):
+        doTiming = true;
+        if (optarg != NULL) timingReportFile = optarg;
+        break;
+      case('C'): {
+        checkpointFile = optarg;
+        size_t iColon = checkpointFile.rfind(":");
+        if (iColon != string::npos) {
+          checkpointInterval = abs(atoi(checkpointFile.substr(iColon+1).c_str()));
+          checkpointFile = checkpointFile.substr(0, iColon);
+        }
+        break;
+      }
+      case('R'):
+        resume = true;
+        break;
+      case('A'):
+        useLogSink = true;
+        if (optarg == NULL || strcmp(optarg, "text") == 0) logSinkFormat = ORLogSink::kText;
+        else if (strcmp(optarg, "json") == 0) logSinkFormat = ORLogSink::kJSONLines;
+        else {
+          ORLog(kError) << "Unknown log format " << optarg << endl << Usage;
+          return 1;
+        }
+        break;
       default: // unrecognized option
         ORLog(kError) << Usage;
         return 1;
     }
   }
 
+  if (resume && checkpointFile == "") {
+    ORLog(kError) << "--resume needs a --checkpoint file" << endl << Usage;
+    return 1;
+  }
+  if (nShards > 1 && nJobs <= 1) nJobs = nShards;
+  if (checkpointFile != "" && nJobs > 1) {
+    ORLog(kError) << "--checkpoint can't be used with --jobs" << endl << Usage;
+    return 1;
+  }
+  if (useMappedReader && nShards > 1) {
+    ORLog(kError) << "--shards can't be used with --mmap" << endl << Usage;
+    return 1;
+  }
+
   if (argc <= optind && !runAsDaemon) {
     ORLog(kError) << "You must supply a filename or socket host:port" << endl
                   << Usage << endl;
     return 1;
   }
 
+  if (useLogSink) ORLogSink::Start(logSinkFormat);
   ORHandlerThread* handlerThread = new ORHandlerThread();
   handlerThread->StartThread();
   /***************************************************************************/
@@ -151,71 +344,42 @@ int main(int argc, char** argv)
   /***************************************************************************/
   if (runAsDaemon) {
     /* Here we start listening on a socket for connections. */
-    /* We are doing this very simply with a simple fork. Eventually want
-       to check number of spawned processes, etc.  */
     ORLog(kRoutine) << "Running orcaroot as daemon on port: " << portToListenOn << endl;
-    pid_t childpid = 0;
-    std::set<pid_t> childPIDRecord;
-    
-    ORServer* server = new ORServer(portToListenOn);
+    ORDaemonServer* server = new ORDaemonServer(portToListenOn, serverMode);
     /* Starting server, binding to a port. */
     if (!server->IsValid()) {
       ORLog(kError) << "Error listening on port " << portToListenOn 
         << endl << "Error code: " << server->GetErrorCode() << endl;
       return 1;
     }
-    while (1) {
-      /* This while loop is broken by a kill signal which is well handled
-       * by the server.  The kill signal will automatically propagate to the
-       * children so we really don't have to worry about waiting for them to
-       * die.  */
-      while (childPIDRecord.size() >= maxConnections) { 
-        /* We've reached our maximum number of child processes. */
-        /* Wait for a process to end. */
-        childpid = wait3(0, WUNTRACED, 0);
-        if(childPIDRecord.erase(childpid) != 1) {
-          /* Something really weird happened. */
-          ORLog(kError) << "Ended child process " << childpid 
-            << " not recognized!" << endl;
-        }
-      }
-      while((childpid = wait3(0,WNOHANG,0)) > 0) {
-        /* Cleaning up any children that may have ended.                   * 
-         * This will just go straight through if no children have stopped. */
-        if(childPIDRecord.erase(childpid) != 1) {
-          /* Something really weird happened. */
-          ORLog(kError) << "Ended child process " << childpid 
-            << " not recognized!" << endl;
-        }
-      } 
-      ORLog(kRoutine) << childPIDRecord.size()  << " connections running..." << endl;
-      ORLog(kRoutine) << "Waiting for connection..." << endl;
-      TSocket* sock = server->Accept(); 
-      if (sock == (TSocket*) 0 || sock == (TSocket*) -1 ) {
-        // There was an error, or the socket got closed .
-        if (!server->IsValid()) return 0;
-        continue;
-      }
-      if(!sock->IsValid()) {
-        /* Invalid socket, cycle to wait. */
-        delete sock;
-        continue;
-      }
-      if ((childpid = fork()) == 0) {
-        /* We are in the child process.  Set up reader and fire away. */
-        delete server;
-        delete handlerThread;
-        handlerThread = new ORHandlerThread;
-        handlerThread->StartThread();
-        reader = new ORSocketReader(sock, true);
-        /* Get out of the while loop */
-        break;
-      } 
-      /* Parent process: wait for next connection. Close our descriptor. */
-      ORLog(kRoutine) << "Connection accepted, child process begun with pid: " 
-        << childpid << endl;
-      childPIDRecord.insert(childpid);
-      delete sock; 
+    server->SetMaxConnections(maxConnections);
+    /* In fork mode, each child places its threads for its own connection. */
+    if (doPlacement) ORThreadPlacement::LogPlacement();
+    server->SetNWorkers(nWorkers);
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+    /* Workers run the processors of different connections concurrently. */
+    if (serverMode == ORStreamServer::kEventLoop && nWorkers > 1) {
+      ROOT::EnableThreadSafety();
+    }
+#endif
+    /* Serve() is left by a kill signal, which is well handled by the 
+     * server, or, in fork mode, in each child process. */
+    TSocket* sock = server->Serve();
+    delete server;
+    if (sock == NULL) {
+      delete handlerThread;
+      return 0;
+    }
+    /* We are in the child process.  Set up reader and fire away. */
+    delete handlerThread;
+    /* The logger thread is not forked with the process. */
+    if (useLogSink) ORLogSink::Start(logSinkFormat);
+    handlerThread = new ORHandlerThread;
+    handlerThread->StartThread();
+    reader = new ORSocketReader(sock, true);
+    if (ORThreadPlacement::HasLocalPlacement()) {
+      ORThreadPlacement::SetLocalNode(ORThreadPlacement::GetNodeOfSocket(sock->GetDescriptor()));
+      ORThreadPlacement::LogPlacement();
     }
   /***************************************************************************/
   /*  End daemon server code.  */
@@ -224,11 +388,45 @@ int main(int argc, char** argv)
     /* Normal running, either connecting to a server or reading in a file. */
     string readerArg = argv[optind];
     size_t iColon = readerArg.find(":");
+    vector<string> fileNames;
     if (iColon == string::npos) {
+      for (int i=optind; i<argc; i++) fileNames.push_back(argv[i]);
+    }
+    if (iColon == string::npos && nJobs > 1) {
+      ORFileJobs jobs(nJobs);
+      jobs.SetNShards(nShards);
+      for (size_t i=0; i<fileNames.size(); i++) jobs.AddFile(fileNames[i]);
+      if (!jobs.ForkJobs(fileNames)) {
+        delete handlerThread;
+        bool isMerged = jobs.MergeShards(label);
+        return (jobs.GetNFailed() == 0 && jobs.GetNNotStarted() == 0 && isMerged) ? 0 : 1;
+      }
+      /* We are in a child process, with the files of one run, or a shard of it. */
+      shard = jobs.GetShard();
+      jobs.GetPacketRange(firstPacket, lastPacket);
+      label = jobs.GetShardLabel(label);
+      delete handlerThread;
+      /* The logger thread is not forked with the process. */
+      if (useLogSink) ORLogSink::Start(logSinkFormat);
+      handlerThread = new ORHandlerThread;
+      handlerThread->StartThread();
+    }
+    if (iColon == string::npos && ORThreadPlacement::HasLocalPlacement()) {
+      ORThreadPlacement::SetLocalNode(ORThreadPlacement::GetNodeOfFile(fileNames[0]));
+    }
+    if (iColon == string::npos && useMappedReader) {
+      reader = new ORMappedFileReader;
+      for (size_t i=0; i<fileNames.size(); i++) {
+        ((ORMappedFileReader*) reader)->AddFileToProcess(fileNames[i]);
+      }
+    } else if (iColon == string::npos) {
       reader = new ORFileReader;
-      for (int i=optind; i<argc; i++) {
-        ((ORFileReader*) reader)->AddFileToProcess(argv[i]);
+      for (size_t i=0; i<fileNames.size(); i++) {
+        ((ORFileReader*) reader)->AddFileToProcess(fileNames[i]);
       }
+      if (shard >= 0) ((ORFileReader*) reader)->AddPacketRange(firstPacket, lastPacket);
+      ((ORFileReader*) reader)->SetReadAhead(readAheadBlocks, readAheadBlockSize);
+      ((ORFileReader*) reader)->SetBuildIndex(buildIndex);
     } else {
       reader = new ORSocketReader(readerArg.substr(0, iColon).c_str(), 
                                   atoi(readerArg.substr(iColon+1).c_str()));
@@ -247,13 +445,39 @@ int main(int argc, char** argv)
       }*/
     }
   }
+  if (ORSocketReader* socketReader = dynamic_cast<ORSocketReader*>(reader)) {
+    if (!runAsDaemon && ORThreadPlacement::HasLocalPlacement()) {
+      ORThreadPlacement::SetLocalNode(ORThreadPlacement::GetNodeOfSocket(
+        socketReader->GetSocket()->GetDescriptor()));
+    }
+    socketReader->SetOverflowPolicy(overflowPolicy);
+    if (overflowPolicy == ORSocketReader::kGrow && overflowArg != "") {
+      socketReader->SetMaxBufferLength(((size_t) atol(overflowArg.c_str()))*1024*1024/sizeof(UInt_t));
+    }
+    if (overflowPolicy == ORSocketReader::kSpill && overflowArg != "") {
+      socketReader->SetSpillDirectory(overflowArg);
+    }
+  }
   if (!reader->OKToRead()) {
     ORLog(kError) << "Reader couldn't read" << endl;
     return 1;
   }
 
+  if (doPlacement && !runAsDaemon) ORThreadPlacement::LogPlacement();
+
   ORLog(kRoutine) << "Setting up data processing manager..." << endl;
   ORDataProcManager dataProcManager(reader);
+  dataProcManager.SetMaxSpanLength(maxSpanLength);
+  if (doTiming) {
+    dataProcManager.SetTiming();
+    dataProcManager.SetTimingReportFile(timingReportFile);
+  }
+  /* Each shard only writes out what is in its own packets. */
+  if (shard >= 0) dataProcManager.SetSkipReplayedRecords();
+  if (checkpointFile != "") {
+    dataProcManager.SetCheckpointFile(checkpointFile, checkpointInterval);
+    if (resume && !dataProcManager.ResumeFromCheckpoint()) return 1;
+  }
 
   /* Declare processors here. */
   // ORMyProcessor processor;
@@ -268,12 +492,14 @@ int main(int argc, char** argv)
   }
 
   ORLog(kRoutine) << "Start processing..." << endl;
-  dataProcManager.ProcessDataStream();
+  ORDataProcessor::EReturnCode retCode = dataProcManager.ProcessDataStream();
   ORLog(kRoutine) << "Finished processing..." << endl;
 
   delete reader;
   delete handlerThread;
 
+  /* With --jobs, the parent counts a failed run by the exit status. */
+  if (nJobs > 1 && retCode >= ORDataProcessor::kAlarm) return 1;
   return 0;
 }
 
@@ -3,17 +3,21 @@
 #include <stdlib.h>
 #include <getopt.h>
 #include <string>
+#include <vector>
 #include "ORBasicTreeWriter.hh"
 #include "ORDataProcManager.hh"
+#include "ORFileJobs.hh"
 #include "ORFileReader.hh"
 #include "ORFileWriter.hh"
 #include "ORHistWriter.hh"
 //#include "ORHistDrawer.hh"
 #include "ORLogger.hh"
+#include "ORLogSink.hh"
 //#include "ORProcessStopper.hh" // removed -tb-
 //#include "ORShaperShaperTreeWriter.hh" 
 //#include "ORSocketReader.hh"
 #include "ORSocketReader.hh"  // new -tb-
+#include "ORThreadPlacement.hh"
 #include "ORHandlerThread.hh" // new -tb-
 
 
@@ -118,6 +122,28 @@ static const char Usage[] =
 "  --verbosity [verbosity] : set the severity/verbosity for the logger.\n"
 "    Choices are: debug, trace, routine, warning, error, and fatal.\n"
 "  --label [label] : use [label] as prefix for root output file name.\n"
+"  --jobs [num] : process input files in up to [num] parallel processes,\n"
+"    one per run, each writing its own output file (default 1).\n"
+"  --shards [num] : split each run that is in a single file into up to [num]\n"
+"    pieces of at least 64 MB, processed in parallel like --jobs (which\n"
+"    defaults to [num] then), and merge their output files.\n"
+"  --pin [role=cpus] : pin the reader, worker, writer or handler threads\n"
+"    to cpus, a list like 0-3,8, nodeN for the CPUs of NUMA node N, or local\n"
+"    for those of the node of the input's disk or network interface; their\n"
+"    buffers are allocated on that node.  May be given once per role.\n"
+"  --span [num] : hand up to [num] consecutive records of one kind to each\n"
+"    processor at once, to be processed in one loop (default 1, one by one).\n"
+"  --timing[=file] : report at the end of each run the time each processor\n"
+"    took and the throughput of the input, and append it to file as JSON.\n"
+"  --checkpoint [file[:seconds]] : write a checkpoint to file every seconds\n"
+"    (default 600) of a run, saving the output files as they are, so that\n"
+"    the processing can be resumed from there with --resume.\n"
+"  --resume : go on from the checkpoint in the --checkpoint file, if there\n"
+"    is one, with the same input files; output files are appended to.\n"
+"  --asynclog[=json] : write the log messages from a thread of their own, so\n"
+"    that a slow terminal or pipe doesn't hold up the processing; repeated\n"
+"    messages are folded and at most 1000 are written per second.  With\n"
+"    json, each message is written as a line of JSON.\n"
 "\n"
 "Example usage:\n"
 "orcaroot run194ecpu\n"
@@ -155,10 +181,33 @@ int main(int argc, char** argv)
     {"help", no_argument, 0, 'h'},
     {"verbosity", required_argument, 0, 'v'},
     {"label", required_argument, 0, 'l'},
+    {"jobs", required_argument, 0, 'j'},
+    {"shards", required_argument, 0, 'S'},
+    {"pin", required_argument, 0, 'P'},
+    {"span", required_argument, 0, 'N'},
+    {"timing", optional_argument, 0, 'T'},
+    {"checkpoint", required_argument, 0, 'C'},
+    {"resume", no_argument, 0, 'R'},
+    {"asynclog", optional_argument, 0, 'A'},
+    {0, 0, 0, 0}
   };
 
   string label = "OR";
   ORVReader* reader = NULL;
+  unsigned int nJobs = 1;
+  unsigned int nShards = 1;
+  int shard = -1;
+  ULong64_t firstPacket = 0;
+  ULong64_t lastPacket = 0;
+  bool doPlacement = false;
+  size_t maxSpanLength = 1;
+  bool doTiming = false;
+  string timingReportFile = "";
+  string checkpointFile = "";
+  unsigned int checkpointInterval = 600;
+  bool resume = false;
+  bool useLogSink = false;
+  ORLogSink::EFormat logSinkFormat = ORLogSink::kText;
   //ORProcessStopper* stopper = NULL; // removed -tb-
 
   while(1) {
@@ -184,18 +233,70 @@ int main(int argc, char** argv)
       case('l'): // label
         label = optarg;
         break;
+      case('j'):
+        nJobs = abs(atoi(optarg));
+        break;
+      case('S'):
+        nShards = abs(atoi(optarg));
+        break;
+      case('P'):
+        if (!ORThreadPlacement::SetPlacement(optarg)) {
+          ORLog(kError) << "Bad thread placement " << optarg << endl << Usage;
+          return 1;
+        }
+        doPlacement = true;
+        break;
+      case('N'):
+        maxSpanLength = abs(atoi(optarg));
+        break;
+      case('T'):
+        doTiming = true;
+        if (optarg != NULL) timingReportFile = optarg;
+        break;
+      case('C'): {
+        checkpointFile = optarg;
+        size_t iColon = checkpointFile.rfind(":");
+        if (iColon != string::npos) {
+          checkpointInterval = abs(atoi(checkpointFile.substr(iColon+1).c_str()));
+          checkpointFile = checkpointFile.substr(0, iColon);
+        }
+        break;
+      }
+      case('R'):
+        resume = true;
+        break;
+      case('A'):
+        useLogSink = true;
+        if (optarg == NULL || strcmp(optarg, "text") == 0) logSinkFormat = ORLogSink::kText;
+        else if (strcmp(optarg, "json") == 0) logSinkFormat = ORLogSink::kJSONLines;
+        else {
+          ORLog(kError) << "Unknown log format " << optarg << endl << Usage;
+          return 1;
+        }
+        break;
       default: // unrecognized option
         ORLog(kError) << Usage;
         return 1;
     }
   }
 
+  if (resume && checkpointFile == "") {
+    ORLog(kError) << "--resume needs a --checkpoint file" << endl << Usage;
+    return 1;
+  }
+  if (nShards > 1 && nJobs <= 1) nJobs = nShards;
+  if (checkpointFile != "" && nJobs > 1) {
+    ORLog(kError) << "--checkpoint can't be used with --jobs" << endl << Usage;
+    return 1;
+  }
+
   if (argc <= optind) {
     ORLog(kError) << "You must supply a filename or socket host:port" << endl
                   << Usage << endl;
     return 1;
   }
 
+  if (useLogSink) ORLogSink::Start(logSinkFormat);
   ORHandlerThread* handlerThread = new ORHandlerThread(); // new -tb-
   handlerThread->StartThread();                           // new -tb-
   bool useShaperDecoder  = true; // new -tb- 2008-02-19
@@ -222,13 +323,42 @@ int main(int argc, char** argv)
       ORLog(kRoutine) << "More than 1 inputs: Using all implemented decoders   ... " << endl;
     }    
     // END check for IPE Katrin Crate file -tb- 2008-02-19
+    vector<string> fileNames;
+    for (int i=optind; i<argc; i++) fileNames.push_back(argv[i]);
+    if (nJobs > 1) {
+      ORFileJobs jobs(nJobs);
+      jobs.SetNShards(nShards);
+      for (size_t i=0; i<fileNames.size(); i++) jobs.AddFile(fileNames[i]);
+      if (!jobs.ForkJobs(fileNames)) {
+        delete handlerThread;
+        bool isMerged = jobs.MergeShards(label);
+        return (jobs.GetNFailed() == 0 && jobs.GetNNotStarted() == 0 && isMerged) ? 0 : 1;
+      }
+      /* We are in a child process, with the files of one run, or a shard of it. */
+      shard = jobs.GetShard();
+      jobs.GetPacketRange(firstPacket, lastPacket);
+      label = jobs.GetShardLabel(label);
+      delete handlerThread;
+      /* The logger thread is not forked with the process. */
+      if (useLogSink) ORLogSink::Start(logSinkFormat);
+      handlerThread = new ORHandlerThread;
+      handlerThread->StartThread();
+    }
     reader = new ORFileReader;
-    for (int i=optind; i<argc; i++) {
-      ((ORFileReader*) reader)->AddFileToProcess(argv[i]);
+    for (size_t i=0; i<fileNames.size(); i++) {
+      ((ORFileReader*) reader)->AddFileToProcess(fileNames[i]);
+    }
+    if (shard >= 0) ((ORFileReader*) reader)->AddPacketRange(firstPacket, lastPacket);
+    if (ORThreadPlacement::HasLocalPlacement()) {
+      ORThreadPlacement::SetLocalNode(ORThreadPlacement::GetNodeOfFile(fileNames[0]));
     }
   } else {
     reader = new ORSocketReader(readerArg.substr(0, iColon).c_str(), 
                                 atoi(readerArg.substr(iColon+1).c_str()));
+    if (ORThreadPlacement::HasLocalPlacement()) {
+      ORThreadPlacement::SetLocalNode(ORThreadPlacement::GetNodeOfSocket(
+        ((ORSocketReader*) reader)->GetSocket()->GetDescriptor()));
+    }
     // stopper = new ORProcessStopper; //removed -tb-
   }
 
@@ -237,8 +367,21 @@ int main(int argc, char** argv)
     return 1;
   }
 
+  if (doPlacement) ORThreadPlacement::LogPlacement();
+
   ORLog(kRoutine) << "Setting up data processing manager..." << endl;
   ORDataProcManager dataProcManager(reader);
+  dataProcManager.SetMaxSpanLength(maxSpanLength);
+  if (doTiming) {
+    dataProcManager.SetTiming();
+    dataProcManager.SetTimingReportFile(timingReportFile);
+  }
+  /* Each shard only writes out what is in its own packets. */
+  if (shard >= 0) dataProcManager.SetSkipReplayedRecords();
+  if (checkpointFile != "") {
+    dataProcManager.SetCheckpointFile(checkpointFile, checkpointInterval);
+    if (resume && !dataProcManager.ResumeFromCheckpoint()) return 1;
+  }
 
   ORLog(kRoutine) << "Starting output file writer..." << endl;
   ORFileWriter fileWriter(label);
@@ -357,7 +500,7 @@ int main(int argc, char** argv)
 
   ORLog(kRoutine) << "Start processing..." << endl;
   //if(stopper != NULL) stopper->ExecuteStopperThread(); // removed -tb-
-  dataProcManager.ProcessDataStream();
+  ORDataProcessor::EReturnCode retCode = dataProcManager.ProcessDataStream();
   ORLog(kRoutine) << "Finished processing..." << endl;
 
 
@@ -366,6 +509,8 @@ int main(int argc, char** argv)
   delete handlerThread;
   //delete stopper;
 
+  /* With --jobs, the parent counts a failed run by the exit status. */
+  if (nJobs > 1 && retCode >= ORDataProcessor::kAlarm) return 1;
   return 0;
 }
 
@@ -2,6 +2,7 @@
 #include <getopt.h>
 #include <string>
 #include <fstream>
+#include <set>
 #include "ORDataProcManager.hh"
 #include "ORFileReader.hh"
 #include "ORLogger.hh"
@@ -31,6 +32,9 @@ static const char Usage[] =
 "  -f, --filepackets [file name] : get list of packets to dump from file.\n"
 "  -d, --device [device name] : dump packets only for one device.\n"
 "  -l, --linelength [words per line] : # of 32 bit words to print in each line.\n"
+"  -n, --noindex : read files from the start instead of jumping to the\n"
+"    requested packets with the packet index (see orindex), which is built\n"
+"    first if it is missing.\n"
 "\n"
 "Example usage:\n"
 "orhexdump run194ecpu\n"
@@ -66,7 +70,9 @@ int main(int argc, char** argv)
     {"packet", required_argument, 0, 'p'},
     {"filepackets", required_argument, 0, 'f'},
     {"device", required_argument, 0, 'd'},
-    {"linelength", required_argument, 0, 'l'}
+    {"linelength", required_argument, 0, 'l'},
+    {"noindex", no_argument, 0, 'n'},
+    {0, 0, 0, 0}
   };
 
   string label = "OR";
@@ -76,8 +82,9 @@ int main(int argc, char** argv)
   string filepackets = "";
   string device = "";
   UInt_t linelength = 0;
+  bool useIndex = true;
   while(1) {
-    char optId = getopt_long(argc, argv, "hv:b:e:p:f:", longOptions, NULL);
+    char optId = getopt_long(argc, argv, "hv:b:e:p:f:d:l:n", longOptions, NULL);
     if(optId == -1) break;
     switch(optId) {
       case('h'): // help
@@ -119,6 +126,9 @@ int main(int argc, char** argv)
       case('l'): // linelength
 	linelength=atoi(optarg);
 	break;
+      case('n'): // noindex
+        useIndex = false;
+        break;
       default: // unrecognized option
         ORLog(kError) << Usage;
         return 1;
@@ -131,13 +141,35 @@ int main(int argc, char** argv)
     return 1;
   }
 
+  set<Int_t> packetList;
+  if(filepackets != "") {
+    ifstream in(filepackets.c_str());
+    Int_t pkt;
+    while(in >> pkt) packetList.insert(pkt);
+  }
+
   string readerArg = argv[optind];
   size_t iColon = readerArg.find(":");
   if (iColon == string::npos) {
-    reader = new ORFileReader;
+    ORFileReader* fileReader = new ORFileReader;
     for (int i=optind; i<argc; i++) {
-      ((ORFileReader*) reader)->AddFileToProcess(argv[i]);
+      fileReader->AddFileToProcess(argv[i]);
     }
+    // Jump straight to the packets to be dumped
+    if(useIndex && (begin > 0 || end >= 0)) {
+      fileReader->AddPacketRange((begin < 0) ? 0 : begin, 
+                                 (end < 0) ? (ULong64_t) -1 : end);
+    }
+    else if(useIndex && !packetList.empty()) {
+      set<Int_t>::iterator iPacket = packetList.lower_bound(0);
+      while(iPacket != packetList.end()) {
+        Int_t first = *iPacket;
+        Int_t last = first;
+        while(++iPacket != packetList.end() && *iPacket == last+1) last++;
+        fileReader->AddPacketRange(first, last);
+      }
+    }
+    reader = fileReader;
   } else {
     reader = new ORSocketReader(readerArg.substr(0, iColon).c_str(), 
                                 atoi(readerArg.substr(iColon+1).c_str()));
@@ -153,10 +185,7 @@ int main(int argc, char** argv)
 
   ORHexDumpAllProc hexDumper;
   if(begin != -1 || end != -1) hexDumper.SetLimits(begin, end);
-  if(filepackets != "") {
-    ifstream in(filepackets.c_str());
-    hexDumper.SetPacketList(in);
-  }
+  if(!packetList.empty()) hexDumper.SetPacketList(packetList);
   if(device != "") hexDumper.AddDevice(device);
   if(linelength > 0) hexDumper.SetLineLength(linelength);
   dataProcManager.AddProcessor(&hexDumper);
@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <getopt.h>
+#include <string>
+#include "ORLogger.hh"
+#include "ORPacketIndex.hh"
+
+using namespace std;
+
+static const char Usage[] =
+"\n"
+"\n"
+"Usage: orindex [options] [input file(s)]\n"
+"\n"
+"Writes a packet index next to each of the given Orca files (file name\n"
+"with \".idx\" appended).  The index lets readers such as orhexdump jump\n"
+"straight to a given packet instead of reading the whole file up to it.\n"
+"Existing indices are rewritten.  Compressed files can't be indexed.\n"
+"\n"
+"Available options:\n"
+"  -h, --help : print this message and exit\n"
+"  -v, --verbosity [verbosity] : set the severity/verbosity for the logger.\n"
+"    Choices are: debug, trace, routine, warning, error, and fatal.\n"
+"  -t, --timestamp [device:low:high[:mask]] : also index the timestamps of\n"
+"    the records of device (data object path), assembled from the 32 bit\n"
+"    words low and high of each record as (high & mask) << 32 | low.\n"
+"    mask defaults to 0xffff.  May be given more than once.\n"
+"\n"
+"Example usage:\n"
+"orindex run194ecpu\n"
+"  Index local file run194ecpu.\n"
+"orindex --timestamp ORGretina4MModel:Gretina4M:3:4 run*\n"
+"  Index all files beginning with \"run\", including the timestamps of\n"
+"  the Gretina4M records.\n"
+"\n"
+"\n";
+
+
+int main(int argc, char** argv)
+{
+  if(argc == 1) {
+    ORLog(kError) << "You must supply some options" << endl << Usage;
+    return 1;
+  }
+
+  static struct option longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"verbosity", required_argument, 0, 'v'},
+    {"timestamp", required_argument, 0, 't'},
+    {0, 0, 0, 0}
+  };
+
+  ORPacketIndex index;
+  while(1) {
+    char optId = getopt_long(argc, argv, "hv:t:", longOptions, NULL);
+    if(optId == -1) break;
+    switch(optId) {
+      case('h'): // help
+        cout << Usage;
+        return 0;
+      case('v'): // verbosity
+        if(strcmp(optarg, "debug") == 0) ORLogger::SetSeverity(ORLogger::kDebug);
+        else if(strcmp(optarg, "trace") == 0) ORLogger::SetSeverity(ORLogger::kTrace);
+        else if(strcmp(optarg, "routine") == 0) ORLogger::SetSeverity(ORLogger::kRoutine);
+        else if(strcmp(optarg, "warning") == 0) ORLogger::SetSeverity(ORLogger::kWarning);
+        else if(strcmp(optarg, "error") == 0) ORLogger::SetSeverity(ORLogger::kError);
+        else if(strcmp(optarg, "fatal") == 0) ORLogger::SetSeverity(ORLogger::kFatal);
+        else {
+          ORLog(kWarning) << "Unknown verbosity setting " << optarg 
+                          << "; using kRoutine" << endl;
+          ORLogger::SetSeverity(ORLogger::kRoutine);
+        }
+        break;
+      case('t'): { // timestamp
+        // device:low:high[:mask], where the device contains a colon itself
+        string source = optarg;
+        size_t iLow = source.find(":", source.find(":")+1);
+        size_t iHigh = (iLow == string::npos) ? iLow : source.find(":", iLow+1);
+        if(iHigh == string::npos) {
+          ORLog(kError) << "Bad timestamp source " << optarg << endl << Usage;
+          return 1;
+        }
+        size_t iMask = source.find(":", iHigh+1);
+        UInt_t mask = 0xffff;
+        if(iMask != string::npos) mask = strtoul(source.c_str() + iMask + 1, NULL, 0);
+        index.AddTimestampSource(source.substr(0, iLow), 
+                                 atoi(source.c_str() + iLow + 1), 
+                                 atoi(source.c_str() + iHigh + 1), mask);
+        break;
+      }
+      default: // unrecognized option
+        ORLog(kError) << Usage;
+        return 1;
+    }
+  }
+
+  if (argc <= optind) {
+    ORLog(kError) << "You must supply a filename" << endl << Usage << endl;
+    return 1;
+  }
+
+  int nFailed = 0;
+  for (int i=optind; i<argc; i++) {
+    ORLog(kRoutine) << "Indexing " << argv[i] << "..." << endl;
+    if(!index.Build(argv[i])) {
+      ORLog(kError) << "Could not index " << argv[i] << endl;
+      nFailed++;
+    }
+  }
+
+  return (nFailed == 0) ? 0 : 1;
+}
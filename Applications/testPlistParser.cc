@@ -0,0 +1,134 @@
+// testPlistParser.cc
+//
+// Loads a header with elements that neither parser supports (date, data),
+// in a dictionary and in an array, with ROOT's TDOMParser, as ORXmlPlist
+// used to, and with ORPlistParser, and checks that both give the same
+// dictionary: the unsupported elements are kept as NULL entries, so that
+// the elements after them in an array keep their indices.
+
+#include <string>
+
+#include "ORLogger.hh"
+#include "ORPlistParser.hh"
+#include "ORXmlPlist.hh"
+#include "TString.h"
+
+using namespace std;
+
+static const char Header[] =
+"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+"<plist version=\"1.0\">\n"
+"<dict>\n"
+"	<key>Document Info</key>\n"
+"	<dict>\n"
+"		<key>date</key>\n"
+"		<date>2010-02-17T10:00:00Z</date>\n"
+"		<key>documentName</key>\n"
+"		<string>~/run194.Orca</string>\n"
+"	</dict>\n"
+"	<key>Run Control</key>\n"
+"	<dict>\n"
+"		<key>RunNumber</key>\n"
+"		<integer>194</integer>\n"
+"		<key>notes</key>\n"
+"		<data>AAECAw==</data>\n"
+"		<key>quickStart</key>\n"
+"		<true/>\n"
+"	</dict>\n"
+"	<key>Thresholds</key>\n"
+"	<array>\n"
+"		<integer>10</integer>\n"
+"		<data>AAECAw==</data>\n"
+"		<integer>30</integer>\n"
+"		<date>2010-02-17T10:00:00Z</date>\n"
+"		<real>4.5</real>\n"
+"	</array>\n"
+"</dict>\n"
+"</plist>\n";
+
+//! Returns the path of the first difference of value and other, "" if none.
+static string Compare(const ORVDictValue* value, const ORVDictValue* other,
+                      const string& path)
+{
+  if (value == NULL || other == NULL) {
+    return (value == other) ? "" : path;
+  }
+  if (value->GetValueType() != other->GetValueType()) return path;
+  if (value->IsA(ORVDictValue::kDict)) {
+    const ORDictionary::DictMap& map = ((const ORDictionary*) value)->GetDictMap();
+    const ORDictionary::DictMap& otherMap = ((const ORDictionary*) other)->GetDictMap();
+    if (map.size() != otherMap.size()) return path;
+    ORDictionary::DictMap::const_iterator entry, otherEntry = otherMap.begin();
+    for (entry = map.begin(); entry != map.end(); entry++, otherEntry++) {
+      if (entry->first != otherEntry->first) return path + ":" + entry->first;
+      string difference = Compare(entry->second, otherEntry->second,
+                                  path + ":" + entry->first);
+      if (difference != "") return difference;
+    }
+    return "";
+  }
+  if (value->IsA(ORVDictValue::kArray)) {
+    const ORDictValueA* array = (const ORDictValueA*) value;
+    const ORDictValueA* otherArray = (const ORDictValueA*) other;
+    if (array->GetNValues() != otherArray->GetNValues()) return path;
+    for (size_t i = 0; i < array->GetNValues(); i++) {
+      string difference = Compare(array->At(i), otherArray->At(i),
+                                  path + ::Form("[%d]", (int) i));
+      if (difference != "") return difference;
+    }
+    return "";
+  }
+  return (value->GetStringOfValue() == other->GetStringOfValue()) ? "" : path;
+}
+
+int main()
+{
+  string header = Header;
+
+  // ORXmlPlist warns at every load that validation is disabled
+  ORLogger::SetSeverity(ORLogger::kError);
+  ORXmlPlist domPlist;
+  domPlist.UseDOMParser();
+  if (!domPlist.LoadXmlPlist(header.data(), header.size())) {
+    ORLog(kError) << "TDOMParser could not load the header" << endl;
+    return 1;
+  }
+  ORDictionary dictionary("rootDict");
+  ORPlistParser parser;
+  if (!parser.Parse(header.data(), header.size(), &dictionary)) {
+    ORLog(kError) << parser.GetError() << endl;
+    return 1;
+  }
+  ORLogger::SetSeverity(ORLogger::kRoutine);
+
+  string difference = Compare(domPlist.GetDictionary(), &dictionary, "");
+  if (difference != "") {
+    ORLog(kError) << "The parsers give different values for " << difference << endl;
+    return 1;
+  }
+
+  const ORDictValueA* thresholds = (const ORDictValueA*) dictionary.LookUp("Thresholds");
+  if (thresholds == NULL || thresholds->GetNValues() != 5 ||
+      thresholds->At(1) != NULL || thresholds->At(3) != NULL ||
+      thresholds->At(2) == NULL || thresholds->At(2)->GetStringOfValue() != "30") {
+    ORLog(kError) << "The unsupported elements of Thresholds were not kept as NULL" << endl;
+    return 1;
+  }
+  const ORDictionary* runControl = (const ORDictionary*) dictionary.LookUp("Run Control");
+  if (runControl == NULL || runControl->GetDictMap().count("notes") != 1 ||
+      runControl->LookUp("notes") != NULL || runControl->LookUp("quickStart") == NULL) {
+    ORLog(kError) << "The unsupported entry Run Control:notes was not kept as NULL" << endl;
+    return 1;
+  }
+
+  // copies keep the NULL entries too
+  ORDictionary copy(dictionary);
+  difference = Compare(&dictionary, &copy, "");
+  if (difference != "") {
+    ORLog(kError) << "The copy differs in " << difference << endl;
+    return 1;
+  }
+
+  ORLog(kRoutine) << "Both parsers give the same dictionary" << endl;
+  return 0;
+}
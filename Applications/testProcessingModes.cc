@@ -0,0 +1,278 @@
+// testProcessingModes.cc
+//
+// Checks that processing in spans of records (see
+// ORDataProcManager::SetMaxSpanLength()) and swapping records in the
+// reader (SetSwapInReader()) give the processors the same records, swapped
+// the same way and in the same order, as processing record by record.
+// The given files are processed once in each mode with a checksumming
+// processor for every data object path in their headers, plus one that
+// checksums the whole stream together with the run state, and the
+// checksums of the passes are compared.
+
+#include <stdlib.h>
+#include <getopt.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+#include "ORBasicDataDecoder.hh"
+#include "ORDataProcManager.hh"
+#include "ORDictionary.hh"
+#include "ORFileReader.hh"
+#include "ORHeader.hh"
+#include "ORHeaderDecoder.hh"
+#include "ORLogger.hh"
+#include "ORRunContext.hh"
+#include "ORUtilityProcessor.hh"
+
+using namespace std;
+
+static const char Usage[] =
+"\n"
+"Usage: testProcessingModes [options] [input file(s)]\n"
+"\n"
+"Processes the given Orca files serially, in spans of records and swapped\n"
+"by the reader, and checks that the processors see the same records in all.\n"
+"\n"
+"Available options:\n"
+"  --help : print this message and exit\n"
+"  --span [num] : maximum span length of the span pass (default 64)\n"
+"\n";
+
+//! FNV-1a, on 32 bit words.
+static inline ULong64_t AddToChecksum(ULong64_t checksum, UInt_t word)
+{
+  return (checksum ^ word) * 1099511628211ULL;
+}
+
+static const ULong64_t kChecksumStart = 14695981039346656037ULL;
+
+class ORPathDecoder : public ORBasicDataDecoder
+{
+  public:
+    ORPathDecoder(const string& path) : fPath(path) {}
+    virtual string GetDataObjectPath() { return fPath; }
+
+  protected:
+    string fPath;
+};
+
+//! Checksums the records of one data object path, as its processors see them.
+class ORChecksumProcessor : public ORDataProcessor
+{
+  public:
+    ORChecksumProcessor(const string& path) : ORDataProcessor(new ORPathDecoder(path))
+      { fChecksum = kChecksumStart; fNRecords = 0; }
+    virtual ~ORChecksumProcessor() { delete fDataDecoder; }
+
+    virtual EReturnCode ProcessMyDataRecord(UInt_t* record)
+    {
+      fChecksum = AddToChecksum(fChecksum, GetRunContext()->GetPacketNumber());
+      UInt_t length = fDataDecoder->LengthOf(record);
+      for (UInt_t i = 0; i < length; i++) fChecksum = AddToChecksum(fChecksum, record[i]);
+      fNRecords++;
+      return kSuccess;
+    }
+    virtual ULong64_t GetChecksum() const { return fChecksum; }
+    virtual size_t GetNRecords() const { return fNRecords; }
+
+  protected:
+    ULong64_t fChecksum;
+    size_t fNRecords;
+};
+
+//! Checksums the whole stream, together with the run state at each record.
+class ORStreamChecksum : public ORUtilityProcessor
+{
+  public:
+    ORStreamChecksum() { fChecksum = kChecksumStart; fNRecords = 0; fNRuns = 0; }
+
+    virtual EReturnCode StartRun() { fNRuns++; return kSuccess; }
+    virtual EReturnCode ProcessDataRecord(UInt_t* record)
+    {
+      const ORRunContext* context = GetRunContext();
+      fChecksum = AddToChecksum(fChecksum, context->GetRunNumber());
+      fChecksum = AddToChecksum(fChecksum, context->GetSubRunNumber());
+      fChecksum = AddToChecksum(fChecksum, context->GetState());
+      fChecksum = AddToChecksum(fChecksum, context->GetPacketNumber());
+      UInt_t length = fDecoder.LengthOf(record);
+      for (UInt_t i = 0; i < length; i++) fChecksum = AddToChecksum(fChecksum, record[i]);
+      fNRecords++;
+      return kSuccess;
+    }
+    virtual ULong64_t GetChecksum() const { return fChecksum; }
+    virtual size_t GetNRecords() const { return fNRecords; }
+    virtual size_t GetNRuns() const { return fNRuns; }
+
+  protected:
+    ORBasicDataDecoder fDecoder;
+    ULong64_t fChecksum;
+    size_t fNRecords;
+    size_t fNRuns;
+};
+
+struct PassResult {
+  map<string, ULong64_t> fChecksums;
+  map<string, size_t> fNRecords;
+  size_t fNRuns;
+  double fSeconds;
+};
+
+static double Now()
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + 1.e-6*now.tv_usec;
+}
+
+//! Adds the data object paths in the header of file to paths.
+static bool GetDataObjectPaths(const string& file, set<string>& paths)
+{
+  ORFileReader reader(file);
+  vector<UInt_t> buffer;
+  ORHeaderDecoder headerDecoder;
+  if (!reader.Open() || !reader.ReadRecord(buffer) ||
+      !headerDecoder.IsHeader(buffer[0])) {
+    ORLog(kError) << "Couldn't read the header of " << file << endl;
+    return false;
+  }
+  size_t nBytes = headerDecoder.NBytesOf(&buffer[0]);
+  ORHeader header(headerDecoder.HeaderStringOf(&buffer[0]), (nBytes < 8) ? 0 : nBytes - 8);
+  reader.Close();
+
+  ORDictionary* dataDescDict = (ORDictionary*) header.LookUp("dataDescription");
+  if (dataDescDict == NULL) {
+    ORLog(kError) << "No dataDescription in the header of " << file << endl;
+    return false;
+  }
+  const ORDictionary::DictMap& dataDescMap = dataDescDict->GetDictMap();
+  ORDictionary::DictMap::const_iterator i;
+  for (i = dataDescMap.begin(); i != dataDescMap.end(); i++) {
+    const ORDictionary::DictMap& deviceDictMap = ((ORDictionary*) i->second)->GetDictMap();
+    ORDictionary::DictMap::const_iterator j;
+    for (j = deviceDictMap.begin(); j != deviceDictMap.end(); j++) {
+      paths.insert(i->first + ":" + j->first);
+    }
+  }
+  return true;
+}
+
+static bool RunPass(const vector<string>& files, const set<string>& paths,
+                    size_t maxSpanLength, bool swapInReader,
+                    PassResult& result)
+{
+  ORFileReader reader;
+  for (size_t i = 0; i < files.size(); i++) reader.AddFileToProcess(files[i]);
+  ORDataProcManager manager(&reader);
+  manager.SetMaxSpanLength(maxSpanLength);
+  manager.SetSwapInReader(swapInReader);
+
+  vector<ORChecksumProcessor*> processors;
+  for (set<string>::const_iterator path = paths.begin(); path != paths.end(); path++) {
+    processors.push_back(new ORChecksumProcessor(*path));
+    manager.AddProcessor(processors.back());
+  }
+  ORStreamChecksum streamChecksum;
+  manager.AddProcessor(&streamChecksum);
+
+  double start = Now();
+  ORDataProcessor::EReturnCode retCode = manager.ProcessDataStream();
+  result.fSeconds = Now() - start;
+
+  set<string>::const_iterator path = paths.begin();
+  for (size_t i = 0; i < processors.size(); i++, path++) {
+    result.fChecksums[*path] = processors[i]->GetChecksum();
+    result.fNRecords[*path] = processors[i]->GetNRecords();
+    manager.RemoveProcessor(processors[i]);
+    delete processors[i];
+  }
+  result.fChecksums["(stream)"] = streamChecksum.GetChecksum();
+  result.fNRecords["(stream)"] = streamChecksum.GetNRecords();
+  result.fNRuns = streamChecksum.GetNRuns();
+  return retCode < ORDataProcessor::kAlarm;
+}
+
+//! Compares the checksums of a pass with those of the serial pass.
+static bool CompareToSerial(PassResult& serial, PassResult& other, const string& mode)
+{
+  bool isSame = (serial.fNRuns == other.fNRuns);
+  map<string, ULong64_t>::const_iterator it;
+  for (it = serial.fChecksums.begin(); it != serial.fChecksums.end(); it++) {
+    const string& path = it->first;
+    bool pathIsSame = (it->second == other.fChecksums[path] &&
+                       serial.fNRecords[path] == other.fNRecords[path]);
+    if (!pathIsSame || serial.fNRecords[path] > 0) {
+      ORLog(kRoutine) << (pathIsSame ? "same     " : "DIFFERENT") << " " << path
+                      << ": " << serial.fNRecords[path] << " / "
+                      << other.fNRecords[path] << " records " << mode << endl;
+    }
+    isSame = isSame && pathIsSame;
+  }
+  if (!isSame) {
+    ORLog(kError) << "Processing " << mode << " differs from the serial mode" << endl;
+  }
+  return isSame;
+}
+
+int main(int argc, char** argv)
+{
+  static struct option longOptions[] = {
+    {"help", no_argument, 0, 'h'},
+    {"span", required_argument, 0, 's'},
+    {0, 0, 0, 0}
+  };
+
+  size_t maxSpanLength = 64;
+  while (1) {
+    int optId = getopt_long(argc, argv, "", longOptions, NULL);
+    if (optId == -1) break;
+    switch (optId) {
+      case('h'):
+        cout << Usage;
+        return 0;
+      case('s'):
+        maxSpanLength = abs(atoi(optarg));
+        break;
+      default:
+        ORLog(kError) << Usage;
+        return 1;
+    }
+  }
+  if (argc <= optind) {
+    ORLog(kError) << "You must supply a file name" << endl << Usage;
+    return 1;
+  }
+
+  vector<string> files;
+  set<string> paths;
+  for (int i = optind; i < argc; i++) {
+    files.push_back(argv[i]);
+    if (!GetDataObjectPaths(argv[i], paths)) return 1;
+  }
+
+  PassResult serial, spans, swappedByReader;
+  if (!RunPass(files, paths, 1, false, serial)) {
+    ORLog(kError) << "Serial processing failed" << endl;
+    return 1;
+  }
+  if (!RunPass(files, paths, maxSpanLength, false, spans)) {
+    ORLog(kError) << "Processing in spans failed" << endl;
+    return 1;
+  }
+  if (!RunPass(files, paths, 1, true, swappedByReader)) {
+    ORLog(kError) << "Processing records swapped by the reader failed" << endl;
+    return 1;
+  }
+
+  bool isSame = CompareToSerial(serial, spans, "in spans");
+  isSame = CompareToSerial(serial, swappedByReader, "swapped by the reader") && isSame;
+  ORLog(kRoutine) << serial.fNRuns << " runs; serial " << serial.fSeconds
+                  << " s, in spans (of up to " << maxSpanLength
+                  << " records) " << spans.fSeconds << " s, swapped by the reader "
+                  << swappedByReader.fSeconds << " s" << endl;
+  if (!isSame) return 1;
+  ORLog(kRoutine) << "All modes give the same results as the serial mode" << endl;
+  return 0;
+}
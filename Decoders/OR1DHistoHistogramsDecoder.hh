@@ -14,6 +14,7 @@ class OR1DHistoHistogramsDecoder : public ORVDataDecoder
  
     
     virtual void Swap(UInt_t* dataRecord);
+    virtual bool HasDefaultSwap() { return false; }
     /* Overloading Swap for 1Dhisto. */
 
     virtual inline UInt_t NKeyWordsOf(UInt_t* record) { return record[1]; }
@@ -15,6 +15,7 @@ class ORAD3511ADCDecoder : public ORVHistDecoder, public ORVBasicRDTreeDecoder
     virtual ~ORAD3511ADCDecoder() {}
 
     virtual void Swap(UInt_t* dataRecord);
+    virtual bool HasDefaultSwap() { return false; }
     /* Handling the correct swapping for this record. */
     virtual inline bool HasReferenceDate(UInt_t* record)
       { return bool(record[1] & 0x02000000); }
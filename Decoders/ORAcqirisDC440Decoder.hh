@@ -40,6 +40,7 @@ class ORAcqirisDC440Decoder: public ORVDigitizerDecoder
     virtual std::string GetDataObjectPath() { return "ORAcqirisDC440Model:Waveform"; }  
     virtual std::string GetDictionaryObjectPath() { return "ORAcqirisDC440Model"; }  
     virtual void Swap(UInt_t* dataRecord);
+    virtual bool HasDefaultSwap() { return false; }
     /* Overloading swap, this is a 16-bit style record. */
     virtual bool SetDataRecord(UInt_t* record);
        
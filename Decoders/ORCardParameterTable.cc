@@ -0,0 +1,144 @@
+// ORCardParameterTable.cc
+
+#include <stdlib.h>
+#include <algorithm>
+#include "ORCardParameterTable.hh"
+#include "ORDecoderDictionary.hh"
+#include "ORLogger.hh"
+
+using namespace std;
+
+void ORCardParameterTable::Declare(size_t par, const string& key, EType type,
+                                   bool isPerChannel, Double_t defaultValue)
+{
+  if (par >= fKeys.size()) {
+    fKeys.resize(par+1);
+    fTypes.resize(par+1, kInt);
+    fIsPerChannel.resize(par+1, false);
+    fDefaultValues.resize(par+1, 0.);
+  }
+  fKeys[par] = key;
+  fTypes[par] = type;
+  fIsPerChannel[par] = isPerChannel;
+  fDefaultValues[par] = defaultValue;
+  Allocate(fNCrates, fNCards);
+}
+
+void ORCardParameterTable::Allocate(UInt_t nCrates, UInt_t nCards)
+{
+  fNCrates = nCrates;
+  fNCards = nCards;
+  size_t nPars = fKeys.size();
+  fOffsets.resize(nPars);
+  fDefaults.resize(nPars);
+  size_t nInts = 0, nReals = 0;
+  for (size_t par = 0; par < nPars; par++) {
+    size_t& n = (fTypes[par] == kReal) ? nReals : nInts;
+    fOffsets[par] = n;
+    n += fNCrates*fNCards*(fIsPerChannel[par] ? fNChannels : 1);
+    fDefaults[par] = n;
+    n++;
+  }
+  fInts.assign(nInts, 0);
+  fReals.assign(nReals, 0.);
+  for (size_t par = 0; par < nPars; par++) {
+    if (fTypes[par] == kReal) {
+      fill(fReals.begin() + fOffsets[par], fReals.begin() + fDefaults[par] + 1,
+           fDefaultValues[par]);
+    }
+    else {
+      fill(fInts.begin() + fOffsets[par], fInts.begin() + fDefaults[par] + 1,
+           (Int_t) fDefaultValues[par]);
+    }
+  }
+}
+
+bool ORCardParameterTable::SetValue(size_t par, size_t i, const ORVDictValue* value)
+{
+  Double_t number;
+  if (value->IsA(ORVDictValue::kInt)) {
+    number = static_cast<const ORDictValueI*>(value)->GetI();
+  }
+  else if (value->IsA(ORVDictValue::kReal)) {
+    number = static_cast<const ORDictValueR*>(value)->GetR();
+  }
+  else if (value->IsA(ORVDictValue::kBool)) {
+    number = static_cast<const ORDictValueB*>(value)->GetB();
+  }
+  else return false;
+
+  if (fTypes[par] == kReal) fReals[i] = number;
+  else if (fTypes[par] == kBool) fInts[i] = (number != 0.);
+  else fInts[i] = (Int_t) number;
+  return true;
+}
+
+void ORCardParameterTable::Resolve(const ORDecoderDictionary* dict)
+{
+  // the crates and cards are the numbered keys of the dictionary
+  vector< pair<UInt_t, const ORDictionary*> > crates;
+  UInt_t nCrates = 0, nCards = 0;
+  if (dict && !fKeys.empty()) {
+    const ORDictionary::DictMap& crateMap = dict->GetDictMap();
+    ORDictionary::DictMap::const_iterator iCrate;
+    for (iCrate = crateMap.begin(); iCrate != crateMap.end(); iCrate++) {
+      UInt_t crate = atoi(iCrate->first.c_str());
+      const ORDictionary* crateDict = dynamic_cast<const ORDictionary*>(iCrate->second);
+      if (crateDict == NULL || crate >= kMaxCrates) continue;
+      crates.push_back(make_pair(crate, crateDict));
+      if (crate >= nCrates) nCrates = crate+1;
+      const ORDictionary::DictMap& cardMap = crateDict->GetDictMap();
+      ORDictionary::DictMap::const_iterator iCard;
+      for (iCard = cardMap.begin(); iCard != cardMap.end(); iCard++) {
+        UInt_t card = atoi(iCard->first.c_str());
+        if (card < kMaxCards && card >= nCards) nCards = card+1;
+      }
+    }
+  }
+  Allocate(nCrates, nCards);
+  if (crates.empty()) return;
+
+  for (size_t par = 0; par < fKeys.size(); par++) {
+    if (fKeys[par] == "") continue;
+    ORDictPath key(fKeys[par]);
+    size_t nMissing = 0, nCardsFound = 0;
+    for (size_t iCrate = 0; iCrate < crates.size(); iCrate++) {
+      UInt_t crate = crates[iCrate].first;
+      const ORDictionary::DictMap& cardMap = crates[iCrate].second->GetDictMap();
+      ORDictionary::DictMap::const_iterator iCard;
+      for (iCard = cardMap.begin(); iCard != cardMap.end(); iCard++) {
+        UInt_t card = atoi(iCard->first.c_str());
+        const ORDictionary* cardDict = dynamic_cast<const ORDictionary*>(iCard->second);
+        if (cardDict == NULL || card >= kMaxCards) continue;
+        nCardsFound++;
+        const ORVDictValue* value = cardDict->LookUp(key);
+        if (!fIsPerChannel[par]) {
+          if (!value || !SetValue(par, fOffsets[par] + crate*fNCards + card, value)) {
+            nMissing++;
+          }
+          continue;
+        }
+        size_t first = fOffsets[par] + (crate*fNCards + card)*fNChannels;
+        if (value && value->IsA(ORVDictValue::kArray)) {
+          // channels beyond the array, or not numbers, keep the default
+          const ORDictValueA* array = static_cast<const ORDictValueA*>(value);
+          for (size_t ch = 0; ch < fNChannels && ch < array->GetNValues(); ch++) {
+            SetValue(par, first + ch, array->At(ch));
+          }
+        }
+        else if (value && SetValue(par, first, value)) {
+          for (size_t ch = 1; ch < fNChannels; ch++) {
+            if (fTypes[par] == kReal) fReals[first + ch] = fReals[first];
+            else fInts[first + ch] = fInts[first];
+          }
+        }
+        else nMissing++;
+      }
+    }
+    if (nMissing > 0) {
+      ORLog(kWarning) << fKeys[par] << " not found for " << nMissing << " of "
+                      << nCardsFound << " cards of " << dict->GetName()
+                      << ", using " << fDefaultValues[par] << std::endl;
+    }
+  }
+}
@@ -0,0 +1,115 @@
+// ORCardParameterTable.hh
+
+#ifndef _ORCardParameterTable_hh_
+#define _ORCardParameterTable_hh_
+
+#include <string>
+#include <vector>
+#ifndef ROOT_Rtypes
+#include "Rtypes.h"
+#endif
+
+class ORDecoderDictionary;
+class ORVDictValue;
+
+//! Hardware parameters of a decoder, looked up once per run
+/*!
+   A decoder declares the parameters it needs from its hardware dictionary
+   once, typically in its constructor, each with its key, its type and
+   whether it is per card or per channel (an array with a value for each
+   channel):
+
+   \verbatim
+   fCardParameters.SetNChannels(16);
+   fCardParameters.Declare(kIntTime, "Integration Time", ORCardParameterTable::kInt);
+   fCardParameters.Declare(kPreRECnt, "Prerecnt", ORCardParameterTable::kInt, true);
+   \endverbatim
+
+   When the decoder dictionary is set (see
+   ORVDataDecoder::SetDecoderDictionary()), Resolve() looks the values up
+   for every crate and card in it and stores them in flat arrays, so that
+
+   \verbatim
+   fCardParameters.GetInt(kPreRECnt, CrateOf(), CardOf(), channel)
+   \endverbatim
+
+   is an array index, with no strings, maps or casts.  A value that is
+   missing, or a crate, card or channel out of range, gives the default of
+   the parameter (0 unless given to Declare()).  Missing values are
+   reported once per parameter by Resolve(), not on every access.  A per
+   channel parameter whose value is not an array has that value for all
+   channels.
+ */
+class ORCardParameterTable
+{
+  public:
+    enum EType { kInt, kReal, kBool };
+    enum EMax { kMaxCrates = 16, kMaxCards = 32 }; // from the crate and card bits of a record
+
+    ORCardParameterTable() : fNChannels(1), fNCrates(0), fNCards(0) {}
+    virtual ~ORCardParameterTable() {}
+
+    //! Channels per card of per channel parameters (default 1).
+    virtual void SetNChannels(size_t nChannels)
+      { fNChannels = nChannels ? nChannels : 1; Allocate(fNCrates, fNCards); }
+    virtual size_t GetNChannels() const { return fNChannels; }
+
+    //! Declares parameter par (an enum of the decoder) as the value of key.
+    virtual void Declare(size_t par, const std::string& key, EType type,
+                         bool isPerChannel = false, Double_t defaultValue = 0.);
+    virtual size_t GetNParameters() const { return fKeys.size(); }
+
+    /*!
+       Looks the declared parameters up for all cards of dict, replacing
+       the values of a previous dictionary; with dict NULL all parameters
+       give their defaults.
+     */
+    virtual void Resolve(const ORDecoderDictionary* dict);
+
+    inline Int_t GetInt(size_t par, UInt_t crate, UInt_t card, UInt_t channel = 0) const
+    {
+      if (par >= fTypes.size()) return 0;
+      size_t i = IndexOf(par, crate, card, channel);
+      if (fTypes[par] == kReal) return (Int_t) fReals[i];
+      return fInts[i];
+    }
+    inline Double_t GetReal(size_t par, UInt_t crate, UInt_t card, UInt_t channel = 0) const
+    {
+      if (par >= fTypes.size()) return 0.;
+      size_t i = IndexOf(par, crate, card, channel);
+      if (fTypes[par] == kReal) return fReals[i];
+      return fInts[i];
+    }
+    inline Bool_t GetBool(size_t par, UInt_t crate, UInt_t card, UInt_t channel = 0) const
+    { return GetInt(par, crate, card, channel) != 0; }
+
+  protected:
+    //! Index of the value of declared parameter par, or of its default if out of range.
+    inline size_t IndexOf(size_t par, UInt_t crate, UInt_t card, UInt_t channel) const
+    {
+      size_t stride = 1;
+      if (fIsPerChannel[par]) stride = fNChannels;
+      else channel = 0;
+      if (crate >= fNCrates || card >= fNCards || channel >= stride) return fDefaults[par];
+      return fOffsets[par] + (crate*fNCards + card)*stride + channel;
+    }
+    //! Sizes the arrays for nCrates x nCards, all values set to their defaults.
+    virtual void Allocate(UInt_t nCrates, UInt_t nCards);
+    //! Stores value at index i of parameter par; false if its type does not fit.
+    virtual bool SetValue(size_t par, size_t i, const ORVDictValue* value);
+
+  protected:
+    size_t fNChannels;
+    UInt_t fNCrates;
+    UInt_t fNCards;
+    std::vector<std::string> fKeys;
+    std::vector<Int_t> fTypes;
+    std::vector<Bool_t> fIsPerChannel;
+    std::vector<Double_t> fDefaultValues;
+    std::vector<size_t> fOffsets;  //! index of the first value of each parameter
+    std::vector<size_t> fDefaults; //! index of the default, after the values
+    std::vector<Int_t> fInts;      //! values of kInt and kBool parameters
+    std::vector<Double_t> fReals;  //! values of kReal parameters
+};
+
+#endif
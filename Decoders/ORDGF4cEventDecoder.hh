@@ -21,6 +21,7 @@ class ORDGF4cEventDecoder: public ORVDigitizerDecoder
     virtual std::string GetDataObjectPath() { return "ORDGF4cModel:Event"; }
     virtual std::string GetDictionaryObjectPath() { return "ORDGF4cModel"; }
     virtual void Swap(UInt_t* dataRecord);
+    virtual bool HasDefaultSwap() { return false; }
     /* Overloading swap, this is a 16-bit style record. */
     virtual bool SetDataRecord(UInt_t* record);
        
@@ -5,6 +5,13 @@
 
 using namespace std;
 
+ORGretina4ADecoder::ORGretina4ADecoder()
+{
+  // decimationFactor is a single value for the card, or one per channel
+  fCardParameters.SetNChannels(16);
+  fCardParameters.Declare(kDSFact, "decimationFactor", ORCardParameterTable::kInt, true);
+}
+
 bool ORGretina4ADecoder::SetDataRecord(UInt_t* dataRecord) 
 {
   fEvPtrs.clear();
@@ -34,48 +41,3 @@ bool ORGretina4ADecoder::SetDataRecord(UInt_t* dataRecord)
   
   return true;
 }
-
-void ORGretina4ADecoder::SetDecoderDictionary(const ORDecoderDictionary* dict)
-{
-  ORVDataDecoder::SetDecoderDictionary(dict);
-  for(UInt_t iPar = 0; iPar < kNPars; iPar++) fCardPars[iPar].clear();
-}
-
-UInt_t ORGretina4ADecoder::GetParameter(EParameters par, UInt_t crate, UInt_t card, UInt_t channel)
-{
-  if(par >= kNPars) return 0;
-  
-  UInt_t ccc = (crate << 12) + (card << 4) + channel; // 0xfffff000 + 0xff0 + 0xf
-  map<UInt_t, UInt_t>::iterator iter = fCardPars[par].find(ccc);
-  
-  //return if found
-  if(iter != fCardPars[par].end()) return iter->second;
-  
-  // otherwise we have to look up the info from the header
-  // first find a key
-  const char* key = "";
-  switch(par) {
-  case kDSFact : key = "decimationFactor"; break;
-
-  default:
-    ORLog(kError) << "Unknown card parameter " << par << endl;
-    return (UInt_t) -1;
-  }
-
-  // now pull out the value for the key
-  UInt_t value = 0;
-  const ORVDictValue* val = GetValueFromKey(key, crate, card);
-  if(!val)
-    value = 0;
-  else if(val->IsA(ORVDictValue::kInt))
-    value = static_cast<const ORDictValueI*>(val)->GetI();
-  else if(val->IsA(ORVDictValue::kArray)) {
-    const ORDictValueA* arr = static_cast<const ORDictValueA*>(val);
-    if(channel > arr->GetNValues() || !arr->At(channel)->IsA(ORVDictValue::kInt)) value = 0;
-    else value = static_cast<const ORDictValueI*>(arr->At(channel))->GetI();
-  }
-  
-  // cache locally and return
-  fCardPars[par][ccc] = value;
-  return value;
-}
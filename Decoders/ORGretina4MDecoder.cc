@@ -12,6 +12,18 @@ const UInt_t ORGretina4MDecoder::kPSDivider[] = {1, 2, 4, 8};
 
 ORGretina4MDecoder::ORGretina4MDecoder() 
 {
+  fCardParameters.SetNChannels(16);
+  fCardParameters.Declare(kIntTime, "Integration Time", ORCardParameterTable::kInt);
+  fCardParameters.Declare(kDownSample, "Down Sample", ORCardParameterTable::kInt);
+  fCardParameters.Declare(kChPreSum, "Chpsrt", ORCardParameterTable::kInt, true);
+  fCardParameters.Declare(kChPreSumDiv, "Chpsdv", ORCardParameterTable::kInt, true);
+  fCardParameters.Declare(kMRPreSum, "Mrpsrt", ORCardParameterTable::kInt, true);
+  fCardParameters.Declare(kMRPreSumDiv, "Mrpsdv", ORCardParameterTable::kInt, true);
+  fCardParameters.Declare(kEnabled, "Enabled", ORCardParameterTable::kInt, true);
+  fCardParameters.Declare(kPSEnabled, "PreSum Enabled", ORCardParameterTable::kInt, true);
+  fCardParameters.Declare(kPreRECnt, "Prerecnt", ORCardParameterTable::kInt, true);
+  fCardParameters.Declare(kPostRECnt, "Postrecnt", ORCardParameterTable::kInt, true);
+  fCardParameters.Declare(kFTCnt, "FtCnt", ORCardParameterTable::kInt, true);
 }
 
 bool ORGretina4MDecoder::SetDataRecord(UInt_t* dataRecord) 
@@ -25,69 +37,6 @@ bool ORGretina4MDecoder::SetDataRecord(UInt_t* dataRecord)
   return true;
 }
 
-void ORGretina4MDecoder::SetDecoderDictionary(const ORDecoderDictionary* dict)
-{
-  ORVDataDecoder::SetDecoderDictionary(dict);
-  for(UInt_t iPar = 0; iPar < kNPars; iPar++) fCardPars[iPar].clear();
-}
-
-UInt_t ORGretina4MDecoder::GetCardParameter(ECardPars par, UInt_t crate, UInt_t card)
-{
-  UInt_t ccc = (crate << 12) + (card << 4); // 0xfffff000 + 0xff0
-  return GetParameter(UInt_t(par), ccc);
-}
-
-UInt_t ORGretina4MDecoder::GetChannelParameter(EChanPars par, UInt_t crate, UInt_t card, UInt_t channel)
-{
-  UInt_t ccc = (crate << 12) + (card << 4) + channel; // 0xfffff000 + 0xff0 + 0xf
-  return GetParameter(UInt_t(par), ccc);
-}
-
-UInt_t ORGretina4MDecoder::GetParameter(UInt_t par, UInt_t ccc)
-{
-  map<UInt_t, UInt_t>::iterator iter = fCardPars[par].find(ccc);
-
-  //return if found
-  if(iter != fCardPars[par].end()) return iter->second;
-
-  // otherwise we have to look up the info from the header
-  // first find a key
-  const char* key = "";
-  switch(par) {
-  case kIntTime: key = "Integration Time"; break;
-  case kDownSample: key = "Down Sample"; break;
-  case kChPreSum: key = "Chpsrt"; break;
-  case kChPreSumDiv: key = "Chpsdv"; break;
-  case kEnabled: key = "Enabled"; break;
-  case kMRPreSum: key = "Mrpsrt"; break;
-  case kMRPreSumDiv: key = "Mrpsdv"; break;
-  case kPSEnabled: key = "PreSum Enabled"; break;
-  case kPreRECnt: key = "Prerecnt"; break;
-  case kPostRECnt: key = "Postrecnt"; break;
-  case kFTCnt: key = "FtCnt"; break;
-    
-  default:
-    ORLog(kError) << "Unknown card parameter " << par << endl;
-    return (UInt_t) -1;
-  }
-
-  // now pull out the value for the key
-  UInt_t cr = ccc >> 12;
-  UInt_t ca = (ccc & 0xff0) >> 4;
-  UInt_t ch = (ccc & 0xf);
-  UInt_t value = 0;
-  if(par < kNCardPars) value = GetIntValueFromKey(key, cr, ca);
-  else {
-    const ORDictValueA* arr = GetArrayFromKey(key, cr, ca);
-    if(!arr || ch > arr->GetNValues() || !arr->At(ch)->IsA(ORVDictValue::kInt)) value = 0;
-    else value = static_cast<const ORDictValueI*>(arr->At(ch))->GetI();
-  }
-  
-  // cache locally and return
-  fCardPars[par][ccc] = value;
-  return value;
-}
-
 ULong64_t ORGretina4MDecoder::GetTimeStamp(UInt_t* header)
 {
   ULong64_t time = header[3] & 0xffff;
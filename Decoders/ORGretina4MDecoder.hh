@@ -3,7 +3,6 @@
 #ifndef _ORGretina4MDecoder_hh_
 #define _ORGretina4MDecoder_hh_
 
-#include <map>
 #include "ORVDigitizerDecoder.hh"
 
 /*
@@ -78,10 +77,12 @@ class ORGretina4MDecoder : public ORVDigitizerDecoder
     virtual inline Bool_t IsFifoHalfFull()
       { return fDataRecord[1] & 0x40000000; }
 
-    // Functions related to setting / accessing card parameters)
-    virtual void SetDecoderDictionary(const ORDecoderDictionary* dict);
-    virtual UInt_t GetCardParameter(ECardPars par, UInt_t crate, UInt_t card); 
-    virtual UInt_t GetChannelParameter(EChanPars par, UInt_t crate, UInt_t card, UInt_t channel); 
+    // Functions related to accessing card parameters, which are looked up
+    // in fCardParameters when the decoder dictionary is set
+    virtual inline UInt_t GetCardParameter(ECardPars par, UInt_t crate, UInt_t card)
+      { return fCardParameters.GetInt(par, crate, card); }
+    virtual inline UInt_t GetChannelParameter(EChanPars par, UInt_t crate, UInt_t card, UInt_t channel)
+      { return fCardParameters.GetInt(par, crate, card, channel); }
     virtual inline UInt_t GetEnergyNormalization()
       { return GetCardParameter(kIntTime, CrateOf(), CardOf()); }
     virtual inline UInt_t GetDownSampleFactor()
@@ -109,12 +110,6 @@ class ORGretina4MDecoder : public ORVDigitizerDecoder
     virtual ULong64_t GetTimeStamp(UInt_t* header); // time of trigger, in clock ticks
     virtual UInt_t GetEnergy(UInt_t* header);
     virtual UShort_t GetChannel(UInt_t* header) { return header[1] & 0xf; }
-
-    // internal interface for parameters
-    virtual UInt_t GetParameter(UInt_t par, UInt_t ccc);
-
-  protected:
-    std::map< UInt_t, std::map<UInt_t, UInt_t> > fCardPars;
 };
 
 #endif
@@ -29,6 +29,7 @@ class ORHeaderDecoder : public ORVDataDecoder
     /* Be careful here, make sure to check the length of the record. */
 
     virtual void Swap(UInt_t* /*dataRecord*/) {}
+    virtual bool HasDefaultSwap() { return false; }
     /* Don't require a swap for char data. */
     virtual std::string GetDataObjectPath() { 
       ORLog(kWarning) << "GetDataObjectPath() should not be called for an ORHeaderDecoder! " 
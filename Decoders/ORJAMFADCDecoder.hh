@@ -15,6 +15,7 @@ class ORJAMFADCDecoder : public ORVHistDecoder, public ORVBasicRDTreeDecoder
     virtual ~ORJAMFADCDecoder() {}
 
     virtual void Swap(UInt_t* dataRecord);
+    virtual bool HasDefaultSwap() { return false; }
 
     virtual double ReferenceDateOf(UInt_t* record)
       { return (double) record[2]; }
@@ -12,6 +12,7 @@ class ORL4532mainTriggerDecoder : public ORVBasicRDTreeDecoder
     virtual ~ORL4532mainTriggerDecoder() {}
 
     virtual void Swap(UInt_t* dataRecord);
+    virtual bool HasDefaultSwap() { return false; }
     /* Handling the correct swapping for this record. */
     virtual inline UInt_t EventCountOf(UInt_t* record) { return record[1]; }
     virtual inline bool HasDoubleWordTimestamp(UInt_t* record)
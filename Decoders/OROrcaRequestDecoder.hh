@@ -26,6 +26,7 @@ class OROrcaRequestDecoder: public ORVDataDecoder
     virtual inline UInt_t GetDataId() 
       {return (fDataRecord) ? DataIdOf(fDataRecord) : 0;} 
     virtual void Swap(UInt_t* /*dataRecord*/) {}
+    virtual bool HasDefaultSwap() { return false; }
     /* Don't require a swap for char data. */
 
     //debugging:
@@ -49,6 +49,7 @@ class ORScriptDecoderForRecord : public ORVDataDecoder
                                           kXMLData };
     /*! Handling the correct swapping for this record. We must deal with a char buffer*/
     virtual void Swap(UInt_t* dataRecord);
+    virtual bool HasDefaultSwap() { return false; }
 
     //! Overloading these functions, they don't mean anything for this record 
     virtual inline UInt_t CrateOf(UInt_t* /*record*/)
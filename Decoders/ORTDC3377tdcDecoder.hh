@@ -12,6 +12,7 @@ class ORTDC3377tdcDecoder : public ORVBasicRDTreeDecoder
     virtual ~ORTDC3377tdcDecoder() {}
 
     virtual void Swap(UInt_t* dataRecord);
+    virtual bool HasDefaultSwap() { return false; }
     /* Handling the correct swapping for this record. */
     virtual inline bool IsDoubleWordTimestamp(UInt_t* record)
       { return (record[1] & 0x02000000) >> 25; }
@@ -14,6 +14,7 @@ class ORVBasicADCDecoder : public ORVHistDecoder, public ORVBasicRDTreeDecoder,
     virtual ~ORVBasicADCDecoder() {}
 
     virtual void Swap(UInt_t* dataRecord);
+    virtual bool HasDefaultSwap() { return false; }
     /* Handling the correct swapping for this record. */
     virtual inline UInt_t ChannelOf(UInt_t* record)
       { return IsShort(record) ? (record[0] & 0x0000f000) >> 12 : (record[1] & 0x0000f000) >> 12; }
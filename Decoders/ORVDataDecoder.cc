@@ -10,9 +10,8 @@ using ORUtils::BitConcat;
 
 void ORVDataDecoder::Swap(UInt_t* dataRecord)
 {
-  for(size_t i=1; i<LengthOf(dataRecord);i++) {
-    ORUtils::Swap(dataRecord[i]);
-  }
+  UInt_t length = LengthOf(dataRecord);
+  if(length > 1) ORUtils::SwapBlock(dataRecord + 1, length - 1);
 }
 
 void ORVDataDecoder::DumpHex(UInt_t* dataRecord, UInt_t rowLength)
@@ -30,7 +29,7 @@ void ORVDataDecoder::DumpHex(UInt_t* dataRecord, UInt_t rowLength)
   ORLog(kRoutine) << str.str() << std::endl;
 }
 
-const ORVDictValue* ORVDataDecoder::GetValueFromKey(std::string key, UInt_t crate,
+const ORVDictValue* ORVDataDecoder::GetValueFromKey(const ORDictPath& key, UInt_t crate,
   UInt_t card)
 {
   if (!fDecoderDictionary) return NULL;
@@ -40,147 +39,147 @@ const ORVDictValue* ORVDataDecoder::GetValueFromKey(std::string key, UInt_t crat
   return dict->LookUp(key);
 }
 
-const ORDictValueA* ORVDataDecoder::GetArrayFromKey(std::string key, UInt_t crate,
+const ORDictValueA* ORVDataDecoder::GetArrayFromKey(const ORDictPath& key, UInt_t crate,
   UInt_t card)
 {
     return (dynamic_cast<const ORDictValueA*>(GetValueFromKey(key, crate, card)));
 }
 
-std::string ORVDataDecoder::GetStringValueFromKey(std::string key, UInt_t crate,
+std::string ORVDataDecoder::GetStringValueFromKey(const ORDictPath& key, UInt_t crate,
   UInt_t card)
 {
   const ORDictValueS* val = 
     dynamic_cast<const ORDictValueS*>(GetValueFromKey(key, crate, card));
   if (!val) {
-    ORLog(kWarning) << key << " not found for crate: " << crate 
+    ORLog(kWarning) << key.GetPath() << " not found for crate: " << crate 
       << ", card: " << card << std::endl;
     return "";
   }
   return val->GetS();
 }
 
-Int_t ORVDataDecoder::GetIntValueFromKey(std::string key, UInt_t crate,
+Int_t ORVDataDecoder::GetIntValueFromKey(const ORDictPath& key, UInt_t crate,
   UInt_t card)
 {
   const ORDictValueI* val = 
     dynamic_cast<const ORDictValueI*>(GetValueFromKey(key, crate, card));
   if (!val) { 
-    ORLog(kWarning) << key << " not found for crate: " << crate 
+    ORLog(kWarning) << key.GetPath() << " not found for crate: " << crate 
       << ", card: " << card << std::endl;
     return 0;
   }
   return val->GetI();
 }
 
-Double_t ORVDataDecoder::GetRealValueFromKey(std::string key, UInt_t crate,
+Double_t ORVDataDecoder::GetRealValueFromKey(const ORDictPath& key, UInt_t crate,
   UInt_t card)
 {
   const ORDictValueR* val = 
     dynamic_cast<const ORDictValueR*>(GetValueFromKey(key, crate, card));
   if (!val) { 
-    ORLog(kWarning) << key << " not found for crate: " << crate 
+    ORLog(kWarning) << key.GetPath() << " not found for crate: " << crate 
       << ", card: " << card << std::endl;
     return 0.;
   }
   return val->GetR();
 }
 
-Bool_t ORVDataDecoder::GetBoolValueFromKey(std::string key, UInt_t crate,
+Bool_t ORVDataDecoder::GetBoolValueFromKey(const ORDictPath& key, UInt_t crate,
   UInt_t card)
 {
   const ORDictValueB* val = 
     dynamic_cast<const ORDictValueB*>(GetValueFromKey(key, crate, card));
   if (!val) { 
-    ORLog(kWarning) << key << " not found for crate: " << crate 
+    ORLog(kWarning) << key.GetPath() << " not found for crate: " << crate 
       << ", card: " << card << std::endl;
     return false;
   }
   return val->GetB();
 }
 
-std::string ORVDataDecoder::GetStringValueFromKeyArray(std::string key, 
+std::string ORVDataDecoder::GetStringValueFromKeyArray(const ORDictPath& key, 
   UInt_t crate, UInt_t card, size_t index)
 {
   const ORDictValueA* array = GetArrayFromKey(key, crate, card);
   if (!array) {
-    ORLog(kWarning) << key << " not found for crate: " << crate 
+    ORLog(kWarning) << key.GetPath() << " not found for crate: " << crate 
       << ", card: " << card << std::endl;
     return "";
   }
   if (index >= array->GetNValues()) {
-    ORLog(kWarning) << "index " << index << " out of range for crate " << crate << ", card " << card << ", key " << key << std::endl; 
+    ORLog(kWarning) << "index " << index << " out of range for crate " << crate << ", card " << card << ", key " << key.GetPath() << std::endl; 
     return "";
   } 
   const ORDictValueS* val = 
     dynamic_cast<const ORDictValueS*>(array->At(index));
   if (!val) {
-    ORLog(kWarning) << key << " for crate " << crate << ", card " << card << ", index " << index << " is not a string!" << std::endl;
+    ORLog(kWarning) << key.GetPath() << " for crate " << crate << ", card " << card << ", index " << index << " is not a string!" << std::endl;
     return "";
   }
   return val->GetS();
 }
 
-Int_t ORVDataDecoder::GetIntValueFromKeyArray(std::string key, 
+Int_t ORVDataDecoder::GetIntValueFromKeyArray(const ORDictPath& key, 
   UInt_t crate, UInt_t card, size_t index)
 {
   const ORDictValueA* array = GetArrayFromKey(key, crate, card);
   if (!array) {
-    ORLog(kWarning) << key << " not found for crate: " << crate 
+    ORLog(kWarning) << key.GetPath() << " not found for crate: " << crate 
       << ", card: " << card << std::endl;
     return 0;
   }
   if (index >= array->GetNValues()) {
-    ORLog(kWarning) << "index " << index << " out of range for crate " << crate << ", card " << card << ", key " << key << std::endl; 
+    ORLog(kWarning) << "index " << index << " out of range for crate " << crate << ", card " << card << ", key " << key.GetPath() << std::endl; 
     return 0;
   } 
   const ORDictValueI* val = 
     dynamic_cast<const ORDictValueI*>(array->At(index));
   if (!val) {
-    ORLog(kWarning) << key << " for crate " << crate << ", card " << card << ", index " << index << " is not an int!" << std::endl;
+    ORLog(kWarning) << key.GetPath() << " for crate " << crate << ", card " << card << ", index " << index << " is not an int!" << std::endl;
     return 0;
   }
   return val->GetI();
 }
 
-Double_t ORVDataDecoder::GetRealValueFromKeyArray(std::string key, 
+Double_t ORVDataDecoder::GetRealValueFromKeyArray(const ORDictPath& key, 
   UInt_t crate, UInt_t card, size_t index)
 {
   const ORDictValueA* array = GetArrayFromKey(key, crate, card);
   if (!array) {
-    ORLog(kWarning) << key << " not found for crate: " << crate 
+    ORLog(kWarning) << key.GetPath() << " not found for crate: " << crate 
       << ", card: " << card << std::endl;
     return 0.;
   }
   if (index >= array->GetNValues()) {
-    ORLog(kWarning) << "index " << index << " out of range for crate " << crate << ", card " << card << ", key " << key << std::endl; 
+    ORLog(kWarning) << "index " << index << " out of range for crate " << crate << ", card " << card << ", key " << key.GetPath() << std::endl; 
     return 0.;
   } 
   const ORDictValueR* val = 
     dynamic_cast<const ORDictValueR*>(array->At(index));
   if (!val) {
-    ORLog(kWarning) << key << " for crate " << crate << ", card " << card << ", index " << index << " is not a float!" << std::endl;
+    ORLog(kWarning) << key.GetPath() << " for crate " << crate << ", card " << card << ", index " << index << " is not a float!" << std::endl;
     return 0.;
   }
   return val->GetR();
 }
 
-Bool_t ORVDataDecoder::GetBoolValueFromKeyArray(std::string key, 
+Bool_t ORVDataDecoder::GetBoolValueFromKeyArray(const ORDictPath& key, 
   UInt_t crate, UInt_t card, size_t index)
  {
   const ORDictValueA* array = GetArrayFromKey(key, crate, card);
   if (!array) {
-    ORLog(kWarning) << key << " not found for crate: " << crate 
+    ORLog(kWarning) << key.GetPath() << " not found for crate: " << crate 
       << ", card: " << card << std::endl;
     return false;
   }
   if (index >= array->GetNValues()) {
-    ORLog(kWarning) << "index " << index << " out of range for crate " << crate << ", card " << card << ", key " << key << std::endl; 
+    ORLog(kWarning) << "index " << index << " out of range for crate " << crate << ", card " << card << ", key " << key.GetPath() << std::endl; 
     return false;
   } 
   const ORDictValueB* val = 
     dynamic_cast<const ORDictValueB*>(array->At(index));
   if (!val) {
-    ORLog(kWarning) << key << " for crate " << crate << ", card " << card << ", index " << index << " is not a bool!" << std::endl;
+    ORLog(kWarning) << key.GetPath() << " for crate " << crate << ", card " << card << ", index " << index << " is not a bool!" << std::endl;
     return false;
   }
   return val->GetB();
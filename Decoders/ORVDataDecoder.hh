@@ -10,6 +10,9 @@
 #ifndef _ORDecoderDictionary_hh_
 #include "ORDecoderDictionary.hh"
 #endif
+#ifndef _ORCardParameterTable_hh_
+#include "ORCardParameterTable.hh"
+#endif
 //! Base Class for all data decoders
 /** 
   ORVDataDecoder provides a number of functions for all decoders
@@ -57,8 +60,15 @@ class ORVDataDecoder
      * words.  If this is not needed, or something different is needed, please 
      * overload it in a derived decoder. Swap does (and should) not touch
      * the first long word since this is already handled in ORVReader.   
+     * A decoder that overloads Swap() must also overload HasDefaultSwap().
      */
     virtual void Swap(UInt_t* dataRecord);
+    //! True if Swap() swaps all long words of a record (the default).
+    /**
+     * Records of such decoders may be swapped in bulk before they reach
+     * the decoder (see ORVReader::SetSwapDataIds()).
+     */
+    virtual bool HasDefaultSwap() { return true; }
 
     virtual void DumpHex(UInt_t* dataRecord, UInt_t rowLength = 0);
 
@@ -98,8 +108,9 @@ class ORVDataDecoder
        See the description for Hardware access functions.
     */
     virtual std::string GetDictionaryObjectPath() { return ""; }
+    //! Sets the hardware dictionary and resolves fCardParameters from it.
     virtual void SetDecoderDictionary(const ORDecoderDictionary* aDict) 
-      { fDecoderDictionary = aDict; }
+      { fDecoderDictionary = aDict; fCardParameters.Resolve(aDict); }
 
   protected:
     //! Hardware dictionary access functions.
@@ -151,34 +162,45 @@ class ORVDataDecoder
      * one would call GetIntValueFromKeyArray("CFD Delay", CardOf(record),
      *                                         CrateOf(record), 0)
      *
+     * The key is resolved to interned keys (see ORDictPath) on every call;
+     * a decoder looking keys up per record can keep the ORDictPath and pass
+     * that instead of a string.
+     *
      * Other access functions work similarly.
      * The failure modes of the functions are to return 0 (or false for bool)
      * and to output an error to ORLog.
+     *
+     * These functions look the key up on every call.  Parameters needed for
+     * every record should rather be declared in fCardParameters, which looks
+     * them up once when the dictionary is set (see ORCardParameterTable).
      */
-    virtual const ORVDictValue* GetValueFromKey(std::string key, 
+    virtual const ORVDictValue* GetValueFromKey(const ORDictPath& key, 
       UInt_t crate, UInt_t card);
-    virtual const ORDictValueA* GetArrayFromKey(std::string key, 
+    virtual const ORDictValueA* GetArrayFromKey(const ORDictPath& key, 
       UInt_t crate, UInt_t card);
 
-    virtual std::string GetStringValueFromKey(std::string key, 
+    virtual std::string GetStringValueFromKey(const ORDictPath& key, 
       UInt_t crate, UInt_t card);
-    virtual Int_t GetIntValueFromKey(std::string key, 
+    virtual Int_t GetIntValueFromKey(const ORDictPath& key, 
       UInt_t crate, UInt_t card);
-    virtual Double_t GetRealValueFromKey(std::string key, 
+    virtual Double_t GetRealValueFromKey(const ORDictPath& key, 
       UInt_t crate, UInt_t card);
-    virtual Bool_t GetBoolValueFromKey(std::string key, 
+    virtual Bool_t GetBoolValueFromKey(const ORDictPath& key, 
       UInt_t crate, UInt_t card);
  
-    virtual std::string GetStringValueFromKeyArray(std::string key, 
+    virtual std::string GetStringValueFromKeyArray(const ORDictPath& key, 
       UInt_t crate, UInt_t card, size_t index);
-    virtual Int_t GetIntValueFromKeyArray(std::string key, 
+    virtual Int_t GetIntValueFromKeyArray(const ORDictPath& key, 
       UInt_t crate, UInt_t card, size_t index);
-    virtual Double_t GetRealValueFromKeyArray(std::string key, 
+    virtual Double_t GetRealValueFromKeyArray(const ORDictPath& key, 
       UInt_t crate, UInt_t card, size_t index);
-    virtual Bool_t GetBoolValueFromKeyArray(std::string key, 
+    virtual Bool_t GetBoolValueFromKeyArray(const ORDictPath& key, 
       UInt_t crate, UInt_t card, size_t index);
     
 
+  protected:
+    ORCardParameterTable fCardParameters; //! hardware parameters needed per record
+
   private:
     const ORDecoderDictionary* fDecoderDictionary;
 };
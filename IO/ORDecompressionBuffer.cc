@@ -0,0 +1,137 @@
+// ORDecompressionBuffer.cc
+
+#include "ORDecompressionBuffer.hh"
+
+#include "ORLogger.hh"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+ORDecompressionBuffer::ORDecompressionBuffer(size_t nBlocks, size_t nBytesPerBlock) :
+  ORReadAheadBuffer(nBlocks, nBytesPerBlock)
+{
+  fDecompressorPid = -1;
+  fFormat = kUncompressed;
+}
+
+ORDecompressionBuffer::~ORDecompressionBuffer()
+{
+  Stop();
+}
+
+ORDecompressionBuffer::EFormat ORDecompressionBuffer::FormatOf(const string& filename)
+{
+  unsigned char magic[6];
+  memset(magic, 0, sizeof(magic));
+  int fileDescriptor = open(filename.c_str(), O_RDONLY);
+  if (fileDescriptor < 0) return kUncompressed;
+  ssize_t nBytes = read(fileDescriptor, magic, sizeof(magic));
+  close(fileDescriptor);
+  if (nBytes >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return kGzip;
+  if (nBytes >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+      magic[2] == 0x2f && magic[3] == 0xfd) return kZstd;
+  if (nBytes >= 6 && memcmp(magic, "\xfd" "7zXZ\0", 6) == 0) return kXz;
+  return kUncompressed;
+}
+
+const char* ORDecompressionBuffer::DecompressorOf(EFormat format)
+{
+  switch (format) {
+    case kGzip: return "gzip";
+    case kZstd: return "zstd";
+    case kXz: return "xz";
+    default: return "";
+  }
+}
+
+bool ORDecompressionBuffer::Start(const string& filename, EFormat format)
+{
+  Stop();
+  const char* decompressor = DecompressorOf(format);
+  if (format == kUncompressed) {
+    ORLog(kError) << filename << " is not compressed" << endl;
+    return false;
+  }
+
+  int pipeEnds[2];
+  if (pipe(pipeEnds) != 0) {
+    ORLog(kError) << "Could not create pipe: " << strerror(errno) << endl;
+    return false;
+  }
+  // Don't leak our end into decompressors started later on.
+  fcntl(pipeEnds[0], F_SETFD, FD_CLOEXEC);
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    ORLog(kError) << "Could not fork " << decompressor << ": "
+                  << strerror(errno) << endl;
+    close(pipeEnds[0]);
+    close(pipeEnds[1]);
+    return false;
+  }
+  if (pid == 0) {
+    // Child: only async-signal-safe calls until exec.
+    dup2(pipeEnds[1], STDOUT_FILENO);
+    close(pipeEnds[0]);
+    close(pipeEnds[1]);
+    execlp(decompressor, decompressor, "-dc", "--", filename.c_str(), (char*) NULL);
+    _exit(127);
+  }
+  close(pipeEnds[1]);
+
+  ORLog(kDebug) << "Start(): decompressing " << filename << " with "
+                << decompressor << " (pid " << pid << ")" << endl;
+  fDecompressorPid = pid;
+  fFormat = format;
+  if (!ORReadAheadBuffer::Start(pipeEnds[0])) {
+    Stop();
+    return false;
+  }
+  return true;
+}
+
+void ORDecompressionBuffer::Stop()
+{
+  if (fDecompressorPid <= 0) {
+    ORReadAheadBuffer::Stop();
+    return;
+  }
+  // Once the pipe is at its end, the decompressor is done, or about to
+  // be: wait for it and check how it went.  Before that, one that is
+  // still running is simply no longer needed.
+  bool pipeIsDone = HasReadAll();
+  int status = 0;
+  pid_t pid = pipeIsDone ? 0 : waitpid(fDecompressorPid, &status, WNOHANG);
+  bool isTerminated = (!pipeIsDone && pid == 0);
+  if (isTerminated) kill(fDecompressorPid, SIGTERM);
+  ORReadAheadBuffer::Stop();
+  if (pid == 0) {
+    while (waitpid(fDecompressorPid, &status, 0) < 0 && errno == EINTR);
+  }
+  if (!isTerminated) ReportExitStatus(status);
+  fDecompressorPid = -1;
+}
+
+void ORDecompressionBuffer::ReportExitStatus(int status)
+{
+  if (WIFSIGNALED(status)) {
+    ORLog(kError) << DecompressorOf(fFormat) << " was killed by signal "
+                  << WTERMSIG(status) << ": the input may be incomplete" << endl;
+    return;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) == 0) return;
+  if (WEXITSTATUS(status) == 127) {
+    ORLog(kError) << "Could not run " << DecompressorOf(fFormat) 
+                  << ": is it installed?" << endl;
+  }
+  else {
+    ORLog(kError) << DecompressorOf(fFormat) << " exited with status "
+                  << WEXITSTATUS(status) << ": the input is corrupt or truncated" 
+                  << endl;
+  }
+}
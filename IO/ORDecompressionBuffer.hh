@@ -0,0 +1,58 @@
+// ORDecompressionBuffer.hh
+
+#ifndef _ORDecompressionBuffer_hh_
+#define _ORDecompressionBuffer_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <string>
+#include <sys/types.h>
+#include "ORReadAheadBuffer.hh"
+
+//! Read-ahead buffer fed by a decompressor
+/*!
+   ORDecompressionBuffer streams a compressed file through the matching
+   command line decompressor (gzip, zstd or xz), which runs as a separate
+   process writing into a pipe.  The read-ahead thread of the base class
+   drains the pipe into its blocks, so decompression overlaps with both
+   the disk and the processing, and the uncompressed data never touches
+   the disk.
+
+   The format is recognized from the magic bytes at the beginning of the
+   file with FormatOf(); file name extensions are not looked at.
+ */
+class ORDecompressionBuffer : public ORReadAheadBuffer
+{
+  public:
+    enum EFormat { kUncompressed, kGzip, kZstd, kXz };
+
+    ORDecompressionBuffer(size_t nBlocks = 4, size_t nBytesPerBlock = 1024*1024);
+    virtual ~ORDecompressionBuffer();
+
+    //! Returns the compression format of filename, judged by magic bytes.
+    static EFormat FormatOf(const std::string& filename);
+    //! Returns the decompressor command used for format.
+    static const char* DecompressorOf(EFormat format);
+
+    /*!
+       Starts the decompressor on filename and reads its output.  Returns
+       false if the decompressor could not be started.
+     */
+    virtual bool Start(const std::string& filename, EFormat format);
+    /*!
+       Stops reading.  If the whole output was read, waits for the
+       decompressor and reports if it failed; otherwise terminates it.
+     */
+    virtual void Stop();
+
+  protected:
+    //! Logs an error if the decompressor failed or was killed.
+    virtual void ReportExitStatus(int status);
+
+  protected:
+    pid_t fDecompressorPid;
+    EFormat fFormat;
+};
+
+#endif /* __CINT__ */
+#endif /* _ORDecompressionBuffer_hh_ */
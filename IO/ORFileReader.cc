@@ -4,9 +4,16 @@
 #include "TSystem.h"
 
 #include "ORLogger.hh"
+#include "ORDecompressionBuffer.hh"
+#include "ORPacketIndex.hh"
+#include "ORUtils.hh"
+#include <algorithm>
+#include <cstring>
 #include <ctime>
 #include <sstream>
 #include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 #include <sys/param.h>
 
@@ -14,13 +21,128 @@ using namespace std;
 
 ORFileReader::ORFileReader(string filename)
 {
+  fReadAhead = NULL;
+  fReadAheadBlocks = 0;
+  fReadAheadBlockSize = 0;
+  fIndex = NULL;
+  fBuildIndex = false;
+  fIsSelecting = false;
+  fSelectionIsDone = false;
+  fMustSeek = false;
+  fRangeIndex = 0;
+  fNextPacket = 0;
   if (filename != "") AddFileToProcess(filename);
 }
 
+ORFileReader::~ORFileReader()
+{
+  delete fReadAhead;
+  delete fIndex;
+}
+
+bool ORFileReader::OKToRead()
+{
+  if(fFileList.size() > 0) return true;
+  // everything wanted from the current file has been returned
+  if(fIsSelecting && fSelectionIsDone && fReplayPackets.empty()) return false;
+  if(fCarryOver.size() > 0) return true;
+  if(fReadAhead != NULL) return fReadAhead->IsActive() && !fReadAhead->AtEnd();
+  return (peek() && !bad() && !eof() && good());
+}
+
+void ORFileReader::Close()
+{
+  if(fIndex != NULL) {
+    // Only an index of the whole file is any good
+    if(fIndex->IsBuilding()) {
+      if(StreamIsOpen() && StreamIsExhausted()) fIndex->FinishBuilding();
+      else fIndex->AbortBuilding();
+    }
+    fIndex->Close();
+  }
+  fIsSelecting = false;
+  close();
+  if(fReadAhead != NULL) fReadAhead->Stop();
+  fCurrentFileName = "";
+  fCarryOver.clear();
+}
+
+void ORFileReader::SetReadAhead(size_t nBlocks, size_t nBytesPerBlock)
+{
+  fReadAheadBlocks = nBlocks;
+  fReadAheadBlockSize = nBytesPerBlock;
+}
+
+void ORFileReader::AddPacketRange(ULong64_t first, ULong64_t last)
+{
+  if(last < first) {
+    ORLog(kWarning) << "AddPacketRange(): ignoring empty range " << first 
+                    << " - " << last << endl;
+    return;
+  }
+  if(fPacketRanges.size() > 0 && first <= fPacketRanges.back().second) {
+    ORLog(kError) << "AddPacketRange(): ranges must be added in increasing order; "
+                  << "ignoring " << first << " - " << last << endl;
+    return;
+  }
+  fPacketRanges.push_back(pair<ULong64_t, ULong64_t>(first, last));
+}
+
+void ORFileReader::SeekToPacket(ULong64_t packet)
+{
+  ClearPacketRanges();
+  AddPacketRange(packet, (ULong64_t) -1);
+}
+
+bool ORFileReader::ResumeAt(const string& fileName, ULong64_t packet)
+{
+  vector<string>::iterator it = find(fFileList.begin(), fFileList.end(), fileName);
+  if(it == fFileList.end()) {
+    ORLog(kError) << "ResumeAt(): " << fileName << " is not among the files to read" << endl;
+    return false;
+  }
+  if(ORDecompressionBuffer::FormatOf(fileName) != ORDecompressionBuffer::kUncompressed) {
+    ORLog(kError) << "ResumeAt(): " << fileName << " is compressed and can't be "
+                  << "read from packet " << packet << endl;
+    return false;
+  }
+  fFileList.erase(fFileList.begin(), it);
+  SeekToPacket(packet);
+  fResumeFileName = fileName;
+  return true;
+}
+
+size_t ORFileReader::ReadFromStream(char* buffer, size_t nBytes)
+{
+  if(fReadAhead != NULL) return fReadAhead->Read(buffer, nBytes);
+  read(buffer, nBytes);
+  return gcount();
+}
+
+bool ORFileReader::StreamIsOpen()
+{
+  if(fReadAhead != NULL) return fReadAhead->IsActive();
+  return is_open();
+}
+
+bool ORFileReader::StreamIsExhausted()
+{
+  if(fCarryOver.size() > 0) return false;
+  if(fReadAhead != NULL) return fReadAhead->AtEnd();
+  return peek() == EOF;
+}
+
 size_t ORFileReader::Read(char* buffer, size_t nBytesMax)
 {
-  read(buffer, nBytesMax);
-  size_t bytesLeft = nBytesMax - gcount();
+  // Bytes left over from the last ReadRecords() come first
+  if(fCarryOver.size() > 0) {
+    size_t nBytes = min(nBytesMax, fCarryOver.size());
+    memcpy(buffer, &fCarryOver[0], nBytes);
+    fCarryOver.erase(fCarryOver.begin(), fCarryOver.begin() + nBytes);
+    if(nBytes == nBytesMax) return nBytes;
+    return nBytes + Read(buffer + nBytes, nBytesMax - nBytes);
+  }
+  size_t bytesLeft = nBytesMax - ReadFromStream(buffer, nBytesMax);
   if(bytesLeft > 0) {
     Close();
     if(Open()) bytesLeft -= Read(buffer, bytesLeft);
@@ -28,17 +150,268 @@ size_t ORFileReader::Read(char* buffer, size_t nBytesMax)
   return nBytesMax-bytesLeft;
 }
 
+bool ORFileReader::ReadRecords(ORRecordBatch& batch)
+{
+  // The header is read in full either way
+  if(fIsSelecting && fStreamVersion != ORHeaderDecoder::kUnknownVersion) {
+    return ReadSelectedRecords(batch);
+  }
+  if(!ReadFramedRecords(batch)) return false;
+  if(fIndex != NULL && fIndex->IsBuilding()) {
+    for(size_t i=0; i<batch.GetNRecords(); i++) {
+      if(!fIndex->AddRecord(batch.GetRecord(i), MustSwap() && !batch.IsRecordSwapped(i))) {
+        ORLog(kWarning) << "Not writing a packet index for " << fCurrentFileName << endl;
+        fIndex->AbortBuilding();
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+bool ORFileReader::ReadSelectedRecords(ORRecordBatch& batch)
+{
+  ULong64_t packet = fNextPacket;
+  if(fReplayPackets.empty() && !fSelectionIsDone) {
+    while(fRangeIndex < fPacketRanges.size() && 
+          fPacketRanges[fRangeIndex].second < fNextPacket) fRangeIndex++;
+    if(fRangeIndex == fPacketRanges.size() || fNextPacket >= fIndex->GetNPackets()) {
+      // Nothing more wanted from this file but the end of the run
+      fSelectionIsDone = true;
+      const vector<ORPacketIndex::RunRecordEntry>& runRecords = fIndex->GetRunRecords();
+      for(size_t i=0; i<runRecords.size(); i++) {
+        if(runRecords[i].fPacket >= fNextPacket && 
+           runRecords[i].fType == ORPacketIndex::kRunStop) {
+          fReplayPackets.push_back(runRecords[i].fPacket);
+          break;
+        }
+      }
+    }
+    else {
+      packet = max(fNextPacket, fPacketRanges[fRangeIndex].first);
+      if(packet > fNextPacket) {
+        fReplayPackets = fIndex->GetRunRecordsToReplay(fNextPacket, packet);
+      }
+    }
+  }
+
+  if(fReplayPackets.size() > 0) {
+    // Run-control records are returned one at a time
+    packet = fReplayPackets.front();
+    fReplayPackets.erase(fReplayPackets.begin());
+    if(packet != fNextPacket || fMustSeek) {
+      if(!SeekToIndexedPacket(packet)) return false;
+    }
+    if(!ORVReader::ReadRecords(batch)) return false;
+    batch.SetNSkipped(packet - fNextPacket);
+    batch.SetIsReplayed();
+    fNextPacket = packet + 1;
+    fMustSeek = false;
+    return true;
+  }
+
+  if(fSelectionIsDone) {
+    ORLog(kDebug) << "ReadSelectedRecords(): done with " << fCurrentFileName << endl;
+    Close();
+    if(!Open()) return false;
+    return ReadRecords(batch);
+  }
+
+  if(packet != fNextPacket || fMustSeek) {
+    if(!SeekToIndexedPacket(packet)) return false;
+  }
+  ULong64_t nSkipped = packet - fNextPacket;
+  fNextPacket = packet;
+  fMustSeek = false;
+  if(!ReadFramedRecords(batch)) return false;
+  ULong64_t lastPacket = fPacketRanges[fRangeIndex].second;
+  if(lastPacket - fNextPacket < batch.GetNRecords() - 1) {
+    // The rest of the block is not wanted
+    batch.Truncate(lastPacket - fNextPacket + 1);
+    fCarryOver.clear();
+    fMustSeek = true;
+  }
+  batch.SetNSkipped(nSkipped);
+  fNextPacket += batch.GetNRecords();
+  return true;
+}
+
+bool ORFileReader::SeekToIndexedPacket(ULong64_t packet)
+{
+  ORPacketIndex::PacketEntry entry;
+  if(!fIndex->GetPacket(packet, entry) || !SeekToOffset(entry.fOffset)) {
+    ORLog(kError) << "Could not seek to packet " << packet << " of " 
+                  << fCurrentFileName << endl;
+    return false;
+  }
+  ORLog(kDebug) << "SeekToIndexedPacket(): packet " << packet << " at " 
+                << entry.fOffset << " B" << endl;
+  return true;
+}
+
+bool ORFileReader::SeekToOffset(ULong64_t offset)
+{
+  fCarryOver.clear();
+  if(fReadAhead != NULL) {
+    // restart the read-ahead thread at the new position
+    int fileDescriptor = ::open(fCurrentFileName.c_str(), O_RDONLY);
+    if(fileDescriptor < 0) return false;
+    if(lseek(fileDescriptor, offset, SEEK_SET) != (off_t) offset) {
+      ::close(fileDescriptor);
+      return false;
+    }
+    return fReadAhead->Start(fileDescriptor);
+  }
+  clear();
+  seekg(offset);
+  return good();
+}
+
+void ORFileReader::SetUpPacketIndex(const string& fileName, bool isCompressed)
+{
+  fIsSelecting = false;
+  fSelectionIsDone = false;
+  fMustSeek = false;
+  fRangeIndex = 0;
+  fNextPacket = 0;
+  fReplayPackets.clear();
+  if(fPacketRanges.empty() && !fBuildIndex) return;
+  if(isCompressed) {
+    if(fPacketRanges.size() > 0) {
+      ORLog(kWarning) << fileName << " is compressed and can't be indexed; "
+                      << "reading all of it" << endl;
+    }
+    return;
+  }
+
+  if(fIndex == NULL) fIndex = new ORPacketIndex;
+  if(fIndex->Open(fileName)) {
+    fIsSelecting = (fPacketRanges.size() > 0);
+    if(!fIsSelecting) fIndex->Close();
+    return;
+  }
+  if(fPacketRanges.size() > 0) {
+    ORLog(kRoutine) << "Indexing " << fileName << "..." << endl;
+    if(fIndex->Build(fileName) && fIndex->Open(fileName)) fIsSelecting = true;
+    else {
+      ORLog(kWarning) << "Could not index " << fileName << "; reading all of it" << endl;
+    }
+    return;
+  }
+  // Index the file as it is read
+  fIndex->BeginBuilding(fileName);
+}
+
+bool ORFileReader::ReadFramedRecords(ORRecordBatch& batch)
+{
+  // The stream version (and hence the swapping) is determined while reading
+  // the first record of a file, and old-style headers are read line by
+  // line: leave these to ReadRecord().
+  if(fStreamVersion == ORHeaderDecoder::kUnknownVersion ||
+     fStreamVersion == ORHeaderDecoder::kOld || !StreamIsOpen()) {
+    return ORVReader::ReadRecords(batch);
+  }
+
+  batch.Clear();
+  size_t nBytesCarried = fCarryOver.size();
+  size_t nBytesBlock = batch.GetBlockSize();
+  if(nBytesBlock < nBytesCarried + sizeof(UInt_t)) {
+    nBytesBlock = nBytesCarried + sizeof(UInt_t);
+  }
+  char* block = (char*) batch.ReserveLongs(nBytesBlock/sizeof(UInt_t) + 1);
+  if(nBytesCarried > 0) memcpy(block, &fCarryOver[0], nBytesCarried);
+  size_t nBytes = nBytesCarried + 
+    ReadFromStream(block + nBytesCarried, nBytesBlock - nBytesCarried);
+  bool isFileLeft = (nBytes == nBytesBlock);
+
+  size_t nLongsFramed = 0;
+  bool isOK = FrameRecords(batch, nBytes/sizeof(UInt_t), nLongsFramed);
+  while(isOK && batch.GetNRecords() == 0 && nBytes >= sizeof(UInt_t) && isFileLeft) {
+    // A single record longer than the block: read the rest of it
+    UInt_t firstWord = *((UInt_t*) block);
+    if(MustSwap()) ORUtils::Swap(firstWord);
+    size_t nBytesRecord = fBasicDecoder.LengthOf(&firstWord)*sizeof(UInt_t);
+    block = (char*) batch.ReserveLongs(nBytesRecord/sizeof(UInt_t));
+    size_t nBytesRead = ReadFromStream(block + nBytes, nBytesRecord - nBytes);
+    isFileLeft = (nBytesRead == nBytesRecord - nBytes);
+    nBytes += nBytesRead;
+    isOK = FrameRecords(batch, nBytes/sizeof(UInt_t), nLongsFramed);
+  }
+
+  size_t nBytesFramed = nLongsFramed*sizeof(UInt_t);
+  if(!isOK && batch.GetNRecords() == 0) {
+    // Drop the corrupt word, just like ReadRecord() would have. 
+    nBytesFramed += sizeof(UInt_t);
+  }
+  fCarryOver.assign(block + nBytesFramed, block + nBytes);
+
+  if(batch.GetNRecords() > 0) {
+    ORLog(kDebug) << "ReadRecords(): framed " << batch.GetNRecords() 
+                  << " records in " << nBytesFramed << " B" << endl;
+    return true;
+  }
+  if(!isOK) return false;
+  // The file is exhausted: ReadRecord() spans the remainder, if any,
+  // over to the next file. 
+  return ORVReader::ReadRecords(batch);
+}
+
 bool ORFileReader::OpenDataStream()
 {
   if(fFileList.size() > 0) {
     ORLog(kDebug) << "OpenDataStream(): opening file " << fFileList[0] << endl;
-    open(fFileList[0].c_str());
+    // Compressed files are always streamed through a decompressor feeding
+    // a read-ahead buffer.
+    ORDecompressionBuffer::EFormat format = ORDecompressionBuffer::FormatOf(fFileList[0]);
+    bool isCompressed = (format != ORDecompressionBuffer::kUncompressed);
+    size_t nBlocks = fReadAheadBlocks;
+    size_t nBytesPerBlock = fReadAheadBlockSize;
+    if(isCompressed && nBlocks == 0) {
+      nBlocks = kDefaultDecompressionBlocks;
+      nBytesPerBlock = kDefaultDecompressionBlockSize;
+    }
+    // (Re)configure the read-ahead between files only
+    if(fReadAhead != NULL && 
+       (fReadAhead->GetNBlocks() != nBlocks || 
+        fReadAhead->GetBlockSize() != nBytesPerBlock ||
+        (dynamic_cast<ORDecompressionBuffer*>(fReadAhead) != NULL) != isCompressed)) {
+      delete fReadAhead;
+      fReadAhead = NULL;
+    }
+    if(fReadAhead == NULL && isCompressed) {
+      fReadAhead = new ORDecompressionBuffer(nBlocks, nBytesPerBlock);
+    }
+    else if(fReadAhead == NULL && nBlocks > 0) {
+      fReadAhead = new ORReadAheadBuffer(nBlocks, nBytesPerBlock);
+    }
+    if(isCompressed) {
+      ORLog(kDebug) << "OpenDataStream(): " << fFileList[0] << " is compressed, using "
+                    << ORDecompressionBuffer::DecompressorOf(format) << endl;
+      if(!((ORDecompressionBuffer*) fReadAhead)->Start(fFileList[0], format)) {
+        ORLog(kError) << "Could not decompress file " << fFileList[0] << endl;
+        return false;
+      }
+    }
+    else if(fReadAhead != NULL) {
+      int fileDescriptor = ::open(fFileList[0].c_str(), O_RDONLY);
+      if(fileDescriptor < 0 || !fReadAhead->Start(fileDescriptor)) {
+        ORLog(kError) << "Could not open file " << fFileList[0] << endl;
+        return false;
+      }
+    }
+    else open(fFileList[0].c_str());
     if(!OKToRead()) {
       ORLog(kError) << "Could not open file " << fFileList[0] << endl;
       return false;
     }
     fCurrentFileName = fFileList[0];
     fFileList.erase(fFileList.begin());
+    // The packet range of ResumeAt() only applies to the file resumed
+    if(fResumeFileName != "" && fCurrentFileName != fResumeFileName) {
+      ClearPacketRanges();
+      fResumeFileName = "";
+    }
+    SetUpPacketIndex(fCurrentFileName, isCompressed);
     return true;
   }
   else {
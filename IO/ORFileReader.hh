@@ -5,30 +5,90 @@
 
 #include <fstream>
 #include <string>
+#include <utility>
 #include <vector>
 #ifndef _ORVReader_hh_
 #include "ORVReader.hh"
 #endif
 
+class ORReadAheadBuffer;
+class ORPacketIndex;
+
 //! Class to read in files
 /*!
    This class reads in Orca files that have been
    saved to disk.  This class can not exist across threads. 
+
+   With SetReadAhead(), files are read by a background thread into a ring
+   of blocks ahead of the processing (see ORReadAheadBuffer).  Derived
+   readers get this for free as long as they go through ReadFromStream()
+   and OKToRead() instead of using the std::ifstream directly.
+
+   Files compressed with gzip, zstd or xz are recognized by their magic
+   bytes and decompressed on the fly (see ORDecompressionBuffer); they are
+   always read ahead, with default settings if SetReadAhead() wasn't used.
+
+   With AddPacketRange() or SeekToPacket(), only part of each file is read:
+   the packet index of the file (see ORPacketIndex) is used to jump over
+   the rest.  The header, and the run-control records needed to get the
+   run into the state it would have been in, are always returned, and the
+   number of packets jumped over is passed on with
+   ORRecordBatch::SetNSkipped().  The run-control records returned only for
+   the sake of the run state come in batches of their own, marked with
+   ORRecordBatch::SetIsReplayed().  Packets are counted from the first
+   record after the header of each file.
  */
 class ORFileReader : public std::ifstream, public ORVReader
 {
   public:
     ORFileReader(std::string filename = "");
-    virtual ~ORFileReader() {}
+    virtual ~ORFileReader();
 
     virtual size_t Read(char* buffer, size_t nBytesMax);
-    virtual bool OKToRead() { return (fFileList.size() > 0) || 
-                                     (peek() && !bad() && 
-                                      !eof() && good()); }
+    /*!
+       Reads a block of batch.GetBlockSize() bytes from the current file
+       with a single read() and frames all complete records in it.  The
+       incomplete record at the end of the block is carried over to the
+       next call (or Read()).
+     */
+    virtual bool ReadRecords(ORRecordBatch& batch);
+    virtual bool OKToRead();
 
     //! Open the next file in the file list.
     virtual bool OpenDataStream();
-    virtual void Close() { close(); fCurrentFileName = ""; }
+    virtual void Close();
+
+    /*!
+       Read files through a background thread keeping up to nBlocks blocks
+       of nBytesPerBlock bytes ahead of the consumer.  nBlocks = 0 switches
+       read-ahead off.  Takes effect when the next file is opened.
+     */
+    virtual void SetReadAhead(size_t nBlocks, size_t nBytesPerBlock = 1024*1024);
+    enum EReadAheadDefaults { kDefaultDecompressionBlocks = 4, 
+                              kDefaultDecompressionBlockSize = 1024*1024 };
+
+    /*!
+       Read only packets first through last of each file (in addition to
+       other ranges added).  Ranges must be added in increasing order.  The
+       packet index of a file is built first if it is missing or out of
+       date.  Compressed files are always read in full.  Takes effect when
+       the next file is opened.
+     */
+    virtual void AddPacketRange(ULong64_t first, ULong64_t last);
+    virtual void ClearPacketRanges() { fPacketRanges.clear(); }
+    //! Start reading each file at packet; replaces any packet ranges.
+    virtual void SeekToPacket(ULong64_t packet);
+    /*!
+       Go on from packet of fileName, which must be in the file list: the
+       files before it are dropped from the list, and the files after it
+       are read in full.  For resuming from a checkpoint (see
+       ORDataProcManager::ResumeFromCheckpoint()); replaces any packet
+       ranges.  Returns false if fileName isn't in the list, or is
+       compressed and can't be indexed.
+     */
+    virtual bool ResumeAt(const std::string& fileName, ULong64_t packet);
+    //! Write the packet index of each file that is read in full.
+    virtual void SetBuildIndex(bool buildIndex = true) { fBuildIndex = buildIndex; }
 
     //! Add a file to the file list.
     virtual void AddFileToProcess(std::string filename)
@@ -36,6 +96,8 @@ class ORFileReader : public std::ifstream, public ORVReader
 
     //! Get last-modified-date string of current file
     virtual std::string GetFileDate();
+    //! Name of the current file, as it was added
+    virtual const std::string& GetFileName() const { return fCurrentFileName; }
     //! Get path of current file
     virtual std::string GetFilePath();
     //! Get last-modification UTC time of current file
@@ -43,9 +105,41 @@ class ORFileReader : public std::ifstream, public ORVReader
     //! Get time interval in seconds since 1 January 2001, GMT of current file
     virtual int GetFileRefTime();
 
+  protected:
+    //! Reads from the current file only, through the read-ahead if enabled.
+    virtual size_t ReadFromStream(char* buffer, size_t nBytes);
+    virtual bool StreamIsOpen();
+    //! True if everything in the current file has been read.
+    virtual bool StreamIsExhausted();
+    /*!
+       Reads a block from the current file and frames the records in it;
+       see ReadRecords().
+     */
+    virtual bool ReadFramedRecords(ORRecordBatch& batch);
+    //! ReadRecords() restricted to the packet ranges
+    virtual bool ReadSelectedRecords(ORRecordBatch& batch);
+    //! Opens the index of fileName, or starts building it, as needed.
+    virtual void SetUpPacketIndex(const std::string& fileName, bool isCompressed);
+    virtual bool SeekToIndexedPacket(ULong64_t packet);
+    virtual bool SeekToOffset(ULong64_t offset);
+
   protected:
     std::vector<std::string> fFileList;
     std::string fCurrentFileName;
+    std::string fResumeFileName;
+    std::vector<char> fCarryOver;
+    ORReadAheadBuffer* fReadAhead;
+    size_t fReadAheadBlocks;
+    size_t fReadAheadBlockSize;
+    std::vector<std::pair<ULong64_t, ULong64_t> > fPacketRanges;
+    ORPacketIndex* fIndex;
+    bool fBuildIndex;
+    bool fIsSelecting;
+    bool fSelectionIsDone;
+    bool fMustSeek;
+    size_t fRangeIndex;
+    ULong64_t fNextPacket;
+    std::vector<ULong64_t> fReplayPackets;
 };
 
 #endif
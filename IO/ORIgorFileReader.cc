@@ -17,8 +17,7 @@ ORIgorFileReader::ORIgorFileReader(std::string filename) : ORFileReader(filename
 
 size_t ORIgorFileReader::Read(char* buffer, size_t nBytesMax)
 {
-  read(buffer, nBytesMax);
-  return gcount();
+  return ReadFromStream(buffer, nBytesMax);
 }
 
 bool ORIgorFileReader::ReadRecord(std::vector<UInt_t>& buffer)
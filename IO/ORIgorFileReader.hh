@@ -23,6 +23,9 @@ class ORIgorFileReader : public ORFileReader
     virtual size_t Read(char* buffer, size_t nBytes);
     virtual size_t ReadPartialLineWithCR(char* , size_t ) { return 0;} 
     virtual bool ReadRecord(std::vector<UInt_t>& buffer);
+    //! Records are synthesized one at a time by ReadRecord().
+    virtual bool ReadRecords(ORRecordBatch& batch)
+      { return ORVReader::ReadRecords(batch); }
 
   protected:
     virtual std::string ReadHeader();
@@ -0,0 +1,202 @@
+// ORMappedFileReader.cc
+
+#include "ORMappedFileReader.hh"
+
+#include "ORDecompressionBuffer.hh"
+#include "ORLogger.hh"
+#include <iomanip>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+ORMappedFileReader::ORMappedFileReader(string filename)
+{
+  fFileDescriptor = -1;
+  fMapping = NULL;
+  fFileSize = 0;
+  fPosition = 0;
+  fReleasedUpTo = 0;
+  fReleaseChunkSize = 64*1024*1024;
+  fPageSize = (size_t) sysconf(_SC_PAGESIZE);
+  if (filename != "") AddFileToProcess(filename);
+}
+
+ORMappedFileReader::~ORMappedFileReader()
+{
+  Close();
+}
+
+bool ORMappedFileReader::OpenDataStream()
+{
+  if(fFileList.size() == 0) {
+    ORLog(kDebug) << "OpenDataStream(): no more files to open. " << endl;
+    return false;
+  }
+  ORLog(kDebug) << "OpenDataStream(): mapping file " << fFileList[0] << endl;
+  Close();
+  if(ORDecompressionBuffer::FormatOf(fFileList[0]) != ORDecompressionBuffer::kUncompressed) {
+    ORLog(kError) << fFileList[0] << " is compressed and can not be mapped; "
+                  << "read it with ORFileReader instead" << endl;
+    return false;
+  }
+  fFileDescriptor = open(fFileList[0].c_str(), O_RDONLY);
+  struct stat attrib;
+  if(fFileDescriptor < 0 || fstat(fFileDescriptor, &attrib) != 0) {
+    ORLog(kError) << "Could not open file " << fFileList[0] << endl;
+    Close();
+    return false;
+  }
+  fFileSize = (size_t) attrib.st_size;
+  if(fFileSize > 0) {
+    void* mapping = mmap(NULL, fFileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                         fFileDescriptor, 0);
+    if(mapping == MAP_FAILED) {
+      ORLog(kError) << "Could not map file " << fFileList[0] << endl;
+      Close();
+      return false;
+    }
+    fMapping = (char*) mapping;
+    // We stream through the file exactly once.
+    madvise(fMapping, fFileSize, MADV_SEQUENTIAL);
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fFileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  }
+  fCurrentFileName = fFileList[0];
+  fFileList.erase(fFileList.begin());
+  return true;
+}
+
+void ORMappedFileReader::Close()
+{
+  if(fMapping != NULL) munmap(fMapping, fFileSize);
+  if(fFileDescriptor >= 0) close(fFileDescriptor);
+  fMapping = NULL;
+  fFileDescriptor = -1;
+  fFileSize = 0;
+  fPosition = 0;
+  fReleasedUpTo = 0;
+  fCurrentFileName = "";
+}
+
+bool ORMappedFileReader::AdvanceToReadableFile()
+{
+  while(fMapping == NULL || fPosition >= fFileSize) {
+    if(fFileList.size() == 0) return false;
+    Close();
+    if(!Open()) return false;
+  }
+  return true;
+}
+
+size_t ORMappedFileReader::Read(char* buffer, size_t nBytesMax)
+{
+  size_t nBytesRead = 0;
+  while(nBytesRead < nBytesMax && AdvanceToReadableFile()) {
+    size_t nBytes = nBytesMax - nBytesRead;
+    if(nBytes > fFileSize - fPosition) nBytes = fFileSize - fPosition;
+    memcpy(buffer + nBytesRead, fMapping + fPosition, nBytes);
+    fPosition += nBytes;
+    nBytesRead += nBytes;
+  }
+  return nBytesRead;
+}
+
+bool ORMappedFileReader::ReadRecordView(vector<UInt_t>& buffer, UInt_t*& record)
+{
+  if(!AdvanceToReadableFile()) return false;
+
+  // Everything in front of the record we are about to hand out has been
+  // processed by now.
+  ReleaseConsumedPages(fPosition);
+
+  // The stream version isn't known until the first word of the file has
+  // been looked at, and swapped records are modified in place: both go
+  // through the copying path.
+  if(fStreamVersion == ORHeaderDecoder::kUnknownVersion || MustSwap()) {
+    return ORVReader::ReadRecordView(buffer, record);
+  }
+
+  size_t nBytesLeft = fFileSize - fPosition;
+  if(nBytesLeft < sizeof(UInt_t)) {
+    ORLog(kWarning) << "ReadRecordView(): " << nBytesLeft
+                    << " trailing bytes in file " << fCurrentFileName << endl;
+    fPosition = fFileSize;
+    return false;
+  }
+  UInt_t* theRecord = (UInt_t*) (fMapping + fPosition);
+  size_t recordLength = fBasicDecoder.LengthOf(theRecord);
+  if (recordLength < 1) {
+    ORLog(kError) << "Record length is less than one!" << endl;
+    fPosition += sizeof(UInt_t);
+    return false;
+  }
+  if(recordLength*sizeof(UInt_t) > nBytesLeft) {
+    ORLog(kWarning) << "ReadRecordView(): record of " << recordLength*sizeof(UInt_t)
+                    << " B only has " << nBytesLeft << " B left in file "
+                    << "(id = " << fBasicDecoder.DataIdOf(theRecord) << ", "
+                    << "len = " << recordLength << ")" << endl;
+    fPosition = fFileSize;
+    return false;
+  }
+  fPosition += recordLength*sizeof(UInt_t);
+  record = theRecord;
+
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) {
+    char type = 'l';
+    if (fHeaderDecoder.IsHeader(record[0])) type = 'h';
+    else if (fBasicDecoder.IsShort(record)) type = 's';
+    ORLog(kDebug) << "ReadRecordView(): " << type << ": id = "
+                  << setw(11) << fBasicDecoder.DataIdOf(record)
+                  << "\tlen = " << recordLength << endl;
+  }
+  return true;
+}
+
+bool ORMappedFileReader::ReadRecords(ORRecordBatch& batch)
+{
+  batch.Clear();
+  if(!AdvanceToReadableFile()) return false;
+
+  // All records of the previous batch have been processed by now.
+  ReleaseConsumedPages(fPosition);
+
+  if(fStreamVersion == ORHeaderDecoder::kUnknownVersion || MustSwap()) {
+    return ORVReader::ReadRecords(batch);
+  }
+
+  size_t nLongsLeft = (fFileSize - fPosition)/sizeof(UInt_t);
+  size_t nLongsFramed = 0;
+  batch.UseExternalArena((UInt_t*) (fMapping + fPosition));
+  bool isOK = FrameRecords(batch, nLongsLeft, nLongsFramed);
+  fPosition += nLongsFramed*sizeof(UInt_t);
+  if(batch.GetNRecords() > 0) return true;
+  if(!isOK) {
+    // skip the corrupt word so that we don't get stuck on it
+    fPosition += sizeof(UInt_t);
+    return false;
+  }
+  ORLog(kWarning) << "ReadRecords(): " << fFileSize - fPosition 
+                  << " B of incomplete record at the end of file " 
+                  << fCurrentFileName << endl;
+  fPosition = fFileSize;
+  return false;
+}
+
+void ORMappedFileReader::ReleaseConsumedPages(size_t upTo)
+{
+  if(fReleaseChunkSize == 0 || fMapping == NULL) return;
+  if(upTo < fReleasedUpTo + fReleaseChunkSize) return;
+  size_t releaseEnd = upTo - (upTo % fPageSize);
+  if(releaseEnd <= fReleasedUpTo) return;
+  madvise(fMapping + fReleasedUpTo, releaseEnd - fReleasedUpTo, MADV_DONTNEED);
+#ifdef POSIX_FADV_DONTNEED
+  posix_fadvise(fFileDescriptor, fReleasedUpTo, releaseEnd - fReleasedUpTo,
+                POSIX_FADV_DONTNEED);
+#endif
+  fReleasedUpTo = releaseEnd;
+}
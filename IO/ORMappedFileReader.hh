@@ -0,0 +1,75 @@
+// ORMappedFileReader.hh
+
+#ifndef _ORMappedFileReader_hh_
+#define _ORMappedFileReader_hh_
+
+#include <string>
+#include <vector>
+#ifndef _ORVReader_hh_
+#include "ORVReader.hh"
+#endif
+
+//! Class to read in files through a memory mapping
+/*!
+   This class reads in Orca files that have been saved to disk, just like
+   ORFileReader, but maps each file into memory instead of read()-ing it.
+   ReadRecordView() hands out pointers directly into the mapping, so records
+   are never copied unless they must be byte-swapped (in which case they are
+   copied into the caller's buffer, since swapping happens in place).
+
+   The mapping is private and writable: processors that modify a record in
+   place only touch a private copy of the page, never the file.  Pages that
+   lie behind the record currently being processed are periodically released
+   back to the kernel so that the resident size stays flat even for very
+   large files.  This class can not exist across threads.
+ */
+class ORMappedFileReader : public ORVReader
+{
+  public:
+    ORMappedFileReader(std::string filename = "");
+    virtual ~ORMappedFileReader();
+
+    virtual size_t Read(char* buffer, size_t nBytesMax);
+    virtual bool ReadRecordView(std::vector<UInt_t>& buffer, UInt_t*& record);
+    //! Frames records in place: the batch points into the mapping.
+    virtual bool ReadRecords(ORRecordBatch& batch);
+    virtual bool OKToRead() { return (fFileList.size() > 0) ||
+                                     (fMapping != NULL && fPosition < fFileSize); }
+
+    //! Open the next file in the file list.
+    virtual bool OpenDataStream();
+    virtual void Close();
+
+    //! Add a file to the file list.
+    virtual void AddFileToProcess(std::string filename)
+      { fFileList.push_back(filename); }
+
+    //! Get name of current file
+    virtual const std::string& GetFileName() const { return fCurrentFileName; }
+
+    /*!
+       Pages behind the current record are handed back to the kernel in
+       chunks of at least this many bytes (default 64 MB).  0 disables the
+       release, keeping everything that was read resident.
+     */
+    virtual void SetReleaseChunkSize(size_t nBytes) { fReleaseChunkSize = nBytes; }
+
+  protected:
+    //! Release pages lying entirely before offset upTo.
+    virtual void ReleaseConsumedPages(size_t upTo);
+    //! Opens the next file if the current one is exhausted.
+    virtual bool AdvanceToReadableFile();
+
+  protected:
+    std::vector<std::string> fFileList;
+    std::string fCurrentFileName;
+    int fFileDescriptor;
+    char* fMapping;
+    size_t fFileSize;
+    size_t fPosition;
+    size_t fReleasedUpTo;
+    size_t fReleaseChunkSize;
+    size_t fPageSize;
+};
+
+#endif
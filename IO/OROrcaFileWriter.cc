@@ -2,11 +2,42 @@
 #include "ORLogger.hh"
 #include "ORUtils.hh"
 #include "ORRunContext.hh"
+#include "ORWriteBehindBuffer.hh"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
 OROrcaFileWriter::OROrcaFileWriter(const std::string& label) {
   SetLabel(label);
+  fBuffer = NULL;
+  fRunContext = NULL;
+  fNBuffers = 4;
+  fBufferSize = 4*1024*1024;
+  fDirectIO = false;
+  fMaxFileSize = 0;
+  fRotateOnRun = false;
+  fRotateOnSubRun = false;
+  fRunNumber = -1;
+  fSubRunNumber = -1;
+  fFileIndex = 0;
+  fNHeaderBytes = 0;
+}
+
+OROrcaFileWriter::~OROrcaFileWriter() {
+  Close();
+  delete fBuffer;
+}
+
+void OROrcaFileWriter::SetBuffering(size_t nBuffers, size_t nBytesPerBuffer) {
+  fNBuffers = nBuffers;
+  fBufferSize = nBytesPerBuffer;
+  if(fBuffer!=NULL && !fBuffer->IsActive()) {
+    delete fBuffer;
+    fBuffer = NULL;
+  }
 }
 
 size_t OROrcaFileWriter::Open(ORRunContext* runContext) {
@@ -16,51 +47,119 @@ size_t OROrcaFileWriter::Open(ORRunContext* runContext) {
     ORLog(kWarning) << "Open: fRunContext is NULL." << endl;
     return 0;
   }
+  fRunNumber = fRunContext->GetRunNumber();
+  fSubRunNumber = fRunContext->GetSubRunNumber();
+  fFileIndex = 0;
+  return OpenFile();
+}
 
-  string filename = fLabel + ::Form("_run%d", fRunContext->GetRunNumber());
-  fOut.open(filename.c_str());
+size_t OROrcaFileWriter::OpenFile() {
+  Close();
+  if(fBuffer==NULL) fBuffer = new ORWriteBehindBuffer(fNBuffers, fBufferSize);
 
-  if(!IsWritable()) {
-    ORLog(kError) << "Could not open file " << filename << " to write" << endl;
+  fFileName = fLabel + ::Form("_run%d", fRunNumber);
+  if(fFileIndex > 0) fFileName += ::Form("_%d", (int) fFileIndex);
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  int fileDescriptor = -1;
+  if(fDirectIO) {
+#ifdef O_DIRECT
+    fileDescriptor = open(fFileName.c_str(), flags | O_DIRECT, 0666);
+    if(fileDescriptor < 0 && errno == EINVAL) {
+      ORLog(kWarning) << "Open: O_DIRECT not supported for " << fFileName
+                      << ", writing through the page cache" << endl;
+    }
+#else
+    ORLog(kWarning) << "Open: O_DIRECT not available, writing through the page cache" << endl;
+#endif
+  }
+  if(fileDescriptor < 0) fileDescriptor = open(fFileName.c_str(), flags, 0666);
+
+  if(fileDescriptor < 0) {
+    ORLog(kError) << "Could not open file " << fFileName << " to write: " 
+                  << strerror(errno) << endl;
+    return 0;
+  }
+  if(!fBuffer->Start(fileDescriptor)) {
+    close(fileDescriptor);
     return 0;
   }
-  return WriteHeader()==0;
+  fNHeaderBytes = WriteHeader();
+  return fNHeaderBytes;
 }
 
+void OROrcaFileWriter::Close() {
+  if(fBuffer==NULL || !fBuffer->IsActive()) return;
+  if(!fBuffer->Stop()) {
+    ORLog(kError) << "Close: not all data could be written to " << fFileName << endl;
+  }
+}
 
+bool OROrcaFileWriter::IsWritable() {
+  return fBuffer!=NULL && fBuffer->IsActive() && fBuffer->IsGood() && fRunContext!=NULL;
+}
 
 size_t OROrcaFileWriter::WriteHeader() {
   if(!IsWritable()) {
     ORLog(kWarning) << "WriteHeader: could not write header xml to file." << endl;
     return 0;
   }
-  
+
   const TString& header = fRunContext->GetHeader()->GetRawXML();
-  UInt_t word = header.Length()/4 + 2;
+  size_t nPadding = (4 - header.Length()%4)%4;
+  UInt_t words[2];
   //first word is packet length
-  fOut.write((const char*)(&word), 4);
+  words[0] = (header.Length() + nPadding)/4 + 2;
   //second word is length of plist in chars. End is padded with zeros, so do not count these
-  word = header.Length();
-  while(header[word-1] == 0) word--;
-  fOut.write((const char*)(&word), 4);
-  fOut.write((const char*)header, header.Length());
-  return header.Length() + 8;
+  words[1] = header.Length();
+  while(words[1] > 0 && header[words[1]-1] == 0) words[1]--;
+  //the header goes in the byte order of the records
+  WriteWords(words, 2, fRunContext->MustSwap());
+  fBuffer->Write((const char*)header, header.Length());
+  const char zeros[4] = {0, 0, 0, 0};
+  fBuffer->Write(zeros, nPadding);
+  return header.Length() + nPadding + 8;
 }
 
 size_t OROrcaFileWriter::WriteDataRecord(UInt_t* record) {
   if(!IsWritable()) {
     ORLog(kWarning) << "WriteDataRecord: could not write record to file." << endl;
     return 0;
-  }    
-  
-  //unswap records as needed
-  if(fRunContext->MustSwap()) ORUtils::Swap(record[0]);
-  if(fRunContext->IsRecordSwapped()) {
-    fDecoder.Swap(record);
-    fRunContext->SetRecordSwapped(false);
   }
-  fOut.write((const char*)record, fDecoder.LengthOf(record)*sizeof(UInt_t));
-  //re-swap first record if needed
-  if(fRunContext->MustSwap()) ORUtils::Swap(record[0]);
-  return fDecoder.LengthOf(record)*sizeof(UInt_t);
+
+  // the first word has always been swapped by the reader
+  size_t nWords = fDecoder.LengthOf(record);
+  size_t nBytes = nWords*sizeof(UInt_t);
+
+  if(fRotateOnRun && fRunContext->GetRunNumber() != fRunNumber) {
+    fRunNumber = fRunContext->GetRunNumber();
+    fSubRunNumber = fRunContext->GetSubRunNumber();
+    fFileIndex = 0;
+    if(OpenFile() == 0) return 0;
+  } else if(fRotateOnSubRun && fRunContext->GetSubRunNumber() != fSubRunNumber) {
+    fSubRunNumber = fRunContext->GetSubRunNumber();
+    fFileIndex++;
+    if(OpenFile() == 0) return 0;
+  } else if(fMaxFileSize > 0 && fBuffer->GetNBytesWritten() > fNHeaderBytes &&
+            fBuffer->GetNBytesWritten() + nBytes > fMaxFileSize) {
+    fFileIndex++;
+    if(OpenFile() == 0) return 0;
+  }
+
+  //records come in host order: swap them back into the order of the stream
+  WriteWords(record, nWords, fRunContext->MustSwap());
+  return nBytes;
+}
+
+void OROrcaFileWriter::WriteWords(const UInt_t* words, size_t nWords, bool swap) {
+  while(nWords > 0) {
+    size_t nBytesFree = 0;
+    UInt_t* out = (UInt_t*) fBuffer->GetWritePointer(nBytesFree);
+    size_t nWordsToCopy = nBytesFree/sizeof(UInt_t);
+    if(nWordsToCopy > nWords) nWordsToCopy = nWords;
+    if(swap) ORUtils::SwapBlock(words, out, nWordsToCopy);
+    else memcpy(out, words, nWordsToCopy*sizeof(UInt_t));
+    fBuffer->CommitWrite(nWordsToCopy*sizeof(UInt_t));
+    words += nWordsToCopy;
+    nWords -= nWordsToCopy;
+  }
 }
@@ -3,32 +3,56 @@
 #ifndef _OROrcaFileWriter_hh_
 #define _OROrcaFileWriter_hh_
 
-#include <fstream>
 #include <string>
 #include "ORBasicDataDecoder.hh"
 
 //! Write data packets to a binary orca file verbatim.
+/*!
+   Records are copied into large output buffers, which a background thread
+   writes to disk (see ORWriteBehindBuffer), so the processing thread
+   doesn't wait for each write.  Records are written in the byte order of
+   the stream they came from, without changing the caller's copy.
+
+   Output can be rotated to a new file when the run or the sub-run changes
+   or when a file would grow beyond a maximum size.  Every file starts with
+   the header, so each can be read on its own.  The first file of a run is
+   called label_run#, later ones label_run#_1, label_run#_2 and so on.
+ */
 
 class ORRunContext;
+class ORWriteBehindBuffer;
 
 class OROrcaFileWriter
 {
   public:
     OROrcaFileWriter(const std::string& label = "");
-    virtual ~OROrcaFileWriter() { }
+    virtual ~OROrcaFileWriter();
 
-    /*! Open file and write XML header. Return number of bytes 
+    /*! Open file and write XML header. Return number of bytes
         written in XML header
     */
     virtual size_t Open(ORRunContext* runContext=NULL);
     //! Save and close file
-    virtual void Close() { fOut.close(); }
-    virtual bool IsWritable() { return fOut.is_open() && fOut.good() && fRunContext!=NULL; }
-  
+    virtual void Close();
+    virtual bool IsWritable();
+
     //! File name is label_run#
     virtual void SetLabel(const std::string& label) { fLabel = label; }
     virtual void SetRunContext(ORRunContext* runContext) { fRunContext = runContext; }
 
+    //! Output buffering; takes effect at the next Open().
+    virtual void SetBuffering(size_t nBuffers, size_t nBytesPerBuffer);
+    //! Write with O_DIRECT, bypassing the page cache, where supported.
+    virtual void SetDirectIO(bool directIO = true) { fDirectIO = directIO; }
+    //! Start a new file before one grows beyond nBytes (0: never).
+    virtual void SetMaxFileSize(size_t nBytes) { fMaxFileSize = nBytes; }
+    //! Start a new file when the run number changes.
+    virtual void SetRotateOnRun(bool rotate = true) { fRotateOnRun = rotate; }
+    //! Start a new file when the sub-run number changes.
+    virtual void SetRotateOnSubRun(bool rotate = true) { fRotateOnSubRun = rotate; }
+    //! Name of the file currently written to.
+    virtual const std::string& GetFileName() const { return fFileName; }
+
     //! Return number of bytes written.
     virtual size_t WriteDataRecord(UInt_t* record);
     virtual inline OROrcaFileWriter& operator<<(UInt_t* record)
@@ -41,12 +65,27 @@ class OROrcaFileWriter
         called when opening file.
     */
     virtual size_t WriteHeader();
-  
+    //! Open the next file of the run, and write the header to it.
+    virtual size_t OpenFile();
+    //! Copy nWords to the output buffer, swapping them if swap is set.
+    virtual void WriteWords(const UInt_t* words, size_t nWords, bool swap);
+
   protected:
-    std::ofstream fOut;
+    ORWriteBehindBuffer* fBuffer;
     std::string fLabel;
+    std::string fFileName;
     ORBasicDataDecoder fDecoder;
     ORRunContext* fRunContext;
+    size_t fNBuffers;
+    size_t fBufferSize;
+    bool fDirectIO;
+    size_t fMaxFileSize;
+    bool fRotateOnRun;
+    bool fRotateOnSubRun;
+    Int_t fRunNumber;
+    Int_t fSubRunNumber;
+    size_t fFileIndex;
+    size_t fNHeaderBytes;
 };
 
 #endif
@@ -0,0 +1,371 @@
+// ORPacketIndex.cc
+
+#include "ORPacketIndex.hh"
+
+#include "ORDecompressionBuffer.hh"
+#include "ORFileReader.hh"
+#include "ORHeader.hh"
+#include "ORHeaderDecoder.hh"
+#include "ORLogger.hh"
+#include "ORUtils.hh"
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char kIndexMagic[8] = { 'O', 'R', 'P', 'K', 'T', 'I', 'D', 'X' };
+static const UInt_t kIndexVersion = 1;
+static const UInt_t kIndexByteOrder = 0x01020304;
+
+ORPacketIndex::ORPacketIndex()
+{
+  fNPackets = 0;
+  fHeaderLength = 0;
+  fOffset = 0;
+  fRunDataId = ORVDataDecoder::GetIllegalDataId();
+  fHeaderIsLoaded = false;
+}
+
+ORPacketIndex::~ORPacketIndex()
+{
+  if(IsBuilding()) AbortBuilding();
+  Close();
+}
+
+bool ORPacketIndex::Build(const string& dataFileName)
+{
+  if(!BeginBuilding(dataFileName)) return false;
+  ORFileReader reader(dataFileName);
+  ORRecordBatch batch;
+  if(!reader.Open()) {
+    AbortBuilding();
+    return false;
+  }
+  while(reader.ReadRecords(batch)) {
+    for(size_t i=0; i<batch.GetNRecords(); i++) {
+      if(!AddRecord(batch.GetRecord(i), reader.MustSwap() && !batch.IsRecordSwapped(i))) {
+        AbortBuilding();
+        return false;
+      }
+    }
+  }
+  reader.Close();
+  return FinishBuilding();
+}
+
+bool ORPacketIndex::StatDataFile(const string& dataFileName,
+                                 ULong64_t& size, Long64_t& time)
+{
+  struct stat attrib;
+  if(stat(dataFileName.c_str(), &attrib) != 0) return false;
+  size = attrib.st_size;
+  time = attrib.st_mtime;
+  return true;
+}
+
+bool ORPacketIndex::Open(const string& dataFileName)
+{
+  Close();
+  string indexFileName = IndexFileNameOf(dataFileName);
+  fIndexFile.open(indexFileName.c_str(), ios::in | ios::binary);
+  if(!fIndexFile.is_open()) return false;
+
+  IndexHeader header;
+  fIndexFile.read((char*) &header, sizeof(header));
+  if(fIndexFile.gcount() != sizeof(header) ||
+     memcmp(header.fMagic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+     header.fVersion != kIndexVersion || header.fByteOrder != kIndexByteOrder) {
+    ORLog(kWarning) << indexFileName << " is not a packet index of this version "
+                    << "or byte order; ignoring it" << endl;
+    Close();
+    return false;
+  }
+  ULong64_t size = 0;
+  Long64_t time = 0;
+  if(!StatDataFile(dataFileName, size, time) ||
+     size != header.fDataFileSize || time != header.fDataFileTime) {
+    ORLog(kWarning) << indexFileName << " is out of date; ignoring it" << endl;
+    Close();
+    return false;
+  }
+
+  fDataFileName = dataFileName;
+  fNPackets = header.fNPackets;
+  fHeaderLength = header.fHeaderLength;
+  fRunRecords.resize(header.fNRunRecords);
+  fTimestamps.resize(header.fNTimestamps);
+  fIndexFile.seekg(sizeof(header) + fNPackets*sizeof(PacketEntry));
+  if(fRunRecords.size() > 0) {
+    fIndexFile.read((char*) &fRunRecords[0], fRunRecords.size()*sizeof(RunRecordEntry));
+  }
+  if(fTimestamps.size() > 0) {
+    fIndexFile.read((char*) &fTimestamps[0], fTimestamps.size()*sizeof(TimestampEntry));
+  }
+  if(!fIndexFile.good()) {
+    ORLog(kWarning) << indexFileName << " is truncated; ignoring it" << endl;
+    Close();
+    return false;
+  }
+  ORLog(kDebug) << "Open(): " << indexFileName << " indexes " << fNPackets
+                << " packets" << endl;
+  return true;
+}
+
+void ORPacketIndex::Close()
+{
+  if(fIndexFile.is_open()) fIndexFile.close();
+  fIndexFile.clear();
+  fDataFileName = "";
+  fNPackets = 0;
+  fHeaderLength = 0;
+  fRunRecords.clear();
+  fTimestamps.clear();
+}
+
+bool ORPacketIndex::GetPacket(ULong64_t packet, PacketEntry& entry)
+{
+  if(!IsOpen() || packet >= fNPackets) return false;
+  fIndexFile.clear();
+  fIndexFile.seekg(sizeof(IndexHeader) + packet*sizeof(PacketEntry));
+  fIndexFile.read((char*) &entry, sizeof(entry));
+  return fIndexFile.gcount() == sizeof(entry);
+}
+
+vector<ULong64_t> ORPacketIndex::GetRunRecordsToReplay(ULong64_t fromPacket,
+                                                       ULong64_t toPacket) const
+{
+  // Find the run start in effect at toPacket and collect what happened
+  // to that run since.
+  size_t iRunStart = fRunRecords.size();
+  for(size_t i=0; i<fRunRecords.size() && fRunRecords[i].fPacket < toPacket; i++) {
+    if(fRunRecords[i].fType == kRunStart) iRunStart = i;
+  }
+  vector<ULong64_t> packets;
+  if(iRunStart == fRunRecords.size()) return packets;
+
+  packets.push_back(fRunRecords[iRunStart].fPacket);
+  size_t iSubRun = fRunRecords.size();
+  for(size_t i=iRunStart+1; i<fRunRecords.size() && fRunRecords[i].fPacket < toPacket; i++) {
+    if(fRunRecords[i].fType == kRunStop) {
+      // the run is over: everything after this gets dropped anyways
+      iSubRun = fRunRecords.size();
+      packets.push_back(fRunRecords[i].fPacket);
+      break;
+    }
+    iSubRun = i;
+  }
+  if(iSubRun != fRunRecords.size()) packets.push_back(fRunRecords[iSubRun].fPacket);
+
+  // Only what hasn't been read yet needs replaying.
+  vector<ULong64_t> toReplay;
+  for(size_t i=0; i<packets.size(); i++) {
+    if(packets[i] >= fromPacket) toReplay.push_back(packets[i]);
+  }
+  return toReplay;
+}
+
+void ORPacketIndex::AddTimestampSource(const string& dataObjectPath,
+                                       size_t iLowWord, size_t iHighWord,
+                                       UInt_t highMask)
+{
+  TimestampSource source;
+  source.fDataObjectPath = dataObjectPath;
+  source.fDataId = ORVDataDecoder::GetIllegalDataId();
+  source.fLowWord = iLowWord;
+  source.fHighWord = iHighWord;
+  source.fHighMask = highMask;
+  fTimestampSources.push_back(source);
+}
+
+bool ORPacketIndex::BeginBuilding(const string& dataFileName)
+{
+  if(IsBuilding()) AbortBuilding();
+  // Offsets into a compressed file are meaningless
+  if(ORDecompressionBuffer::FormatOf(dataFileName) != ORDecompressionBuffer::kUncompressed) {
+    ORLog(kError) << "Can't index compressed file " << dataFileName << endl;
+    return false;
+  }
+
+  // Old-style headers are text, and don't tile the file with records.
+  char firstWord[4];
+  ifstream dataFile(dataFileName.c_str(), ios::in | ios::binary);
+  dataFile.read(firstWord, sizeof(firstWord));
+  if(dataFile.gcount() != sizeof(firstWord) || memcmp(firstWord, "<?xm", 4) == 0) {
+    ORLog(kError) << "Can't index " << dataFileName
+                  << ": no data or an old-style header" << endl;
+    return false;
+  }
+
+  string tmpFileName = IndexFileNameOf(dataFileName) + ".tmp";
+  fBuildFile.open(tmpFileName.c_str(), ios::out | ios::binary | ios::trunc);
+  if(!fBuildFile.is_open()) {
+    ORLog(kWarning) << "Can't write packet index " << tmpFileName << endl;
+    return false;
+  }
+  // The header is filled in by FinishBuilding()
+  IndexHeader header;
+  memset(&header, 0, sizeof(header));
+  fBuildFile.write((char*) &header, sizeof(header));
+
+  fDataFileName = dataFileName;
+  fNPackets = 0;
+  fHeaderLength = 0;
+  fOffset = 0;
+  fHeaderIsLoaded = false;
+  fRunDataId = ORVDataDecoder::GetIllegalDataId();
+  fRunRecords.clear();
+  fTimestamps.clear();
+  return true;
+}
+
+bool ORPacketIndex::AddRecord(UInt_t* record, bool mustSwap)
+{
+  if(!IsBuilding()) return false;
+  ULong64_t nBytes = fRunDecoder.LengthOf(record)*sizeof(UInt_t);
+  if(!fHeaderIsLoaded) {
+    if(!LoadHeader(record)) return false;
+    fHeaderLength = nBytes;
+    fOffset = nBytes;
+    return true;
+  }
+  UInt_t dataId = fRunDecoder.DataIdOf(record);
+  if(dataId == 0) {
+    ORLog(kError) << "AddRecord(): second header in " << fDataFileName << endl;
+    return false;
+  }
+
+  PacketEntry entry;
+  entry.fOffset = fOffset;
+  entry.fDataId = dataId;
+  entry.fLength = fRunDecoder.LengthOf(record);
+  fBuildFile.write((char*) &entry, sizeof(entry));
+  if(dataId == fRunDataId) AddRunRecord(record, mustSwap);
+  else if(fTimestampSources.size() > 0) AddTimestamp(record, mustSwap);
+
+  fOffset += nBytes;
+  fNPackets++;
+  return true;
+}
+
+bool ORPacketIndex::LoadHeader(UInt_t* record)
+{
+  ORHeaderDecoder headerDecoder;
+  if(!headerDecoder.IsHeader(record[0])) {
+    ORLog(kError) << "LoadHeader(): " << fDataFileName
+                  << " doesn't start with a header" << endl;
+    return false;
+  }
+  size_t nBytes = headerDecoder.NBytesOf(record);
+  ORHeader header;
+  if(!header.LoadHeaderString(headerDecoder.HeaderStringOf(record),
+                              (nBytes < 8) ? 0 : nBytes - 8)) {
+    ORLog(kError) << "LoadHeader(): couldn't parse header of " << fDataFileName << endl;
+    return false;
+  }
+  fRunDataId = header.GetDataId(fRunDecoder.GetDataObjectPath());
+  for(size_t i=0; i<fTimestampSources.size(); i++) {
+    fTimestampSources[i].fDataId = header.GetDataId(fTimestampSources[i].fDataObjectPath);
+  }
+  fHeaderIsLoaded = true;
+  return true;
+}
+
+void ORPacketIndex::AddRunRecord(UInt_t* record, bool mustSwap)
+{
+  // Work on a swapped copy: the record itself is swapped by the processors.
+  UInt_t words[4] = { record[0], 0, 0, 0 };
+  size_t nWords = fRunDecoder.LengthOf(record);
+  for(size_t i=1; i<4 && i<nWords; i++) {
+    words[i] = record[i];
+    if(mustSwap) ORUtils::Swap(words[i]);
+  }
+  if(fRunDecoder.IsHeartBeat(words)) return;
+
+  RunRecordEntry entry;
+  entry.fPacket = fNPackets;
+  entry.fRunNumber = fRunDecoder.RunNumberOf(words);
+  entry.fSubRunNumber = fRunDecoder.SubRunNumberOf(words);
+  entry.fReserved = 0;
+  // same precedence as ORRunDataProcessor::ProcessMyDataRecord()
+  if(fRunDecoder.IsRunStart(words)) entry.fType = kRunStart;
+  else if(fRunDecoder.IsPrepareForSubRun(words)) entry.fType = kPrepareForSubRun;
+  else if(fRunDecoder.IsSubRunStart(words)) entry.fType = kSubRunStart;
+  else entry.fType = kRunStop;
+  fRunRecords.push_back(entry);
+}
+
+void ORPacketIndex::AddTimestamp(UInt_t* record, bool mustSwap)
+{
+  UInt_t dataId = fRunDecoder.DataIdOf(record);
+  size_t nWords = fRunDecoder.LengthOf(record);
+  for(size_t i=0; i<fTimestampSources.size(); i++) {
+    const TimestampSource& source = fTimestampSources[i];
+    if(source.fDataId != dataId) continue;
+    if(source.fLowWord >= nWords || source.fHighWord >= nWords) return;
+    UInt_t low = record[source.fLowWord];
+    UInt_t high = record[source.fHighWord];
+    if(mustSwap) {
+      ORUtils::Swap(low);
+      ORUtils::Swap(high);
+    }
+    TimestampEntry entry;
+    entry.fPacket = fNPackets;
+    entry.fTimestamp = (((ULong64_t) (high & source.fHighMask)) << 32) | low;
+    fTimestamps.push_back(entry);
+    return;
+  }
+}
+
+bool ORPacketIndex::FinishBuilding()
+{
+  if(!IsBuilding()) return false;
+  if(fRunRecords.size() > 0) {
+    fBuildFile.write((char*) &fRunRecords[0], fRunRecords.size()*sizeof(RunRecordEntry));
+  }
+  if(fTimestamps.size() > 0) {
+    fBuildFile.write((char*) &fTimestamps[0], fTimestamps.size()*sizeof(TimestampEntry));
+  }
+
+  IndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.fMagic, kIndexMagic, sizeof(kIndexMagic));
+  header.fVersion = kIndexVersion;
+  header.fByteOrder = kIndexByteOrder;
+  header.fHeaderLength = fHeaderLength;
+  header.fNPackets = fNPackets;
+  header.fNRunRecords = fRunRecords.size();
+  header.fNTimestamps = fTimestamps.size();
+  bool isOK = StatDataFile(fDataFileName, header.fDataFileSize, header.fDataFileTime);
+  if(isOK && header.fDataFileSize != fOffset) {
+    ORLog(kWarning) << "FinishBuilding(): only " << fOffset << " of "
+                    << header.fDataFileSize << " B of " << fDataFileName
+                    << " are complete records" << endl;
+  }
+  fBuildFile.seekp(0);
+  fBuildFile.write((char*) &header, sizeof(header));
+  isOK = isOK && fBuildFile.good();
+  fBuildFile.close();
+
+  string indexFileName = IndexFileNameOf(fDataFileName);
+  string tmpFileName = indexFileName + ".tmp";
+  if(!isOK || rename(tmpFileName.c_str(), indexFileName.c_str()) != 0) {
+    ORLog(kWarning) << "Couldn't write packet index " << indexFileName << endl;
+    remove(tmpFileName.c_str());
+    return false;
+  }
+  ORLog(kRoutine) << "Wrote packet index " << indexFileName << " ("
+                  << fNPackets << " packets)" << endl;
+  fRunRecords.clear();
+  fTimestamps.clear();
+  return true;
+}
+
+void ORPacketIndex::AbortBuilding()
+{
+  if(!IsBuilding()) return;
+  fBuildFile.close();
+  remove((IndexFileNameOf(fDataFileName) + ".tmp").c_str());
+  fRunRecords.clear();
+  fTimestamps.clear();
+}
@@ -0,0 +1,155 @@
+// ORPacketIndex.hh
+
+#ifndef _ORPacketIndex_hh_
+#define _ORPacketIndex_hh_
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Rtypes.h"
+#ifndef _ORRunDecoder_hh_
+#include "ORRunDecoder.hh"
+#endif
+
+//! Packet index of an Orca file
+/*!
+   ORPacketIndex describes the sidecar file (see IndexFileNameOf()) written
+   next to a raw Orca file, allowing readers to jump straight to a given
+   packet instead of reading everything in front of it.  Packets are
+   numbered from 0 starting with the first record after the header; for
+   files starting with a run-start record (i.e. all files written by Orca)
+   this coincides with ORRunContext::GetPacketNumber().
+
+   The index holds, for every packet, its byte offset in the file, its
+   data ID and its length, followed by a table of the run-control records
+   (run start/stop and sub-run boundaries), and, optionally, timestamps
+   of the records of the devices registered with AddTimestampSource().
+
+   The packet table is read on demand with GetPacket(), so that indices of
+   very large files don't have to be held in memory.  The index is tied to
+   the size and modification time of the data file; a stale index is
+   refused by Open().
+
+   An index is built by feeding it all records of a file in order:
+   BeginBuilding(), AddRecord() for each record including the header, and
+   FinishBuilding().  Build() does this for a file on disk.  Indices can
+   only be built for files with new-style (binary) headers.  An object is
+   either building or reading an index at any one time, not both.
+ */
+class ORPacketIndex
+{
+  public:
+    enum ERunRecordType { kRunStart = 0, kRunStop, kSubRunStart, kPrepareForSubRun };
+
+    struct PacketEntry {
+      ULong64_t fOffset;
+      UInt_t fDataId;
+      UInt_t fLength;
+    };
+    struct RunRecordEntry {
+      ULong64_t fPacket;
+      Int_t fRunNumber;
+      Int_t fSubRunNumber;
+      UInt_t fType;
+      UInt_t fReserved;
+    };
+    struct TimestampEntry {
+      ULong64_t fPacket;
+      ULong64_t fTimestamp;
+    };
+
+    ORPacketIndex();
+    virtual ~ORPacketIndex();
+
+    //! Name of the index belonging to a data file
+    static std::string IndexFileNameOf(const std::string& dataFileName)
+      { return dataFileName + ".idx"; }
+    //! Scan dataFileName and write its index.  Returns true on success.
+    virtual bool Build(const std::string& dataFileName);
+
+    //! Open the index of dataFileName for reading.
+    virtual bool Open(const std::string& dataFileName);
+    virtual void Close();
+    virtual bool IsOpen() const { return fIndexFile.is_open(); }
+
+    virtual ULong64_t GetNPackets() const { return fNPackets; }
+    //! Byte length of the header record at the beginning of the file
+    virtual ULong64_t GetHeaderLength() const { return fHeaderLength; }
+    //! Reads the entry of packet from the index. Returns false if out of range.
+    virtual bool GetPacket(ULong64_t packet, PacketEntry& entry);
+    virtual const std::vector<RunRecordEntry>& GetRunRecords() const
+      { return fRunRecords; }
+    virtual const std::vector<TimestampEntry>& GetTimestamps() const
+      { return fTimestamps; }
+    /*!
+       Returns the run-control packets that must be processed when jumping
+       from fromPacket (the next packet that would have been read) to
+       toPacket so that the run is in the state it would have been had all
+       packets been read: the last run start and sub-run boundary as well as
+       any run stop in between.
+     */
+    virtual std::vector<ULong64_t> GetRunRecordsToReplay(ULong64_t fromPacket,
+                                                         ULong64_t toPacket) const;
+
+    /*!
+       Record a timestamp for each record of dataObjectPath (e.g.
+       "ORGretina4MModel:Gretina4M").  The timestamp is assembled from
+       the (swapped) words iLowWord and iHighWord of the record as
+       (high & highMask) << 32 | low.  Must be called before BeginBuilding().
+     */
+    virtual void AddTimestampSource(const std::string& dataObjectPath,
+                                    size_t iLowWord, size_t iHighWord,
+                                    UInt_t highMask = 0xffff);
+
+    virtual bool BeginBuilding(const std::string& dataFileName);
+    /*!
+       Adds the next record of the file.  The first word of the record must
+       already be swapped (as done by ORVReader), the rest not.
+     */
+    virtual bool AddRecord(UInt_t* record, bool mustSwap);
+    virtual bool FinishBuilding();
+    virtual void AbortBuilding();
+    virtual bool IsBuilding() const { return fBuildFile.is_open(); }
+
+  protected:
+    struct IndexHeader {
+      char fMagic[8];
+      UInt_t fVersion;
+      UInt_t fByteOrder;
+      ULong64_t fDataFileSize;
+      Long64_t fDataFileTime;
+      ULong64_t fHeaderLength;
+      ULong64_t fNPackets;
+      ULong64_t fNRunRecords;
+      ULong64_t fNTimestamps;
+    };
+    struct TimestampSource {
+      std::string fDataObjectPath;
+      UInt_t fDataId;
+      size_t fLowWord;
+      size_t fHighWord;
+      UInt_t fHighMask;
+    };
+
+    virtual bool StatDataFile(const std::string& dataFileName,
+                              ULong64_t& size, Long64_t& time);
+    virtual bool LoadHeader(UInt_t* record);
+    virtual void AddRunRecord(UInt_t* record, bool mustSwap);
+    virtual void AddTimestamp(UInt_t* record, bool mustSwap);
+
+  protected:
+    std::ifstream fIndexFile;
+    std::ofstream fBuildFile;
+    std::string fDataFileName;
+    ULong64_t fNPackets;
+    ULong64_t fHeaderLength;
+    ULong64_t fOffset;
+    UInt_t fRunDataId;
+    bool fHeaderIsLoaded;
+    std::vector<RunRecordEntry> fRunRecords;
+    std::vector<TimestampEntry> fTimestamps;
+    std::vector<TimestampSource> fTimestampSources;
+    ORRunDecoder fRunDecoder;
+};
+
+#endif
@@ -0,0 +1,181 @@
+// ORReadAheadBuffer.cc
+
+#include "ORReadAheadBuffer.hh"
+
+#include "ORLogger.hh"
+#include "ORThreadPlacement.hh"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+
+void* ReadAheadThread(void* readAheadBuffer)
+{
+  ((ORReadAheadBuffer*) readAheadBuffer)->FillBlocks();
+  return NULL;
+}
+
+ORReadAheadBuffer::ORReadAheadBuffer(size_t nBlocks, size_t nBytesPerBlock)
+{
+  fNBlocks = (nBlocks < 1) ? 1 : nBlocks;
+  fBlockSize = (nBytesPerBlock < 1) ? 1 : nBytesPerBlock;
+  fBlocks.resize(fNBlocks*fBlockSize);
+  ORThreadPlacement::BindMemory(&fBlocks[0], fBlocks.size(), ORThreadPlacement::kReader);
+  fBlockFill.resize(fNBlocks);
+  fFileDescriptor = -1;
+  fFirstFullBlock = 0;
+  fNFullBlocks = 0;
+  fFileIsDone = true;
+  fStopRequested = false;
+  fReadPosition = 0;
+  fThreadIsRunning = false;
+  pthread_mutex_init(&fMutex, NULL);
+  pthread_cond_init(&fBlockFilled, NULL);
+  pthread_cond_init(&fBlockFreed, NULL);
+}
+
+ORReadAheadBuffer::~ORReadAheadBuffer()
+{
+  Stop();
+  pthread_cond_destroy(&fBlockFreed);
+  pthread_cond_destroy(&fBlockFilled);
+  pthread_mutex_destroy(&fMutex);
+}
+
+bool ORReadAheadBuffer::Start(int fileDescriptor)
+{
+  // not virtual: derived classes call this after setting up the descriptor
+  ORReadAheadBuffer::Stop();
+  fFileDescriptor = fileDescriptor;
+  fFirstFullBlock = 0;
+  fNFullBlocks = 0;
+  fFileIsDone = false;
+  fStopRequested = false;
+  fReadPosition = 0;
+  if (ORThreadPlacement::CreateThread(&fThread, ORThreadPlacement::kReader, 0,
+                                      ReadAheadThread, this) != 0) {
+    ORLog(kError) << "Error starting read-ahead thread" << endl;
+    fFileIsDone = true;
+    return false;
+  }
+  fThreadIsRunning = true;
+  return true;
+}
+
+void ORReadAheadBuffer::Stop()
+{
+  if (fThreadIsRunning) {
+    pthread_mutex_lock(&fMutex);
+    fStopRequested = true;
+    pthread_cond_broadcast(&fBlockFreed);
+    pthread_mutex_unlock(&fMutex);
+    pthread_join(fThread, NULL);
+    fThreadIsRunning = false;
+  }
+  if (fFileDescriptor >= 0) close(fFileDescriptor);
+  fFileDescriptor = -1;
+  fFirstFullBlock = 0;
+  fNFullBlocks = 0;
+  fFileIsDone = true;
+  fReadPosition = 0;
+}
+
+size_t ORReadAheadBuffer::Read(char* buffer, size_t nBytes)
+{
+  size_t nBytesRead = 0;
+  while (nBytesRead < nBytes) {
+    pthread_mutex_lock(&fMutex);
+    while (fNFullBlocks == 0 && !fFileIsDone) {
+      pthread_cond_wait(&fBlockFilled, &fMutex);
+    }
+    if (fNFullBlocks == 0) {
+      pthread_mutex_unlock(&fMutex);
+      break;
+    }
+    size_t iBlock = fFirstFullBlock;
+    pthread_mutex_unlock(&fMutex);
+
+    // The thread doesn't touch full blocks, so copy without the lock.
+    size_t nBytesInBlock = fBlockFill[iBlock] - fReadPosition;
+    size_t nBytesToCopy = nBytes - nBytesRead;
+    if (nBytesToCopy > nBytesInBlock) nBytesToCopy = nBytesInBlock;
+    memcpy(buffer + nBytesRead, &fBlocks[iBlock*fBlockSize] + fReadPosition,
+           nBytesToCopy);
+    nBytesRead += nBytesToCopy;
+    fReadPosition += nBytesToCopy;
+
+    if (fReadPosition == fBlockFill[iBlock]) {
+      // Hand the block back to the thread.
+      pthread_mutex_lock(&fMutex);
+      fFirstFullBlock = (fFirstFullBlock + 1) % fNBlocks;
+      fNFullBlocks--;
+      fReadPosition = 0;
+      pthread_cond_signal(&fBlockFreed);
+      pthread_mutex_unlock(&fMutex);
+    }
+  }
+  return nBytesRead;
+}
+
+bool ORReadAheadBuffer::AtEnd()
+{
+  pthread_mutex_lock(&fMutex);
+  while (fNFullBlocks == 0 && !fFileIsDone) {
+    pthread_cond_wait(&fBlockFilled, &fMutex);
+  }
+  bool atEnd = (fNFullBlocks == 0);
+  pthread_mutex_unlock(&fMutex);
+  return atEnd;
+}
+
+bool ORReadAheadBuffer::HasReadAll()
+{
+  pthread_mutex_lock(&fMutex);
+  bool hasReadAll = fFileIsDone;
+  pthread_mutex_unlock(&fMutex);
+  return hasReadAll;
+}
+
+size_t ORReadAheadBuffer::FillBlock(char* block, size_t nBytesMax)
+{
+  size_t nBytesRead = 0;
+  while (nBytesRead < nBytesMax) {
+    ssize_t retVal = read(fFileDescriptor, block + nBytesRead, nBytesMax - nBytesRead);
+    if (retVal == 0) break;
+    if (retVal < 0) {
+      if (errno == EINTR) continue;
+      ORLog(kError) << "FillBlock(): read failed: " << strerror(errno) << endl;
+      break;
+    }
+    nBytesRead += retVal;
+  }
+  return nBytesRead;
+}
+
+void ORReadAheadBuffer::FillBlocks()
+{
+  while (1) {
+    pthread_mutex_lock(&fMutex);
+    while (fNFullBlocks == fNBlocks && !fStopRequested) {
+      pthread_cond_wait(&fBlockFreed, &fMutex);
+    }
+    if (fStopRequested) {
+      pthread_mutex_unlock(&fMutex);
+      return;
+    }
+    size_t iBlock = (fFirstFullBlock + fNFullBlocks) % fNBlocks;
+    pthread_mutex_unlock(&fMutex);
+
+    size_t nBytes = FillBlock(&fBlocks[iBlock*fBlockSize], fBlockSize);
+
+    pthread_mutex_lock(&fMutex);
+    fBlockFill[iBlock] = nBytes;
+    if (nBytes > 0) fNFullBlocks++;
+    bool isDone = (nBytes < fBlockSize);
+    if (isDone) fFileIsDone = true;
+    pthread_cond_signal(&fBlockFilled);
+    pthread_mutex_unlock(&fMutex);
+    if (isDone) return;
+  }
+}
@@ -0,0 +1,96 @@
+// ORReadAheadBuffer.hh
+
+#ifndef _ORReadAheadBuffer_hh_
+#define _ORReadAheadBuffer_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <pthread.h>
+#include <vector>
+
+extern "C" void* ReadAheadThread(void*);
+
+//! Multi-buffered asynchronous reader for a file descriptor
+/*!
+   ORReadAheadBuffer runs a thread which reads a file descriptor into a
+   ring of fixed-size blocks ahead of the consumer, so that reading the
+   disk overlaps with processing the data.  The consumer pulls bytes out
+   with Read(), which only blocks if the thread has not caught up yet.
+
+   The number of blocks (the read-ahead depth) and their size are fixed at
+   construction.  A block is only handed back to the thread once it has
+   been consumed completely, so at most nBlocks*nBytesPerBlock bytes are
+   held in memory.  Derived classes can change how a block is filled by
+   overriding FillBlock().  This class is not meant to be shared between
+   consumer threads.
+ */
+class ORReadAheadBuffer
+{
+  friend void* ReadAheadThread(void*);
+
+  public:
+    ORReadAheadBuffer(size_t nBlocks = 4, size_t nBytesPerBlock = 1024*1024);
+    virtual ~ORReadAheadBuffer();
+
+    /*!
+       Start reading fileDescriptor from its current position.  The buffer
+       takes ownership of the descriptor and closes it in Stop().
+       Returns false if the thread could not be started.
+     */
+    virtual bool Start(int fileDescriptor);
+    //! Stop the thread, drop all buffered data and close the descriptor.
+    virtual void Stop();
+    virtual bool IsActive() const { return fThreadIsRunning; }
+
+    /*!
+       Copies up to nBytes into buffer, blocking until they are available.
+       Returns fewer than nBytes only at the end of the file (or after a
+       read error).
+     */
+    virtual size_t Read(char* buffer, size_t nBytes);
+    /*!
+       True if everything in the file has been consumed.  Blocks until the
+       thread has either delivered more data or hit the end of the file.
+     */
+    virtual bool AtEnd();
+    //! True once the thread has read up to the end of the file; doesn't block.
+    virtual bool HasReadAll();
+
+    virtual size_t GetNBlocks() const { return fNBlocks; }
+    virtual size_t GetBlockSize() const { return fBlockSize; }
+
+  protected:
+    /*!
+       Fills block with up to nBytesMax bytes from fFileDescriptor.  Must
+       return less than nBytesMax only at the end of the file or on error.
+       Called from the read-ahead thread.
+     */
+    virtual size_t FillBlock(char* block, size_t nBytesMax);
+    //! Body of the read-ahead thread.
+    virtual void FillBlocks();
+
+  protected:
+    size_t fNBlocks;
+    size_t fBlockSize;
+    std::vector<char> fBlocks;
+    std::vector<size_t> fBlockFill;
+    int fFileDescriptor;
+
+  private:
+    /* Ring state; shared between the threads and guarded by fMutex. */
+    size_t fFirstFullBlock;
+    size_t fNFullBlocks;
+    bool fFileIsDone;
+    bool fStopRequested;
+    /* Consumer-only state. */
+    size_t fReadPosition;
+    bool fThreadIsRunning;
+
+    pthread_t fThread;
+    pthread_mutex_t fMutex;
+    pthread_cond_t fBlockFilled;
+    pthread_cond_t fBlockFreed;
+};
+
+#endif /* __CINT__ */
+#endif /* _ORReadAheadBuffer_hh_ */
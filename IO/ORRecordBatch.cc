@@ -0,0 +1,57 @@
+// ORRecordBatch.cc
+
+#include "ORRecordBatch.hh"
+
+ORRecordBatch::ORRecordBatch(size_t nBytesPerBlock)
+{
+  fBase = NULL;
+  fNLongs = 0;
+  fNext = 0;
+  fBlockSize = nBytesPerBlock;
+  fNSkipped = 0;
+  fIsReplayed = false;
+}
+
+void ORRecordBatch::Clear()
+{
+  fBase = fArena.empty() ? NULL : &fArena[0];
+  fOffsets.clear();
+  fIsSwapped.clear();
+  fNLongs = 0;
+  fNext = 0;
+  fNSkipped = 0;
+  fIsReplayed = false;
+}
+
+UInt_t* ORRecordBatch::ReserveLongs(size_t nLongs)
+{
+  if (fArena.size() < fNLongs + nLongs) {
+    // grow geometrically so that oversized records don't cost a
+    // reallocation each time
+    size_t newSize = 2*fArena.size();
+    if (newSize < fNLongs + nLongs) newSize = fNLongs + nLongs;
+    fArena.resize(newSize);
+  }
+  fBase = &fArena[0];
+  return fBase + fNLongs;
+}
+
+void ORRecordBatch::UseExternalArena(UInt_t* base)
+{
+  fBase = base;
+}
+
+void ORRecordBatch::SetRecordSwapped(size_t i)
+{
+  if (fIsSwapped.size() <= i) fIsSwapped.resize(i + 1, 0);
+  fIsSwapped[i] = 1;
+}
+
+void ORRecordBatch::Truncate(size_t nRecords)
+{
+  if (nRecords >= fOffsets.size()) return;
+  fNLongs = fOffsets[nRecords];
+  fOffsets.resize(nRecords);
+  if (fIsSwapped.size() > nRecords) fIsSwapped.resize(nRecords);
+  if (fNext > nRecords) fNext = nRecords;
+}
@@ -0,0 +1,115 @@
+// ORRecordBatch.hh
+
+#ifndef _ORRecordBatch_hh_
+#define _ORRecordBatch_hh_
+
+#include <vector>
+#include "Rtypes.h"
+
+//! Container for a batch of complete records read in one go
+/*!
+   ORRecordBatch holds a contiguous block of data words together with an
+   offset table pointing at the beginning of each complete record within
+   the block.  It is filled by ORVReader::ReadRecords() and consumed
+   record by record with NextRecord().
+
+   The block is normally the batch's own arena, but a reader can also point
+   the batch at an external region (e.g. a memory mapping) with
+   UseExternalArena(), in which case the records are never copied.  Records
+   returned by the batch are valid until the next call to Clear(), i.e.
+   until the next ReadRecords().
+ */
+class ORRecordBatch
+{
+  public:
+    ORRecordBatch(size_t nBytesPerBlock = 2*1024*1024);
+    virtual ~ORRecordBatch() {}
+
+    //! Forget all records; the arena is kept allocated.
+    virtual void Clear();
+
+    //! Number of records in the batch
+    virtual inline size_t GetNRecords() const { return fOffsets.size(); }
+    //! Number of data words used by the records in the batch
+    virtual inline size_t GetNLongs() const { return fNLongs; }
+    //! Returns the i-th record of the batch
+    virtual inline UInt_t* GetRecord(size_t i) { return fBase + fOffsets[i]; }
+
+    //! Number of records NextRecord() has returned so far
+    virtual inline size_t GetNConsumed() const { return fNext; }
+    //! True if NextRecord() will return another record.
+    virtual inline bool HasNext() const { return fNext < fOffsets.size(); }
+    //! Returns the next unconsumed record, or NULL if there are none left.
+    virtual inline UInt_t* NextRecord()
+      { return HasNext() ? GetRecord(fNext++) : NULL; }
+
+    /*!
+       Number of bytes readers should aim to put into a single batch.
+       A batch always holds at least one record, however long it is.
+     */
+    virtual inline size_t GetBlockSize() const { return fBlockSize; }
+    virtual void SetBlockSize(size_t nBytes) { fBlockSize = nBytes; }
+
+    /*!
+       Makes room for nLongs words behind the records already in the batch
+       and returns a pointer to the first of them.  The pointer (as well as
+       previously returned records) is invalidated by the next call.
+     */
+    virtual UInt_t* ReserveLongs(size_t nLongs);
+    //! Pointer to where the next record added to the batch will start.
+    virtual inline UInt_t* GetFillPosition() { return fBase + fNLongs; }
+    //! Adds the nLongs words at GetFillPosition() as a record to the batch.
+    virtual inline void AddRecord(size_t nLongs)
+      { fOffsets.push_back(fNLongs); fNLongs += nLongs; }
+
+    /*!
+       Let the records of this batch live in an external region starting at
+       base instead of the arena.  The batch must be empty.  The caller is
+       responsible for keeping the region valid until the next Clear().
+     */
+    virtual void UseExternalArena(UInt_t* base);
+
+    /*!
+       Readers that swap whole records as they read them (see
+       ORVReader::SetSwapDataIds()) mark them, so that they don't get
+       swapped again.
+     */
+    virtual inline bool IsRecordSwapped(size_t i) const
+      { return i < fIsSwapped.size() && fIsSwapped[i]; }
+    virtual void SetRecordSwapped(size_t i);
+
+    //! Drops all records from the nRecords-th on.
+    virtual void Truncate(size_t nRecords);
+
+    /*!
+       Readers that jump over records (see ORFileReader::AddPacketRange())
+       set the number of records skipped in front of the first record of
+       the batch, so that the consumer can keep count.
+     */
+    virtual void SetNSkipped(ULong64_t nSkipped) { fNSkipped = nSkipped; }
+    //! Returns the number of skipped records and resets it to zero.
+    virtual inline ULong64_t TakeNSkipped()
+      { ULong64_t nSkipped = fNSkipped; fNSkipped = 0; return nSkipped; }
+
+    /*!
+       Readers that jump over records also mark the batches holding the
+       records returned only to get the run into its state (see
+       ORFileReader::AddPacketRange()), which are not part of the selection.
+     */
+    virtual void SetIsReplayed(bool isReplayed = true) { fIsReplayed = isReplayed; }
+    virtual inline bool IsReplayed() const { return fIsReplayed; }
+
+  protected:
+    UInt_t* fBase;
+    std::vector<UInt_t> fArena;
+    std::vector<size_t> fOffsets;
+    /* Only as long as needed for the last swapped record. */
+    std::vector<char> fIsSwapped;
+    size_t fNLongs;
+    size_t fNext;
+    size_t fBlockSize;
+    ULong64_t fNSkipped;
+    bool fIsReplayed;
+};
+
+#endif
@@ -0,0 +1,191 @@
+// ORRingBuffer.cc
+
+#include "ORRingBuffer.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <sys/time.h>
+
+ORRingBuffer::ORRingBuffer(size_t nLongs)
+{
+  fBuffer = NULL;
+  fLength = 0;
+  fWriteIndex = 0;
+  fReadIndex = 0;
+  fIsClosed = 0;
+  fNext = NULL;
+  fConsumerIsWaiting = 0;
+  fProducerIsWaiting = 0;
+  pthread_mutex_init(&fMutex, NULL);
+  pthread_cond_init(&fCondition, NULL);
+  Resize(nLongs);
+}
+
+ORRingBuffer::~ORRingBuffer()
+{
+  delete [] fBuffer;
+  pthread_cond_destroy(&fCondition);
+  pthread_mutex_destroy(&fMutex);
+}
+
+void ORRingBuffer::Resize(size_t nLongs)
+{
+  if (nLongs != fLength) {
+    delete [] fBuffer;
+    fBuffer = (nLongs > 0) ? new UInt_t[nLongs] : NULL;
+    fLength = nLongs;
+  }
+  Reset();
+}
+
+void ORRingBuffer::Reset()
+{
+  __atomic_store_n(&fWriteIndex, 0, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&fReadIndex, 0, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&fIsClosed, 0, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&fNext, (ORRingBuffer*) NULL, __ATOMIC_SEQ_CST);
+}
+
+UInt_t* ORRingBuffer::GetWritePointer(size_t& nContiguous, size_t offset)
+{
+  size_t position = (fWriteIndex + offset) % fLength;
+  size_t nFree = GetNFree();
+  nContiguous = (offset < nFree) ? nFree - offset : 0;
+  if (nContiguous > fLength - position) nContiguous = fLength - position;
+  return fBuffer + position;
+}
+
+int ORRingBuffer::GetWriteRegion(size_t firstByte, size_t nBytes, 
+                                 struct iovec* pieces)
+{
+  int nPieces = 0;
+  while (nBytes > 0 && nPieces < 2) {
+    size_t nContiguous = 0;
+    char* start = (char*) GetWritePointer(nContiguous, firstByte/sizeof(UInt_t));
+    if (nContiguous == 0) break;
+    size_t nBytesContiguous = nContiguous*sizeof(UInt_t) - firstByte%sizeof(UInt_t);
+    if (nBytesContiguous > nBytes) nBytesContiguous = nBytes;
+    pieces[nPieces].iov_base = start + firstByte%sizeof(UInt_t);
+    pieces[nPieces].iov_len = nBytesContiguous;
+    nPieces++;
+    firstByte += nBytesContiguous;
+    nBytes -= nBytesContiguous;
+  }
+  return nPieces;
+}
+
+void ORRingBuffer::CommitWrite(size_t nLongs)
+{
+  __atomic_store_n(&fWriteIndex, fWriteIndex + nLongs, __ATOMIC_RELEASE);
+  Signal(fConsumerIsWaiting);
+}
+
+void ORRingBuffer::Write(const UInt_t* buffer, size_t nLongs)
+{
+  while (nLongs > 0) {
+    size_t nContiguous = 0;
+    UInt_t* destination = GetWritePointer(nContiguous);
+    if (nContiguous > nLongs) nContiguous = nLongs;
+    memcpy(destination, buffer, nContiguous*sizeof(UInt_t));
+    CommitWrite(nContiguous);
+    buffer += nContiguous;
+    nLongs -= nContiguous;
+  }
+}
+
+void ORRingBuffer::Close()
+{
+  __atomic_store_n(&fIsClosed, 1, __ATOMIC_RELEASE);
+  Signal(fConsumerIsWaiting);
+}
+
+void ORRingBuffer::CloseAndContinueIn(ORRingBuffer* next)
+{
+  // published before the ring is seen to be closed
+  __atomic_store_n(&fNext, next, __ATOMIC_RELEASE);
+  Close();
+}
+
+UInt_t* ORRingBuffer::GetReadPointer(size_t& nContiguous)
+{
+  size_t position = fReadIndex % fLength;
+  nContiguous = GetNLongs();
+  if (nContiguous > fLength - position) nContiguous = fLength - position;
+  return fBuffer + position;
+}
+
+void ORRingBuffer::CommitRead(size_t nLongs)
+{
+  __atomic_store_n(&fReadIndex, fReadIndex + nLongs, __ATOMIC_RELEASE);
+  Signal(fProducerIsWaiting);
+}
+
+size_t ORRingBuffer::Read(UInt_t* buffer, size_t nLongs)
+{
+  size_t nLongsRead = 0;
+  while (nLongsRead < nLongs) {
+    size_t nContiguous = 0;
+    const UInt_t* source = GetReadPointer(nContiguous);
+    if (nContiguous == 0) break;
+    if (nContiguous > nLongs - nLongsRead) nContiguous = nLongs - nLongsRead;
+    memcpy(buffer + nLongsRead, source, nContiguous*sizeof(UInt_t));
+    nLongsRead += nContiguous;
+    // hand the words back right away, so the producer can carry on
+    CommitRead(nContiguous);
+  }
+  return nLongsRead;
+}
+
+bool ORRingBuffer::WaitForData(size_t nLongs, long timeoutUSec)
+{
+  if (GetNLongs() >= nLongs) return true;
+  return Wait(fConsumerIsWaiting, true, nLongs, timeoutUSec);
+}
+
+bool ORRingBuffer::WaitForSpace(size_t nLongs, long timeoutUSec)
+{
+  if (GetNFree() >= nLongs) return true;
+  return Wait(fProducerIsWaiting, false, nLongs, timeoutUSec);
+}
+
+void ORRingBuffer::Signal(int& isWaiting)
+{
+  // Pairs with the fence in Wait(): either the waiter sees the new index,
+  // or we see that it is waiting.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (!__atomic_load_n(&isWaiting, __ATOMIC_RELAXED)) return;
+  pthread_mutex_lock(&fMutex);
+  pthread_cond_broadcast(&fCondition);
+  pthread_mutex_unlock(&fMutex);
+}
+
+bool ORRingBuffer::Wait(int& isWaiting, bool forData, size_t nLongs, long timeoutUSec)
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  struct timespec deadline;
+  long nanoSeconds = (now.tv_usec + timeoutUSec % 1000000)*1000;
+  deadline.tv_sec = now.tv_sec + timeoutUSec/1000000 + nanoSeconds/1000000000;
+  deadline.tv_nsec = nanoSeconds % 1000000000;
+
+  // Waiting threads must not be canceled while holding the mutex.
+  int cancelState;
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancelState);
+  __atomic_store_n(&isWaiting, 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  pthread_mutex_lock(&fMutex);
+  bool isReady = false;
+  while (1) {
+    isReady = forData ? (GetNLongs() >= nLongs) : (GetNFree() >= nLongs);
+    if (isReady || (forData && IsClosed())) break;
+    if (pthread_cond_timedwait(&fCondition, &fMutex, &deadline) == ETIMEDOUT) {
+      isReady = forData ? (GetNLongs() >= nLongs) : (GetNFree() >= nLongs);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&fMutex);
+  __atomic_store_n(&isWaiting, 0, __ATOMIC_RELAXED);
+  pthread_setcancelstate(cancelState, NULL);
+  return isReady;
+}
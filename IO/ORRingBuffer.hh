@@ -0,0 +1,143 @@
+// ORRingBuffer.hh
+
+#ifndef _ORRingBuffer_hh_
+#define _ORRingBuffer_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <pthread.h>
+#include <sys/uio.h>
+#include "Rtypes.h"
+#include "ORThreadPlacement.hh"
+
+//! Lock-free single-producer/single-consumer ring of 32-bit words
+/*!
+   ORRingBuffer passes data words from one producer thread to one consumer
+   thread without locks: the producer owns the write index and the
+   consumer owns the read index, and each publishes its index with release
+   semantics and reads the other's with acquire semantics.  Both indices
+   count words since the last Reset() and are taken modulo the length only
+   to address the buffer, so a full ring and an empty one can be told
+   apart without sacrificing a slot.
+
+   Either side may block waiting for the other with WaitForData() or
+   WaitForSpace().  Waiting uses a condition variable with a timeout, so
+   the waiter wakes as soon as the other side publishes, and the mutex is
+   only touched when somebody is actually waiting.  The timeout lets the
+   waiter check for cancellation periodically.
+
+   The producer marks the end of the data with Close(); after that the
+   consumer drains what is left and WaitForData() no longer blocks.  With
+   CloseAndContinueIn() the producer can instead move on to a new (e.g.
+   larger) ring, which the consumer picks up with GetNext().
+ */
+class ORRingBuffer
+{
+  public:
+    ORRingBuffer(size_t nLongs = 0);
+    virtual ~ORRingBuffer();
+
+    /*!
+       Reallocates the ring to hold nLongs words and resets it.  Not thread
+       safe: neither side may be using the ring.
+     */
+    virtual void Resize(size_t nLongs);
+    //! Empties and reopens the ring.  Not thread safe.
+    virtual void Reset();
+    virtual inline size_t GetLength() const { return fLength; }
+    //! Keeps the ring on the NUMA node of the threads of role (see ORThreadPlacement).
+    virtual void BindMemory(ORThreadPlacement::ERole role)
+      { ORThreadPlacement::BindMemory(fBuffer, fLength*sizeof(UInt_t), role); }
+
+    //! Number of words the consumer can read
+    virtual inline size_t GetNLongs() const
+      { return __atomic_load_n(&fWriteIndex, __ATOMIC_ACQUIRE) -
+               __atomic_load_n(&fReadIndex, __ATOMIC_ACQUIRE); }
+    //! Number of words the producer can write
+    virtual inline size_t GetNFree() const { return fLength - GetNLongs(); }
+
+    /*!
+       Producer: returns where the next words are to be written, and sets
+       nContiguous to the number of words that can be written there before
+       the end of the ring or the unread data is reached.  With offset, the
+       pointer is to the word offset words past the next one, so that the
+       producer can stage data beyond what it has published.
+     */
+    virtual UInt_t* GetWritePointer(size_t& nContiguous, size_t offset = 0);
+    /*!
+       Producer: describes the nBytes of free space starting firstByte
+       bytes past the next word as at most two pieces, for scatter reads
+       (readv(), recvmsg()) straight into the ring.  Returns the number of
+       pieces.
+     */
+    virtual int GetWriteRegion(size_t firstByte, size_t nBytes, 
+                               struct iovec* pieces);
+    //! Producer: publishes nLongs words written at GetWritePointer().
+    virtual void CommitWrite(size_t nLongs);
+    //! Producer: copies nLongs words into the ring; there must be room.
+    virtual void Write(const UInt_t* buffer, size_t nLongs);
+    //! Producer: no more data will be written.
+    virtual void Close();
+    /*!
+       Producer: no more data will be written to this ring; the consumer
+       is to continue in next once it has drained this one.  Used to grow
+       a ring without stopping either side.
+     */
+    virtual void CloseAndContinueIn(ORRingBuffer* next);
+    //! Consumer: the ring to continue in once this one is closed and empty
+    virtual inline ORRingBuffer* GetNext() const
+      { return __atomic_load_n(&fNext, __ATOMIC_ACQUIRE); }
+    virtual inline bool IsClosed() const
+      { return __atomic_load_n(&fIsClosed, __ATOMIC_ACQUIRE); }
+
+    /*!
+       Consumer: returns the oldest unread word, and sets nContiguous to the
+       number of unread words following it before the end of the ring.  The
+       consumer may modify the words in place until it hands them back.
+     */
+    virtual UInt_t* GetReadPointer(size_t& nContiguous);
+    //! Consumer: hands nLongs words back to the producer.
+    virtual void CommitRead(size_t nLongs);
+    //! Consumer: copies up to nLongs words out.  Returns the number copied.
+    virtual size_t Read(UInt_t* buffer, size_t nLongs);
+
+    /*!
+       Consumer: blocks until at least nLongs words are available, the ring
+       is closed, or timeoutUSec microseconds have passed.  Returns true if
+       the words are available.
+     */
+    virtual bool WaitForData(size_t nLongs, long timeoutUSec);
+    /*!
+       Producer: blocks until there is room for nLongs words or
+       timeoutUSec microseconds have passed.  Returns true if there is
+       room.
+     */
+    virtual bool WaitForSpace(size_t nLongs, long timeoutUSec);
+
+  protected:
+    //! Wakes the other side if it is waiting.
+    virtual void Signal(int& isWaiting);
+    virtual bool Wait(int& isWaiting, bool forData, size_t nLongs, long timeoutUSec);
+
+  protected:
+    UInt_t* fBuffer;
+    size_t fLength;
+
+  private:
+    /* Each index is written by one side only; kept apart to avoid false
+       sharing between the threads. */
+    size_t fWriteIndex;
+    char fPadding1[64];
+    size_t fReadIndex;
+    char fPadding2[64];
+    int fIsClosed;
+    ORRingBuffer* fNext;
+    int fConsumerIsWaiting;
+    int fProducerIsWaiting;
+
+    pthread_mutex_t fMutex;
+    pthread_cond_t fCondition;
+};
+
+#endif /* __CINT__ */
+#endif /* _ORRingBuffer_hh_ */
@@ -1,7 +1,7 @@
 // ORServer.cc
 
 #include "ORServer.hh"
-#include <unistd.h>
+#include <sys/select.h>
 
 ORServer::ORServer(int aPort) : TServerSocket(aPort, kTRUE)
 {
@@ -18,9 +18,25 @@ TSocket* ORServer::Accept(UChar_t opt)
       return NULL;
     }
     aSocket = TServerSocket::Accept(opt); 
-    sleep(1); // wait until we try again
+    if (aSocket == NULL || aSocket == (TSocket*)-1) {
+      /* Wait until we try again, returns as soon as a connection comes in. */
+      WaitForConnection(1000000);
+    }
   }
   return aSocket;
 }
 
+bool ORServer::WaitForConnection(long timeoutUSec)
+{
+  int descriptor = GetDescriptor();
+  if (descriptor < 0) return false;
+  fd_set readSet;
+  FD_ZERO(&readSet);
+  FD_SET(descriptor, &readSet);
+  struct timeval timeout;
+  timeout.tv_sec = timeoutUSec/1000000;
+  timeout.tv_usec = timeoutUSec%1000000;
+  return select(descriptor + 1, &readSet, NULL, NULL, &timeout) > 0;
+}
+
 
@@ -38,6 +38,9 @@ class ORServer : public TServerSocket, ORVSigHandler
     //! Returns a socket, and NULL if there's an error. 
     virtual TSocket* Accept(UChar_t opt = 0);
 
+    //! Waits up to timeoutUSec for a connection, returns true if one is waiting.
+    virtual bool WaitForConnection(long timeoutUSec);
+
   ClassDef(ORServer, 0)
 
 };
@@ -19,8 +19,7 @@ ORSisCviFileReader::ORSisCviFileReader(string filename) : ORFileReader(filename)
 
 size_t ORSisCviFileReader::Read(char* buffer, size_t nBytesMax)
 {
-  read(buffer, nBytesMax);
-  return gcount();
+  return ReadFromStream(buffer, nBytesMax);
 }
 
 bool ORSisCviFileReader::ReadRecord(vector<UInt_t>& buffer)
@@ -23,6 +23,9 @@ class ORSisCviFileReader : public ORFileReader
     virtual size_t Read(char* buffer, size_t nBytes);
     virtual size_t ReadPartialLineWithCR(char* , size_t ) { return 0;} 
     virtual bool ReadRecord(std::vector<UInt_t>& buffer);
+    //! Records are synthesized one at a time by ReadRecord().
+    virtual bool ReadRecords(ORRecordBatch& batch)
+      { return ORVReader::ReadRecords(batch); }
 
   protected:
     enum ESISFileDelimiters { kEOF =  0xE0F0E0F, kBucketHeader = 0xABBAABBA, kEventTrailer = 0xDEADBEEF };
@@ -2,12 +2,22 @@
 
 #include "ORSocketReader.hh"
 #include "ORLogger.hh"
+#include "ORRingBuffer.hh"
+#include "ORThreadPlacement.hh"
 #include "ORUtils.hh"
+#include <cstdlib>
+#include <cstring>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <sys/errno.h>
 #include <unistd.h>
 
+/* Defined below, with the readout thread. */
+Int_t ReadoutRootSocket(TSocket* sock, void* buffer, Int_t length, 
+                        const ORSocketReader& check_cancel,
+                        ESendRecvOptions opt = kDefault);
+bool SocketHasData(TSocket* sock, long timeoutUSec);
 
 ORSocketReader::ORSocketReader(const char* host, int port, bool writable) 
 {
@@ -32,18 +42,29 @@ ORSocketReader::ORSocketReader(TSocket* aSocket, bool writable)
 ORSocketReader::~ORSocketReader()
 {
   StopThread();
-  if (fCircularBuffer.buffer) delete [] fCircularBuffer.buffer;
+  DeleteBuffers();
+  if (fLocalBuffer.buffer) delete [] fLocalBuffer.buffer;
   pthread_attr_destroy(&fThreadAttr);
-  pthread_rwlock_destroy(&fCircularBuffer.cbMutex);
   if (fIOwnSocket) delete fSocket; 
 }
 
 void ORSocketReader::Initialize()
 {
-  memset(&fCircularBuffer, 0, sizeof(fCircularBuffer));
-  fCircularBuffer.buffer = NULL;
-  fCircularBuffer.isRunning = false;
-  pthread_rwlock_init(&fCircularBuffer.cbMutex, NULL);
+  fCircularBuffer = new ORRingBuffer;
+  fProducerBuffer = fCircularBuffer;
+  fRetiredBuffer = NULL;
+  fThreadIsRunning = false;
+  fLostLongCount = 0;
+  fOverflowPolicy = kDrop;
+  fMaxBufferLength = kDefaultMaxBufferLength;
+  fSpillDirectory = "/tmp";
+  fSpillFile = -1;
+  fSpillReadOffset = 0;
+  fSpillWriteOffset = 0;
+  memset(&fStats, 0, sizeof(fStats));
+  fNBytesPending = 0;
+  fStreamMustSwap = false;
+  fNLongsInUse = 0;
 
   SetCircularBufferLength(kDefaultBufferLength);
 
@@ -51,16 +72,12 @@ void ORSocketReader::Initialize()
   pthread_attr_setdetachstate(&fThreadAttr, PTHREAD_CREATE_JOINABLE);
   memset(&fLocalBuffer, 0, sizeof(fLocalBuffer));
   fLocalBuffer.buffer = NULL;
-  fSleepTime = 1;
+  fWaitTimeout = kDefaultWaitTimeout;
 }
 
 bool ORSocketReader::ThreadIsStillRunning()
 {
-  bool threadIsStillRunning;
-  pthread_rwlock_rdlock(&fCircularBuffer.cbMutex);
-  threadIsStillRunning = fCircularBuffer.isRunning;
-  pthread_rwlock_unlock(&fCircularBuffer.cbMutex);
-  return threadIsStillRunning;
+  return __atomic_load_n(&fThreadIsRunning, __ATOMIC_ACQUIRE);
 }
 
 bool ORSocketReader::StartThread()
@@ -72,7 +89,8 @@ bool ORSocketReader::StartThread()
   if (!fSocket->IsValid()) return false;
 
   ResetCircularBuffer();
-  fCircularBuffer.isRunning = true;
+  fThreadIsRunning = true;
+  ORThreadPlacement::SetUpAttributes(fThreadAttr, ORThreadPlacement::kReader);
 
   Int_t retValue = pthread_create(&fThreadId, 
     &fThreadAttr, SocketReadoutThread, this);
@@ -80,7 +98,7 @@ bool ORSocketReader::StartThread()
     return true;
   }
 
-  fCircularBuffer.isRunning = false;
+  fThreadIsRunning = false;
   return false; 
 }
 
@@ -95,21 +113,28 @@ void ORSocketReader::StopThread()
     // block until the thread actual stops.
     pthread_join(fThreadId, 0);
   }
-  fCircularBuffer.isRunning = false;
+  fProducerBuffer->Close();
+  fThreadIsRunning = false;
+  if (fSpillFile >= 0) close(fSpillFile);
+  fSpillFile = -1;
+  LogOverflowStats();
 }
 
 void ORSocketReader::ResetCircularBuffer()
 {
   /* Not thread safe, be careful! */
-  if (fCircularBuffer.buffer) delete [] fCircularBuffer.buffer;
-  fCircularBuffer.buffer = new UInt_t[fBufferLength];
-  fCircularBuffer.bufferLength = fBufferLength;
-  fCircularBuffer.amountInBuffer = 0;
-  fCircularBuffer.writeIndex = 0;
-  fCircularBuffer.readIndex = 0;
-  fCircularBuffer.lostLongCount = 0;
-  fCircularBuffer.wrapArounds = 0;
-  fCircularBuffer.isRunning = false;
+  DeleteBuffers();
+  fCircularBuffer = new ORRingBuffer(fBufferLength);
+  fCircularBuffer->BindMemory(ORThreadPlacement::kReader);
+  fProducerBuffer = fCircularBuffer;
+  fLostLongCount = 0;
+  fThreadIsRunning = false;
+  fSpillReadOffset = 0;
+  fSpillWriteOffset = 0;
+  memset(&fStats, 0, sizeof(fStats));
+  fStats.fBufferLength = fBufferLength;
+  fNBytesPending = 0;
+  fNLongsInUse = 0;
   fLocalBuffer.bufferLength = fBufferLength >> 4;
   if (fLocalBuffer.buffer) delete [] fLocalBuffer.buffer;
   fLocalBuffer.buffer = new UInt_t[fLocalBuffer.bufferLength];
@@ -117,6 +142,332 @@ void ORSocketReader::ResetCircularBuffer()
   fLocalBuffer.readIndex = 0;
 }
 
+void ORSocketReader::DeleteBuffers()
+{
+  /* Not thread safe either: grown buffers are chained until consumed. */
+  while (fCircularBuffer != NULL) {
+    ORRingBuffer* next = fCircularBuffer->GetNext();
+    delete fCircularBuffer;
+    fCircularBuffer = next;
+  }
+  delete fRetiredBuffer;
+  fRetiredBuffer = NULL;
+  fProducerBuffer = NULL;
+}
+
+ORSocketReader::OverflowStats ORSocketReader::GetOverflowStats() const
+{
+  OverflowStats stats;
+  const size_t* source = (const size_t*) &fStats;
+  size_t* destination = (size_t*) &stats;
+  for (size_t i=0; i<sizeof(stats)/sizeof(size_t); i++) {
+    destination[i] = __atomic_load_n(source + i, __ATOMIC_RELAXED);
+  }
+  return stats;
+}
+
+void ORSocketReader::LogOverflowStats() const
+{
+  OverflowStats stats = GetOverflowStats();
+  ORLog(kRoutine) << "Socket buffer: " << stats.fBufferLength << " long words, " 
+    << stats.fMaxNLongsBuffered << " used at most" << std::endl;
+  if (stats.fNStalls + stats.fNDroppedRecords + stats.fNSpilledRecords + 
+      stats.fNGrowths == 0) return;
+  ORLog(kRoutine) << "Socket buffer overflows: " 
+    << stats.fNStalls << " stalls, " 
+    << stats.fNGrowths << " growths, "
+    << stats.fNSpilledRecords << " records (" << stats.fNSpilledLongs 
+    << " long words) spilled, at most " << stats.fMaxNLongsSpilled << " at once, "
+    << stats.fNDroppedRecords << " records (" << stats.fNDroppedLongs 
+    << " long words) dropped" << std::endl;
+}
+
+void ORSocketReader::UpdateStat(size_t& stat, size_t increment)
+{
+  __atomic_add_fetch(&stat, increment, __ATOMIC_RELAXED);
+}
+
+void ORSocketReader::UpdateMaximum(size_t& stat, size_t value)
+{
+  /* Only the thread writes the stats. */
+  if (value > stat) __atomic_store_n(&stat, value, __ATOMIC_RELAXED);
+}
+
+bool ORSocketReader::MakeRoomFor(size_t numLongWords)
+{
+  if (fProducerBuffer->GetNFree() >= numLongWords) return true;
+  if (fOverflowPolicy == kDrop || fOverflowPolicy == kSpill) return false;
+
+  size_t length = fProducerBuffer->GetLength();
+  if (fOverflowPolicy == kGrow && length < fMaxBufferLength) {
+    /* Continue in a larger buffer; Read() moves over once it has drained
+       this one. */
+    size_t newLength = 2*length;
+    if (newLength < length + numLongWords) newLength = length + numLongWords;
+    if (newLength > fMaxBufferLength) newLength = fMaxBufferLength;
+    if (newLength >= numLongWords) {
+      ORRingBuffer* newBuffer = new ORRingBuffer(newLength);
+      newBuffer->BindMemory(ORThreadPlacement::kReader);
+      /* The staged part of the record moves along. */
+      struct iovec pieces[2];
+      int nPieces = fProducerBuffer->GetWriteRegion(0, fNBytesPending, pieces);
+      size_t nContiguous = 0;
+      char* destination = (char*) newBuffer->GetWritePointer(nContiguous);
+      for (int i=0; i<nPieces; i++) {
+        memcpy(destination, pieces[i].iov_base, pieces[i].iov_len);
+        destination += pieces[i].iov_len;
+      }
+      fProducerBuffer->CloseAndContinueIn(newBuffer);
+      fProducerBuffer = newBuffer;
+      UpdateStat(fStats.fNGrowths, 1);
+      __atomic_store_n(&fStats.fBufferLength, newLength, __ATOMIC_RELAXED);
+      return true;
+    }
+  }
+
+  if (numLongWords > fProducerBuffer->GetLength()) {
+    ORLog(kError) << "Record of " << numLongWords << " long words can never fit "
+      << "into the socket buffer" << std::endl;
+    return false;
+  }
+  /* Block: leave the data in the socket until there is room. */
+  UpdateStat(fStats.fNStalls, 1);
+  while (!fProducerBuffer->WaitForSpace(numLongWords, fWaitTimeout)) {
+    pthread_testcancel();
+    if (TestCancel()) return false;
+  }
+  return true;
+}
+
+ssize_t ORSocketReader::ReceiveIntoBuffer()
+{
+  /* Everything the socket has that fits goes in with one call, in two
+     pieces if the free part of the buffer wraps around. */
+  ORRingBuffer* ring = fProducerBuffer;
+  size_t numBytesFree = ring->GetNFree()*sizeof(UInt_t) - fNBytesPending;
+  struct iovec pieces[2];
+  struct msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = pieces;
+  message.msg_iovlen = ring->GetWriteRegion(fNBytesPending, numBytesFree, pieces);
+  if (message.msg_iovlen == 0) return 0;
+  ssize_t numBytesRead = recvmsg(fSocket->GetDescriptor(), &message, MSG_DONTWAIT);
+  if (numBytesRead > 0) return numBytesRead;
+  if (numBytesRead == 0) return -1; // closed connection
+  if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+  return -1;
+}
+
+size_t ORSocketReader::PendingRecordLength(size_t offset)
+{
+  size_t numContiguous = 0;
+  UInt_t firstWord = *fProducerBuffer->GetWritePointer(numContiguous, offset);
+  if (fStreamMustSwap) ORUtils::Swap(firstWord);
+  return fBasicDecoder.LengthOf(&firstWord);
+}
+
+bool ORSocketReader::PublishRecords()
+{
+  size_t numLongsPending = fNBytesPending/sizeof(UInt_t);
+  size_t numLongsComplete = 0;
+  while (numLongsComplete < numLongsPending) {
+    size_t recordLength = PendingRecordLength(numLongsComplete);
+    if (recordLength < 1) {
+      ORLog(kError) << "Record length is less than one!" << std::endl;
+      return false;
+    }
+    if (recordLength > numLongsPending - numLongsComplete) break;
+    numLongsComplete += recordLength;
+  }
+  if (numLongsComplete == 0) return true;
+  fProducerBuffer->CommitWrite(numLongsComplete);
+  fNBytesPending -= numLongsComplete*sizeof(UInt_t);
+  UpdateMaximum(fStats.fMaxNLongsBuffered, fProducerBuffer->GetNLongs());
+  return true;
+}
+
+bool ORSocketReader::HandleOverflow(size_t numLongWords, const UInt_t* heldWord,
+                                    UInt_t* scratchBuffer, size_t scratchLength)
+{
+  if (MakeRoomFor(numLongWords)) {
+    if (heldWord != NULL) {
+      size_t numContiguous = 0;
+      *fProducerBuffer->GetWritePointer(numContiguous) = *heldWord;
+      fNBytesPending = sizeof(UInt_t);
+    }
+    return true;
+  }
+  if (!fSocketIsOK || TestCancel()) return false;
+
+  /* Keep the order: once spilling, everything goes to the spill file
+     until it has been replayed. */
+  if (fOverflowPolicy == kSpill && numLongWords <= fProducerBuffer->GetLength() &&
+      OpenSpillFile()) {
+    struct iovec pieces[2];
+    int numPieces = 1;
+    if (heldWord != NULL) {
+      pieces[0].iov_base = (void*) heldWord;
+      pieces[0].iov_len = sizeof(UInt_t);
+    } else {
+      numPieces = fProducerBuffer->GetWriteRegion(0, fNBytesPending, pieces);
+    }
+    if (!SpillBytes(pieces, numPieces)) return false;
+    fNBytesPending = 0;
+    return true;
+  }
+
+  /* Throw away data now. */
+  size_t numBytesHeld = (heldWord != NULL) ? sizeof(UInt_t) : fNBytesPending;
+  __atomic_add_fetch(&fLostLongCount, numLongWords, __ATOMIC_RELAXED);
+  UpdateStat(fStats.fNDroppedRecords, 1);
+  UpdateStat(fStats.fNDroppedLongs, numLongWords);
+  fNBytesPending = 0;
+  return DiscardFromSocket(numLongWords*sizeof(UInt_t) - numBytesHeld,
+                           scratchBuffer, scratchLength);
+}
+
+bool ORSocketReader::DiscardFromSocket(size_t numBytes, UInt_t* scratchBuffer,
+                                       size_t scratchLength)
+{
+  while (numBytes > 0) {
+    size_t numBytesToRead = scratchLength*sizeof(UInt_t);
+    if (numBytesToRead > numBytes) numBytesToRead = numBytes;
+    Int_t numBytesRead = ReadoutRootSocket(fSocket, scratchBuffer,
+                                           numBytesToRead, *this);
+    if (numBytesRead != (Int_t) numBytesToRead) {
+      fSocketIsOK = false;
+      return false;
+    }
+    numBytes -= numBytesRead;
+  }
+  return true;
+}
+
+bool ORSocketReader::OpenSpillFile()
+{
+  if (fSpillFile >= 0) return true;
+  std::string fileName = fSpillDirectory + "/orcaroot_spill_XXXXXX";
+  char* nameBuffer = strdup(fileName.c_str());
+  fSpillFile = mkstemp(nameBuffer);
+  /* Nobody else needs to see it, and it goes away with us. */
+  if (fSpillFile >= 0) unlink(nameBuffer);
+  free(nameBuffer);
+  if (fSpillFile < 0) {
+    ORLog(kError) << "Could not create a spill file in " << fSpillDirectory
+      << ": " << strerror(errno) << "; dropping records instead" << std::endl;
+    fOverflowPolicy = kDrop;
+    return false;
+  }
+  fSpillReadOffset = 0;
+  fSpillWriteOffset = 0;
+  return true;
+}
+
+bool ORSocketReader::SpillBytes(const struct iovec* pieces, int numPieces)
+{
+  for (int i=0; i<numPieces; i++) {
+    ssize_t numBytes = pieces[i].iov_len;
+    if (pwrite(fSpillFile, pieces[i].iov_base, numBytes, fSpillWriteOffset) != numBytes) {
+      ORLog(kError) << "Could not write to spill file: " << strerror(errno)
+        << std::endl;
+      fSocketIsOK = false;
+      return false;
+    }
+    fSpillWriteOffset += numBytes;
+  }
+  UpdateMaximum(fStats.fMaxNLongsSpilled,
+                (fSpillWriteOffset - fSpillReadOffset)/sizeof(UInt_t));
+  return true;
+}
+
+ssize_t ORSocketReader::SpillFromSocket(UInt_t* scratchBuffer, size_t scratchLength,
+                                        long timeoutUSec)
+{
+  if (!SocketHasData(fSocket, timeoutUSec)) return 0;
+  ssize_t numBytesRead = recv(fSocket->GetDescriptor(), scratchBuffer,
+                              scratchLength*sizeof(UInt_t), MSG_DONTWAIT);
+  if (numBytesRead == 0) return -1; // closed connection
+  if (numBytesRead < 0) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+  }
+  struct iovec piece;
+  piece.iov_base = scratchBuffer;
+  piece.iov_len = numBytesRead;
+  if (!SpillBytes(&piece, 1)) return -1;
+  return numBytesRead;
+}
+
+bool ORSocketReader::ReplaySpill(size_t& numLongsNeeded)
+{
+  /* Nothing is staged while spilling, so the free part of the buffer
+     starts right at the write pointer. */
+  numLongsNeeded = 0;
+  size_t numBytesSpilled = fSpillWriteOffset - fSpillReadOffset;
+  if (numBytesSpilled < sizeof(UInt_t)) return false;
+  UInt_t firstWord;
+  if (pread(fSpillFile, &firstWord, sizeof(firstWord), fSpillReadOffset) !=
+      sizeof(firstWord)) {
+    firstWord = 0;
+  }
+  if (fStreamMustSwap) ORUtils::Swap(firstWord);
+  size_t recordLength = fBasicDecoder.LengthOf(&firstWord);
+  if (recordLength < 1) {
+    ORLog(kError) << "Could not read back spill file: " << strerror(errno)
+      << std::endl;
+    fSocketIsOK = false;
+    return false;
+  }
+  if (recordLength*sizeof(UInt_t) > numBytesSpilled) return false;
+  if (recordLength > fProducerBuffer->GetNFree()) {
+    numLongsNeeded = recordLength;
+    return false;
+  }
+
+  size_t numBytes = fProducerBuffer->GetNFree()*sizeof(UInt_t);
+  if (numBytes > numBytesSpilled) numBytes = numBytesSpilled;
+  struct iovec pieces[2];
+  int numPieces = fProducerBuffer->GetWriteRegion(0, numBytes, pieces);
+  off_t offset = fSpillReadOffset;
+  for (int i=0; i<numPieces; i++) {
+    ssize_t numBytesRead = pread(fSpillFile, pieces[i].iov_base,
+                                 pieces[i].iov_len, offset);
+    if (numBytesRead != (ssize_t) pieces[i].iov_len) {
+      /* Nothing sensible can be done with the rest of it. */
+      ORLog(kError) << "Could not read back spill file: " << strerror(errno)
+        << std::endl;
+      fSocketIsOK = false;
+      return false;
+    }
+    offset += numBytesRead;
+  }
+
+  /* Only complete records leave the spill file; the rest is read again
+     next time. */
+  size_t numLongsRead = numBytes/sizeof(UInt_t);
+  size_t numLongsComplete = 0;
+  size_t numRecords = 0;
+  while (numLongsComplete < numLongsRead) {
+    recordLength = PendingRecordLength(numLongsComplete);
+    if (recordLength < 1 || recordLength > numLongsRead - numLongsComplete) break;
+    numLongsComplete += recordLength;
+    numRecords++;
+  }
+  fNBytesPending = numLongsComplete*sizeof(UInt_t);
+  fSpillReadOffset += fNBytesPending;
+  UpdateStat(fStats.fNSpilledRecords, numRecords);
+  UpdateStat(fStats.fNSpilledLongs, numLongsComplete);
+
+  if (!SpillIsPending()) {
+    /* Done with it: start the file over. */
+    if (ftruncate(fSpillFile, 0) != 0) {
+      ORLog(kWarning) << "Could not truncate spill file" << std::endl;
+    }
+    fSpillReadOffset = 0;
+    fSpillWriteOffset = 0;
+  }
+  return true;
+}
+
 Int_t ORSocketReader::WriteBuffer(const void* buffer, size_t nBytes)
 {
   if (!fSocketToWrite) return 0;
@@ -128,76 +479,91 @@ Int_t ORSocketReader::WriteBuffer(const void* buffer, size_t nBytes)
   return numBytes;
 }
 
-size_t ORSocketReader::ReadFromCircularBuffer(UInt_t* buffer, size_t numLongWords, size_t minimumWords)
+void ORSocketReader::ReleaseRecords()
 {
-  size_t firstRead = 0, secondRead = 0;
-  size_t tempReadIndex = 0, tempNumWords = 0;
-  pthread_rwlock_rdlock(&fCircularBuffer.cbMutex);
-
-  if (numLongWords > fCircularBuffer.amountInBuffer) {
-    /* Block until there's something to read. */
-    while(1) {
-      /* In this while loop, we sleep to wait for data available.  If any data are 
-         available it grabs as much as it can after one sleep cycle.  If nothing
-         is in the circular buffer, it waits. */
-      /* unlock before we wait to not deadlock. */
-      pthread_rwlock_unlock(&fCircularBuffer.cbMutex);
-      if (fSleepTime != 0) sleep(fSleepTime);
-      /* Relock and keep it if we break out of this loop. */
-      pthread_rwlock_rdlock(&fCircularBuffer.cbMutex);
-      /* There is a sufficient amount in the buffer, read it out. */
-      if (numLongWords <= fCircularBuffer.amountInBuffer) break;
-      /* If we have exceeded the number of wait cycles, just grab what we can. */
-      if (!fCircularBuffer.isRunning || fCircularBuffer.amountInBuffer >= minimumWords) {
-        numLongWords = fCircularBuffer.amountInBuffer; 
-        break;
-      }
-      if (TestCancel()) return 0; // We've been canceled, get out
+  if (fNLongsInUse == 0) return;
+  fCircularBuffer->CommitRead(fNLongsInUse);
+  fNLongsInUse = 0;
+}
+
+bool ORSocketReader::WaitForCircularBuffer(size_t minimumWords)
+{
+  ReleaseRecords();
+  if (minimumWords > fCircularBuffer->GetLength()) {
+    minimumWords = fCircularBuffer->GetLength();
+  }
+  /* Block until there's enough to read.  The wait returns as soon as the
+     thread publishes data; timing out only serves to check for
+     cancellation.  Once the thread is done, grab what is left. */
+  while (1) {
+    while (!fCircularBuffer->WaitForData(minimumWords, fWaitTimeout)) {
+      if (fCircularBuffer->IsClosed() || !ThreadIsStillRunning()) break;
+      if (TestCancel()) return false; // We've been canceled, get out
     }
+    /* The thread may have moved on to a larger buffer. */
+    ORRingBuffer* next = fCircularBuffer->GetNext();
+    if (next == NULL || fCircularBuffer->GetNLongs() > 0) break;
+    /* The thread may still be signaling the buffer it closed, so it is
+       kept until we move on again, by which time the thread is done
+       with it. */
+    delete fRetiredBuffer;
+    fRetiredBuffer = fCircularBuffer;
+    fCircularBuffer = next;
   }
 
-  if (numLongWords == 0) {
-    return 0;
-    pthread_rwlock_unlock(&fCircularBuffer.cbMutex);
+  size_t lostLongCount = __atomic_exchange_n(&fLostLongCount, 0, __ATOMIC_ACQ_REL);
+  if (lostLongCount != 0) {
+    /* Give a quick notification. */
+    ORLog(kWarning) << "Socket has thrown away " << lostLongCount
+      << " long words" << std::endl;
   }
-  tempNumWords = 0;
-  tempReadIndex = fCircularBuffer.readIndex;
-  firstRead = (fCircularBuffer.readIndex > fCircularBuffer.writeIndex) ?
-    fCircularBuffer.bufferLength - fCircularBuffer.readIndex :
-    fCircularBuffer.writeIndex - fCircularBuffer.readIndex;
-
-  if (firstRead > numLongWords) firstRead = numLongWords;
-  secondRead = (firstRead < numLongWords) ? numLongWords - firstRead : 0;
+  return fCircularBuffer->GetNLongs() > 0;
+}
 
-  /* Now copy out. */
-  memcpy(buffer, fCircularBuffer.buffer + tempReadIndex, firstRead*4);
-  tempReadIndex += firstRead;
-  tempNumWords += firstRead;
+size_t ORSocketReader::ReadFromCircularBuffer(UInt_t* buffer, size_t numLongWords, size_t minimumWords)
+{
+  if (minimumWords > numLongWords) minimumWords = numLongWords;
+  if (!WaitForCircularBuffer(minimumWords)) return 0;
+  return fCircularBuffer->Read(buffer, numLongWords);
+}
 
-  if (tempReadIndex == fCircularBuffer.bufferLength) {
-    tempReadIndex = 0;
-  }
-  if (secondRead != 0) {
-    memcpy(buffer + firstRead, 
-      fCircularBuffer.buffer + tempReadIndex, secondRead*4);
-    tempReadIndex += secondRead;
-    tempNumWords += secondRead;
+bool ORSocketReader::ReadRecords(ORRecordBatch& batch)
+{
+  batch.Clear();
+  /* Words left over from Read() come first. */
+  if (fLocalBuffer.readIndex < fLocalBuffer.currentAmountOfData) {
+    return ORVReader::ReadRecords(batch);
   }
-  if (fCircularBuffer.lostLongCount != 0) {
-    /* Give a quick notification. */
-    ORLog(kWarning) << "Socket has thrown away " << fCircularBuffer.lostLongCount 
-      << " long words" << std::endl;
+  if (!WaitForCircularBuffer(1)) return false;
+
+  /* The thread only publishes complete records. */
+  size_t numContiguous = 0;
+  UInt_t* records = fCircularBuffer->GetReadPointer(numContiguous);
+  if (fStreamVersion == ORHeaderDecoder::kUnknownVersion) {
+    DetermineFileTypeAndSetupSwap((char*) records);
+    if (fStreamVersion == ORHeaderDecoder::kOld) {
+      ORLog(kError) << "Old-style headers can not be read from a socket" << std::endl;
+      fStreamVersion = ORHeaderDecoder::kUnknownVersion;
+      return false;
+    }
+    if (fStreamVersion == ORHeaderDecoder::kUnknownVersion) return false;
   }
-  pthread_rwlock_unlock(&fCircularBuffer.cbMutex);
 
-  /* Now we write. */
-  pthread_rwlock_wrlock(&fCircularBuffer.cbMutex);
-  fCircularBuffer.readIndex = tempReadIndex;
-  fCircularBuffer.amountInBuffer -= tempNumWords;
-  fCircularBuffer.lostLongCount = 0;
-  pthread_rwlock_unlock(&fCircularBuffer.cbMutex);
+  size_t numLongsFramed = 0;
+  batch.UseExternalArena(records);
+  if (!FrameRecords(batch, numContiguous, numLongsFramed)) return false;
+  if (batch.GetNRecords() > 0) {
+    fNLongsInUse = numLongsFramed;
+    return true;
+  }
 
-  return numLongWords;
+  /* The next record wraps around the end of the buffer: copy it out. */
+  batch.Clear();
+  UInt_t firstWord = records[0];
+  if (MustSwap()) ORUtils::Swap(firstWord);
+  size_t recordLength = fBasicDecoder.LengthOf(&firstWord);
+  fCircularBuffer->Read(batch.ReserveLongs(recordLength), recordLength);
+  return FrameRecords(batch, recordLength, numLongsFramed);
 }
 
 size_t ORSocketReader::Read(char* buffer, size_t nBytes)
@@ -273,7 +639,7 @@ Int_t WriteToRootSocket(TSocket* sock, void* buffer, Int_t length)
 }
 Int_t ReadoutRootSocket(TSocket* sock, void* buffer, Int_t length, 
                         const ORSocketReader& check_cancel,
-                        ESendRecvOptions opt = kDefault) 
+                        ESendRecvOptions opt) 
 {
     Int_t socketDescriptor = sock->GetDescriptor();
     Int_t numBytesRead;
@@ -315,15 +681,24 @@ Int_t ReadoutRootSocket(TSocket* sock, void* buffer, Int_t length,
 
 }
 
+bool SocketHasData(TSocket* sock, long timeoutUSec)
+{
+  Int_t socketDescriptor = sock->GetDescriptor();
+  fd_set fileDescSet;
+  struct timeval timeout;
+  timeout.tv_sec = timeoutUSec/1000000;
+  timeout.tv_usec = timeoutUSec%1000000;
+  FD_ZERO(&fileDescSet);
+  FD_SET(socketDescriptor, &fileDescSet);
+  return select(socketDescriptor+1, &fileDescSet, 0, 0, &timeout) > 0;
+}
+
 void* SocketReadoutThread(void* input)
 {
   /* Readout Thread which sucks info out of socket as fast as it can. */
-  /* Currently, it throws data away that it can't process. */
-  
+  /* What happens to data it can't buffer depends on the overflow policy. */
+
   bool firstWordRead = false;
-  bool mustSwap = false;
-  Int_t numBytesRead = 0, numLongsToRead = 0, amountAbleToRead = 0, firstRead = 0,
-    secondRead = 0;
   const size_t sizeOfScratchBuffer = 0xFFFF;
   UInt_t scratchBuffer[sizeOfScratchBuffer];
   ORSocketReader* socketReader = reinterpret_cast<ORSocketReader*>(input);
@@ -334,147 +709,133 @@ void* SocketReadoutThread(void* input)
      it emits Events which are not pleasant to deal with in Threads. */
 
   TSocket* sock = socketReader->fSocket;
-  //fd_set fileDescriptors; 
 
   while (socketReader->fSocketIsOK) {
     /* In this thread, we readout the socket into the circular buffer. */
     pthread_testcancel(); // When we are here, it is safe to cancel the thread.
-
-    numBytesRead = ReadoutRootSocket(sock, scratchBuffer, 
-                                sizeof(UInt_t), *socketReader, kPeek);
-    if (numBytesRead <= 0) {
-      // Something is wrong with the socket
-      socketReader->fSocketIsOK = false;
-      break;
+    ORRingBuffer* ring = socketReader->fProducerBuffer;
+
+    if (socketReader->SpillIsPending()) {
+      /* Spilled data goes back in first, and must not wait for the socket;
+         whatever arrives meanwhile is appended to the spill file. */
+      size_t numLongsNeeded = 0;
+      if (!socketReader->ReplaySpill(numLongsNeeded)) {
+        if (!socketReader->fSocketIsOK) break;
+        ssize_t numBytesSpilled = 0;
+        if (numLongsNeeded == 0) {
+          /* The rest of the record is still in the socket. */
+          numBytesSpilled = socketReader->SpillFromSocket(scratchBuffer,
+            sizeOfScratchBuffer, socketReader->fWaitTimeout);
+        } else if (SocketHasData(sock, 0)) {
+          numBytesSpilled = socketReader->SpillFromSocket(scratchBuffer,
+            sizeOfScratchBuffer, 0);
+        } else {
+          ring->WaitForSpace(numLongsNeeded, socketReader->fWaitTimeout);
+        }
+        if (numBytesSpilled < 0) socketReader->fSocketIsOK = false;
+        if (socketReader->TestCancel()) break;
+        continue;
+      }
+    } else if (ring->GetNFree() == 0) {
+      /*************************************************************/
+      /* Not even the first word of the next record fits: read it  */
+      /* to see how long the record is, and deal with it.          */
+      /*************************************************************/
+      if (ReadoutRootSocket(sock, scratchBuffer, sizeof(UInt_t), *socketReader) !=
+          sizeof(UInt_t)) {
+        socketReader->fSocketIsOK = false;
+        break;
+      }
+      UInt_t firstWord = scratchBuffer[0];
+      if (socketReader->fStreamMustSwap) ORUtils::Swap(firstWord);
+      if (!socketReader->HandleOverflow(socketReader->fBasicDecoder.LengthOf(&firstWord),
+            scratchBuffer, scratchBuffer + 1, sizeOfScratchBuffer - 1)) break;
+      continue;
+    } else {
+      /*************************************************************/
+      /* Read whatever the socket has straight into the buffer.    */
+      /*************************************************************/
+      ssize_t numBytesRead = socketReader->ReceiveIntoBuffer();
+      if (numBytesRead < 0) {
+        // Problem in the socket, or closed connection.
+        socketReader->fSocketIsOK = false;
+        break;
+      }
+      if (numBytesRead == 0) {
+        /* Nothing there: wait for the socket, and check now and then
+           whether we've been canceled. */
+        if (!SocketHasData(sock, socketReader->fWaitTimeout) &&
+            socketReader->TestCancel()) break;
+        continue;
+      }
+      socketReader->fNBytesPending += numBytesRead;
     }
 
     // Only do the following once:
     /* Check the first word to determine if we must swap. */
     if (!firstWordRead) {
+      if (socketReader->fNBytesPending < sizeof(UInt_t)) continue;
+      size_t numContiguous = 0;
       ORHeaderDecoder headerDec;
-      ORHeaderDecoder::EOrcaStreamVersion version = 
-        headerDec.GetStreamVersion(scratchBuffer[0]);
-      if (version == ORHeaderDecoder::kOld) {
-        mustSwap = ORUtils::SysIsLittleEndian();
-      }
-      else if (version == ORHeaderDecoder::kNewUnswapped) {
-        mustSwap = false; 
+      ORHeaderDecoder::EOrcaStreamVersion version =
+        headerDec.GetStreamVersion(*ring->GetWritePointer(numContiguous));
+      if (version == ORHeaderDecoder::kNewUnswapped) {
+        socketReader->fStreamMustSwap = false;
       }
       else if (version == ORHeaderDecoder::kNewSwapped) {
-        mustSwap = true;
+        socketReader->fStreamMustSwap = true;
       }
-      else if (version == ORHeaderDecoder::kUnknownVersion) {
-        /* Get out, something is wrong. */
+      else {
+        /* Get out, something is wrong: old-style headers can't be framed. */
+        ORLog(kError) << "Unknown stream version on socket" << std::endl;
         socketReader->fSocketIsOK = false;
         break;
       }
       firstWordRead = true;
     }
 
-    // Check to see the number of words to read out for this record
-    if (mustSwap) ORUtils::Swap(scratchBuffer[0]);
-    numLongsToRead = socketReader->fBasicDecoder.LengthOf(scratchBuffer);
-    
-    /* We're beginning to work on the circular buffer. */
-    pthread_rwlock_rdlock(&socketReader->fCircularBuffer.cbMutex);
-
-    amountAbleToRead = socketReader->fCircularBuffer.bufferLength 
-      - socketReader->fCircularBuffer.amountInBuffer; 
+    /* Hand the complete records to the reader. */
+    if (!socketReader->PublishRecords()) {
+      socketReader->fSocketIsOK = false;
+      break;
+    }
 
     /*************************************************************/
     /* Dealing with a record if we don't have room for it. */
     /*************************************************************/
-    if (amountAbleToRead < numLongsToRead) {
-      /* Do we wait, or throw away data? */
-      /* Throw away data now. */
-      // fixME, this needs to be set in an option
-      pthread_rwlock_unlock(&socketReader->fCircularBuffer.cbMutex);
-      pthread_rwlock_wrlock(&socketReader->fCircularBuffer.cbMutex);
-      socketReader->fCircularBuffer.lostLongCount += numLongsToRead;
-      pthread_rwlock_unlock(&socketReader->fCircularBuffer.cbMutex);
-
-      while (numLongsToRead > 0) {
-        numBytesRead = ReadoutRootSocket(sock, scratchBuffer, 
-          (((size_t)numLongsToRead > sizeOfScratchBuffer) ? 
-            sizeOfScratchBuffer : numLongsToRead)*sizeof(UInt_t), *socketReader);
-        if (numBytesRead <=0 || numBytesRead % sizeof(UInt_t) != 0) break;
-        numLongsToRead -= numBytesRead/sizeof(UInt_t);
-      }
-      if (numBytesRead <= 0 || numBytesRead % sizeof(UInt_t) != 0) {
-        socketReader->fSocketIsOK = false;
-      }
-      continue;
+    if (!socketReader->SpillIsPending() &&
+        socketReader->fNBytesPending >= sizeof(UInt_t)) {
+      size_t numLongsToRead = socketReader->PendingRecordLength(0);
+      if (numLongsToRead > socketReader->fProducerBuffer->GetNFree() &&
+          !socketReader->HandleOverflow(numLongsToRead, NULL,
+            scratchBuffer, sizeOfScratchBuffer)) break;
     }
-    /*************************************************************/
-    /*************************************************************/
-
-    /*************************************************************/
-    /* We have room for it, so now figure out how to read it out.*/
-    /*************************************************************/
+  }
 
-    firstRead = (socketReader->fCircularBuffer.writeIndex >= 
-                 socketReader->fCircularBuffer.readIndex) ?
-      socketReader->fCircularBuffer.bufferLength 
-        - socketReader->fCircularBuffer.writeIndex :
-      socketReader->fCircularBuffer.readIndex 
-        - socketReader->fCircularBuffer.writeIndex;
-
-    
-    pthread_rwlock_unlock(&socketReader->fCircularBuffer.cbMutex);
-
-    /* First and second reads are set to make sure the wrapping works 
-       correctly. */
-    if (firstRead > numLongsToRead) firstRead = numLongsToRead;
-    secondRead = (firstRead < numLongsToRead) ? numLongsToRead - firstRead : 0;
-
-    pthread_rwlock_wrlock(&socketReader->fCircularBuffer.cbMutex);
-
-    /* ROOT automatically calls the receive function so that we
-       don't have to cycle through the calls. That is, it *will*
-       get all the bytes requested or error. */
-    numBytesRead = ReadoutRootSocket(sock, 
-              socketReader->fCircularBuffer.buffer 
-              + socketReader->fCircularBuffer.writeIndex, 
-              firstRead*sizeof(UInt_t), *socketReader); 
-    if (numBytesRead <= 0 || numBytesRead != (Int_t)(firstRead*sizeof(UInt_t))) {
-      // Problem in the socket, or closed connection. 
-      pthread_rwlock_unlock(&socketReader->fCircularBuffer.cbMutex);
-      socketReader->fSocketIsOK = false;
+  /* Whatever is still spilled is handed over before closing up. */
+  while (socketReader->SpillIsPending() && !socketReader->TestCancel()) {
+    pthread_testcancel();
+    size_t numLongsNeeded = 0;
+    if (socketReader->ReplaySpill(numLongsNeeded)) {
+      socketReader->PublishRecords();
+    } else if (numLongsNeeded == 0) {
       break;
-    } 
-    socketReader->fCircularBuffer.writeIndex += numBytesRead/sizeof(UInt_t);
-    socketReader->fCircularBuffer.amountInBuffer += numBytesRead/sizeof(UInt_t);
-
-    if (socketReader->fCircularBuffer.writeIndex 
-        == socketReader->fCircularBuffer.bufferLength) {
-      socketReader->fCircularBuffer.writeIndex = 0;
-    }
-
-    if (secondRead != 0) {
-      numBytesRead = ReadoutRootSocket(sock, 
-                socketReader->fCircularBuffer.buffer 
-                + socketReader->fCircularBuffer.writeIndex,
-                secondRead*sizeof(UInt_t), *socketReader); 
-      if (numBytesRead <= 0 || numBytesRead != (Int_t)(secondRead*sizeof(UInt_t))) {
-        // Problem in the socket, or closed connection. 
-        pthread_rwlock_unlock(&socketReader->fCircularBuffer.cbMutex);
-        socketReader->fSocketIsOK = false;
-        break;
-      } 
-      socketReader->fCircularBuffer.writeIndex += numBytesRead/sizeof(UInt_t);
-      socketReader->fCircularBuffer.amountInBuffer += numBytesRead/sizeof(UInt_t);
-      socketReader->fCircularBuffer.wrapArounds++;
+    } else {
+      socketReader->fProducerBuffer->WaitForSpace(numLongsNeeded,
+        socketReader->fWaitTimeout);
     }
-
-    /* OK, we're done reading into the circular buffer, unlock it. */
-    pthread_rwlock_unlock(&socketReader->fCircularBuffer.cbMutex);
-     
+  }
+  if (socketReader->fNBytesPending > 0 || socketReader->SpillIsPending()) {
+    ORLog(kWarning) << "Socket closed in the middle of a record" << std::endl;
   }
 
-  pthread_rwlock_wrlock(&socketReader->fCircularBuffer.cbMutex);
-  socketReader->fCircularBuffer.isRunning = false;
-  pthread_rwlock_unlock(&socketReader->fCircularBuffer.cbMutex);
+  if (socketReader->fSpillFile >= 0) close(socketReader->fSpillFile);
+  socketReader->fSpillFile = -1;
+  socketReader->LogOverflowStats();
+
+  /* Wake up the reader: there is nothing more coming. */
+  socketReader->fProducerBuffer->Close();
+  __atomic_store_n(&socketReader->fThreadIsRunning, false, __ATOMIC_RELEASE);
 
   pthread_exit((void *) 0);
 }
-
@@ -13,8 +13,10 @@
 #ifndef _ORVSigHandler_hh_
 #include "ORVSigHandler.hh"
 #endif
+#include <string>
 #ifndef __CINT__
 #include <pthread.h>
+#include <sys/types.h>
 #else
 // Dealing with CINT
 typedef struct { private: char x[SIZEOF_PTHREAD_T]; } pthread_t;
@@ -25,18 +27,8 @@ typedef struct{ private: char x[SIZEOF_PTHREAD_ATTR_T]; } pthread_attr_t;
 #include "TSocket.h"
 #endif
 
-//! Struct encapsulating a circular buffer
-typedef struct {
-   pthread_rwlock_t cbMutex;
-   UInt_t*          buffer;
-   size_t           bufferLength;
-   size_t           amountInBuffer;
-   size_t           writeIndex;
-   size_t           readIndex;
-   size_t           lostLongCount;
-   size_t           wrapArounds;
-   bool             isRunning;
-} CircularBufferStruct;
+class ORRingBuffer;
+struct iovec;
 
 //! Struct encapsulating a linear buffer
 typedef struct {
@@ -51,12 +43,17 @@ extern "C" void* SocketReadoutThread(void*);
 //! ORSocketReader provides a class to read data from a socket.  
 /*!
     It runs a thread which takes data from a socket and fills
-    a circular buffer.  This circular buffer can then 
-    be read out using Read().  The class will not
-    block indefinitely on a call to read from the socket.
-    Instead it periodically times out to check if it has
-    been canceled ( from ORVSigHandler ) and exits nicely
-    if so.
+    a circular buffer (a lock-free ORRingBuffer).  The thread reads
+    whatever the socket has, in large chunks, straight into the free part
+    of the buffer (a single scatter read even when the free part wraps
+    around), frames the records it received and only publishes complete
+    records.  At high rates a single read brings in many records.
+    ReadRecords() hands the records out in place, as views into the
+    buffer, so that they are never copied; Read() is still available for
+    byte-wise access.  Either wakes up as soon as the thread has delivered
+    data.  The class will not block indefinitely on a call to read from
+    the socket.  Instead it periodically times out to check if it has
+    been canceled ( from ORVSigHandler ) and exits nicely if so.
  */
 class ORSocketReader : public ORVReader, public ORVSigHandler, public ORVWriter
 {
@@ -82,12 +79,63 @@ class ORSocketReader : public ORVReader, public ORVSigHandler, public ORVWriter
     virtual ~ORSocketReader(); 
 
     virtual size_t Read(char* buffer, size_t nBytes);
+    /*!
+       Frames the records waiting in the circular buffer in place.  The
+       records stay in the buffer until the next call, so only a record
+       wrapping around the end of the buffer gets copied.
+     */
+    virtual bool ReadRecords(ORRecordBatch& batch);
     virtual bool OKToRead() { return (fSocket->IsValid() && fSocketIsOK); }
+    virtual TSocket* GetSocket() { return fSocket; }
     virtual bool OpenDataStream() { return StartThread(); } 
     virtual void Close() { if(TestCancel() || !fSocketIsOK) StopThread(); } 
     virtual void SetCircularBufferLength(Int_t length) 
       { fBufferLength = length; }
-    enum ESocketReaderConsts {kDefaultBufferLength = 0xFFFFFF};
+    enum ESocketReaderConsts {kDefaultBufferLength = 0xFFFFFF,
+                              kDefaultMaxBufferLength = 0xFFFFFFF,
+                              kDefaultWaitTimeout = 100000 /* us */};
+    /*! 
+        Waiting for data times out after timeoutUSec microseconds to check
+        for cancellation.  Data arriving earlier wakes the reader at once.
+     */
+    virtual void SetWaitTimeout(long timeoutUSec) { fWaitTimeout = timeoutUSec; }
+
+    /*!
+       What the readout thread does with a record that doesn't fit into
+       the circular buffer:
+         - kDrop: throw it away (the default).
+         - kBlock: stop reading the socket until Read() has made room, so
+           that TCP flow control pushes back on the sender.
+         - kGrow: continue in a buffer twice as large, up to
+           SetMaxBufferLength() words, then block.
+         - kSpill: append it, and everything after it, to a file in
+           SetSpillDirectory(), which is replayed into the buffer as
+           room frees up.
+       Takes effect when the thread is started (OpenDataStream()).
+     */
+    enum EOverflowPolicy { kDrop, kBlock, kGrow, kSpill };
+    virtual void SetOverflowPolicy(EOverflowPolicy policy) 
+      { fOverflowPolicy = policy; }
+    virtual EOverflowPolicy GetOverflowPolicy() const { return fOverflowPolicy; }
+    virtual void SetMaxBufferLength(size_t length) { fMaxBufferLength = length; }
+    virtual void SetSpillDirectory(const std::string& directory) 
+      { fSpillDirectory = directory; }
+
+    //! Counters of how the circular buffer coped with the incoming data
+    struct OverflowStats {
+      size_t fNStalls;           // times the thread waited for room
+      size_t fNDroppedRecords;
+      size_t fNDroppedLongs;
+      size_t fNSpilledRecords;
+      size_t fNSpilledLongs;
+      size_t fNGrowths;
+      size_t fBufferLength;      // current length of the buffer
+      size_t fMaxNLongsBuffered; // high-water mark of the buffer
+      size_t fMaxNLongsSpilled;  // high-water mark of the spill file
+    };
+    //! Snapshot of the counters; may be called while the thread runs.
+    virtual OverflowStats GetOverflowStats() const;
+    virtual void LogOverflowStats() const;
 
     //! Writes onto the socket.
     /*!
@@ -108,12 +156,65 @@ class ORSocketReader : public ORVReader, public ORVSigHandler, public ORVWriter
     //! Stop Socket readout Thread.
     void StopThread();
     void ResetCircularBuffer();
+    void DeleteBuffers();
 
     /*! 
-        This function blocks until numLongWords are available. 
-        Returns the number of bytes read, 0 if there's nothing left. 
+        This function blocks until minWords are available (or the thread
+        has stopped), then reads up to numLongWords.
+        Returns the number of words read, 0 if there's nothing left. 
      */
     size_t ReadFromCircularBuffer(UInt_t* buffer, size_t numLongWords, size_t minWords);
+    /*! 
+        Blocks until minWords are available or the thread has stopped.
+        Returns true if there is anything to read.
+     */
+    bool WaitForCircularBuffer(size_t minWords);
+    //! Hands the records of the last ReadRecords() back to the thread.
+    void ReleaseRecords();
+
+    /* The following are called from the readout thread only.  The thread
+       stages what it receives behind the published data of the buffer
+       (fNBytesPending bytes) until the records are complete. */
+
+    //! Receives what the socket has into the free part of the buffer.
+    ssize_t ReceiveIntoBuffer();
+    //! Publishes the complete records among the staged bytes.
+    bool PublishRecords();
+    //! Length of the staged record starting offset words in.
+    size_t PendingRecordLength(size_t offset);
+    /*! 
+        Applies the overflow policy when a record of numLongWords, of which
+        the first fNBytesPending bytes are staged (or heldWord, if given, 
+        has been read), doesn't fit into the buffer.  Returns false if the
+        thread has to stop.
+     */
+    bool HandleOverflow(size_t numLongWords, const UInt_t* heldWord, 
+                        UInt_t* scratchBuffer, size_t scratchLength);
+    /*! 
+        Applies the kBlock or kGrow policy for numLongWords.  Returns true 
+        once they fit.
+     */
+    bool MakeRoomFor(size_t numLongWords);
+    //! Reads and throws away numBytes from the socket.
+    bool DiscardFromSocket(size_t numBytes, UInt_t* scratchBuffer, size_t scratchLength);
+    bool OpenSpillFile();
+    //! Appends the pieces to the spill file.
+    bool SpillBytes(const struct iovec* pieces, int numPieces);
+    /*!
+        Waits up to timeoutUSec for the socket and appends what it has to 
+        the spill file.  Returns the number of bytes spilled, -1 if the
+        socket is gone.
+     */
+    ssize_t SpillFromSocket(UInt_t* scratchBuffer, size_t scratchLength, long timeoutUSec);
+    /*! 
+        Moves the complete spilled records that fit into the buffer.  If
+        there are none, numLongsNeeded is set to the room the next record
+        needs, or to 0 if the record isn't completely spilled yet.
+     */
+    bool ReplaySpill(size_t& numLongsNeeded);
+    bool SpillIsPending() const { return fSpillReadOffset < fSpillWriteOffset; }
+    void UpdateStat(size_t& stat, size_t increment);
+    void UpdateMaximum(size_t& stat, size_t value);
     bool ThreadIsStillRunning();
     TSocket* fSocket;
     TSocket* fSocketToWrite;
@@ -127,9 +228,23 @@ class ORSocketReader : public ORVReader, public ORVSigHandler, public ORVWriter
     pthread_t fThreadId;
     pthread_attr_t fThreadAttr;
     Int_t fBufferLength;
-    CircularBufferStruct fCircularBuffer;
+    ORRingBuffer* fCircularBuffer;  // the buffer Read() consumes
+    ORRingBuffer* fProducerBuffer;  // the buffer the thread fills
+    ORRingBuffer* fRetiredBuffer;   // the last buffer Read() moved away from
+    bool fThreadIsRunning;
+    size_t fLostLongCount;
+    EOverflowPolicy fOverflowPolicy;
+    size_t fMaxBufferLength;
+    std::string fSpillDirectory;
+    int fSpillFile;
+    off_t fSpillReadOffset;
+    off_t fSpillWriteOffset;
+    OverflowStats fStats;
+    size_t fNBytesPending;     // staged behind the buffer's published data
+    bool fStreamMustSwap;      // as seen by the thread
+    size_t fNLongsInUse;       // handed out by the last ReadRecords()
     LinearBufferStruct fLocalBuffer;
-    UInt_t fSleepTime;
+    long fWaitTimeout;
 
 };
 
@@ -0,0 +1,194 @@
+// ORStreamConnection.cc
+
+#include "ORStreamConnection.hh"
+#include "ORLogger.hh"
+#include "ORRingBuffer.hh"
+#include "ORUtils.hh"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* A peer going away must not take down the whole server. */
+#ifdef MSG_NOSIGNAL
+static const int kSendFlags = MSG_NOSIGNAL;
+#else
+static const int kSendFlags = 0;
+#endif
+
+ORStreamConnection::ORStreamConnection(int socketDescriptor, size_t bufferLength)
+{
+  fSocketDescriptor = socketDescriptor;
+  fBuffer = new ORRingBuffer(bufferLength);
+  fNBytesPending = 0;
+  fFirstWordRead = false;
+  fStreamMustSwap = false;
+  fNLongsInUse = 0;
+}
+
+ORStreamConnection::~ORStreamConnection()
+{
+  if (fSocketDescriptor >= 0) close(fSocketDescriptor);
+  delete fBuffer;
+}
+
+bool ORStreamConnection::ReceiveData()
+{
+  /* Everything the socket has that fits goes in with one call. */
+  size_t nBytesFree = fBuffer->GetNFree()*sizeof(UInt_t) - fNBytesPending;
+  struct iovec pieces[2];
+  struct msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = pieces;
+  message.msg_iovlen = fBuffer->GetWriteRegion(fNBytesPending, nBytesFree, pieces);
+  if (message.msg_iovlen == 0) return true;
+  ssize_t nBytesRead = recvmsg(fSocketDescriptor, &message, MSG_DONTWAIT);
+  if (nBytesRead == 0) return false; // closed connection
+  if (nBytesRead < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return true;
+    ORLog(kWarning) << "ReceiveData(): " << strerror(errno) << std::endl;
+    return false;
+  }
+  fNBytesPending += nBytesRead;
+
+  if (!fFirstWordRead) {
+    if (fNBytesPending < sizeof(UInt_t)) return true;
+    size_t nContiguous = 0;
+    ORHeaderDecoder::EOrcaStreamVersion version =
+      fHeaderDecoder.GetStreamVersion(*fBuffer->GetWritePointer(nContiguous));
+    if (version == ORHeaderDecoder::kNewUnswapped) fStreamMustSwap = false;
+    else if (version == ORHeaderDecoder::kNewSwapped) fStreamMustSwap = true;
+    else {
+      ORLog(kError) << "ReceiveData(): unknown stream version" << std::endl;
+      return false;
+    }
+    fFirstWordRead = true;
+  }
+
+  if (!PublishRecords()) return false;
+  if (fNBytesPending >= sizeof(UInt_t) &&
+      PendingRecordLength(0) > fBuffer->GetLength()) {
+    ORLog(kError) << "ReceiveData(): record of " << PendingRecordLength(0)
+                  << " long words can never fit into the buffer" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+size_t ORStreamConnection::PendingRecordLength(size_t offset)
+{
+  size_t nContiguous = 0;
+  UInt_t firstWord = *fBuffer->GetWritePointer(nContiguous, offset);
+  if (fStreamMustSwap) ORUtils::Swap(firstWord);
+  return fBasicDecoder.LengthOf(&firstWord);
+}
+
+bool ORStreamConnection::PublishRecords()
+{
+  size_t nLongsPending = fNBytesPending/sizeof(UInt_t);
+  size_t nLongsComplete = 0;
+  while (nLongsComplete < nLongsPending) {
+    size_t recordLength = PendingRecordLength(nLongsComplete);
+    if (recordLength < 1) {
+      ORLog(kError) << "Record length is less than one!" << std::endl;
+      return false;
+    }
+    if (recordLength > nLongsPending - nLongsComplete) break;
+    nLongsComplete += recordLength;
+  }
+  if (nLongsComplete == 0) return true;
+  fBuffer->CommitWrite(nLongsComplete);
+  fNBytesPending -= nLongsComplete*sizeof(UInt_t);
+  return true;
+}
+
+bool ORStreamConnection::IsBufferFull() const
+{
+  return fBuffer->GetNFree()*sizeof(UInt_t) <= fNBytesPending;
+}
+
+void ORStreamConnection::CloseStream()
+{
+  if (fNBytesPending > 0) {
+    ORLog(kWarning) << "Stream closed in the middle of a record" << std::endl;
+  }
+  fBuffer->Close();
+}
+
+bool ORStreamConnection::HasData() const
+{
+  return fBuffer->GetNLongs() > fNLongsInUse;
+}
+
+bool ORStreamConnection::IsFinished() const
+{
+  return fBuffer->IsClosed() && !HasData();
+}
+
+void ORStreamConnection::ReleaseRecords()
+{
+  if (fNLongsInUse == 0) return;
+  fBuffer->CommitRead(fNLongsInUse);
+  fNLongsInUse = 0;
+}
+
+size_t ORStreamConnection::Read(char* buffer, size_t nBytes)
+{
+  ReleaseRecords();
+  return fBuffer->Read((UInt_t*) buffer, nBytes/sizeof(UInt_t))*sizeof(UInt_t);
+}
+
+bool ORStreamConnection::ReadRecords(ORRecordBatch& batch)
+{
+  batch.Clear();
+  ReleaseRecords();
+  if (fBuffer->GetNLongs() == 0) return false;
+
+  /* Only complete records are published. */
+  size_t nContiguous = 0;
+  UInt_t* records = fBuffer->GetReadPointer(nContiguous);
+  if (fStreamVersion == ORHeaderDecoder::kUnknownVersion) {
+    DetermineFileTypeAndSetupSwap((char*) records);
+  }
+
+  size_t nLongsFramed = 0;
+  batch.UseExternalArena(records);
+  if (!FrameRecords(batch, nContiguous, nLongsFramed)) return false;
+  if (batch.GetNRecords() > 0) {
+    fNLongsInUse = nLongsFramed;
+    return true;
+  }
+
+  /* The next record wraps around the end of the buffer: copy it out. */
+  batch.Clear();
+  UInt_t firstWord = records[0];
+  if (MustSwap()) ORUtils::Swap(firstWord);
+  size_t recordLength = fBasicDecoder.LengthOf(&firstWord);
+  fBuffer->Read(batch.ReserveLongs(recordLength), recordLength);
+  return FrameRecords(batch, recordLength, nLongsFramed);
+}
+
+Int_t ORStreamConnection::WriteBuffer(const void* buffer, size_t nBytes)
+{
+  const char* charBuffer = (const char*) buffer;
+  size_t nBytesWritten = 0;
+  while (nBytesWritten < nBytes) {
+    ssize_t retVal = send(fSocketDescriptor, charBuffer + nBytesWritten,
+                          nBytes - nBytesWritten, kSendFlags);
+    if (retVal > 0) {
+      nBytesWritten += retVal;
+      continue;
+    }
+    if (retVal < 0 && errno == EINTR) continue;
+    if (retVal < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      struct pollfd pollDescriptor;
+      pollDescriptor.fd = fSocketDescriptor;
+      pollDescriptor.events = POLLOUT;
+      poll(&pollDescriptor, 1, 1000);
+      continue;
+    }
+    break;
+  }
+  return nBytesWritten;
+}
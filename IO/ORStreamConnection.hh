@@ -0,0 +1,94 @@
+// ORStreamConnection.hh
+
+#ifndef _ORStreamConnection_hh_
+#define _ORStreamConnection_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef _ORVReader_hh_
+#include "ORVReader.hh"
+#endif
+#ifndef _ORVWriter_hh_
+#include "ORVWriter.hh"
+#endif
+
+class ORRingBuffer;
+
+//! A connected Orca stream that is fed by an event loop
+/*!
+   ORStreamConnection is the reader of one stream served by ORStreamServer.
+   Unlike ORSocketReader it has no thread of its own: the server's event
+   loop calls ReceiveData() whenever the socket is readable, which reads
+   whatever the socket has into a circular buffer and publishes the
+   complete records.  A worker then processes them with ReadRecords(),
+   which hands them out in place and, instead of waiting for more, returns
+   false once there are none left (see
+   ORDataProcManager::ProcessAvailableRecords()).
+
+   When the buffer fills up, the event loop stops reading the socket until
+   the worker has caught up, so that TCP flow control pushes back on the
+   sender.  A record that can never fit into the buffer ends the stream.
+
+   ReceiveData() and CloseStream() must be called from one thread, the
+   reading functions from one other thread at a time.
+ */
+class ORStreamConnection : public ORVReader, public ORVWriter
+{
+  public:
+    enum EStreamConnectionConsts { kDefaultBufferLength = 0x100000 };
+
+    //! Takes over the (connected) socket socketDescriptor.
+    ORStreamConnection(int socketDescriptor,
+                       size_t bufferLength = kDefaultBufferLength);
+    virtual ~ORStreamConnection();
+
+    virtual int GetDescriptor() const { return fSocketDescriptor; }
+
+    /* Event loop side. */
+
+    /*!
+       Receives what the socket has without blocking and publishes the
+       complete records.  Returns false once the stream is over (closed by
+       the peer, broken or corrupt); call CloseStream() then.
+     */
+    virtual bool ReceiveData();
+    //! True if ReceiveData() can't take anything before records are read.
+    virtual bool IsBufferFull() const;
+    //! No more data will be received.
+    virtual void CloseStream();
+
+    /* Worker side. */
+
+    //! True if there are records to be read
+    virtual bool HasData() const;
+    //! True once the stream is closed and all its records have been read
+    virtual bool IsFinished() const;
+
+    //! Copies up to nBytes out of the buffer, without waiting for more.
+    virtual size_t Read(char* buffer, size_t nBytes);
+    /*!
+       Frames the records waiting in the buffer in place.  Returns false
+       if there are none; does not wait.
+     */
+    virtual bool ReadRecords(ORRecordBatch& batch);
+    virtual bool OKToRead() { return !IsFinished(); }
+    virtual bool OpenDataStream() { return true; }
+    virtual void Close() {}
+
+    //! Writes back to the peer, e.g. answers to Orca requests.
+    virtual Int_t WriteBuffer(const void* buffer, size_t nBytes);
+
+  protected:
+    virtual size_t PendingRecordLength(size_t offset);
+    virtual bool PublishRecords();
+    virtual void ReleaseRecords();
+
+  protected:
+    int fSocketDescriptor;
+    ORRingBuffer* fBuffer;
+    size_t fNBytesPending;   // received behind the published records
+    bool fFirstWordRead;
+    bool fStreamMustSwap;    // as seen by the event loop
+    size_t fNLongsInUse;     // handed out by the last ReadRecords()
+};
+
+#endif
@@ -61,6 +61,73 @@ bool ORVReader::ReadRecord(std::vector<UInt_t>& buffer)
   return true;
 }
 
+bool ORVReader::ReadRecordView(std::vector<UInt_t>& buffer, UInt_t*& record)
+{
+  if (!ReadRecord(buffer)) return false;
+  record = &buffer[0];
+  return true;
+}
+
+bool ORVReader::ReadRecords(ORRecordBatch& batch)
+{
+  batch.Clear();
+  UInt_t* record = NULL;
+  if (!ReadRecordView(fRecordBuffer, record)) return false;
+  batch.UseExternalArena(record);
+  batch.AddRecord(fBasicDecoder.LengthOf(record));
+  SwapRecord(batch, 0);
+  return true;
+}
+
+void ORVReader::SwapRecord(ORRecordBatch& batch, size_t i)
+{
+  UInt_t* record = batch.GetRecord(i);
+  if (fHeaderDecoder.IsHeader(record[0])) {
+    // the data ids may be different after this header
+    fSwapDataIds.clear();
+    return;
+  }
+  if (!MustSwap() || fSwapDataIds.empty()) return;
+  if (fSwapDataIds.find(fBasicDecoder.DataIdOf(record)) == fSwapDataIds.end()) return;
+  size_t length = fBasicDecoder.LengthOf(record);
+  if (length > 1) ORUtils::SwapBlock(record + 1, length - 1);
+  batch.SetRecordSwapped(i);
+}
+
+bool ORVReader::FrameRecords(ORRecordBatch& batch, size_t nLongs, 
+                             size_t& nLongsFramed)
+{
+  UInt_t* data = batch.GetFillPosition();
+  size_t nLongsTarget = batch.GetBlockSize()/sizeof(UInt_t);
+  nLongsFramed = 0;
+  while (nLongsFramed < nLongs) {
+    UInt_t* record = data + nLongsFramed;
+    // Don't touch the record until we know it is complete: an incomplete
+    // one is read again, and must not get swapped twice.
+    UInt_t firstWord = record[0];
+    if (MustSwap()) ORUtils::Swap(firstWord);
+    size_t recordLength = fBasicDecoder.LengthOf(&firstWord);
+    if (recordLength < 1) { 
+      ORLog(kError) << "Record length is less than one!" << std::endl;
+      return false;
+    }
+    if (recordLength > nLongs - nLongsFramed) break;
+    bool isHeader = fHeaderDecoder.IsHeader(firstWord);
+    // Only write to the record if it has to be swapped: a mapped file
+    // (see ORMappedFileReader) copies every page that is written to.
+    if (MustSwap()) {
+      record[0] = firstWord;
+      // header records have 2 *header* words, see ReadRestOfHeader()
+      if (isHeader) ORUtils::Swap(record[1]);
+    }
+    batch.AddRecord(recordLength);
+    SwapRecord(batch, batch.GetNRecords() - 1);
+    nLongsFramed += recordLength;
+    if (isHeader || batch.GetNLongs() >= nLongsTarget) break;
+  }
+  return true;
+}
+
 size_t ORVReader::DeleteAndResizeBuffer(std::vector<UInt_t>& buffer, size_t newNLongsMax)
 {
   buffer.resize(newNLongsMax);
@@ -69,6 +136,8 @@ size_t ORVReader::DeleteAndResizeBuffer(std::vector<UInt_t>& buffer, size_t newN
 
 void ORVReader::DetermineFileTypeAndSetupSwap(char* buffer)
 {
+  // a new stream: its data ids aren't known yet
+  fSwapDataIds.clear();
   fStreamVersion = fHeaderDecoder.GetStreamVersion(((UInt_t*) buffer)[0]);
   if (fStreamVersion == ORHeaderDecoder::kOld) {
     fMustSwap = ORUtils::SysIsLittleEndian();
@@ -9,6 +9,11 @@
 #ifndef _ORBasicDataDecoder_hh
 #include "ORBasicDataDecoder.hh"
 #endif
+#ifndef _ORRecordBatch_hh_
+#include "ORRecordBatch.hh"
+#endif
+#include <set>
+#include <vector>
 //! Virtual Reader class defining the interface for OrcaROOT Readers.
 /*!
 
@@ -39,6 +44,27 @@ class ORVReader
      */
     virtual bool ReadRecord(std::vector<UInt_t>& buffer); 
 
+    /*!
+       ReadRecordView reads the next record like ReadRecord, but returns a
+       pointer to it in record instead of guaranteeing that it was placed
+       in buffer.  Readers that can hand out records without copying them
+       (e.g. ORMappedFileReader) override this; by default the record is
+       read into buffer and record points to its beginning.  The record is
+       only valid until the next call.  Returns true if successful.
+     */
+    virtual bool ReadRecordView(std::vector<UInt_t>& buffer, UInt_t*& record);
+
+    /*!
+       ReadRecords clears batch and fills it with as many complete records as
+       the reader can cheaply provide, aiming for batch.GetBlockSize() bytes.
+       A header record always ends a batch, so that MustSwap() reflects the
+       stream the last record of the batch came from.  The default
+       implementation returns a single record read with ReadRecordView;
+       readers that can frame records in bulk override it.  Returns true if
+       at least one record was read.
+     */
+    virtual bool ReadRecords(ORRecordBatch& batch);
+
     virtual bool Open() { fStreamVersion = ORHeaderDecoder::kUnknownVersion; 
                           return OpenDataStream(); }
 
@@ -58,18 +84,45 @@ class ORVReader
      */
     inline bool MustSwap() { return fMustSwap; }
 
+    /*!
+       Let ReadRecords() swap the records with these data ids whole (all
+       but the first word, which is always swapped), in bulk with
+       ORUtils::SwapBlock(), and mark them swapped in the batch.  Only for
+       data ids whose decoders have the default Swap() (see
+       ORVDataDecoder::HasDefaultSwap()).  The data ids are those of one
+       header: they are forgotten when the reader comes across the next.
+     */
+    virtual void SetSwapDataIds(const std::set<UInt_t>& dataIds) { fSwapDataIds = dataIds; }
+
   protected:
     virtual size_t DeleteAndResizeBuffer(std::vector<UInt_t>& buffer, size_t newNLongsMax); 
     virtual void DetermineFileTypeAndSetupSwap(char* buffer);
     virtual bool ReadFirstWord(std::vector<UInt_t>& buffer);
     virtual bool ReadRestOfHeader(std::vector<UInt_t>& buffer);
     virtual bool ReadRestOfLongRecord(std::vector<UInt_t>& buffer);
+    /*!
+       Frames the complete records among the nLongs words found at
+       batch.GetFillPosition(), swapping their first word if necessary, and
+       adds them to batch.  Framing stops at an incomplete record, after a
+       header, or once the batch reaches its block size.  nLongsFramed is
+       set to the number of words consumed.  Returns false if a corrupt
+       record length was encountered at position nLongsFramed.
+     */
+    virtual bool FrameRecords(ORRecordBatch& batch, size_t nLongs, 
+                              size_t& nLongsFramed);
+    /*!
+       Swaps the rest of the i-th record of batch if its data id is one of
+       fSwapDataIds (see SetSwapDataIds()), or forgets them at a header.
+     */
+    virtual void SwapRecord(ORRecordBatch& batch, size_t i);
 
   protected:
     ORHeaderDecoder::EOrcaStreamVersion fStreamVersion;
     ORBasicDataDecoder fBasicDecoder;
     ORHeaderDecoder fHeaderDecoder;
     bool fMustSwap;
+    std::vector<UInt_t> fRecordBuffer;
+    std::set<UInt_t> fSwapDataIds;
 };
 
 #endif
@@ -0,0 +1,209 @@
+// ORWriteBehindBuffer.cc
+
+#include "ORWriteBehindBuffer.hh"
+
+#include "ORLogger.hh"
+#include "ORThreadPlacement.hh"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+void* WriteBehindThread(void* writeBehindBuffer)
+{
+  ((ORWriteBehindBuffer*) writeBehindBuffer)->WriteBlocks();
+  return NULL;
+}
+
+ORWriteBehindBuffer::ORWriteBehindBuffer(size_t nBlocks, size_t nBytesPerBlock)
+{
+  fNBlocks = (nBlocks < 1) ? 1 : nBlocks;
+  fBlockSize = ((nBytesPerBlock + kAlignment - 1)/kAlignment)*kAlignment;
+  if (fBlockSize == 0) fBlockSize = kAlignment;
+  void* blocks = NULL;
+  if (posix_memalign(&blocks, kAlignment, fNBlocks*fBlockSize) != 0) {
+    ORLog(kFatal) << "Could not allocate " << fNBlocks*fBlockSize
+                  << " bytes of output buffer" << endl;
+  }
+  fBlocks = (char*) blocks;
+  ORThreadPlacement::BindMemory(fBlocks, fNBlocks*fBlockSize, ORThreadPlacement::kWriter);
+  fBlockFill.resize(fNBlocks);
+  fFileDescriptor = -1;
+  fFirstFullBlock = 0;
+  fNFullBlocks = 0;
+  fWriteFailed = false;
+  fStopRequested = false;
+  fHaveBlock = false;
+  fCurrentBlock = 0;
+  fNBytesWritten = 0;
+  fThreadIsRunning = false;
+  pthread_mutex_init(&fMutex, NULL);
+  pthread_cond_init(&fBlockFilled, NULL);
+  pthread_cond_init(&fBlockFreed, NULL);
+}
+
+ORWriteBehindBuffer::~ORWriteBehindBuffer()
+{
+  Stop();
+  pthread_cond_destroy(&fBlockFreed);
+  pthread_cond_destroy(&fBlockFilled);
+  pthread_mutex_destroy(&fMutex);
+  free(fBlocks);
+}
+
+bool ORWriteBehindBuffer::Start(int fileDescriptor)
+{
+  // not virtual: derived classes call this after setting up the descriptor
+  ORWriteBehindBuffer::Stop();
+  fFileDescriptor = fileDescriptor;
+  fFirstFullBlock = 0;
+  fNFullBlocks = 0;
+  fWriteFailed = false;
+  fStopRequested = false;
+  fHaveBlock = false;
+  fNBytesWritten = 0;
+  if (ORThreadPlacement::CreateThread(&fThread, ORThreadPlacement::kWriter, 0,
+                                      WriteBehindThread, this) != 0) {
+    ORLog(kError) << "Error starting write-behind thread" << endl;
+    return false;
+  }
+  fThreadIsRunning = true;
+  return true;
+}
+
+bool ORWriteBehindBuffer::Stop()
+{
+  bool isGood = true;
+  if (fThreadIsRunning) {
+    // The partially filled block goes out last.
+    if (fHaveBlock && fBlockFill[fCurrentBlock] > 0) HandOverBlock();
+    fHaveBlock = false;
+    pthread_mutex_lock(&fMutex);
+    fStopRequested = true;
+    pthread_cond_broadcast(&fBlockFilled);
+    pthread_mutex_unlock(&fMutex);
+    pthread_join(fThread, NULL);
+    fThreadIsRunning = false;
+    isGood = !fWriteFailed;
+  }
+  if (fFileDescriptor >= 0) close(fFileDescriptor);
+  fFileDescriptor = -1;
+  fFirstFullBlock = 0;
+  fNFullBlocks = 0;
+  return isGood;
+}
+
+bool ORWriteBehindBuffer::IsGood()
+{
+  pthread_mutex_lock(&fMutex);
+  bool isGood = !fWriteFailed;
+  pthread_mutex_unlock(&fMutex);
+  return isGood;
+}
+
+char* ORWriteBehindBuffer::GetWritePointer(size_t& nBytesFree)
+{
+  if (!fHaveBlock) {
+    pthread_mutex_lock(&fMutex);
+    while (fNFullBlocks == fNBlocks) {
+      pthread_cond_wait(&fBlockFreed, &fMutex);
+    }
+    fCurrentBlock = (fFirstFullBlock + fNFullBlocks) % fNBlocks;
+    pthread_mutex_unlock(&fMutex);
+    // The thread doesn't touch free blocks, so fill without the lock.
+    fBlockFill[fCurrentBlock] = 0;
+    fHaveBlock = true;
+  }
+  nBytesFree = fBlockSize - fBlockFill[fCurrentBlock];
+  return fBlocks + fCurrentBlock*fBlockSize + fBlockFill[fCurrentBlock];
+}
+
+void ORWriteBehindBuffer::CommitWrite(size_t nBytes)
+{
+  if (!fHaveBlock) return;
+  fBlockFill[fCurrentBlock] += nBytes;
+  fNBytesWritten += nBytes;
+  if (fBlockFill[fCurrentBlock] == fBlockSize) {
+    HandOverBlock();
+    fHaveBlock = false;
+  }
+}
+
+void ORWriteBehindBuffer::Write(const char* buffer, size_t nBytes)
+{
+  while (nBytes > 0) {
+    size_t nBytesFree = 0;
+    char* block = GetWritePointer(nBytesFree);
+    size_t nBytesToCopy = (nBytes < nBytesFree) ? nBytes : nBytesFree;
+    memcpy(block, buffer, nBytesToCopy);
+    CommitWrite(nBytesToCopy);
+    buffer += nBytesToCopy;
+    nBytes -= nBytesToCopy;
+  }
+}
+
+void ORWriteBehindBuffer::HandOverBlock()
+{
+  pthread_mutex_lock(&fMutex);
+  fNFullBlocks++;
+  pthread_cond_signal(&fBlockFilled);
+  pthread_mutex_unlock(&fMutex);
+}
+
+bool ORWriteBehindBuffer::WriteBlock(const char* block, size_t nBytes)
+{
+  size_t nBytesDone = 0;
+  while (nBytesDone < nBytes) {
+    size_t nBytesToWrite = nBytes - nBytesDone;
+#ifdef O_DIRECT
+    int flags = fcntl(fFileDescriptor, F_GETFL);
+    if ((flags & O_DIRECT) && nBytesToWrite % kAlignment != 0) {
+      /* Direct I/O only takes whole aligned pieces: write those, and the
+         tail at the end of the file through the page cache. */
+      if (nBytesToWrite >= kAlignment) nBytesToWrite -= nBytesToWrite % kAlignment;
+      else fcntl(fFileDescriptor, F_SETFL, flags & ~O_DIRECT);
+    }
+#endif
+    ssize_t retVal = write(fFileDescriptor, block + nBytesDone, nBytesToWrite);
+    if (retVal < 0) {
+      if (errno == EINTR) continue;
+      ORLog(kError) << "WriteBlock(): write failed: " << strerror(errno) << endl;
+      return false;
+    }
+    nBytesDone += retVal;
+  }
+  return true;
+}
+
+void ORWriteBehindBuffer::WriteBlocks()
+{
+  bool writeFailed = false;
+  while (1) {
+    pthread_mutex_lock(&fMutex);
+    while (fNFullBlocks == 0 && !fStopRequested) {
+      pthread_cond_wait(&fBlockFilled, &fMutex);
+    }
+    if (fNFullBlocks == 0) {
+      // stopping, and everything is written
+      pthread_mutex_unlock(&fMutex);
+      return;
+    }
+    size_t iBlock = fFirstFullBlock;
+    pthread_mutex_unlock(&fMutex);
+
+    // After a failure, blocks are dropped so that the producer goes on.
+    if (!writeFailed) {
+      writeFailed = !WriteBlock(fBlocks + iBlock*fBlockSize, fBlockFill[iBlock]);
+    }
+
+    pthread_mutex_lock(&fMutex);
+    if (writeFailed) fWriteFailed = true;
+    fFirstFullBlock = (fFirstFullBlock + 1) % fNBlocks;
+    fNFullBlocks--;
+    pthread_cond_signal(&fBlockFreed);
+    pthread_mutex_unlock(&fMutex);
+  }
+}
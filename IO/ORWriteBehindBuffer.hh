@@ -0,0 +1,106 @@
+// ORWriteBehindBuffer.hh
+
+#ifndef _ORWriteBehindBuffer_hh_
+#define _ORWriteBehindBuffer_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <pthread.h>
+#include <vector>
+
+extern "C" void* WriteBehindThread(void*);
+
+//! Multi-buffered asynchronous writer for a file descriptor
+/*!
+   ORWriteBehindBuffer is the counterpart of ORReadAheadBuffer: the
+   producer fills a ring of large blocks, and a thread writes each block to
+   the file descriptor as soon as it is full, so that writing to disk
+   overlaps with processing.  The producer only blocks if all blocks are
+   waiting to be written.
+
+   The blocks are aligned to kAlignment bytes and their size is a multiple
+   of it, so the descriptor may be opened with O_DIRECT: all but the last,
+   partial block of a file are then written directly from the blocks.
+   The producer can write through Write(), or fill the blocks in place
+   with GetWritePointer() and CommitWrite().  This class is not meant to
+   be shared between producer threads.
+ */
+class ORWriteBehindBuffer
+{
+  friend void* WriteBehindThread(void*);
+
+  public:
+    enum EWriteBehindBufferConsts { kAlignment = 4096 };
+
+    //! nBytesPerBlock is rounded up to a multiple of kAlignment.
+    ORWriteBehindBuffer(size_t nBlocks = 4, size_t nBytesPerBlock = 4*1024*1024);
+    virtual ~ORWriteBehindBuffer();
+
+    /*!
+       Start writing to fileDescriptor at its current position.  The buffer
+       takes ownership of the descriptor and closes it in Stop().
+       Returns false if the thread could not be started.
+     */
+    virtual bool Start(int fileDescriptor);
+    /*!
+       Write out everything that was written to the buffer, stop the thread
+       and close the descriptor.  Returns false if anything failed to be
+       written.
+     */
+    virtual bool Stop();
+    virtual bool IsActive() const { return fThreadIsRunning; }
+    //! False once a write to the descriptor has failed.
+    virtual bool IsGood();
+
+    //! Copies nBytes into the buffer, blocking while all blocks are full.
+    virtual void Write(const char* buffer, size_t nBytes);
+    /*!
+       Returns where the next bytes go, and in nBytesFree how many fit
+       there contiguously (at least one).  Blocks while all blocks are full.
+     */
+    virtual char* GetWritePointer(size_t& nBytesFree);
+    //! Hands the next nBytes (at most nBytesFree) over to be written.
+    virtual void CommitWrite(size_t nBytes);
+
+    //! Bytes written to the buffer since Start().
+    virtual size_t GetNBytesWritten() const { return fNBytesWritten; }
+    virtual size_t GetNBlocks() const { return fNBlocks; }
+    virtual size_t GetBlockSize() const { return fBlockSize; }
+
+  protected:
+    /*!
+       Writes nBytes of block to fFileDescriptor.  Returns false if they
+       could not all be written.  Called from the write-behind thread.
+     */
+    virtual bool WriteBlock(const char* block, size_t nBytes);
+    //! Body of the write-behind thread.
+    virtual void WriteBlocks();
+    virtual void HandOverBlock();
+
+  protected:
+    size_t fNBlocks;
+    size_t fBlockSize;
+    char* fBlocks;
+    std::vector<size_t> fBlockFill;
+    int fFileDescriptor;
+
+  private:
+    /* Ring state; shared between the threads and guarded by fMutex. */
+    size_t fFirstFullBlock;
+    size_t fNFullBlocks;
+    bool fWriteFailed;
+    bool fStopRequested;
+    /* Producer-only state. */
+    bool fHaveBlock;
+    size_t fCurrentBlock;
+    size_t fNBytesWritten;
+    bool fThreadIsRunning;
+
+    pthread_t fThread;
+    pthread_mutex_t fMutex;
+    pthread_cond_t fBlockFilled;
+    pthread_cond_t fBlockFreed;
+};
+
+#endif /* __CINT__ */
+#endif /* _ORWriteBehindBuffer_hh_ */
@@ -2,9 +2,16 @@
 
 #include "ORDataProcManager.hh"
 
+#include "ORFileReader.hh"
 #include "ORLogger.hh"
 #include "ORSocketReader.hh"
+#include "ORTimingStats.hh"
 #include "ORVWriter.hh"
+#include "TString.h"
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
 #include <vector>
 
 ORDataProcManager::ORDataProcManager(ORVReader* reader, ORRunDataProcessor* runDataProc, ORHeaderProcessor* headerProc)
@@ -27,6 +34,26 @@ ORDataProcManager::ORDataProcManager(ORVReader* reader, ORRunDataProcessor* runD
     fRunDataProcessor->IncreaseHeartbeatVerbosity();
   }
   fRunAsDaemon = false;
+  fHeaderIsReadIn = false;
+  fRunIsOpen = false;
+  fRecordIsSwapped = false;
+  fRecordIsReplayed = false;
+  fLastSwapDataId = ORVDataDecoder::GetIllegalDataId();
+  fLastSwapDecoder = NULL;
+  fMaxSpanLength = 1;
+  fSwapInReader = false;
+  fSkipReplayedRecords = false;
+  fCheckpointInterval = 600;
+  fLastCheckpointTime = 0;
+  fNextStreamPacket = 0;
+  fResumePacket = 0;
+  fIsResumingFile = false;
+  fResumeIsInRun = false;
+  fResumedRunNumber = -1;
+  fRunStartTicks = 0;
+  fReadTicks = 0;
+  fLastCountedDataId = ORVDataDecoder::GetIllegalDataId();
+  fLastDataIdCount = NULL;
 }
 
 ORDataProcManager::~ORDataProcManager()
@@ -38,6 +65,18 @@ ORDataProcManager::~ORDataProcManager()
 }
 
 ORDataProcManager::EReturnCode ORDataProcManager::ProcessDataStream()
+{
+  if (StartDataStream() >= kAlarm) return kAlarm;
+  while (1) {
+    EReturnCode retCode = ProcessRun();
+    if (retCode >= kAlarm) return kAlarm;
+    if (retCode >= kBreak) break;
+    if (!fRecordBatch.HasNext() && !fReader->OKToRead()) break;
+  }
+  return FinishDataStream();
+}
+
+ORDataProcManager::EReturnCode ORDataProcManager::StartDataStream()
 {
   if (fReader == NULL) {
     ORLog(kError) << "ProcessDataStream(): fReader == NULL: "
@@ -51,13 +90,24 @@ ORDataProcManager::EReturnCode ORDataProcManager::ProcessDataStream()
   
   ORLog(kDebug) << "ProcessDataStream(): calling fReader->Open()..." << std::endl;
   if (!fReader->Open()) return kAlarm; 
-  while (1) {
-    retCode = ProcessRun();
-    if (retCode >= kAlarm) return kAlarm;
-    if (retCode >= kBreak || !fReader->OKToRead()) break;
+  fRecordBatch.Clear();
+  fRunIsOpen = false;
+  fStreamFileName = "";
+  fNextStreamPacket = 0;
+  fLastCheckpointTime = time(NULL);
+  return kSuccess;
+}
+
+ORDataProcManager::EReturnCode ORDataProcManager::FinishDataStream()
+{
+  if (fRunIsOpen) {
+    fRunIsOpen = false;
+    if (FinishRun() >= kAlarm) return kAlarm;
   }
   ORLog(kDebug) << "ProcessDataStream(): calling fReader->Close()..." << std::endl;
   fReader->Close();
+  // nothing left to resume, unless cancelled
+  if (fCheckpointFile != "" && !TestCancel()) remove(fCheckpointFile.c_str());
 
   return EndProcessing();
 }
@@ -66,93 +116,224 @@ ORDataProcManager::EReturnCode ORDataProcManager::ProcessRun()
 {
   // always allow all processors to try to process a run
   SetDoProcessRun();
+  fHeaderIsReadIn = false;
+  if (fIsTiming) StartRunTiming();
+
+  ORLog(kDebug) << "ProcessRun(): start reading records..." << std::endl;
+  bool runIsOver = false;
+  UInt_t* buffer = NULL;
+  while (!runIsOver && NextRecord(buffer)) {
+    if (fMaxSpanLength > 1 && CollectSpan(buffer)) {
+      if (ProcessSpan(runIsOver) >= kAlarm) return kAlarm;
+      continue;
+    }
+    if (ProcessRecord(buffer, runIsOver) >= kAlarm) return kAlarm;
+  }
+  return FinishRun();
+}
+
+bool ORDataProcManager::NextRecord(UInt_t*& record)
+{
+  if (!fRecordBatch.HasNext()) {
+    // all records read so far have been processed
+    if (fCheckpointFile != "" && 
+        time(NULL) >= fLastCheckpointTime + (time_t) fCheckpointInterval && IsInRun()) {
+      WriteCheckpoint(true);
+    }
+    ULong64_t start = fIsTiming ? ORTimingStats::Now() : 0;
+    bool isRead = fReader->ReadRecords(fRecordBatch);
+    if (fIsTiming) fReadTicks += ORTimingStats::Now() - start;
+    if (!isRead) return false;
+  }
+  fRecordIsSwapped = fRecordBatch.IsRecordSwapped(fRecordBatch.GetNConsumed());
+  fRecordIsReplayed = fRecordBatch.IsReplayed();
+  record = fRecordBatch.NextRecord();
+  // account for packets the reader jumped over
+  ULong64_t nSkipped = fRecordBatch.TakeNSkipped();
+  fRunContext->fPacketNumber += nSkipped;
+  if (fRecordDecoder.DataIdOf(record) == 0) fNextStreamPacket = 0;
+  else fNextStreamPacket += nSkipped + 1;
+  return true;
+}
+
+bool ORDataProcManager::CollectSpan(UInt_t* record)
+{
+  fSpan.clear();
+  // only data records of a running run, for which some processor is there
+  if (!fHeaderIsReadIn || !fDoProcessRun || fRunAsDaemon) return false;
+  if (fRunContext->GetState() != ORRunContext::kRunning) return false;
+  UInt_t dataId = fRecordDecoder.DataIdOf(record);
+  if (dataId == fRunDataProcessor->GetDataId()) return false;
+  if (fSwapDecoders.find(dataId) == fSwapDecoders.end()) return false;
+
+  fSpan.push_back(record);
+  while (fSpan.size() < fMaxSpanLength && fRecordBatch.HasNext()) {
+    size_t iNext = fRecordBatch.GetNConsumed();
+    if (fRecordDecoder.DataIdOf(fRecordBatch.GetRecord(iNext)) != dataId) break;
+    if (fRecordBatch.IsRecordSwapped(iNext) != fRecordIsSwapped) break;
+    fSpan.push_back(fRecordBatch.NextRecord());
+  }
+  fNextStreamPacket += fSpan.size() - 1;
+  return fSpan.size() > 1;
+}
+
+ORDataProcManager::EReturnCode ORDataProcManager::ProcessSpan(bool& runIsOver)
+{
+  if (fIsTiming) {
+    for (size_t i=0; i<fSpan.size(); i++) CountRecord(fSpan[i]);
+  }
+  for (size_t i=0; i<fSpan.size(); i++) {
+    SwapRecord(fSpan[i]);
+    fRunDataProcessor->ProcessDataRecord(fSpan[i]);
+  }
 
+  fRunContext->StartSpan();
+  if (ProcessDataRecords(&fSpan[0], fSpan.size()) >= kAlarm) return kAlarm;
+  fRunContext->fPacketNumber = fRunContext->fFirstPacketOfSpan + fSpan.size();
+
+  if (fRunContext->GetState() == ORRunContext::kStopping || TestCancel()) {
+    runIsOver = true;
+  }
+  return kSuccess;
+}
 
+ORDataProcManager::EReturnCode ORDataProcManager::ProcessAvailableRecords(size_t maxRecords)
+{
+  size_t nRecords = 0;
+  while (fRecordBatch.HasNext() || fReader->ReadRecords(fRecordBatch)) {
+    if (!fRunIsOpen) {
+      SetDoProcessRun();
+      fHeaderIsReadIn = false;
+      fRunIsOpen = true;
+      if (fIsTiming) StartRunTiming();
+    }
+    fRecordIsSwapped = fRecordBatch.IsRecordSwapped(fRecordBatch.GetNConsumed());
+    fRecordIsReplayed = fRecordBatch.IsReplayed();
+    UInt_t* buffer = fRecordBatch.NextRecord();
+    fRunContext->fPacketNumber += fRecordBatch.TakeNSkipped();
+    bool runIsOver = false;
+    if (ProcessRecord(buffer, runIsOver) >= kAlarm) return kAlarm;
+    if (runIsOver) {
+      fRunIsOpen = false;
+      EReturnCode retCode = FinishRun();
+      if (retCode != kSuccess) return retCode;
+    }
+    nRecords++;
+    if (maxRecords != 0 && nRecords >= maxRecords && !fRecordBatch.HasNext()) break;
+  }
+  return kSuccess;
+}
+
+ORDataProcManager::EReturnCode ORDataProcManager::ProcessRecord(UInt_t* buffer, 
+                                                               bool& runIsOver)
+{
   EReturnCode retCode;
-  size_t nLongsMax = 1024;
-  std::vector<UInt_t> vecbuffer(nLongsMax);
+  if (fIsTiming) CountRecord(buffer);
 
-  Bool_t headerIsReadIn = false;
+  // Check if it is a header
 
-  ORLog(kDebug) << "ProcessRun(): start reading records..." << std::endl;
-  while (fReader->ReadRecord(vecbuffer)) {
-
-    UInt_t* buffer = &vecbuffer[0];
-    // Check if it is a header
-
-    if(fHeaderProcessor->ProcessDataRecord(buffer) == kSuccess) {
-      // It is a header, perform the setup
-      // Set the default flag, header is not read in yet
-      headerIsReadIn = false;
-      fRunContext->SetMustSwap(fReader->MustSwap());
-      
-      /* Also check to see if we can write to the reader. */
-      if (ORVWriter* theMonitor = dynamic_cast<ORVWriter*>(fReader)) {
-        fRunContext->SetWritableSocket(theMonitor);
-      } else {
-        fRunContext->SetWritableSocket(NULL);
-      }
-      
-      // Load the header dictionary
-      ORLog(kDebug) << "ProcessRun(): loading dictionary..." << std::endl;
-      if (!fRunContext->LoadHeader(fHeaderProcessor->GetHeader(), fRunAsDaemon)) {
-
-        /* We have encountered a problem loading the header file. */
-        /* Kill Run, try going to the next run. */
-        ORLog(kError) << "ProcessRun(): Error loading header file.  Stopping run." << std::endl;
-        break;
-      } 
-      
-      // Set all the IDs, dictionary
-      ORLog(kDebug) << "ProcessRun(): setting dataIDs..." << std::endl;
-
-      SetDataId();
-
-      SetDecoderDictionary();
-
-      headerIsReadIn = true;
-      
-      // Read the next record
-      continue; 
-    } // End checking if it is a header
-    if (!headerIsReadIn) break;
-
-    fRunContext->ResetRecordFlags();
-    if (!fRunAsDaemon) {
-      fRunDataProcessor->ProcessDataRecord(buffer);
+  if(fHeaderProcessor->ProcessDataRecord(buffer) == kSuccess) {
+    // It is a header, perform the setup
+    // Set the default flag, header is not read in yet
+    fHeaderIsReadIn = false;
+    fRunContext->SetMustSwap(fReader->MustSwap());
+    // the reader is still at the file of the header
+    ORFileReader* fileReader = dynamic_cast<ORFileReader*>(fReader);
+    fStreamFileName = (fileReader != NULL) ? fileReader->GetFileName() : "";
+    // only the first file is resumed
+    if (fIsResumingFile) fResumePacket = 0;
+    fIsResumingFile = (fResumePacket > 0);
+    
+    /* Also check to see if we can write to the reader. */
+    if (ORVWriter* theMonitor = dynamic_cast<ORVWriter*>(fReader)) {
+      fRunContext->SetWritableSocket(theMonitor);
+    } else {
+      fRunContext->SetWritableSocket(NULL);
     }
+    
+    // Load the header dictionary
+    ORLog(kDebug) << "ProcessRun(): loading dictionary..." << std::endl;
+    if (!fRunContext->LoadHeader(fHeaderProcessor->GetHeader(), fRunAsDaemon)) {
+
+      /* We have encountered a problem loading the header file. */
+      /* Kill Run, try going to the next run. */
+      ORLog(kError) << "ProcessRun(): Error loading header file.  Stopping run." << std::endl;
+      runIsOver = true;
+      return kSuccess;
+    } 
+    
+    // Set all the IDs, dictionary
+    ORLog(kDebug) << "ProcessRun(): setting dataIDs..." << std::endl;
+
+    SetDataId();
+    SetSwapDecoders();
+
+    SetDecoderDictionary();
+
+    fHeaderIsReadIn = true;
+    
+    // Read the next record
+    return kSuccess; 
+  } // End checking if it is a header
+  if (!fHeaderIsReadIn) {
+    runIsOver = true;
+    return kSuccess;
+  }
+
+  // records replayed up to the checkpoint (see ResumeFromCheckpoint()) were
+  // processed before; those of a run that was over aren't processed again
+  bool isReplayed = fIsResumingFile && fNextStreamPacket <= fResumePacket;
+  if (isReplayed && !fResumeIsInRun) return kSuccess;
 
-    if (fRunContext->GetState() <= ORRunContext::kStarting) {
-      // Starting a run
-      fRunContext->fPacketNumber = 0;
-      retCode = StartRun();
-      if (retCode >= kFailure) KillRun(); // but keep processing: skips to next run
-      if (retCode >= kAlarm) return kAlarm;
-      if (!fRunAsDaemon) {
-        fRunDataProcessor->OnStartRunComplete(); 
-      }
-    }      
-    if (fDoProcessRun) {
-      // let all processors process the data record
-      if (ProcessDataRecord(buffer) >= kAlarm) return kAlarm;
+  /* The reader may have swapped the record already. */
+  SwapRecord(buffer);
+  if (!fRunAsDaemon) {
+    fRunDataProcessor->ProcessDataRecord(buffer);
+  }
+
+  if (fRunContext->GetState() <= ORRunContext::kStarting) {
+    // Starting a run
+    fRunContext->fPacketNumber = 0;
+    fRunContext->fIsResumed = isReplayed;
+    if (isReplayed && fRunContext->GetRunNumber() != fResumedRunNumber) {
+      ORLog(kWarning) << "ProcessRun(): resuming run " << fRunContext->GetRunNumber()
+                      << ", but the checkpoint was in run " << fResumedRunNumber << std::endl;
     }
-  
-    if (fRunContext->GetState() == ORRunContext::kStopping) {
-      break;
+    retCode = StartRun();
+    if (retCode >= kFailure) KillRun(); // but keep processing: skips to next run
+    if (retCode >= kAlarm) return kAlarm;
+    if (!fRunAsDaemon) {
+      fRunDataProcessor->OnStartRunComplete(); 
     }
+  }      
+  if (fDoProcessRun && !isReplayed && !(fSkipReplayedRecords && fRecordIsReplayed)) {
+    // let all processors process the data record
+    if (ProcessDataRecord(buffer) >= kAlarm) return kAlarm;
+  }
 
-    if (TestCancel()) break;
-
-    fRunContext->fPacketNumber++;
+  if (fRunContext->GetState() == ORRunContext::kStopping || TestCancel()) {
+    runIsOver = true;
+    return kSuccess;
   }
+
+  fRunContext->fPacketNumber++;
+  return kSuccess;
+}
+
+ORDataProcManager::EReturnCode ORDataProcManager::FinishRun()
+{
   // Set up Run Context
   ORLog(kDebug) << "ProcessRun(): finished reading records..." << std::endl;
-  retCode = EndRun();
+  // a run cut short (by a ctrl-c, say) can be resumed where it was cut
+  bool isInRun = IsInRun();
+  EReturnCode retCode = EndRun();
+  if (fIsTiming) ReportRunTiming();
 
   if (retCode >= kAlarm) return kAlarm;
   if (!fRunAsDaemon) {
     fRunDataProcessor->OnEndRunComplete();
   }
+  if (fCheckpointFile != "" && fHeaderIsReadIn) WriteCheckpoint(isInRun);
 
   if (TestCancel()) return kBreak;
   return kSuccess;
@@ -181,3 +362,220 @@ void ORDataProcManager::SetDataId()
   }
   ORCompoundDataProcessor::SetDataId();
 }
+
+void ORDataProcManager::SetSwapDecoders()
+{
+  fSwapDecoders.clear();
+  fLastSwapDataId = ORVDataDecoder::GetIllegalDataId();
+  fLastSwapDecoder = NULL;
+  // the run data processor gets to swap its records first
+  if (!fRunAsDaemon && 
+      fRunDataProcessor->GetDataId() != ORVDataDecoder::GetIllegalDataId()) {
+    fSwapDecoders[fRunDataProcessor->GetDataId()] = fRunDataProcessor->GetDecoder();
+  }
+  GetDecoders(fSwapDecoders);
+  if (fSwapInReader) {
+    std::set<UInt_t> dataIds;
+    std::map<UInt_t, ORVDataDecoder*>::const_iterator it;
+    for (it = fSwapDecoders.begin(); it != fSwapDecoders.end(); it++) {
+      if (it->second != NULL && it->second->HasDefaultSwap()) dataIds.insert(it->first);
+    }
+    fReader->SetSwapDataIds(dataIds);
+  }
+}
+
+void ORDataProcManager::BuildDispatchTable()
+{
+  ORCompoundDataProcessor::BuildDispatchTable();
+  // a new processor may want records that weren't swapped so far
+  fLastSwapDataId = ORVDataDecoder::GetIllegalDataId();
+  fLastSwapDecoder = NULL;
+}
+
+void ORDataProcManager::SwapRecordWithDecoder(UInt_t* record)
+{
+  UInt_t dataId = fRecordDecoder.DataIdOf(record);
+  if (dataId != fLastSwapDataId) {
+    std::map<UInt_t, ORVDataDecoder*>::const_iterator it = fSwapDecoders.find(dataId);
+    if (it != fSwapDecoders.end()) fLastSwapDecoder = it->second;
+    // processors that take all records get the others swapped whole
+    else if (!GetProcessorsFor(dataId).empty()) fLastSwapDecoder = &fRecordDecoder;
+    else fLastSwapDecoder = NULL;
+    fLastSwapDataId = dataId;
+  }
+  if (fLastSwapDecoder != NULL) fLastSwapDecoder->Swap(record);
+}
+
+bool ORDataProcManager::ResumeFromCheckpoint()
+{
+  if (fCheckpointFile == "") {
+    ORLog(kError) << "ResumeFromCheckpoint(): no checkpoint file was set" << std::endl;
+    return false;
+  }
+  std::ifstream file(fCheckpointFile.c_str());
+  if (!file) {
+    ORLog(kRoutine) << "No checkpoint in " << fCheckpointFile 
+                    << ": starting from the beginning" << std::endl;
+    return true;
+  }
+  std::string fileName;
+  ULong64_t packet = 0;
+  Int_t runNumber = -1;
+  int isInRun = 0;
+  std::string key;
+  while (file >> key) {
+    if (key == "file") {
+      file >> std::ws;
+      std::getline(file, fileName);
+    }
+    else if (key == "packet") file >> packet;
+    else if (key == "inRun") file >> isInRun;
+    else if (key == "run") file >> runNumber;
+    // the rest is for people to read
+    else std::getline(file, key);
+  }
+  ORFileReader* fileReader = dynamic_cast<ORFileReader*>(fReader);
+  if (fileName == "" || fileReader == NULL) {
+    ORLog(kError) << "ResumeFromCheckpoint(): can't resume from " << fCheckpointFile 
+                  << ((fileReader == NULL) ? " without a file reader" : "") << std::endl;
+    return false;
+  }
+  if (!fileReader->ResumeAt(fileName, packet)) return false;
+  fResumePacket = packet;
+  fIsResumingFile = false;
+  fResumeIsInRun = (isInRun != 0);
+  fResumedRunNumber = runNumber;
+  ORLog(kRoutine) << "Resuming from packet " << packet << " of " << fileName 
+                  << (fResumeIsInRun ? ::Form(", in run %d", runNumber) : "") << std::endl;
+  return true;
+}
+
+bool ORDataProcManager::IsInRun()
+{
+  return fHeaderIsReadIn && (fRunContext->GetState() == ORRunContext::kRunning ||
+                             fRunContext->GetState() == ORRunContext::kPreparingForSubRun);
+}
+
+void ORDataProcManager::WriteCheckpoint(bool isInRun)
+{
+  fLastCheckpointTime = time(NULL);
+  if (fStreamFileName == "") return;
+  if (isInRun && Checkpoint() >= kFailure) {
+    ORLog(kError) << "WriteCheckpoint(): the processors couldn't save their outputs; "
+                  << "not writing a checkpoint" << std::endl;
+    return;
+  }
+
+  // write it aside first, so that a checkpoint is always there in full
+  std::string tmpFileName = fCheckpointFile + ".tmp";
+  std::ofstream file(tmpFileName.c_str());
+  file << "file " << fStreamFileName << std::endl
+       << "packet " << fNextStreamPacket << std::endl
+       << "inRun " << (isInRun ? 1 : 0) << std::endl
+       << "run " << fRunContext->GetRunNumber() << std::endl
+       << "subRun " << fRunContext->GetSubRunNumber() << std::endl
+       << "packetNumber " << fRunContext->GetPacketNumber() << std::endl;
+  file.close();
+  if (!file || rename(tmpFileName.c_str(), fCheckpointFile.c_str()) != 0) {
+    ORLog(kError) << "WriteCheckpoint(): couldn't write " << fCheckpointFile << std::endl;
+    return;
+  }
+  ORLog(kDebug) << "WriteCheckpoint(): at packet " << fNextStreamPacket << " of "
+                << fStreamFileName << std::endl;
+}
+
+void ORDataProcManager::SetTiming(bool doTiming)
+{
+  ORCompoundDataProcessor::SetTiming(doTiming);
+  // calibrate the ticks now rather than in the first report
+  if (doTiming) ORTimingStats::GetSecondsPerTick();
+}
+
+void ORDataProcManager::StartRunTiming()
+{
+  ResetTiming();
+  fRunStartTicks = ORTimingStats::Now();
+  fReadTicks = 0;
+  fDataIdCounts.clear();
+  fLastCountedDataId = ORVDataDecoder::GetIllegalDataId();
+  fLastDataIdCount = NULL;
+}
+
+void ORDataProcManager::CountRecord(UInt_t* record)
+{
+  UInt_t dataId = fRecordDecoder.DataIdOf(record);
+  if (fLastDataIdCount == NULL || dataId != fLastCountedDataId) {
+    std::map<UInt_t, DataIdCount>::iterator it = fDataIdCounts.find(dataId);
+    if (it == fDataIdCounts.end()) {
+      DataIdCount count = { 0, 0 };
+      it = fDataIdCounts.insert(std::make_pair(dataId, count)).first;
+    }
+    fLastDataIdCount = &it->second;
+    fLastCountedDataId = dataId;
+  }
+  fLastDataIdCount->fNRecords++;
+  fLastDataIdCount->fNBytes += 4*fRecordDecoder.LengthOf(record);
+}
+
+void ORDataProcManager::ReportRunTiming()
+{
+  // nothing to say about a "run" without records, at the end of the stream
+  if (fDataIdCounts.empty()) return;
+  double secondsPerTick = ORTimingStats::GetSecondsPerTick();
+  double seconds = (ORTimingStats::Now() - fRunStartTicks)*secondsPerTick;
+  double readSeconds = fReadTicks*secondsPerTick;
+  ULong64_t nRecords = 0;
+  ULong64_t nBytes = 0;
+  std::map<UInt_t, DataIdCount>::const_iterator it;
+  for (it = fDataIdCounts.begin(); it != fDataIdCounts.end(); it++) {
+    nRecords += it->second.fNRecords;
+    nBytes += it->second.fNBytes;
+  }
+
+  std::ostringstream report;
+  report << ::Form("Run %d: %llu records, %.1f MB in %.3f s: %.1f MB/s, %.0f records/s; "
+                   "%.3f s waiting for records, %.3f s processing",
+                   fRunContext->GetRunNumber(), (unsigned long long) nRecords, nBytes/1.e6,
+                   seconds, (seconds > 0) ? nBytes/1.e6/seconds : 0.,
+                   (seconds > 0) ? nRecords/seconds : 0., readSeconds, seconds - readSeconds)
+         << std::endl << "Records by data id:" << std::endl;
+  std::vector<std::string> names;
+  for (it = fDataIdCounts.begin(); it != fDataIdCounts.end(); it++) {
+    std::map<UInt_t, ORVDataDecoder*>::const_iterator decoder = fSwapDecoders.find(it->first);
+    if (it->first == 0) names.push_back("(header)");
+    else if (decoder != fSwapDecoders.end()) {
+      names.push_back(decoder->second->GetDataObjectPath());
+    } else names.push_back(::Form("0x%x", it->first));
+    report << "  " << names.back() << ": " << it->second.fNRecords << " records, " 
+           << ::Form("%.3f MB", it->second.fNBytes/1.e6) << std::endl;
+  }
+  report << "Processors:" << std::endl;
+  PrintTiming(report, "  ");
+  ORLog(kRoutine) << report.str();
+
+  if (fTimingReportFile == "") return;
+  std::ostringstream json;
+  json << ::Form("{\"run\": %d, \"seconds\": %.6g, \"read_seconds\": %.6g, "
+                 "\"records\": %llu, \"bytes\": %llu, \"data_ids\": [",
+                 fRunContext->GetRunNumber(), seconds, readSeconds, 
+                 (unsigned long long) nRecords, (unsigned long long) nBytes);
+  size_t iName = 0;
+  for (it = fDataIdCounts.begin(); it != fDataIdCounts.end(); it++, iName++) {
+    if (iName > 0) json << ", ";
+    json << ::Form("{\"id\": %u, \"name\": \"%s\", \"records\": %llu, \"bytes\": %llu}",
+                   it->first, names[iName].c_str(), (unsigned long long) it->second.fNRecords,
+                   (unsigned long long) it->second.fNBytes);
+  }
+  json << "], \"processors\": ";
+  WriteTimingJSON(json);
+  json << "}" << std::endl;
+
+  // one write per run, so that parallel jobs can share the file
+  std::ofstream file(fTimingReportFile.c_str(), std::ios::app);
+  if (!file) {
+    ORLog(kError) << "Couldn't open " << fTimingReportFile << " for the timing report" 
+                  << std::endl;
+    return;
+  }
+  file << json.str() << std::flush;
+}
@@ -3,14 +3,27 @@
 #ifndef _ORDataProcManager_hh_
 #define _ORDataProcManager_hh_
 
+#include <map>
 #include <string>
 #include <vector>
+#include <time.h>
 #include "ORVReader.hh"
+#include "ORRecordBatch.hh"
 #include "ORCompoundDataProcessor.hh"
 #include "ORHeaderProcessor.hh"
 #include "ORRunDataProcessor.hh"
 #include "ORVSigHandler.hh"
 
+/*!
+   Reads a data stream and runs the processors on it, run by run.  The
+   records of a swapped stream are swapped into host byte order once, by
+   data id, before any processor sees them: with the decoder of the first
+   processor (the run data processor included) that handles the data id
+   (see ORCompoundDataProcessor::GetDecoders()), or whole with the default
+   ORVDataDecoder::Swap() if none does.  Records that no processor wants
+   are not swapped at all.  Processors thus always get records in host
+   order.
+ */
 class ORDataProcManager : public ORCompoundDataProcessor, public ORVSigHandler
 {
   public:
@@ -19,6 +32,90 @@ class ORDataProcManager : public ORCompoundDataProcessor, public ORVSigHandler
 
     virtual EReturnCode ProcessDataStream();
     virtual EReturnCode ProcessRun();
+
+    /*!
+       Incremental processing, for readers that are fed from elsewhere and
+       return false from ReadRecords() while they wait for more data (see
+       ORStreamServer): StartDataStream(), then ProcessAvailableRecords()
+       whenever the reader has new records, and FinishDataStream() once it
+       has no more to come.  Runs may span any number of calls.
+       ProcessAvailableRecords() returns after about maxRecords records
+       (at the end of a batch) if maxRecords isn't 0.
+       ProcessDataStream() does the same with a reader that blocks.
+     */
+    virtual EReturnCode StartDataStream();
+    virtual EReturnCode ProcessAvailableRecords(size_t maxRecords = 0);
+    virtual EReturnCode FinishDataStream();
+
+    /*!
+       Hand consecutive data records with the same data id, up to nRecords
+       of them from one batch, to the processors as a span (see
+       ORDataProcessor::ProcessDataRecords()), so that each processor can
+       go through them in a tight loop.  The records of a span are swapped
+       before any processor sees them, and each processor processes all of
+       them before the next processor gets them: processors that work
+       together record by record (filling one tree, say) should not be
+       used with spans.  Records that change the run state are never part
+       of a span.  0 or 1 (the default) processes record by record.
+       ProcessDataStream() and ProcessRun() use spans.
+     */
+    virtual void SetMaxSpanLength(size_t nRecords) { fMaxSpanLength = nRecords; }
+    virtual size_t GetMaxSpanLength() const { return fMaxSpanLength; }
+
+    /*!
+       Have the reader swap the records of a swapped stream as it reads
+       them, a batch at a time (see ORVReader::SetSwapDataIds()), for the
+       data ids whose decoders swap records whole.  Off by default, since
+       a decoder that overloads ORVDataDecoder::Swap() must say so with
+       ORVDataDecoder::HasDefaultSwap().
+     */
+    virtual void SetSwapInReader(bool swapInReader = true) { fSwapInReader = swapInReader; }
+    virtual bool GetSwapInReader() const { return fSwapInReader; }
+
+    /*!
+       Only let the run data processor see the run-control records that a
+       reader jumping over records replays to get the run into its state
+       (see ORFileReader::AddPacketRange()), not the other processors, as
+       when the file is processed in pieces whose outputs get merged (see
+       ORFileJobs::SetNShards()).  Off by default.
+     */
+    virtual void SetSkipReplayedRecords(bool skipReplayed = true) 
+      { fSkipReplayedRecords = skipReplayed; }
+    virtual bool GetSkipReplayedRecords() const { return fSkipReplayedRecords; }
+
+    /*!
+       Report at the end of each run how long the processors took (see
+       ORCompoundDataProcessor::SetTiming()), the records and bytes of each
+       data id, and the throughput of the stream, with the time spent
+       waiting for the reader apart from the time spent processing.  If
+       SetTimingReportFile() was given a file name, the report is also
+       appended to that file as one line of JSON per run.
+     */
+    virtual void SetTiming(bool doTiming = true);
+    virtual void SetTimingReportFile(const std::string& fileName) 
+      { fTimingReportFile = fileName; }
+
+    /*!
+       Write a checkpoint to fileName every interval seconds of a run, in
+       between batches of records: the processors save what they have so
+       far (see ORDataProcessor::Checkpoint()), and fileName gets the input
+       file and the packet in it (see ORFileReader) to go on from, with the
+       state of the run.  A checkpoint is also written at the end of each
+       run, and fileName is removed once the stream is done.  Only with
+       an ORFileReader.
+     */
+    virtual void SetCheckpointFile(const std::string& fileName, unsigned int interval = 600)
+      { fCheckpointFile = fileName; fCheckpointInterval = interval; }
+    /*!
+       Go on from the checkpoint in the checkpoint file, if there is one:
+       the reader skips what came before (see ORFileReader::ResumeAt()),
+       and if the checkpoint was in the middle of a run, the run context
+       says so (see ORRunContext::IsResumed()), so that the processors
+       append to their outputs.  Call before ProcessDataStream().  Returns
+       false if the checkpoint can't be resumed from.
+     */
+    virtual bool ResumeFromCheckpoint();
+
     virtual void SetReader(ORVReader* reader) { fReader = reader; }
     virtual void SetDataId();
     virtual inline void ValidateHeaderXML(bool doValidate = true)
@@ -28,12 +125,94 @@ class ORDataProcManager : public ORCompoundDataProcessor, public ORVSigHandler
     virtual void SetRunAsDaemon(bool runAsDaemon = true) { fRunAsDaemon = runAsDaemon; }
   protected:
     virtual void SetRunContext(ORRunContext* aContext);
+    /*!
+       Processes a single record of the current run.  Sets runIsOver if the
+       run ends with this record.
+     */
+    virtual EReturnCode ProcessRecord(UInt_t* record, bool& runIsOver);
+    virtual EReturnCode FinishRun();
+    /*!
+       Gets the next record of the stream from the reader.  Returns false
+       where the reader returns false from ReadRecords().
+     */
+    virtual bool NextRecord(UInt_t*& record);
+    /*!
+       Collects record and the records following it in the same batch that
+       make up a span with it into fSpan.  Returns true if there is more
+       than one.
+     */
+    virtual bool CollectSpan(UInt_t* record);
+    //! Processes the records in fSpan, like ProcessRecord() would.
+    virtual EReturnCode ProcessSpan(bool& runIsOver);
+    /*!
+       Finds the decoders that swap records of each data id, for spans and
+       for the reader.
+     */
+    virtual void SetSwapDecoders();
+    //! Swaps record into host order, unless it has been already.
+    virtual inline void SwapRecord(UInt_t* record)
+      { if (fRunContext->MustSwap() && !fRecordIsSwapped) SwapRecordWithDecoder(record); }
+    virtual void SwapRecordWithDecoder(UInt_t* record);
+    //! Also forgets which decoder swapped the last record.
+    virtual void BuildDispatchTable();
+    /*!
+       Writes a checkpoint (see SetCheckpointFile()): with the processors
+       saving their outputs if isInRun, else just the position.
+     */
+    virtual void WriteCheckpoint(bool isInRun);
+    //! True in a run, where a checkpoint can be resumed from.
+    virtual bool IsInRun();
+    //! Starts the stream numbers of a run over.
+    virtual void StartRunTiming();
+    //! Counts record, in the numbers of its data id.
+    virtual void CountRecord(UInt_t* record);
+    //! Logs the numbers of the run, and writes them to fTimingReportFile.
+    virtual void ReportRunTiming();
+
+    struct DataIdCount {
+      ULong64_t fNRecords;
+      ULong64_t fNBytes;
+    };
     ORVReader* fReader;
     ORHeaderProcessor* fHeaderProcessor;
     ORRunDataProcessor* fRunDataProcessor;
+    /* Records read in but not yet processed survive the end of a run. */
+    ORRecordBatch fRecordBatch;
+    bool fRecordIsSwapped;
+    bool fRecordIsReplayed;
+    std::map<UInt_t, ORVDataDecoder*> fSwapDecoders;
+    /* SwapRecordWithDecoder() looks up consecutive records of the same
+       data id only once; fLastSwapDecoder is NULL if they aren't swapped. */
+    UInt_t fLastSwapDataId;
+    ORVDataDecoder* fLastSwapDecoder;
+    std::vector<UInt_t*> fSpan;
+    size_t fMaxSpanLength;
+    bool fSwapInReader;
+    bool fSkipReplayedRecords;
     bool fIOwnRunDataProcessor;
     bool fIOwnHeaderProcessor;
     bool fRunAsDaemon;
+    bool fHeaderIsReadIn;
+    bool fRunIsOpen;
+    std::string fCheckpointFile;
+    unsigned int fCheckpointInterval;
+    time_t fLastCheckpointTime;
+    /* The file of the last header, and the packet in it of the next record
+       to be read, counted from the record after the header. */
+    std::string fStreamFileName;
+    ULong64_t fNextStreamPacket;
+    /* The records of the file resumed before fResumePacket are replayed
+       to get the run into its state, and were processed before. */
+    ULong64_t fResumePacket;
+    bool fIsResumingFile;
+    bool fResumeIsInRun;
+    Int_t fResumedRunNumber;
+    std::string fTimingReportFile;
+    ULong64_t fRunStartTicks;
+    ULong64_t fReadTicks;
+    std::map<UInt_t, DataIdCount> fDataIdCounts;
+    UInt_t fLastCountedDataId;
+    DataIdCount* fLastDataIdCount;
 };
 
 #endif
@@ -0,0 +1,370 @@
+// ORFileJobs.cc
+
+#include "ORFileJobs.hh"
+
+#include "ORDictionary.hh"
+#include "ORDecompressionBuffer.hh"
+#include "ORFileReader.hh"
+#include "ORFileWriter.hh"
+#include "ORHeader.hh"
+#include "ORHeaderDecoder.hh"
+#include "ORLogger.hh"
+#include "ORPacketIndex.hh"
+#include "TSystem.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+ORFileJobs::ORFileJobs(size_t nJobs)
+{
+  SetNJobs(nJobs);
+  SetNShards(1);
+  fShard = -1;
+  fFirstPacket = 0;
+  fLastPacket = 0;
+  fProgressInterval = 30;
+  fNJobsDone = 0;
+  fNJobsNotStarted = 0;
+  fNBytesTotal = 0;
+  fNBytesDone = 0;
+  fStartTime = 0;
+}
+
+double ORFileJobs::Now()
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + 1.e-6*now.tv_usec;
+}
+
+int ORFileJobs::GetRunNumberOf(const string& fileName)
+{
+  ORFileReader reader(fileName);
+  vector<UInt_t> buffer;
+  ORHeaderDecoder headerDecoder;
+  if (!reader.Open() || !reader.ReadRecord(buffer) || buffer.empty() ||
+      !headerDecoder.IsHeader(buffer[0])) {
+    return -1;
+  }
+  size_t nBytes = headerDecoder.NBytesOf(&buffer[0]);
+  ORHeader header;
+  if (!header.LoadHeaderString(headerDecoder.HeaderStringOf(&buffer[0]),
+                               (nBytes < 8) ? 0 : nBytes - 8)) {
+    return -1;
+  }
+  // the run control is in the data chain, or at the top in older files
+  const ORDictionary* runCtrlDict = NULL;
+  const ORDictValueA* dataChain = (const ORDictValueA*) header.LookUp("ObjectInfo:DataChain");
+  if (dataChain == NULL) runCtrlDict = (const ORDictionary*) header.LookUp("Run Control");
+  for (size_t i = 0; dataChain != NULL && i < dataChain->GetNValues(); i++) {
+    runCtrlDict = (const ORDictionary*) ((const ORDictionary*) dataChain->At(i))->LookUp("Run Control");
+    if (runCtrlDict != NULL) break;
+  }
+  if (runCtrlDict == NULL) return -1;
+  const ORDictValueI* runNumber = (const ORDictValueI*) runCtrlDict->LookUp("RunNumber");
+  if (runNumber == NULL || !runNumber->IsA(ORVDictValue::kInt)) return -1;
+  return runNumber->GetI();
+}
+
+void ORFileJobs::MakeJobs()
+{
+  fJobs.clear();
+  fNBytesTotal = 0;
+  map<int, size_t> jobOfRun;
+  for (size_t i = 0; i < fFileNames.size(); i++) {
+    int runNumber = GetRunNumberOf(fFileNames[i]);
+    struct stat attrib;
+    ULong64_t nBytes = (stat(fFileNames[i].c_str(), &attrib) == 0) ? attrib.st_size : 0;
+    fNBytesTotal += nBytes;
+
+    // a file whose run can't be told gets a job of its own
+    size_t iJob = fJobs.size();
+    if (runNumber >= 0 && jobOfRun.count(runNumber) > 0) iJob = jobOfRun[runNumber];
+    if (iJob == fJobs.size()) {
+      Job job;
+      job.fNBytes = 0;
+      job.fStartTime = 0;
+      job.fShard = -1;
+      job.fFirstPacket = 0;
+      job.fLastPacket = 0;
+      job.fFirstShardJob = iJob;
+      job.fHasFailed = false;
+      fJobs.push_back(job);
+      if (runNumber >= 0) jobOfRun[runNumber] = iJob;
+    }
+    Job& job = fJobs[iJob];
+    job.fFileNames.push_back(fFileNames[i]);
+    job.fNBytes += nBytes;
+    if (runNumber >= 0 && job.fRunNumbers.empty()) job.fRunNumbers.push_back(runNumber);
+  }
+  if (fNShards < 2) return;
+
+  vector<Job> runJobs;
+  runJobs.swap(fJobs);
+  for (size_t i = 0; i < runJobs.size(); i++) {
+    vector<Job> shards;
+    if (runJobs[i].fFileNames.size() > 1 || !MakeShards(runJobs[i], shards)) {
+      shards.assign(1, runJobs[i]);
+    }
+    for (size_t j = 0; j < shards.size(); j++) {
+      shards[j].fFirstShardJob = fJobs.size() - j;
+      fJobs.push_back(shards[j]);
+    }
+  }
+}
+
+bool ORFileJobs::MakeShards(const Job& job, vector<Job>& shards)
+{
+  const string& fileName = job.fFileNames[0];
+  size_t nShards = fNShards;
+  if (fMinBytesPerShard > 0 && job.fNBytes/fMinBytesPerShard < nShards) {
+    nShards = job.fNBytes/fMinBytesPerShard;
+  }
+  if (nShards < 2) return false;
+  if (ORDecompressionBuffer::FormatOf(fileName) != ORDecompressionBuffer::kUncompressed) {
+    ORLog(kWarning) << fileName << " is compressed and can't be split" << endl;
+    return false;
+  }
+
+  ORPacketIndex index;
+  if (!index.Open(fileName)) {
+    ORLog(kRoutine) << "Indexing " << fileName << "..." << endl;
+    if (!index.Build(fileName) || !index.Open(fileName)) {
+      ORLog(kWarning) << "Could not index " << fileName << "; not splitting it" << endl;
+      return false;
+    }
+  }
+  ULong64_t nPackets = index.GetNPackets();
+  if (nPackets < nShards) return false;
+
+  // Each shard starts with the first packet at or after its share of the
+  // bytes; the packets in front of it belong to the shard before.
+  vector<ULong64_t> firstPackets(1, 0);
+  ORPacketIndex::PacketEntry entry;
+  for (size_t iShard = 1; iShard < nShards; iShard++) {
+    ULong64_t offset = index.GetHeaderLength() + 
+      (job.fNBytes - index.GetHeaderLength())/nShards*iShard;
+    ULong64_t low = firstPackets.back(), high = nPackets;
+    while (low < high) {
+      ULong64_t middle = low + (high - low)/2;
+      if (!index.GetPacket(middle, entry)) return false;
+      if (entry.fOffset < offset) low = middle + 1;
+      else high = middle;
+    }
+    // a very long record can take up more than one share
+    if (low > firstPackets.back() && low < nPackets) firstPackets.push_back(low);
+  }
+  if (firstPackets.size() < 2) return false;
+
+  // the runs in the file, for MergeShards()
+  vector<int> runNumbers = job.fRunNumbers;
+  const vector<ORPacketIndex::RunRecordEntry>& runRecords = index.GetRunRecords();
+  for (size_t i = 0; i < runRecords.size(); i++) {
+    if (runRecords[i].fType != ORPacketIndex::kRunStart) continue;
+    if (find(runNumbers.begin(), runNumbers.end(), runRecords[i].fRunNumber) == runNumbers.end()) {
+      runNumbers.push_back(runRecords[i].fRunNumber);
+    }
+  }
+
+  for (size_t iShard = 0; iShard < firstPackets.size(); iShard++) {
+    Job shard = job;
+    shard.fShard = iShard;
+    shard.fFirstPacket = firstPackets[iShard];
+    shard.fLastPacket = (iShard + 1 < firstPackets.size()) ? firstPackets[iShard+1] - 1 : nPackets - 1;
+    ULong64_t endOffset = job.fNBytes;
+    if (iShard + 1 < firstPackets.size() && index.GetPacket(firstPackets[iShard+1], entry)) {
+      endOffset = entry.fOffset;
+    }
+    ULong64_t startOffset = 0;
+    if (iShard > 0 && index.GetPacket(shard.fFirstPacket, entry)) startOffset = entry.fOffset;
+    shard.fNBytes = endOffset - startOffset;
+    shard.fRunNumbers = runNumbers;
+    shards.push_back(shard);
+  }
+  ORLog(kRoutine) << "Splitting " << fileName << " into " << shards.size() 
+                  << " shards of " << ::Form("%.1f MB", job.fNBytes/1.e6/shards.size())
+                  << endl;
+  return true;
+}
+
+string ORFileJobs::GetShardLabel(const string& label) const
+{
+  if (fShard < 0) return label;
+  return label + ::Form("_shard%d", fShard);
+}
+
+bool ORFileJobs::MergeShards(const string& label)
+{
+  bool isMerged = true;
+  for (size_t iJob = 0; iJob < fJobs.size(); iJob++) {
+    const Job& job = fJobs[iJob];
+    if (job.fShard != 0) continue;
+    size_t iEnd = iJob + 1;
+    bool hasFailed = job.fHasFailed;
+    while (iEnd < fJobs.size() && fJobs[iEnd].fFirstShardJob == iJob) {
+      hasFailed = hasFailed || fJobs[iEnd].fHasFailed;
+      iEnd++;
+    }
+    for (size_t iRun = 0; iRun < job.fRunNumbers.size(); iRun++) {
+      string fileName = ORFileWriter::FileNameOf(label, job.fRunNumbers[iRun]);
+      vector<string> inputs;
+      for (size_t iShard = 0; iShard < iEnd - iJob; iShard++) {
+        string shardLabel = label + ::Form("_shard%d", (int) iShard);
+        string shardFileName = ORFileWriter::FileNameOf(shardLabel, job.fRunNumbers[iRun]);
+        // AccessPathName() is true if the file does NOT exist
+        if (!gSystem->AccessPathName(shardFileName.c_str())) inputs.push_back(shardFileName);
+      }
+      if (inputs.empty()) continue;
+      if (hasFailed) {
+        ORLog(kWarning) << "Not merging the shards of " << fileName 
+                        << ", since some failed" << endl;
+        continue;
+      }
+      ORLog(kRoutine) << "Merging " << inputs.size() << " shard(s) into " 
+                      << fileName << "..." << endl;
+      if (!ORFileWriter::MergeFiles(inputs, fileName)) {
+        ORLog(kError) << "Could not merge the shards of " << fileName << "; keeping them" << endl;
+        isMerged = false;
+        continue;
+      }
+      for (size_t i = 0; i < inputs.size(); i++) gSystem->Unlink(inputs[i].c_str());
+    }
+  }
+  return isMerged;
+}
+
+bool ORFileJobs::ForkJobs(vector<string>& fileNames)
+{
+  fStartTime = Now();
+  MakeJobs();
+  ORLog(kRoutine) << "Processing " << fFileNames.size() << " file(s) in "
+                  << fJobs.size() << " job(s), up to " << fNJobs
+                  << " in parallel..." << endl;
+
+  fRunningJobs.clear();
+  fFailures.clear();
+  fNJobsDone = 0;
+  fNJobsNotStarted = 0;
+  fNBytesDone = 0;
+  double lastReport = Now();
+  size_t iNextJob = 0;
+  while (iNextJob < fJobs.size() || !fRunningJobs.empty()) {
+    if (TestCancel() && iNextJob < fJobs.size()) {
+      ORLog(kWarning) << "Interrupted: not starting the remaining "
+                      << fJobs.size() - iNextJob << " job(s)" << endl;
+      for (; iNextJob < fJobs.size(); iNextJob++) {
+        fJobs[iNextJob].fHasFailed = true;
+        fNJobsNotStarted++;
+      }
+      continue;
+    }
+    if (iNextJob < fJobs.size() && fRunningJobs.size() < fNJobs) {
+      Job& job = fJobs[iNextJob];
+      job.fStartTime = Now();
+      pid_t childpid = fork();
+      if (childpid == 0) {
+        /* We are in the child process: the caller takes it from here. */
+        fRunningJobs.clear();
+        fileNames = job.fFileNames;
+        fShard = job.fShard;
+        fFirstPacket = job.fFirstPacket;
+        fLastPacket = job.fLastPacket;
+        return true;
+      }
+      iNextJob++;
+      if (childpid < 0) {
+        ORLog(kError) << "Could not fork for " << job.fFileNames[0] << ": "
+                      << strerror(errno) << endl;
+        fFailures.push_back(job.fFileNames[0] + ": could not fork");
+        job.fHasFailed = true;
+        fNJobsDone++;
+        continue;
+      }
+      fRunningJobs[childpid] = iNextJob - 1;
+      continue;
+    }
+
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, WNOHANG);
+    if (pid > 0) {
+      JobEnded(pid, status);
+      ReportProgress();
+      lastReport = Now();
+    } else if (pid < 0 && errno != EINTR) {
+      ORLog(kError) << "ForkJobs(): waitpid failed: " << strerror(errno) << endl;
+      break;
+    } else {
+      usleep(100000);
+      if (fProgressInterval > 0 && Now() - lastReport >= fProgressInterval) {
+        ReportProgress();
+        lastReport = Now();
+      }
+    }
+  }
+  ReportSummary();
+  return false;
+}
+
+void ORFileJobs::JobEnded(pid_t pid, int status)
+{
+  map<pid_t, size_t>::iterator it = fRunningJobs.find(pid);
+  if (it == fRunningJobs.end()) {
+    ORLog(kError) << "Ended child process " << pid << " not recognized!" << endl;
+    return;
+  }
+  Job& job = fJobs[it->second];
+  fNJobsDone++;
+  fNBytesDone += job.fNBytes;
+  string files = job.fFileNames[0];
+  if (job.fFileNames.size() > 1) {
+    files += ::Form(" (and %d more)", (int) job.fFileNames.size() - 1);
+  }
+  if (job.fShard >= 0) files += ::Form(" (shard %d)", job.fShard);
+  if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+    ORLog(kRoutine) << "Done with " << files << " in "
+                    << ::Form("%.1f s", Now() - job.fStartTime) << endl;
+  } else {
+    string reason = WIFSIGNALED(status) ?
+      ::Form("killed by signal %d", WTERMSIG(status)) :
+      ::Form("exit status %d", WEXITSTATUS(status));
+    ORLog(kError) << "Processing of " << files << " failed: " << reason << endl;
+    fFailures.push_back(files + ": " + reason);
+    job.fHasFailed = true;
+  }
+  fRunningJobs.erase(it);
+}
+
+void ORFileJobs::ReportProgress()
+{
+  double seconds = Now() - fStartTime;
+  ORLog(kRoutine) << "Progress: " << fNJobsDone << "/" << fJobs.size() << " job(s) done"
+                  << (fFailures.empty() ? "" : ::Form(" (%d failed)", (int) fFailures.size()))
+                  << ", " << fRunningJobs.size() << " running, "
+                  << ::Form("%.1f of %.1f MB, %.1f MB/s", fNBytesDone/1.e6, fNBytesTotal/1.e6,
+                            (seconds > 0) ? fNBytesDone/1.e6/seconds : 0.)
+                  << endl;
+}
+
+void ORFileJobs::ReportSummary()
+{
+  double seconds = Now() - fStartTime;
+  ORLog(kRoutine) << "Processed " << fNJobsDone - fFailures.size() << " of "
+                  << fJobs.size() << " job(s)"
+                  << (fNJobsNotStarted ? ::Form(", %d not started", (int) fNJobsNotStarted) : "")
+                  << " (" << fFileNames.size() << " file(s), "
+                  << ::Form("%.1f MB) in %.1f s: %.1f MB/s with %d job(s)",
+                            fNBytesDone/1.e6, seconds,
+                            (seconds > 0) ? fNBytesDone/1.e6/seconds : 0., (int) fNJobs)
+                  << endl;
+  if (fFailures.empty()) return;
+  ostringstream failures;
+  for (size_t i = 0; i < fFailures.size(); i++) failures << endl << "  " << fFailures[i];
+  ORLog(kError) << fFailures.size() << " job(s) failed:" << failures.str() << endl;
+}
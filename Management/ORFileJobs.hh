@@ -0,0 +1,156 @@
+// ORFileJobs.hh
+
+#ifndef _ORFileJobs_hh_
+#define _ORFileJobs_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "Rtypes.h"
+#include "ORVSigHandler.hh"
+
+//! Processes Orca files in parallel child processes
+/*!
+   ORFileJobs forks a child process for each job, with at most nJobs
+   children running at once.  A job is the list of files of one run (as
+   given by their headers), in the order in which they were added, so
+   that each run goes to its own output files just as if all files had
+   been processed one after another.  A child sets up its own reader,
+   manager and processors, so that memory is bounded by the number of
+   jobs times what a single process needs.  Usage:
+
+   \verbatim
+   ORFileJobs jobs(nJobs);
+   for (...) jobs.AddFile(fileName);
+   std::vector<std::string> fileNames;
+   if (!jobs.ForkJobs(fileNames)) return (jobs.GetNFailed() == 0) ? 0 : 1;
+   // Child process: process fileNames, and exit with status 0 on success.
+   \endverbatim
+
+   The parent reports progress while the children run, and the files
+   whose processing failed as well as the throughput at the end.  After a
+   ctrl-c (see ORHandlerThread), which the children get as well, no new
+   children are started.
+
+   A run in a single large file can be split into shards (see
+   SetNShards()), each processed by a child of its own:
+
+   \verbatim
+   jobs.SetNShards(nJobs);
+   ...
+   if (!jobs.ForkJobs(fileNames)) {
+     jobs.MergeShards(label);
+     return (jobs.GetNFailed() == 0) ? 0 : 1;
+   }
+   // Child process: if GetShard() >= 0, process only the packets of
+   // GetPacketRange() (see ORFileReader::AddPacketRange()), skipping the
+   // replayed records (see ORDataProcManager::SetSkipReplayedRecords()),
+   // and write the output files with GetShardLabel(label).
+   \endverbatim
+ */
+class ORFileJobs : public ORVSigHandler
+{
+  public:
+    ORFileJobs(size_t nJobs = 1);
+    virtual ~ORFileJobs() {}
+
+    virtual void AddFile(const std::string& fileName) { fFileNames.push_back(fileName); }
+    virtual void SetNJobs(size_t nJobs) { fNJobs = (nJobs < 1) ? 1 : nJobs; }
+    virtual size_t GetNJobs() const { return fNJobs; }
+    //! Seconds between progress reports; 0 only reports when jobs end.
+    virtual void SetProgressInterval(unsigned int seconds) { fProgressInterval = seconds; }
+
+    /*!
+       Runs the jobs.  Returns true in each child, with fileNames set to
+       the files the child has to process.  Returns false in the parent,
+       once all children have ended.
+     */
+    virtual bool ForkJobs(std::vector<std::string>& fileNames);
+
+    virtual size_t GetNFailed() const { return fFailures.size(); }
+    //! Jobs not started because the processing was interrupted.
+    virtual size_t GetNNotStarted() const { return fNJobsNotStarted; }
+
+    /*!
+       Split each run that is in a single file into up to nShards shards of
+       about the same number of bytes, but no smaller than minBytesPerShard.
+       The file is cut at record boundaries found with its packet index
+       (see ORPacketIndex), which is built if it isn't there.  Compressed
+       files are not split.  1 (the default) doesn't split runs.
+     */
+    virtual void SetNShards(size_t nShards, ULong64_t minBytesPerShard = 64*1024*1024)
+      { fNShards = (nShards < 1) ? 1 : nShards; fMinBytesPerShard = minBytesPerShard; }
+    virtual size_t GetNShards() const { return fNShards; }
+
+    //! In a child, the shard it processes, or -1 if it processes whole files.
+    virtual int GetShard() const { return fShard; }
+    //! In a child processing a shard, the first and last packet of the shard.
+    virtual void GetPacketRange(ULong64_t& first, ULong64_t& last) const
+      { first = fFirstPacket; last = fLastPacket; }
+    //! The label a child's output files get, so that shards don't collide.
+    virtual std::string GetShardLabel(const std::string& label) const;
+
+    /*!
+       In the parent, once ForkJobs() returned: merges the files that the
+       shards of each run wrote with ORFileWriter under GetShardLabel(label)
+       into the file the run would have had if it wasn't split, in the
+       order of the shards (see ORFileWriter::MergeFiles()), and removes
+       them.  The shards of a run of which a shard failed are kept.
+       Returns false if any merge failed.
+     */
+    virtual bool MergeShards(const std::string& label);
+
+  protected:
+    struct Job {
+      std::vector<std::string> fFileNames;
+      ULong64_t fNBytes;
+      double fStartTime;
+      /* Shards only: the shard of the run, and its packets. */
+      int fShard;
+      ULong64_t fFirstPacket;
+      ULong64_t fLastPacket;
+      /* The runs of the shards of a file are those of its first shard. */
+      size_t fFirstShardJob;
+      std::vector<int> fRunNumbers;
+      bool fHasFailed;
+    };
+
+    //! Groups the files into jobs, one per run.
+    virtual void MakeJobs();
+    /*!
+       Splits job, of a single file, into the jobs of its shards.  Returns
+       false if the file can't or needn't be split.
+     */
+    virtual bool MakeShards(const Job& job, std::vector<Job>& shards);
+    //! Run number in the header of fileName, or -1 if it can't be read.
+    virtual int GetRunNumberOf(const std::string& fileName);
+    virtual void JobEnded(pid_t pid, int status);
+    virtual void ReportProgress();
+    virtual void ReportSummary();
+    static double Now();
+
+  protected:
+    std::vector<std::string> fFileNames;
+    size_t fNJobs;
+    size_t fNShards;
+    ULong64_t fMinBytesPerShard;
+    int fShard;
+    ULong64_t fFirstPacket;
+    ULong64_t fLastPacket;
+    unsigned int fProgressInterval;
+    std::vector<Job> fJobs;
+    /* The index in fJobs of the job of each child */
+    std::map<pid_t, size_t> fRunningJobs;
+    std::vector<std::string> fFailures;
+    size_t fNJobsDone;       //! ended or could not be forked; fFailures are among them
+    size_t fNJobsNotStarted;
+    ULong64_t fNBytesTotal;
+    ULong64_t fNBytesDone;
+    double fStartTime;
+};
+
+#endif /* __CINT__ */
+#endif /* _ORFileJobs_hh_ */
@@ -1,6 +1,7 @@
 #include "ORHandlerThread.hh"
 #include "ORVSigHandler.hh"
 #include "ORLogger.hh"
+#include "ORThreadPlacement.hh"
 #include <signal.h>
 #include <cstdlib>
 
@@ -44,6 +45,7 @@ void ORHandlerThread::StartThread()
   if (fThreadIsRunning || !fCanIStart) return; 
   pthread_attr_init(&fAttr);                                                       
   pthread_attr_setdetachstate(&fAttr, PTHREAD_CREATE_JOINABLE);
+  ORThreadPlacement::SetUpAttributes(fAttr, ORThreadPlacement::kHandler);
   int retCode = pthread_create(&fThread, &fAttr, SigWaitThread, NULL); 
   if (retCode) {
     ORLog(kError) << "Error starting SigWaitThread" << std::endl;
@@ -0,0 +1,469 @@
+// ORStreamServer.cc
+
+#include "ORStreamServer.hh"
+#include "ORDataProcManager.hh"
+#include "ORLogger.hh"
+#include "ORThreadPlacement.hh"
+#include "ORServer.hh"
+#include "ORStreamConnection.hh"
+#include <set>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+/* Records a worker processes of one stream before giving the others a turn. */
+static const size_t kRecordsPerTurn = 10000;
+static const int kPollTimeoutMSec = 1000;
+
+struct ORStreamServer::Session {
+  ORStreamConnection* fConnection;
+  ORDataProcManager* fManager;
+  std::vector<ORDataProcessor*> fProcessors;
+  bool fStreamClosed;  // event loop only
+  /* Guarded by fMutex. */
+  bool fIsQueued;      // in the work queue, or being processed
+  bool fIsPaused;      // not watched, as its buffer is full
+  bool fIsDone;        // handed back to the event loop for deletion
+};
+
+void* StreamServerWorkerThread(void* input)
+{
+  ORStreamServer* server = reinterpret_cast<ORStreamServer*>(input);
+  server->RunWorker();
+  return NULL;
+}
+
+ORStreamServer::ORStreamServer(int aPort, EMode mode)
+{
+  fServer = new ORServer(aPort);
+  fMode = mode;
+  fNWorkers = 1;
+  fMaxConnections = 5;
+  fBufferLength = ORStreamConnection::kDefaultBufferLength;
+  fRunAsDaemon = false;
+  fListenDescriptor = -1;
+  fIsAccepting = false;
+  fPollDescriptor = -1;
+  fNotifyPipe[0] = -1;
+  fNotifyPipe[1] = -1;
+  pthread_mutex_init(&fMutex, NULL);
+  pthread_cond_init(&fWorkAvailable, NULL);
+  fStopWorkers = false;
+}
+
+ORStreamServer::~ORStreamServer()
+{
+  delete fServer;
+  pthread_cond_destroy(&fWorkAvailable);
+  pthread_mutex_destroy(&fMutex);
+}
+
+bool ORStreamServer::IsValid() const
+{
+  return fServer != NULL && fServer->IsValid();
+}
+
+Int_t ORStreamServer::GetErrorCode() const
+{
+  return (fServer == NULL) ? -1 : fServer->GetErrorCode();
+}
+
+TSocket* ORStreamServer::Serve()
+{
+  if (!IsValid()) {
+    ORLog(kError) << "Serve(): server isn't listening" << std::endl;
+    return NULL;
+  }
+  if (fMode == kFork) return ServeForking();
+  ServeEventLoop();
+  return NULL;
+}
+
+TSocket* ORStreamServer::ServeForking()
+{
+  pid_t childpid = 0;
+  std::set<pid_t> childPIDRecord;
+  while (1) {
+    /* This while loop is broken by a kill signal which is well handled
+     * by the server.  The kill signal will automatically propagate to the
+     * children so we really don't have to worry about waiting for them to
+     * die.  */
+    while (childPIDRecord.size() >= fMaxConnections) {
+      /* We've reached our maximum number of child processes. */
+      /* Wait for a process to end. */
+      childpid = wait3(0, WUNTRACED, 0);
+      if(childPIDRecord.erase(childpid) != 1) {
+        /* Something really weird happened. */
+        ORLog(kError) << "Ended child process " << childpid
+          << " not recognized!" << std::endl;
+      }
+    }
+    while((childpid = wait3(0,WNOHANG,0)) > 0) {
+      /* Cleaning up any children that may have ended.                   *
+       * This will just go straight through if no children have stopped. */
+      if(childPIDRecord.erase(childpid) != 1) {
+        /* Something really weird happened. */
+        ORLog(kError) << "Ended child process " << childpid
+          << " not recognized!" << std::endl;
+      }
+    }
+    ORLog(kRoutine) << childPIDRecord.size()  << " connections running..." << std::endl;
+    ORLog(kRoutine) << "Waiting for connection..." << std::endl;
+    TSocket* sock = fServer->Accept();
+    if (sock == (TSocket*) 0 || sock == (TSocket*) -1 ) {
+      // There was an error, or the socket got closed .
+      if (!fServer->IsValid()) return NULL;
+      continue;
+    }
+    if(!sock->IsValid()) {
+      /* Invalid socket, cycle to wait. */
+      delete sock;
+      continue;
+    }
+    if ((childpid = fork()) == 0) {
+      /* We are in the child process: the caller takes it from here. */
+      return sock;
+    }
+    /* Parent process: wait for next connection. Close our descriptor. */
+    ORLog(kRoutine) << "Connection accepted, child process begun with pid: "
+      << childpid << std::endl;
+    childPIDRecord.insert(childpid);
+    delete sock;
+  }
+}
+
+void ORStreamServer::ServeEventLoop()
+{
+  fServingThread = pthread_self();
+  fListenDescriptor = fServer->GetDescriptor();
+#ifdef __linux__
+  fPollDescriptor = epoll_create(64);
+  if (fPollDescriptor < 0) {
+    ORLog(kWarning) << "ServeEventLoop(): epoll unavailable (" << strerror(errno)
+                    << "), using poll" << std::endl;
+  }
+#endif
+  if (pipe(fNotifyPipe) != 0) {
+    ORLog(kError) << "ServeEventLoop(): can't create pipe: " << strerror(errno) << std::endl;
+    return;
+  }
+  fcntl(fNotifyPipe[0], F_SETFL, fcntl(fNotifyPipe[0], F_GETFL) | O_NONBLOCK);
+  fcntl(fNotifyPipe[1], F_SETFL, fcntl(fNotifyPipe[1], F_GETFL) | O_NONBLOCK);
+  WatchDescriptor(fNotifyPipe[0]);
+  WatchDescriptor(fListenDescriptor);
+  fIsAccepting = true;
+
+  fStopWorkers = false;
+  for (size_t i = 0; i < fNWorkers; i++) {
+    pthread_t worker;
+    if (ORThreadPlacement::CreateThread(&worker, ORThreadPlacement::kWorker, i,
+                                        StreamServerWorkerThread, this) != 0) {
+      ORLog(kError) << "ServeEventLoop(): can't start worker " << i << std::endl;
+      break;
+    }
+    fWorkers.push_back(worker);
+  }
+  ORLog(kRoutine) << "Serving connections with " << fWorkers.size()
+                  << " worker(s)..." << std::endl;
+
+  std::vector<int> readyDescriptors;
+  while (!fWorkers.empty() && !TestCancel()) {
+    WaitForDescriptors(readyDescriptors, kPollTimeoutMSec);
+    for (size_t i = 0; i < readyDescriptors.size(); i++) {
+      int descriptor = readyDescriptors[i];
+      if (descriptor == fListenDescriptor) AcceptConnections();
+      else if (descriptor == fNotifyPipe[0]) HandleNotifications();
+      else {
+        std::map<int, Session*>::iterator it = fSessions.find(descriptor);
+        if (it != fSessions.end()) ReceiveFromSession(it->second);
+      }
+    }
+  }
+
+  /* Let the workers finish up all streams, and delete them. */
+  ORLog(kRoutine) << "Closing " << fSessions.size() << " connection(s)..." << std::endl;
+  std::map<int, Session*>::iterator it;
+  for (it = fSessions.begin(); it != fSessions.end(); it++) {
+    Session* session = it->second;
+    if (!session->fStreamClosed) {
+      session->fConnection->CloseStream();
+      session->fStreamClosed = true;
+    }
+    Schedule(session);
+  }
+  pthread_mutex_lock(&fMutex);
+  fStopWorkers = true;
+  pthread_cond_broadcast(&fWorkAvailable);
+  pthread_mutex_unlock(&fMutex);
+  for (size_t i = 0; i < fWorkers.size(); i++) pthread_join(fWorkers[i], NULL);
+  fWorkers.clear();
+  while (!fSessions.empty()) DeleteSession(fSessions.begin()->second);
+  fFinishedSessions.clear();
+  fSessionsToResume.clear();
+
+  fWatched.clear();
+  if (fPollDescriptor >= 0) close(fPollDescriptor);
+  fPollDescriptor = -1;
+  close(fNotifyPipe[0]);
+  close(fNotifyPipe[1]);
+  fNotifyPipe[0] = fNotifyPipe[1] = -1;
+  fServer->Close();
+}
+
+void ORStreamServer::AcceptConnections()
+{
+  /* The listening socket doesn't block: take all that are waiting. */
+  while (fSessions.size() < fMaxConnections) {
+    int descriptor = accept(fListenDescriptor, NULL, NULL);
+    if (descriptor < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        ORLog(kWarning) << "AcceptConnections(): " << strerror(errno) << std::endl;
+      }
+      break;
+    }
+    Session* session = new Session;
+    session->fConnection = new ORStreamConnection(descriptor, fBufferLength);
+    session->fManager = NULL;
+    session->fStreamClosed = false;
+    session->fIsQueued = false;
+    session->fIsPaused = false;
+    session->fIsDone = false;
+    fSessions[descriptor] = session;
+    WatchDescriptor(descriptor);
+    ORLog(kRoutine) << "Connection accepted, " << fSessions.size()
+                    << " connections running..." << std::endl;
+  }
+  if (fSessions.size() >= fMaxConnections && fIsAccepting) {
+    /* The rest wait in the backlog. */
+    SetWatching(fListenDescriptor, false);
+    fIsAccepting = false;
+  }
+}
+
+void ORStreamServer::ReceiveFromSession(Session* session)
+{
+  ORStreamConnection* connection = session->fConnection;
+  if (!connection->ReceiveData()) {
+    /* The descriptor stays open until the session is deleted, as the
+       processors may still write back to the peer. */
+    connection->CloseStream();
+    session->fStreamClosed = true;
+    UnwatchDescriptor(connection->GetDescriptor());
+  } else if (connection->IsBufferFull()) {
+    /* Stop reading until a worker has made room. */
+    pthread_mutex_lock(&fMutex);
+    session->fIsPaused = true;
+    pthread_mutex_unlock(&fMutex);
+    SetWatching(connection->GetDescriptor(), false);
+  }
+  Schedule(session);
+}
+
+void ORStreamServer::HandleNotifications()
+{
+  char drain[64];
+  while (read(fNotifyPipe[0], drain, sizeof(drain)) > 0);
+
+  pthread_mutex_lock(&fMutex);
+  std::vector<Session*> toResume;
+  std::vector<Session*> finished;
+  toResume.swap(fSessionsToResume);
+  finished.swap(fFinishedSessions);
+  pthread_mutex_unlock(&fMutex);
+
+  for (size_t i = 0; i < toResume.size(); i++) {
+    if (!toResume[i]->fStreamClosed) {
+      SetWatching(toResume[i]->fConnection->GetDescriptor(), true);
+    }
+  }
+  for (size_t i = 0; i < finished.size(); i++) DeleteSession(finished[i]);
+  if (!fIsAccepting && fSessions.size() < fMaxConnections) {
+    SetWatching(fListenDescriptor, true);
+    fIsAccepting = true;
+  }
+}
+
+void ORStreamServer::Schedule(Session* session)
+{
+  pthread_mutex_lock(&fMutex);
+  if (!session->fIsQueued && !session->fIsDone) {
+    session->fIsQueued = true;
+    fWorkQueue.push_back(session);
+    pthread_cond_signal(&fWorkAvailable);
+  }
+  pthread_mutex_unlock(&fMutex);
+}
+
+void ORStreamServer::DeleteSession(Session* session)
+{
+  int descriptor = session->fConnection->GetDescriptor();
+  if (!session->fStreamClosed) UnwatchDescriptor(descriptor);
+  fSessions.erase(descriptor);
+  delete session->fManager;
+  for (size_t i = 0; i < session->fProcessors.size(); i++) {
+    delete session->fProcessors[i];
+  }
+  delete session->fConnection;
+  delete session;
+  ORLog(kRoutine) << "Connection closed, " << fSessions.size()
+                  << " connections running..." << std::endl;
+}
+
+bool ORStreamServer::WatchDescriptor(int descriptor)
+{
+  fWatched[descriptor] = true;
+#ifdef __linux__
+  if (fPollDescriptor >= 0) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = descriptor;
+    if (epoll_ctl(fPollDescriptor, EPOLL_CTL_ADD, descriptor, &event) != 0) {
+      ORLog(kError) << "WatchDescriptor(): " << strerror(errno) << std::endl;
+      fWatched.erase(descriptor);
+      return false;
+    }
+  }
+#endif
+  return true;
+}
+
+void ORStreamServer::SetWatching(int descriptor, bool watch)
+{
+  std::map<int, bool>::iterator it = fWatched.find(descriptor);
+  if (it == fWatched.end() || it->second == watch) return;
+  it->second = watch;
+#ifdef __linux__
+  if (fPollDescriptor >= 0) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = watch ? (uint32_t) EPOLLIN : 0;
+    event.data.fd = descriptor;
+    epoll_ctl(fPollDescriptor, EPOLL_CTL_MOD, descriptor, &event);
+  }
+#endif
+}
+
+void ORStreamServer::UnwatchDescriptor(int descriptor)
+{
+  if (fWatched.erase(descriptor) == 0) return;
+#ifdef __linux__
+  if (fPollDescriptor >= 0) {
+    struct epoll_event event; // ignored, but can't be NULL on old kernels
+    epoll_ctl(fPollDescriptor, EPOLL_CTL_DEL, descriptor, &event);
+  }
+#endif
+}
+
+size_t ORStreamServer::WaitForDescriptors(std::vector<int>& readyDescriptors,
+                                          int timeoutMSec)
+{
+  readyDescriptors.clear();
+#ifdef __linux__
+  if (fPollDescriptor >= 0) {
+    const int maxEvents = 64;
+    struct epoll_event events[maxEvents];
+    int nReady = epoll_wait(fPollDescriptor, events, maxEvents, timeoutMSec);
+    for (int i = 0; i < nReady; i++) readyDescriptors.push_back(events[i].data.fd);
+    return readyDescriptors.size();
+  }
+#endif
+  std::vector<struct pollfd> pollDescriptors;
+  std::map<int, bool>::iterator it;
+  for (it = fWatched.begin(); it != fWatched.end(); it++) {
+    if (!it->second) continue;
+    struct pollfd pollDescriptor;
+    pollDescriptor.fd = it->first;
+    pollDescriptor.events = POLLIN;
+    pollDescriptor.revents = 0;
+    pollDescriptors.push_back(pollDescriptor);
+  }
+  if (pollDescriptors.empty()) return 0;
+  if (poll(&pollDescriptors[0], pollDescriptors.size(), timeoutMSec) <= 0) return 0;
+  for (size_t i = 0; i < pollDescriptors.size(); i++) {
+    if (pollDescriptors[i].revents != 0) readyDescriptors.push_back(pollDescriptors[i].fd);
+  }
+  return readyDescriptors.size();
+}
+
+void ORStreamServer::RunWorker()
+{
+  /* Log like the thread that serves, rather than to the null stream. */
+  ORLogger::SetORLoggerSeverity(pthread_self(), 
+    ORLogger::GetORLoggerSeverity(fServingThread));
+  ORLogger::SetORLoggerOStream(pthread_self(), &std::cout);
+  pthread_mutex_lock(&fMutex);
+  while (1) {
+    while (fWorkQueue.empty() && !fStopWorkers) {
+      pthread_cond_wait(&fWorkAvailable, &fMutex);
+    }
+    if (fWorkQueue.empty()) break; // stopping, and nothing left to do
+    Session* session = fWorkQueue.front();
+    fWorkQueue.pop_front();
+    pthread_mutex_unlock(&fMutex);
+    ProcessSession(session);
+    pthread_mutex_lock(&fMutex);
+  }
+  pthread_mutex_unlock(&fMutex);
+}
+
+void ORStreamServer::ProcessSession(Session* session)
+{
+  /* Only one worker at a time gets here with a given session. */
+  ORStreamConnection* connection = session->fConnection;
+  bool isDone = false;
+  if (session->fManager == NULL) {
+    session->fManager = new ORDataProcManager(connection);
+    session->fManager->SetRunAsDaemon(fRunAsDaemon);
+    CreateProcessors(session->fProcessors);
+    for (size_t i = 0; i < session->fProcessors.size(); i++) {
+      session->fManager->AddProcessor(session->fProcessors[i]);
+    }
+    if (session->fManager->StartDataStream() >= ORDataProcessor::kAlarm) {
+      isDone = true;
+    }
+  }
+  if (!isDone) {
+    ORDataProcessor::EReturnCode retCode =
+      session->fManager->ProcessAvailableRecords(kRecordsPerTurn);
+    isDone = (retCode >= ORDataProcessor::kBreak || connection->IsFinished());
+    if (isDone) session->fManager->FinishDataStream();
+  }
+
+  bool mustNotify = false;
+  pthread_mutex_lock(&fMutex);
+  if (isDone) {
+    session->fIsDone = true;
+    session->fIsQueued = false;
+    fFinishedSessions.push_back(session);
+    mustNotify = true;
+  } else {
+    if (session->fIsPaused) {
+      session->fIsPaused = false;
+      fSessionsToResume.push_back(session);
+      mustNotify = true;
+    }
+    /* Whatever came in meanwhile gets its turn after the others. */
+    if (connection->HasData() || connection->IsFinished()) {
+      fWorkQueue.push_back(session);
+    }
+    else session->fIsQueued = false;
+  }
+  pthread_mutex_unlock(&fMutex);
+  if (mustNotify) Notify();
+}
+
+void ORStreamServer::Notify()
+{
+  char wakeUp = 0;
+  while (write(fNotifyPipe[1], &wakeUp, 1) < 0 && errno == EINTR);
+}
@@ -0,0 +1,147 @@
+// ORStreamServer.hh
+
+#ifndef _ORStreamServer_hh_
+#define _ORStreamServer_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <deque>
+#include <map>
+#include <vector>
+#include <pthread.h>
+#ifndef _ORVSigHandler_hh_
+#include "ORVSigHandler.hh"
+#endif
+#ifndef _ORDataProcessor_hh_
+#include "ORDataProcessor.hh"
+#endif
+
+class ORServer;
+class TSocket;
+
+extern "C" void* StreamServerWorkerThread(void*);
+
+//! Serves many Orca streams from a single process
+/*!
+   ORStreamServer accepts connections from Orca on a port and processes
+   each stream with its own ORDataProcManager, run context and processors
+   (see CreateProcessors()).  It runs in one of two modes:
+
+     - kEventLoop: one thread watches the listening socket and all
+       connections (with epoll where available, poll otherwise), accepts
+       connections as soon as they come in and reads the data of each
+       into the buffer of its ORStreamConnection.  A fixed pool of
+       SetNWorkers() worker threads processes the streams that have new
+       records; a stream is only ever processed by one worker at a time.
+       A stream whose buffer is full isn't read until a worker has caught
+       up with it.
+
+     - kFork: a process is forked for each connection, which is handed the
+       connected socket by Serve() and processes it on its own (typically
+       with an ORSocketReader).  This is the default, and what orcaroot
+       does unless told otherwise: a slow or crashing stream can't hold
+       up or take down the others.
+
+   With more than one worker, the processors of different streams run
+   concurrently and must not share state that isn't thread safe,
+   including ROOT's; ROOT's thread support must then be enabled by the
+   application.  Usage:
+
+   \verbatim
+   MyServer server(44556);
+   TSocket* sock = server.Serve();
+   if (sock != NULL) {
+     // fork mode, child process: work with socket
+   }
+   \endverbatim
+ */
+class ORStreamServer : public ORVSigHandler
+{
+  friend void* StreamServerWorkerThread(void*);
+
+  public:
+    enum EMode { kEventLoop, kFork };
+
+    //! Listen on port aPort
+    ORStreamServer(int aPort, EMode mode = kFork);
+    virtual ~ORStreamServer();
+
+    virtual bool IsValid() const;
+    //! Error code of the listening socket (see TSocket::GetErrorCode())
+    virtual Int_t GetErrorCode() const;
+    virtual EMode GetMode() const { return fMode; }
+    virtual void SetNWorkers(size_t nWorkers)
+      { fNWorkers = (nWorkers < 1) ? 1 : nWorkers; }
+    //! Connections beyond this wait in the backlog of the listening socket.
+    virtual void SetMaxConnections(size_t maxConnections)
+      { fMaxConnections = (maxConnections < 1) ? 1 : maxConnections; }
+    //! Length in long words of the buffer of each connection.
+    virtual void SetBufferLength(size_t nLongs) { fBufferLength = nLongs; }
+    //! Run the managers as daemon (see ORDataProcManager::SetRunAsDaemon()).
+    virtual void SetRunAsDaemon(bool runAsDaemon = true) { fRunAsDaemon = runAsDaemon; }
+
+    /*!
+       Serves connections until canceled, and returns NULL.  In fork mode
+       the child process returns instead, with the connected socket, and
+       is responsible for processing it; the server object should be
+       deleted in the child right away.
+     */
+    virtual TSocket* Serve();
+
+  protected:
+    /*!
+       Creates the processors that are to process a new stream (event loop
+       mode only).  Called from a worker thread.  The server adds them to
+       the stream's manager and deletes them when the stream is done.
+       By default, there are none.
+     */
+    virtual void CreateProcessors(std::vector<ORDataProcessor*>& /*processors*/) {}
+
+    virtual TSocket* ServeForking();
+    virtual void ServeEventLoop();
+
+    struct Session;
+    /* Event loop side. */
+    virtual void AcceptConnections();
+    virtual void ReceiveFromSession(Session* session);
+    virtual void HandleNotifications();
+    virtual void Schedule(Session* session);
+    virtual void DeleteSession(Session* session);
+    virtual bool WatchDescriptor(int descriptor);
+    virtual void SetWatching(int descriptor, bool watch);
+    virtual void UnwatchDescriptor(int descriptor);
+    virtual size_t WaitForDescriptors(std::vector<int>& readyDescriptors, int timeoutMSec);
+    /* Worker side. */
+    virtual void RunWorker();
+    virtual void ProcessSession(Session* session);
+    virtual void Notify();
+
+  protected:
+    ORServer* fServer;
+    EMode fMode;
+    size_t fNWorkers;
+    size_t fMaxConnections;
+    size_t fBufferLength;
+    bool fRunAsDaemon;
+
+  private:
+    pthread_t fServingThread;
+    int fListenDescriptor;
+    bool fIsAccepting;
+    int fPollDescriptor;           // epoll instance, -1 if poll() is used
+    std::map<int, bool> fWatched;  // descriptor -> watched for input
+    int fNotifyPipe[2];            // workers wake up the event loop
+    std::map<int, Session*> fSessions;
+
+    /* Shared with the workers, guarded by fMutex. */
+    pthread_mutex_t fMutex;
+    pthread_cond_t fWorkAvailable;
+    std::deque<Session*> fWorkQueue;
+    std::vector<Session*> fFinishedSessions;
+    std::vector<Session*> fSessionsToResume;
+    bool fStopWorkers;
+    std::vector<pthread_t> fWorkers;
+};
+
+#endif /* __CINT__ */
+#endif /* _ORStreamServer_hh_ */
@@ -47,7 +47,7 @@ ORDataProcessor::EReturnCode ORAcqirisDC440TreeWriter::ProcessMyDataRecord(UInt_
   fCard = fEventDecoder->CardOf();
   fChannel = fEventDecoder->GetChannelNum();
   fWaveformLength = fEventDecoder->GetWaveformLen();
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "time-crate-card-channel-length- = "
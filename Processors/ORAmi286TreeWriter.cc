@@ -37,7 +37,7 @@ ORDataProcessor::EReturnCode ORAmi286TreeWriter::ProcessMyDataRecord(UInt_t* rec
     fTime = fAmi286Decoder->GetTimeOfChannel(record, i);
     fStatus = fAmi286Decoder->GetStatusOfChannel(record,i);
     fChannel = i;
-    if(ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+    if(ORLogger::GetSeverity() <= ORLogger::kDebug) { 
       ORLog(kDebug) << std::endl << "   Channel: " << fChannel << std::endl
       << "     Level: " << fLevel << std::endl
       << "     Time: " << fTime << std::endl
@@ -70,7 +70,7 @@ ORDataProcessor::EReturnCode ORAmptekDP5SpectrumTreeWriter::ProcessMyDataRecord(
     fRealTime    =  fEventDecoder->GetRealTime();
 
     
-    if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+    if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
     { 
         ORLog(kDebug) << "ProcessMyDataRecord(): "
         << "deviceID-sec-infoFlags-spectrumLen-statusLen64 = "
@@ -113,7 +113,7 @@ ORDataProcessor::EReturnCode ORAmptekDP5SpectrumTreeWriter::ProcessMyDataRecord(
   fEventFlags = fEventDecoder->GetEventFlags();
   fEventInfo = fEventDecoder->GetEventInfo();
    
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "crate-card-channel-sec-subsec-energy_adc-chmap-eventID-eventFlags-eventInfo-wfLen = "
@@ -45,10 +45,8 @@ ORDataProcessor::EReturnCode ORBasicTreeWriter::ProcessMyDataRecord(UInt_t* reco
   for (size_t iRow=0; iRow<fBasicTreeDecoder->GetNRows(record); iRow++) {
     for (size_t iPar=0; iPar<fBasicTreeDecoder->GetNPars(); iPar++) {
       *(fParameters[iPar]) = fBasicTreeDecoder->GetPar(record, iPar, iRow);
-      if(ORLogger::GetSeverity() <= ORLogger::kDebug) {
-        ORLog(kDebug) << fBranchPrefix+fBasicTreeDecoder->GetParName(iPar) << ": " 
-                      << *(fParameters[iPar]) << endl;
-      }
+      ORLog(kDebug) << fBranchPrefix+fBasicTreeDecoder->GetParName(iPar) << ": " 
+                    << *(fParameters[iPar]) << endl;
     }
     fTree->Fill();
   }
@@ -35,7 +35,7 @@ ORDataProcessor::EReturnCode ORBocTIC3TreeWriter::ProcessMyDataRecord(UInt_t* re
     fPressure = fBocTIC3Decoder->GetPressureOfChannel(record, i);
     fTime = fBocTIC3Decoder->GetTimeOfChannel(record, i);
     fChannel = i;
-    if(ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+    if(ORLogger::GetSeverity() <= ORLogger::kDebug) { 
       ORLog(kDebug) << "channel:pressure:time = "  
         << fChannel << ":" << fPressure << ":" 
         << ":" << fTime << endl;
@@ -38,7 +38,7 @@ ORDataProcessor::EReturnCode ORCaen5720TreeWriter::InitializeBranches()
 ORDataProcessor::EReturnCode ORCaen5720TreeWriter::ProcessMyDataRecord(UInt_t* record)
 {
   //check severity to improve speed
-  if(ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+  if(ORLogger::GetSeverity() <= ORLogger::kDebug) { 
     ORLog(kDebug) << "ProcessMyDataRecord(): got one: "
                   << "CAEN Digitizer  " << endl;
   }
@@ -3,11 +3,31 @@
 #include "ORCompoundDataProcessor.hh"
 
 #include "ORLogger.hh"
+#include "ORTimingStats.hh"
+#include "TString.h"
 #include <algorithm>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <typeinfo>
+
+struct ORCompoundDataProcessor::ProcessorTiming {
+  std::string fName;
+  ORTimingStats fStartRun;
+  ORTimingStats fProcess;
+  ORTimingStats fEndRun;
+};
 
 ORCompoundDataProcessor::ORCompoundDataProcessor()
 {
   SetComponentBreakReturnsFailure();
+  fIsTiming = false;
+  BuildDispatchTable();
+}
+
+ORCompoundDataProcessor::~ORCompoundDataProcessor()
+{
+  std::map<ORDataProcessor*, ProcessorTiming*>::iterator it;
+  for (it = fTimings.begin(); it != fTimings.end(); it++) delete it->second;
 }
 
 void ORCompoundDataProcessor::SetDataId()
@@ -15,6 +35,95 @@ void ORCompoundDataProcessor::SetDataId()
   for (size_t i=0; i<fDataProcessors.size(); i++) {
     fDataProcessors[i]->SetDataId();
   }
+  BuildDispatchTable();
+}
+
+void ORCompoundDataProcessor::BuildDispatchTable()
+{
+  fDispatchTable.clear();
+  fAllRecordProcessors.clear();
+  fTimingTable.clear();
+  fAllRecordTimings.clear();
+
+  // processors keep their timing; those that are gone take theirs along
+  std::map<ORDataProcessor*, ProcessorTiming*> timings;
+  for (size_t i=0; i<fDataProcessors.size(); i++) {
+    ORDataProcessor* processor = fDataProcessors[i];
+    if (timings.find(processor) != timings.end()) continue;
+    std::map<ORDataProcessor*, ProcessorTiming*>::iterator it = fTimings.find(processor);
+    if (it != fTimings.end()) {
+      timings[processor] = it->second;
+      fTimings.erase(it);
+    } else {
+      timings[processor] = new ProcessorTiming;
+      timings[processor]->fName = GetNameOf(processor);
+    }
+  }
+  std::map<ORDataProcessor*, ProcessorTiming*>::iterator it;
+  for (it = fTimings.begin(); it != fTimings.end(); it++) delete it->second;
+  fTimings.swap(timings);
+
+  // Processors whose device is not in the header keep the illegal data
+  // id; no record is theirs, so they stay out of the table.
+  for (size_t i=0; i<fDataProcessors.size(); i++) {
+    if (fDataProcessors[i]->ProcessesAllRecords()) continue;
+    if (fDataProcessors[i]->GetDataId() == ORVDataDecoder::GetIllegalDataId()) continue;
+    fDispatchTable[fDataProcessors[i]->GetDataId()];
+  }
+  // Keep the order in which processors were added: it matters when one
+  // of them breaks off the processing of a record.
+  for (size_t i=0; i<fDataProcessors.size(); i++) {
+    ORDataProcessor* processor = fDataProcessors[i];
+    bool processesAllRecords = processor->ProcessesAllRecords();
+    ProcessorTiming* timing = fTimings[processor];
+    if (processesAllRecords) {
+      fAllRecordProcessors.push_back(processor);
+      fAllRecordTimings.push_back(timing);
+    }
+    DispatchTable::iterator it;
+    for (it = fDispatchTable.begin(); it != fDispatchTable.end(); it++) {
+      if (processesAllRecords || processor->GetDataId() == it->first) {
+        it->second.push_back(processor);
+        fTimingTable[it->first].push_back(timing);
+      }
+    }
+  }
+  fLastDataId = ORVDataDecoder::GetIllegalDataId();
+  fLastProcessors = &fAllRecordProcessors;
+  fLastTimings = &fAllRecordTimings;
+}
+
+const std::vector<ORDataProcessor*>& 
+  ORCompoundDataProcessor::GetProcessorsFor(UInt_t dataId)
+{
+  if (dataId != fLastDataId) {
+    DispatchTable::const_iterator it = fDispatchTable.find(dataId);
+    if (it == fDispatchTable.end()) {
+      fLastProcessors = &fAllRecordProcessors;
+      fLastTimings = &fAllRecordTimings;
+    } else {
+      fLastProcessors = &it->second;
+      fLastTimings = &fTimingTable[dataId];
+    }
+    fLastDataId = dataId;
+  }
+  return *fLastProcessors;
+}
+
+void ORCompoundDataProcessor::GetDecoders(std::map<UInt_t, ORVDataDecoder*>& decoders)
+{
+  for (size_t i=0; i<fDataProcessors.size(); i++) {
+    ORDataProcessor* processor = fDataProcessors[i];
+    if (ORCompoundDataProcessor* compound = 
+        dynamic_cast<ORCompoundDataProcessor*>(processor)) {
+      compound->GetDecoders(decoders);
+      continue;
+    }
+    UInt_t dataId = processor->GetDataId();
+    if (dataId == ORVDataDecoder::GetIllegalDataId()) continue;
+    if (processor->GetDecoder() == NULL) continue;
+    if (decoders.find(dataId) == decoders.end()) decoders[dataId] = processor->GetDecoder();
+  }
 }
 
 void ORCompoundDataProcessor::SetDecoderDictionary()
@@ -38,7 +147,12 @@ ORDataProcessor::EReturnCode ORCompoundDataProcessor::StartProcessing()
 ORDataProcessor::EReturnCode ORCompoundDataProcessor::StartRun()
 {
   for (size_t i=0; i<fDataProcessors.size(); i++) {
-     EReturnCode retCode = fDataProcessors[i]->StartRun();
+    EReturnCode retCode;
+    if (fIsTiming) {
+      ULong64_t start = ORTimingStats::Now();
+      retCode = fDataProcessors[i]->StartRun();
+      fTimings[fDataProcessors[i]]->fStartRun.Add(ORTimingStats::Now() - start);
+    } else retCode = fDataProcessors[i]->StartRun();
     if (retCode >= kFailure) fDataProcessors[i]->KillRun();
     if (retCode >= kBreak) return fBreakRetCode;
     if (retCode >= kAlarm) return retCode;
@@ -49,8 +163,35 @@ ORDataProcessor::EReturnCode ORCompoundDataProcessor::StartRun()
 ORDataProcessor::EReturnCode ORCompoundDataProcessor::ProcessDataRecord(UInt_t* record)
 {
   if (!fDoProcess || !fDoProcessRun) return kFailure;
-  for (size_t i=0; i<fDataProcessors.size(); i++) {
-    EReturnCode retCode = fDataProcessors[i]->ProcessDataRecord(record);
+  const std::vector<ORDataProcessor*>& processors = 
+    GetProcessorsFor(fRecordDecoder.DataIdOf(record));
+  for (size_t i=0; i<processors.size(); i++) {
+    EReturnCode retCode;
+    if (fIsTiming) {
+      ULong64_t start = ORTimingStats::Now();
+      retCode = processors[i]->ProcessDataRecord(record);
+      (*fLastTimings)[i]->fProcess.Add(ORTimingStats::Now() - start);
+    } else retCode = processors[i]->ProcessDataRecord(record);
+    if (retCode == kBreak) return fBreakRetCode;
+    if (retCode >= kAlarm) return retCode;
+  }
+  return kSuccess;
+}
+
+ORDataProcessor::EReturnCode ORCompoundDataProcessor::ProcessDataRecords(UInt_t** records, 
+                                                                         size_t nRecords)
+{
+  if (!fDoProcess || !fDoProcessRun) return kFailure;
+  if (nRecords == 0) return kSuccess;
+  const std::vector<ORDataProcessor*>& processors = 
+    GetProcessorsFor(fRecordDecoder.DataIdOf(records[0]));
+  for (size_t i=0; i<processors.size(); i++) {
+    EReturnCode retCode;
+    if (fIsTiming) {
+      ULong64_t start = ORTimingStats::Now();
+      retCode = processors[i]->ProcessDataRecords(records, nRecords);
+      (*fLastTimings)[i]->fProcess.Add(ORTimingStats::Now() - start, nRecords);
+    } else retCode = processors[i]->ProcessDataRecords(records, nRecords);
     if (retCode == kBreak) return fBreakRetCode;
     if (retCode >= kAlarm) return retCode;
   }
@@ -60,7 +201,12 @@ ORDataProcessor::EReturnCode ORCompoundDataProcessor::ProcessDataRecord(UInt_t*
 ORDataProcessor::EReturnCode ORCompoundDataProcessor::EndRun()
 {
   for (size_t i=0; i<fDataProcessors.size(); i++) {
-    EReturnCode retCode = fDataProcessors[i]->EndRun();
+    EReturnCode retCode;
+    if (fIsTiming) {
+      ULong64_t start = ORTimingStats::Now();
+      retCode = fDataProcessors[i]->EndRun();
+      fTimings[fDataProcessors[i]]->fEndRun.Add(ORTimingStats::Now() - start);
+    } else retCode = fDataProcessors[i]->EndRun();
     if (retCode >= kBreak) return fBreakRetCode;
     if (retCode >= kAlarm) return retCode;
   }
@@ -77,6 +223,16 @@ ORDataProcessor::EReturnCode ORCompoundDataProcessor::EndProcessing()
   return kSuccess;
 }
 
+ORDataProcessor::EReturnCode ORCompoundDataProcessor::Checkpoint()
+{
+  for (size_t i=0; i<fDataProcessors.size(); i++) {
+    EReturnCode retCode = fDataProcessors[i]->Checkpoint();
+    if (retCode >= kBreak) return fBreakRetCode;
+    if (retCode >= kAlarm) return retCode;
+  }
+  return kSuccess;
+}
+
 ORDataProcessor::EReturnCode ORCompoundDataProcessor::ProcessMyDataRecord(UInt_t* /*record*/)
 {
   ORLog(kWarning) << "ProcessMyDataRecord() should never be called..." << std::endl;
@@ -107,6 +263,13 @@ void ORCompoundDataProcessor::AddProcessor(ORDataProcessor* processor)
   }
   processor->SetRunContext(fRunContext);
   fDataProcessors.push_back(processor); 
+  BuildDispatchTable();
+}
+
+void ORCompoundDataProcessor::ClearProcessors()
+{
+  fDataProcessors.clear();
+  BuildDispatchTable();
 }
 
 void ORCompoundDataProcessor::RemoveProcessor(ORDataProcessor* processor)
@@ -115,8 +278,97 @@ void ORCompoundDataProcessor::RemoveProcessor(ORDataProcessor* processor)
     std::find(fDataProcessors.begin(), fDataProcessors.end(), processor);
   if (it != fDataProcessors.end()) {
     fDataProcessors.erase(it);
+    BuildDispatchTable();
   } else {
     ORLog(kWarning) << "Unable to remove processor, not found!" << std::endl;
   }
   
 }
+
+void ORCompoundDataProcessor::SetTiming(bool doTiming)
+{
+  fIsTiming = doTiming;
+  for (size_t i=0; i<fDataProcessors.size(); i++) {
+    if (ORCompoundDataProcessor* compound = 
+        dynamic_cast<ORCompoundDataProcessor*>(fDataProcessors[i])) {
+      compound->SetTiming(doTiming);
+    }
+  }
+}
+
+void ORCompoundDataProcessor::ResetTiming()
+{
+  std::map<ORDataProcessor*, ProcessorTiming*>::iterator it;
+  for (it = fTimings.begin(); it != fTimings.end(); it++) {
+    it->second->fStartRun.Reset();
+    it->second->fProcess.Reset();
+    it->second->fEndRun.Reset();
+    if (ORCompoundDataProcessor* compound = 
+        dynamic_cast<ORCompoundDataProcessor*>(it->first)) {
+      compound->ResetTiming();
+    }
+  }
+}
+
+std::string ORCompoundDataProcessor::GetNameOf(ORDataProcessor* processor)
+{
+  const char* mangledName = typeid(*processor).name();
+  int status = 0;
+  char* demangledName = abi::__cxa_demangle(mangledName, NULL, NULL, &status);
+  std::string name = (status == 0 && demangledName != NULL) ? demangledName : mangledName;
+  free(demangledName);
+  if (processor->GetDecoder() != NULL) {
+    name += " (" + processor->GetDecoder()->GetDataObjectPath() + ")";
+  }
+  return name;
+}
+
+void ORCompoundDataProcessor::PrintTiming(std::ostream& out, const std::string& indent)
+{
+  for (size_t i=0; i<fDataProcessors.size(); i++) {
+    // a processor added twice only shows up once
+    if (std::find(fDataProcessors.begin(), fDataProcessors.begin() + i, 
+                  fDataProcessors[i]) != fDataProcessors.begin() + i) continue;
+    const ProcessorTiming* timing = fTimings[fDataProcessors[i]];
+    const ORTimingStats& process = timing->fProcess;
+    out << indent << timing->fName << ": " << process.GetNCalls() << " records, "
+        << ::Form("%.3f s (%.3g us/record; p50 %.3g, p90 %.3g, p99 %.3g us), ",
+                  process.GetSeconds(), 1.e6*process.GetMeanSeconds(),
+                  1.e6*process.GetPercentileSeconds(0.5), 
+                  1.e6*process.GetPercentileSeconds(0.9),
+                  1.e6*process.GetPercentileSeconds(0.99))
+        << ::Form("StartRun %.3f s, EndRun %.3f s", timing->fStartRun.GetSeconds(), 
+                  timing->fEndRun.GetSeconds()) << std::endl;
+    if (ORCompoundDataProcessor* compound = 
+        dynamic_cast<ORCompoundDataProcessor*>(fDataProcessors[i])) {
+      compound->PrintTiming(out, indent + "  ");
+    }
+  }
+}
+
+void ORCompoundDataProcessor::WriteTimingJSON(std::ostream& out)
+{
+  out << "[";
+  for (size_t i=0; i<fDataProcessors.size(); i++) {
+    if (std::find(fDataProcessors.begin(), fDataProcessors.begin() + i, 
+                  fDataProcessors[i]) != fDataProcessors.begin() + i) continue;
+    const ProcessorTiming* timing = fTimings[fDataProcessors[i]];
+    std::string name;
+    for (size_t j=0; j<timing->fName.size(); j++) {
+      if (timing->fName[j] == '"' || timing->fName[j] == '\\') name += '\\';
+      name += timing->fName[j];
+    }
+    if (i > 0) out << ", ";
+    out << "{\"name\": \"" << name << "\", "
+        << "\"start_run\": {" << timing->fStartRun.ToJSON() << "}, "
+        << "\"process\": {" << timing->fProcess.ToJSON() << "}, "
+        << "\"end_run\": {" << timing->fEndRun.ToJSON() << "}";
+    if (ORCompoundDataProcessor* compound = 
+        dynamic_cast<ORCompoundDataProcessor*>(fDataProcessors[i])) {
+      out << ", \"processors\": ";
+      compound->WriteTimingJSON(out);
+    }
+    out << "}";
+  }
+  out << "]";
+}
@@ -4,15 +4,36 @@
 #define _ORCompoundDataProcessor_hh_
 
 #include "ORUtilityProcessor.hh"
+#include "ORBasicDataDecoder.hh"
 
+#include <map>
+#include <ostream>
+#include <string>
 #include <vector>
 
 
+/*!
+   Runs a list of processors on the data, in the order in which they were
+   added.  Records are dispatched by data id: SetDataId() builds a table
+   from each data id to the processors that want it, so that each record
+   only goes to those processors and to the ones that process all records
+   (see ORDataProcessor::ProcessesAllRecords()).  The table is rebuilt
+   when processors are added or removed.
+
+   A span of records (see ProcessDataRecords()) goes to each processor in
+   turn: the first one processes all of its records before the next one
+   gets them, and a processor that breaks off a span does so for all of
+   its records.
+
+   With SetTiming(), the calls of StartRun(), ProcessDataRecord() and
+   EndRun() of each processor are counted and timed (see ORTimingStats);
+   PrintTiming() and WriteTimingJSON() report the numbers.
+ */
 class ORCompoundDataProcessor : public ORUtilityProcessor
 {
   public:
     ORCompoundDataProcessor();
-    virtual ~ORCompoundDataProcessor() {}
+    virtual ~ORCompoundDataProcessor();
 
     virtual void SetDataId();
     virtual void SetDecoderDictionary();
@@ -20,8 +41,10 @@ class ORCompoundDataProcessor : public ORUtilityProcessor
     virtual EReturnCode StartProcessing(); 
     virtual EReturnCode StartRun();
     virtual EReturnCode ProcessDataRecord(UInt_t* record);
+    virtual EReturnCode ProcessDataRecords(UInt_t** records, size_t nRecords);
     virtual EReturnCode EndRun();
     virtual EReturnCode EndProcessing();
+    virtual EReturnCode Checkpoint();
 
     virtual EReturnCode ProcessMyDataRecord(UInt_t* record);
     virtual void SetDoProcessRun();
@@ -39,13 +62,61 @@ class ORCompoundDataProcessor : public ORUtilityProcessor
     virtual void SetComponentBreakReturnsBreak() { fBreakRetCode = kBreak; }
 
     virtual void AddProcessor(ORDataProcessor* processor);
-    virtual void ClearProcessors() { fDataProcessors.clear(); }
+    virtual void ClearProcessors();
     virtual void RemoveProcessor(ORDataProcessor* processor);
 
+    /*!
+       Adds to decoders the decoder of the first processor (looking into
+       nested compound processors) that handles each data id, unless
+       decoders already has one for that id.  This is the decoder a record
+       with that id gets swapped with.
+     */
+    virtual void GetDecoders(std::map<UInt_t, ORVDataDecoder*>& decoders);
+
+    /*!
+       Time the calls of each processor, here and in nested compound
+       processors.  Off by default; when on, each call costs two readings
+       of the time stamp counter.
+     */
+    virtual void SetTiming(bool doTiming = true);
+    virtual bool IsTiming() const { return fIsTiming; }
+    virtual void ResetTiming();
+    //! One line per processor: calls, total time and percentiles per call.
+    virtual void PrintTiming(std::ostream& out, const std::string& indent = "");
+    //! The timing of the processors as a JSON array.
+    virtual void WriteTimingJSON(std::ostream& out);
+
   protected:
     virtual void SetRunContext(ORRunContext* aContext);
+    //! Rebuild fDispatchTable from the current data ids of fDataProcessors.
+    virtual void BuildDispatchTable();
+    //! Processors, in order, that want records with dataId.
+    virtual const std::vector<ORDataProcessor*>& GetProcessorsFor(UInt_t dataId);
+
+    //! Name of processor for reports: its class and data object path.
+    virtual std::string GetNameOf(ORDataProcessor* processor);
+
+    typedef std::map< UInt_t, std::vector<ORDataProcessor*> > DispatchTable;
+    struct ProcessorTiming;
+    typedef std::map< UInt_t, std::vector<ProcessorTiming*> > TimingTable;
+
     std::vector<ORDataProcessor*> fDataProcessors;
     EReturnCode fBreakRetCode;
+    ORBasicDataDecoder fRecordDecoder;
+    DispatchTable fDispatchTable;
+    /* Processors that process all records; these get the data ids that
+       no other processor wants. */
+    std::vector<ORDataProcessor*> fAllRecordProcessors;
+    /* Consecutive records mostly have the same data id. */
+    UInt_t fLastDataId;
+    const std::vector<ORDataProcessor*>* fLastProcessors;
+    /* Timing of each processor, and the same per data id as
+       fDispatchTable so that a timed record needs no look-ups. */
+    bool fIsTiming;
+    std::map<ORDataProcessor*, ProcessorTiming*> fTimings;
+    TimingTable fTimingTable;
+    std::vector<ProcessorTiming*> fAllRecordTimings;
+    const std::vector<ProcessorTiming*>* fLastTimings;
 };
 
 #endif
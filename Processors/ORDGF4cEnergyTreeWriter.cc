@@ -38,7 +38,7 @@ ORDataProcessor::EReturnCode ORDGF4cEnergyTreeWriter::ProcessMyDataRecord(UInt_t
   for (size_t i = 0; i < fEventDecoder->GetDGFNEvents(); i++) {
     for (size_t k = 0; k < fEventDecoder->GetNChannels(i); k++) {
       // check severity to improve speed:
-      if (ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+      if (ORLogger::GetSeverity() <= ORLogger::kDebug) { 
         ORLog(kDebug) << "ProcessMyDataRecord(): " 
                       << "event-time-crate-card-channel-energy = "
                       << i << "-" 
@@ -49,7 +49,7 @@ ORDataProcessor::EReturnCode ORDGF4cWaveformTreeWriter::ProcessMyDataRecord(UInt
       // check severity to improve speed:
       ORLog(kDebug) << "Found channels: " << fEventDecoder->GetNChannels(i)
           << " in event: " << i  << endl;
-      if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+      if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
       { 
         ORLog(kDebug) << "ProcessMyDataRecord(): "
           << "event-time-crate-card-channel-energy = "
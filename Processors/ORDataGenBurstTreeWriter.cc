@@ -47,7 +47,7 @@ ORDataGenBurstTreeWriter::EReturnCode ORDataGenBurstTreeWriter::ProcessMyDataRec
 	fTime    = fBurstDecoder->TimeOf(record);
 
 	
-	if (ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+	if (ORLogger::GetSeverity() <= ORLogger::kDebug) { 
 		ORLog(kDebug)	<< "ProcessMyDataRecord(): got one: "
 		<< "crate-card-channel-value-time = " 
 		<< fBurstDecoder->CrateOf(record) << "-"
@@ -67,11 +67,6 @@ ORDataProcessor::EReturnCode ORDataProcessor::ProcessDataRecord(UInt_t* record)
   else if (fDataDecoder->DataIdOf(record) == fDataId) {
     ORLog(kDebug) << fDataDecoder->GetDataObjectPath() 
                   << " (data id = " << fDataId << "): " << endl;
-    if(fRunContext->MustSwap() && !fRunContext->IsRecordSwapped()) {
-      /* Swapping the record.  This only must be done once! */
-      fDataDecoder->Swap(record);
-      fRunContext->SetRecordSwapped();
-    }
     if(fDebugRecord) {
       if(ORLogger::GetSeverity() > ORLogger::kDebug) {
         ORLog(kRoutine) << fDataDecoder->GetDataObjectPath() 
@@ -83,3 +78,22 @@ ORDataProcessor::EReturnCode ORDataProcessor::ProcessDataRecord(UInt_t* record)
   }
   else return kSuccess;
 }
+
+ORDataProcessor::EReturnCode ORDataProcessor::ProcessDataRecords(UInt_t** records, 
+                                                                 size_t nRecords)
+{
+  if (!fDoProcess || !fDoProcessRun || !fRunContext) return kFailure;
+  EReturnCode spanRetCode = kSuccess;
+  for (size_t i=0; i<nRecords; i++) {
+    SelectRecordOfSpan(i);
+    EReturnCode retCode = ProcessDataRecord(records[i]);
+    if (retCode >= kAlarm) return retCode;
+    if (retCode > spanRetCode) spanRetCode = retCode;
+  }
+  return spanRetCode;
+}
+
+void ORDataProcessor::SelectRecordOfSpan(size_t iRecord)
+{
+  if (fRunContext) fRunContext->SetRecordOfSpan(iRecord);
+}
@@ -43,10 +43,28 @@ class ORDataProcessor
     virtual EReturnCode ProcessMyDataRecord(UInt_t* /*record*/) { return kSuccess; }
     virtual EReturnCode EndRun() { return kSuccess; }
     virtual EReturnCode EndProcessing() { return kSuccess; }
+    /*!
+     * Called by the manager now and then in the middle of a run (see
+     * ORDataProcManager::SetCheckpointFile()): a processor that writes
+     * output should save everything processed so far, so that processing
+     * can be resumed from here (see ORRunContext::IsResumed()).
+     */
+    virtual EReturnCode Checkpoint() { return kSuccess; }
 
     virtual UInt_t GetDataId() { return fDataId; } 
     virtual ORVDataDecoder* GetDecoder() { return fDataDecoder; } 
 
+    /*!
+     * An ORCompoundDataProcessor only hands a record to the processors
+     * whose data id matches the record's, and to those processors that
+     * return true here.  By default, these are the processors without a
+     * decoder, e.g. utility processors.  A processor with a decoder that
+     * also wants to look at other records (to count bytes, say) must
+     * overload this to return true.  A processor whose data id was not
+     * found in the header gets no records at all.
+     */
+    virtual bool ProcessesAllRecords() { return fDataDecoder == NULL; }
+
     /*!
      * Gives access to ORRunContext, which allows one to access global
      * parameters associated with a run: run number, sub-run number, etc.
@@ -59,6 +77,18 @@ class ORDataProcessor
     virtual void KillProcessor() { fDoProcess = false; }
     virtual void KillRun() { fDoProcessRun = false; }
     virtual EReturnCode ProcessDataRecord(UInt_t* record);
+    /*!
+     * Processes a span of nRecords consecutive records of the stream, all
+     * with the same data id (see ORDataProcManager::SetMaxSpanLength()).
+     * The manager brings them into host byte order before handing them
+     * out.  Processors that can decode and store several records in a
+     * tight loop may overload this; call SelectRecordOfSpan(i) before
+     * processing the i-th record so that the run context gives its packet
+     * number.  By default, the records go to ProcessDataRecord() one by
+     * one.  Returns the worst return code of the records, but stops at
+     * the first kAlarm.
+     */
+    virtual EReturnCode ProcessDataRecords(UInt_t** records, size_t nRecords);
     virtual void SetDataId();
     virtual void SetDecoderDictionary();
     virtual void SetDoProcess() { fDoProcess = true; fDoProcessRun = true; }
@@ -76,6 +106,8 @@ class ORDataProcessor
 
   protected:
     virtual void SetRunContext(ORRunContext* aContext) { fRunContext = aContext; }
+    //! Points the run context at the iRecord-th record of the current span.
+    virtual void SelectRecordOfSpan(size_t iRecord);
     ORRunContext* fRunContext; 
     UInt_t fDataId;
     bool fDoProcess;
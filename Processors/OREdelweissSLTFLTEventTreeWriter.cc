@@ -69,7 +69,7 @@ ORDataProcessor::EReturnCode OREdelweissSLTFLTEventTreeWriter::ProcessMyDataReco
   fEventFlags = fEventDecoder->GetEventFlags();
   fEventInfo = fEventDecoder->GetEventInfo();
    
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "crate-card-channel-sec-subsec-energy_adc-chmap-eventID-eventFlags-eventInfo-wfLen = "
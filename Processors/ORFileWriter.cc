@@ -3,7 +3,10 @@
 #include "ORFileWriter.hh"
 
 #include "TROOT.h"
+#include "TFileMerger.h"
 #include "TObjString.h"
+#include "TSystem.h"
+#include "TTree.h"
 #include "ORLogger.hh"
 #include "ORRunContext.hh"
 
@@ -14,6 +17,8 @@ ORFileWriter::ORFileWriter(string label)
   fLabel = label;
   fSavedName = "";
   fFile = NULL;
+  fIsCheckpointing = false;
+  fTreeAutoSaveIsStopped = false;
 }
 
 ORDataProcessor::EReturnCode ORFileWriter::StartRun()
@@ -23,22 +28,30 @@ ORDataProcessor::EReturnCode ORFileWriter::StartRun()
       ORLog(kError) << "Lost track of fFile!" << endl;
       return kFailure;
     }
-    fFile->Close();
-    delete fFile;
+    CloseFile();
   }
   if (!fRunContext) {
     ORLog(kError) << "fRunContext is NULL!" << endl;
     return kFailure;
   }
-  string filename = fLabel + ::Form("_run%d.root", fRunContext->GetRunNumber());
+  string filename = FileNameOf(fLabel, fRunContext->GetRunNumber());
+  if (fRunContext->IsResumed()) {
+    if (!SetUpResumedFile(filename)) return kFailure;
+    fIsCheckpointing = true;
+  }
   fFile = new TFile(filename.c_str(), "RECREATE");
+  fFileName = filename;
   fSavedName = fFile->GetName();
   fSavedName.erase( fSavedName.size() - 5, 5 ); // Removing .root from the end
 
-  TObjString headerXML(fRunContext->GetHeader()->GetRawXML().Data());
-  headerXML.Write("headerXML");
+  // the file saved at the checkpoint has the header already
+  if (fCheckpointFileName == "") {
+    TObjString headerXML(fRunContext->GetHeader()->GetRawXML().Data());
+    headerXML.Write("headerXML");
+  }
 
   fLastSubRunNumber = 0;
+  fTreeAutoSaveIsStopped = false;
 
   return kSuccess;
 }
@@ -62,6 +75,8 @@ ORDataProcessor::EReturnCode ORFileWriter::EndRun()
 
 ORDataProcessor::EReturnCode ORFileWriter::ProcessDataRecord(UInt_t*)
 {
+  // the other processors make their trees in StartRun()
+  if (fIsCheckpointing && !fTreeAutoSaveIsStopped) StopTreeAutoSave();
   if (fRunContext->GetSubRunNumber()!=fLastSubRunNumber)
   {
     fFile->cd();
@@ -82,9 +97,126 @@ ORDataProcessor::EReturnCode ORFileWriter::EndProcessing()
     ORLog(kError) << "Lost track of fFile!" << endl;
     return kFailure;
   }
+  CloseFile();
+  return kSuccess;
+}
+
+ORDataProcessor::EReturnCode ORFileWriter::Checkpoint()
+{
+  if(fFile == NULL) return kSuccess;
+  if(UpdateFilePointer() == NULL) {
+    ORLog(kError) << "Lost track of fFile!" << endl;
+    return kFailure;
+  }
+  fIsCheckpointing = true;
+  StopTreeAutoSave();
+  TDirectory* savedDirectory = gDirectory;
+  fFile->cd();
+  TIter next(fFile->GetList());
+  while(TObject* object = next()) {
+    TTree* tree = dynamic_cast<TTree*>(object);
+    if(tree != NULL) tree->AutoSave("SaveSelf;FlushBaskets");
+    else object->Write(object->GetName(), TObject::kOverwrite);
+  }
+  fFile->SaveSelf();
+  savedDirectory->cd();
+  return kSuccess;
+}
+
+void ORFileWriter::StopTreeAutoSave()
+{
+  fTreeAutoSaveIsStopped = true;
+  if(fFile == NULL) return;
+  TIter next(fFile->GetList());
+  while(TObject* object = next()) {
+    TTree* tree = dynamic_cast<TTree*>(object);
+    if(tree != NULL) tree->SetAutoSave(0);
+  }
+}
+
+void ORFileWriter::CloseFile()
+{
   fFile->Close();
   delete fFile;
-  return kSuccess;
+  fFile = NULL;
+  if(fCheckpointFileName == "") return;
+
+  // what was saved at the checkpoint comes first
+  string mergedFileName = fFileName;
+  mergedFileName.insert(mergedFileName.size() - 5, "_merged");
+  if(MergeFiles(fCheckpointFileName, fFileName, mergedFileName) && 
+     gSystem->Rename(mergedFileName.c_str(), fFileName.c_str()) == 0) {
+    gSystem->Unlink(fCheckpointFileName.c_str());
+    ORLog(kRoutine) << "Appended the rest of the resumed run to " << fFileName << endl;
+  }
+  else {
+    ORLog(kError) << "Could not merge " << fCheckpointFileName << " and " << fFileName 
+                  << "; keeping both" << endl;
+  }
+  fCheckpointFileName = "";
+}
+
+bool ORFileWriter::SetUpResumedFile(const string& fileName)
+{
+  fCheckpointFileName = fileName;
+  fCheckpointFileName.insert(fCheckpointFileName.size() - 5, "_checkpoint");
+  // AccessPathName() is true if the file does NOT exist
+  bool haveFile = !gSystem->AccessPathName(fileName.c_str());
+  bool haveCheckpointFile = !gSystem->AccessPathName(fCheckpointFileName.c_str());
+  if(!haveFile && !haveCheckpointFile) {
+    ORLog(kError) << "Resuming run " << fRunContext->GetRunNumber() << ", but " << fileName 
+                  << " isn't there to go on with" << endl;
+    fCheckpointFileName = "";
+    return false;
+  }
+  if(!haveCheckpointFile) {
+    if(gSystem->Rename(fileName.c_str(), fCheckpointFileName.c_str()) != 0) {
+      ORLog(kError) << "Could not move " << fileName << " to " << fCheckpointFileName << endl;
+      fCheckpointFileName = "";
+      return false;
+    }
+  }
+  else if(haveFile) {
+    // the run was resumed before: fileName has what came after that
+    string mergedFileName = fCheckpointFileName;
+    mergedFileName.insert(mergedFileName.size() - 5, "_merged");
+    if(!MergeFiles(fCheckpointFileName, fileName, mergedFileName) ||
+       gSystem->Rename(mergedFileName.c_str(), fCheckpointFileName.c_str()) != 0) {
+      ORLog(kError) << "Could not merge " << fCheckpointFileName << " and " << fileName << endl;
+      fCheckpointFileName = "";
+      return false;
+    }
+    gSystem->Unlink(fileName.c_str());
+  }
+  ORLog(kRoutine) << "Resuming run " << fRunContext->GetRunNumber() << " from " 
+                  << fCheckpointFileName << endl;
+  return true;
+}
+
+bool ORFileWriter::MergeFiles(const string& first, const string& second,
+                              const string& output)
+{
+  vector<string> inputs;
+  inputs.push_back(first);
+  inputs.push_back(second);
+  return MergeFiles(inputs, output);
+}
+
+bool ORFileWriter::MergeFiles(const vector<string>& inputs, const string& output)
+{
+  TFileMerger merger(kFALSE);
+  merger.SetPrintLevel(0);
+  if(!merger.OutputFile(output.c_str(), kTRUE)) {
+    ORLog(kError) << "Could not open " << output << " for merging" << endl;
+    return false;
+  }
+  for(size_t i=0; i<inputs.size(); i++) {
+    if(!merger.AddFile(inputs[i].c_str(), kFALSE)) {
+      ORLog(kError) << "Could not open " << inputs[i] << " for merging" << endl;
+      return false;
+    }
+  }
+  return merger.Merge();
 }
 
 TFile* ORFileWriter::UpdateFilePointer()
@@ -4,10 +4,27 @@
 #define _ORFileWriter_hh_
 
 #include <string>
+#include <vector>
 #include "TFile.h"
 #include "ORUtilityProcessor.hh"
 
 
+/*!
+   Opens an output file for each run, named after the label and the run
+   number, to which the other processors write their trees and histograms.
+
+   At a checkpoint (see ORDataProcManager::SetCheckpointFile()), the trees
+   are saved with TTree::AutoSave() and the other objects in the file are
+   written, so that the file holds everything processed up to there even if
+   the process dies.  Once checkpoints are written, the trees of the file
+   no longer save themselves on their own (see TTree::SetAutoSave()): a
+   header saved after the checkpoint would bring back, in a file left by a
+   crash, entries that are processed again when the run is resumed.  When a
+   run is resumed from a checkpoint (see
+   ORRunContext::IsResumed()), the file saved at the checkpoint is moved
+   aside, the rest of the run goes to a new file, and the two are merged
+   (see MergeFiles()) when the new file is closed.
+ */
 class ORFileWriter : public ORUtilityProcessor
 {
   public:
@@ -23,18 +40,44 @@ class ORFileWriter : public ORUtilityProcessor
     virtual EReturnCode ProcessDataRecord(UInt_t*);
 
     virtual EReturnCode EndProcessing();
+    virtual EReturnCode Checkpoint();
 
     virtual std::string GetLabel() { return fLabel; }
     virtual void SetLabel(std::string label) { fLabel = label; }
 
+    /*!
+       Merges the files first and second into output with TFileMerger: the
+       entries of trees in second are appended to those in first, and
+       histograms are added.  output may not be one of the two.
+     */
+    static bool MergeFiles(const std::string& first, const std::string& second,
+                           const std::string& output);
+    //! Merges all inputs, in order, into output; see above.
+    static bool MergeFiles(const std::vector<std::string>& inputs, 
+                           const std::string& output);
+    //! Name of the file written for run runNumber with label.
+    static std::string FileNameOf(const std::string& label, int runNumber)
+      { return label + ::Form("_run%d.root", runNumber); }
+
   protected:
     virtual TFile* UpdateFilePointer();
+    //! Closes fFile, and merges it with the file saved at the checkpoint.
+    virtual void CloseFile();
+    //! Moves the file fileName saved at the checkpoint aside, to fCheckpointFileName.
+    virtual bool SetUpResumedFile(const std::string& fileName);
+    //! Keeps the trees in fFile from saving themselves between checkpoints.
+    virtual void StopTreeAutoSave();
   
   protected:
     std::string fLabel;
     std::string fSavedName;
+    std::string fFileName;
+    /* Holds what the resumed run had at the checkpoint; "" unless resumed. */
+    std::string fCheckpointFileName;
     TFile* fFile;
     Int_t fLastSubRunNumber;
+    bool fIsCheckpointing;
+    bool fTreeAutoSaveIsStopped;
 };
 
 #endif
@@ -45,7 +45,7 @@ ORDataProcessor::EReturnCode ORGretaWaveformTreeWriter::ProcessMyDataRecord(UInt
   // the event decoder could run into a problem, but this might not
   // ruin the rest of the run.
   if(!fEventDecoder->SetDataRecord(record)) return kFailure;
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "LEDtime-crate-card-channel-energy = "
@@ -29,12 +29,6 @@ ORHexDumpAllProc::EReturnCode ORHexDumpAllProc::ProcessDataRecord(UInt_t* record
   if (fCheckLimits && ((fRunContext->GetPacketNumber() < fBegin) || (fEnd>=0 && fRunContext->GetPacketNumber() > fEnd))) return kSuccess;
   if (!fPacketList.empty() && !fPacketList.count(fRunContext->GetPacketNumber())) return kSuccess; //if list exists and not in list, return
 
-  if(fRunContext->MustSwap() && !fRunContext->IsRecordSwapped()) {
-    /* Swapping the record.  This only must be done once! */
-    fDataDecoder->Swap(record);
-    fRunContext->SetRecordSwapped();
-  }
-
   if(fIDMap.size() == 0) return kAlarm;
   UInt_t dataID = fDataDecoder->DataIdOf(record);
   string deviceName = fIDMap[dataID];
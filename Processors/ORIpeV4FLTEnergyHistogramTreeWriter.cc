@@ -58,7 +58,7 @@ ORDataProcessor::EReturnCode ORIpeV4FLTEnergyHistogramTreeWriter::ProcessMyDataR
   fHistID =  fEventDecoder->HistogramIDOf(record);
   fHistInfo =  fEventDecoder->HistogramInfoOf(record);
 
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "crate-card-channel-fReadoutSec-fRefreshTime-fFirstBin-fLastBin-fHistogramLength-fMaxHistogramLength-fBinSize-fOffsetEMin-fID-fInfo: "
@@ -49,7 +49,7 @@ ORDataProcessor::EReturnCode ORIpeV4FLTEnergyTreeWriter::ProcessMyDataRecord(UIn
   fChannelMap = fEventDecoder->ChannelMapOf(record);
   fPageNumber = fEventDecoder->PageNumberOf(record);
   fEventID = fEventDecoder->EventIDOf(record);
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "sec-subsec-ID-crate-card-channel-energy_adc = "
@@ -45,7 +45,7 @@ ORDataProcessor::EReturnCode ORIpeV4SLTEventTreeWriter::ProcessMyDataRecord(UInt
   fTimestampLow  = fEventDecoder->TimestampLowOf(record);
   
   
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "sec-subsec-ID-crate-card-counterType-counterSubType-eventCounter-timestampHigh-timestampLow = "
@@ -54,7 +54,7 @@ ORDataProcessor::EReturnCode ORKatrinFLTEnergyHistogramTreeWriter::ProcessMyData
   fBinSize = fEventDecoder->BinSizeOf(record);
   fOffsetEMin = fEventDecoder->OffsetEMinOf(record);
 
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "crate-card-channel-fReadoutSec-fRefreshTime-fFirstBin-fLastBin-fHistogramLength-fMaxHistogramLength-fBinSize-fOffsetEMin: "
@@ -64,7 +64,7 @@ ORDataProcessor::EReturnCode ORKatrinFLTWaveformTreeWriter::ProcessMyDataRecord(
   fResetSec = fEventDecoder->GetResetSec();
   fResetSubSec = fEventDecoder->GetResetSubSec();
    
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "event-sec-subsec-crate-card-channel-energy_adc-resetsec-resetsubsec-chmap-pagenum = "
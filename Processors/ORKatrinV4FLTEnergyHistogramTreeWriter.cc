@@ -58,7 +58,7 @@ ORDataProcessor::EReturnCode ORKatrinV4FLTEnergyHistogramTreeWriter::ProcessMyDa
   fHistID =  fEventDecoder->HistogramIDOf(record);
   fHistInfo =  fEventDecoder->HistogramInfoOf(record);
 
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "crate-card-channel-fReadoutSec-fRefreshTime-fFirstBin-fLastBin-fHistogramLength-fMaxHistogramLength-fBinSize-fOffsetEMin-fID-fInfo: "
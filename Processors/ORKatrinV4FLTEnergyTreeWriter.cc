@@ -51,7 +51,7 @@ ORDataProcessor::EReturnCode ORKatrinV4FLTEnergyTreeWriter::ProcessMyDataRecord(
   fPageNumber = fEventDecoder->PageNumberOf(record);
   fEventID = fEventDecoder->EventIDOf(record);
   fEventInfo =  fEventDecoder->EventInfoOf(record);//TODO: not yet in kDebug output, see below -tb-
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "sec-subsec-ID-crate-card-channel-energy_adc = "
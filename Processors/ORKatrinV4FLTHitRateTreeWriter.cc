@@ -53,7 +53,7 @@ ORDataProcessor::EReturnCode ORKatrinV4FLTHitRateTreeWriter::ProcessMyDataRecord
   
   
   
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "sec-fVersion-crate-card-totalRate-NChannels = "
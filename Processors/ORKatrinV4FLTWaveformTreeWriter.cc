@@ -49,20 +49,9 @@ ORDataProcessor::EReturnCode ORKatrinV4FLTWaveformTreeWriter::ProcessMyDataRecor
   // the event decoder could run into a problem, but this might not
   // ruin the rest of the run.
   if(!fEventDecoder->SetDataRecord(record)) return kFailure;
+  ReadHeader();
       // check severity to improve speed:
-  fCrate = fEventDecoder->CrateOf();
-  fCard = fEventDecoder->CardOf();
-  fChannel = fEventDecoder->GetChannel();
-  fChannelMap = fEventDecoder->GetChannelMap();
-  fSec = fEventDecoder->GetSec();
-  fSubSec = fEventDecoder->GetSubSec();
-  fEventID = fEventDecoder->GetEventID();
-  fEnergy = fEventDecoder->GetEnergy();
-  fWaveformLength = fEventDecoder->GetWaveformLen();
-  fEventFlags = fEventDecoder->GetEventFlags();
-  fEventInfo = fEventDecoder->GetEventInfo();
-   
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
   { 
     ORLog(kDebug) << "ProcessMyDataRecord(): "
       << "crate-card-channel-sec-subsec-energy_adc-chmap-eventID-eventFlags-eventInfo = "
@@ -85,3 +74,61 @@ ORDataProcessor::EReturnCode ORKatrinV4FLTWaveformTreeWriter::ProcessMyDataRecor
 }
 
 
+
+ORDataProcessor::EReturnCode 
+ORKatrinV4FLTWaveformTreeWriter::ProcessDataRecords(UInt_t** records, size_t nRecords)
+{
+  if (!fThisProcessorAutoFillsTree || fFillMethod != kFillAfterProcessDataRecord ||
+      fFillPeriod != 1 || fDebugRecord || ORLogger::GetSeverity() <= ORLogger::kDebug) {
+    return ORVTreeWriter::ProcessDataRecords(records, nRecords);
+  }
+  if (!fDoProcess || !fDoProcessRun || !fRunContext) return kFailure;
+  if (nRecords == 0 || fDataDecoder->DataIdOf(records[0]) != fDataId) return kSuccess;
+
+  EReturnCode spanRetCode = kSuccess;
+  for (size_t i=0; i<nRecords; i++) {
+    SelectRecordOfSpan(i);
+    fLastProcessedRecordRetCode = kFailure;
+    if (!fEventDecoder->ORKatrinV4FLTWaveformDecoder::SetDataRecord(records[i])) {
+      spanRetCode = kFailure;
+      continue;
+    }
+    ReadHeader();
+    if (fWaveformLength > kMaxWFLength) {
+      ORLog(kError) << "Waveform length (" << fWaveformLength 
+        << ") exceeds kMaxWFLength (" << kMaxWFLength << ")" << endl;
+      spanRetCode = kFailure;
+      continue;
+    }
+    // same unpacking as ORKatrinV4FLTWaveformDecoder::CopyWaveformData()
+    const UInt_t* waveformData = 
+      fEventDecoder->ORKatrinV4FLTWaveformDecoder::GetWaveformDataPointer();
+    for (size_t j=0; j<fWaveformLength/2; j++) {
+      fWaveform[2*j] = waveformData[j] & 0xFFFF;
+      fWaveform[2*j+1] = waveformData[j] >> 16;
+    }
+    fLastProcessedRecordRetCode = kSuccess;
+    fFillCount++;
+    fTree->Fill();
+  }
+  return spanRetCode;
+}
+
+void ORKatrinV4FLTWaveformTreeWriter::ReadHeader()
+{
+  // The decoder is made by this writer and is of exactly this class:
+  // calling its getters by their qualified names skips the virtual
+  // dispatch and lets them be inlined.
+  typedef ORKatrinV4FLTWaveformDecoder Decoder;
+  fCrate = fEventDecoder->Decoder::CrateOf();
+  fCard = fEventDecoder->Decoder::CardOf();
+  fChannel = fEventDecoder->Decoder::GetChannel();
+  fChannelMap = fEventDecoder->Decoder::GetChannelMap();
+  fSec = fEventDecoder->Decoder::GetSec();
+  fSubSec = fEventDecoder->Decoder::GetSubSec();
+  fEventID = fEventDecoder->Decoder::GetEventID();
+  fEnergy = fEventDecoder->Decoder::GetEnergy();
+  fWaveformLength = fEventDecoder->Decoder::GetWaveformLen();
+  fEventFlags = fEventDecoder->Decoder::GetEventFlags();
+  fEventInfo = fEventDecoder->Decoder::GetEventInfo();
+}
@@ -12,6 +12,10 @@ class ORKatrinV4FLTWaveformTreeWriter : public ORVTreeWriter
     ORKatrinV4FLTWaveformTreeWriter(std::string treeName = "");
     virtual ~ORKatrinV4FLTWaveformTreeWriter();
     virtual EReturnCode ProcessMyDataRecord(UInt_t* record);
+    // Decodes and fills a whole span in one loop when this writer fills
+    // its tree once after each record (the default); otherwise it goes
+    // record by record like ORVTreeWriter.
+    virtual EReturnCode ProcessDataRecords(UInt_t** records, size_t nRecords);
     virtual inline void Clear() 
       { fSec = 0; fSubSec = 0; fEventID = 0;fCrate = 0; fCard = 0; 
         fChannel = 0; fEnergy = 0; fWaveformLength = 0;
@@ -24,6 +28,8 @@ class ORKatrinV4FLTWaveformTreeWriter : public ORVTreeWriter
       };
   protected:
     virtual EReturnCode InitializeBranches();
+    // Sets the branch values from the header of the decoder's record.
+    void ReadHeader();
 
   protected:
     ORKatrinV4FLTWaveformDecoder* fEventDecoder;
@@ -84,7 +84,7 @@ ORDataProcessor::EReturnCode ORKatrinV4SLTEnergyTreeWriter::ProcessMyDataRecord(
       fEventFlags = fEventDecoder->GetEventFlags(i);
       fEventInfo = fEventDecoder->GetEventInfo(i);
    
-      if (ORLogger::GetSeverity() >= ORLogger::kDebug) 
+      if (ORLogger::GetSeverity() <= ORLogger::kDebug) 
       { 
           ORLog(kDebug) << "ProcessMyDataRecord(): "
               << "num-crate-card-channel-sec-subsec-energy_adc-PeakADC-ValleyADC-PeakPos-ValleyPos-chmap-eventID-eventFlags-eventInfo = "
@@ -34,7 +34,7 @@ ORDataProcessor::EReturnCode ORL2551ScalersTreeWriter::InitializeBranches()
 ORDataProcessor::EReturnCode ORL2551ScalersTreeWriter::ProcessMyDataRecord(UInt_t* record)
 {
   // check severity to improve speed
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) { 
     ORLog(kDebug) << "ProcessMyDataRecord(): got one: "
                   << "crate-card-nscalers = " 
 		  << fScalersDecoder->CrateOf(record) << "-"
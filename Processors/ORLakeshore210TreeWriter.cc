@@ -36,7 +36,7 @@ ORDataProcessor::EReturnCode ORLakeshore210TreeWriter::ProcessMyDataRecord(UInt_
     fTemperature = fLakeshore210Decoder->GetTempOfChannel(record, i);
     fTime = fLakeshore210Decoder->GetTimeOfChannel(record, i);
     fChannel = i;
-    if(ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+    if(ORLogger::GetSeverity() <= ORLogger::kDebug) { 
       ORLog(kDebug) << "channel:temp:unit:time = "  
         << fChannel << ":" << fTemperature << ":" 
         << ((fIsCelsius) ? 'C' : 'K') 
@@ -50,7 +50,7 @@ ORDataProcessor::EReturnCode ORMCA927TreeWriter::ProcessMyDataRecord(UInt_t* rec
 	fLiveTime		= fEventDecoder->GetLiveTime();
 	fRealTime		= fEventDecoder->GetRealTime();
 	fSpectrumLength = fEventDecoder->GetSpectrumLength();
-	if (ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+	if (ORLogger::GetSeverity() <= ORLogger::kDebug) { 
 		ORLog(kDebug) << "ProcessMyDataRecord(): "
 			<< "device-channel-type-zdtMode-liveTime-realTime-length- = "
 			<< fDevice << "-"
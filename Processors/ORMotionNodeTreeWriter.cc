@@ -43,7 +43,7 @@ ORDataProcessor::EReturnCode ORMotionNodeTreeWriter::ProcessMyDataRecord(UInt_t*
 	fChannel		= fEventDecoder->GetChannelNum();
 	fWaveformLength = fEventDecoder->GetWaveformLength();
     fTimeStamp      = fEventDecoder->GetTimeStamp();
-	if (ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+	if (ORLogger::GetSeverity() <= ORLogger::kDebug) { 
 		ORLog(kDebug) << "ProcessMyDataRecord(): "
 			<< "device-channel-length- = "
 			<< fDevice << "-"
@@ -16,11 +16,12 @@ ORRunContext::ORRunContext(ORHeader* header, const char* runCtrlPath)
   fRunNumber = 0;
   fSubRunNumber = 0;
   fIsQuickStartRun = false;
-  fIsRecordSwapped = false;
+  fIsResumed = false;
   fRunType = 0;
   fStartTime = 0;
   fStopTime = 0;
   fPacketNumber = 0;
+  fFirstPacketOfSpan = 0;
   fState = kIdle;
   if (header != NULL) LoadHeader(header, runCtrlPath);
   fHardwareDict = NULL;
@@ -10,6 +10,7 @@
 
 class ORRunDataProcessor;
 class ORDataProcManager;
+class ORDataProcessor;
 class ORVWriter;
 
 
@@ -30,7 +31,7 @@ class ORVWriter;
  *    indexing packets.
 
  *  ORRunContext handles several other 'global' aspects of a run, including
- *  determining if the current record is already swapped, and providing
+ *  whether the stream came swapped, and providing
  *  pointer access to a writable socket to return data across a socket.
  *  This latter functionality is used by ORVOrcaRequestProcessor to 
  *  handle communication back to a running ORCA program.
@@ -45,6 +46,7 @@ class ORRunContext
 
   friend class ORRunDataProcessor;
   friend class ORDataProcManager;
+  friend class ORDataProcessor;
   /* These classes are managers and so they have access to the protected 
    * members of ORRunContext.  This is to improve data hiding. */
   public:
@@ -79,8 +81,15 @@ class ORRunContext
     virtual Int_t GetPacketNumber() const { return fPacketNumber; }
     virtual const ORHeader* GetHeader() const { return fHeader; }
     virtual const ORHardwareDictionary* GetHardwareDict() const { return fHardwareDict; }
+    //! True if the stream came swapped; processors get records in host order anyway.
     virtual inline Bool_t MustSwap() const { return fMustSwap; }
-    virtual inline Bool_t IsRecordSwapped() const { return fIsRecordSwapped; }
+    /*!
+        True in a run whose processing was resumed from a checkpoint (see
+        ORDataProcManager::ResumeFromCheckpoint()): what was processed up
+        to the checkpoint is in the outputs already, and the run goes on
+        from there.
+     */
+    virtual inline Bool_t IsResumed() const { return fIsResumed; }
 
     //! Pointer access function for Run number
     /*!
@@ -119,13 +128,7 @@ class ORRunContext
 
     virtual Int_t WriteBackToSocket(const void* buffer, size_t nBytes);
 
-    // for use by a managing process
-    // FIXME: allow only ORRunDataProcessor to call this?
-    virtual void SetRecordSwapped(Bool_t swapped = true) { fIsRecordSwapped = swapped; }
-    
-
   protected:
-    virtual void ResetRecordFlags() { fIsRecordSwapped = false; }
     virtual Bool_t LoadHeader(ORHeader* header, 
       Bool_t ignoreRunControl = false,
       const char* runCtrlPath = "ObjectInfo:DataChain");
@@ -141,6 +144,11 @@ class ORRunContext
     virtual void SetStopping();
     virtual void SetPreparingForSubRun();
     virtual void SetMustSwap(Bool_t mustSwap) { fMustSwap = mustSwap; } 
+    /* For spans of records (see ORDataProcessor::ProcessDataRecords()):
+     * the packet number is that of the iRecord-th record of the span. */
+    virtual void StartSpan() { fFirstPacketOfSpan = fPacketNumber; }
+    virtual void SetRecordOfSpan(size_t iRecord) 
+      { fPacketNumber = fFirstPacketOfSpan + iRecord; }
 
     ORHeader* fHeader;
     ORHardwareDictionary* fHardwareDict;
@@ -148,13 +156,14 @@ class ORRunContext
     Int_t fRunNumber;
     Int_t fSubRunNumber;
     Bool_t fIsQuickStartRun;
-    Bool_t fIsRecordSwapped;
     Bool_t fMustSwap;
+    Bool_t fIsResumed;
     Int_t fRunType;
     Int_t fStartTime;
     Int_t fStopTime; // won't be valid until the end of a run
     std::string fStringOfState; 
     Int_t fPacketNumber;
+    Int_t fFirstPacketOfSpan;
 
     ORVWriter* fWritableSocket;
 
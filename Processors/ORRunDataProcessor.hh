@@ -18,6 +18,8 @@ class ORRunDataProcessor : public ORDataProcessor
 
     // overloaded from ORDataProcessor
     virtual EReturnCode ProcessDataRecord(UInt_t* record);
+    // counts the bytes of all records
+    virtual bool ProcessesAllRecords() { return true; }
     virtual EReturnCode ProcessMyDataRecord(UInt_t* record);
 
     // to be overloaded, if desired
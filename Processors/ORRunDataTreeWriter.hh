@@ -14,6 +14,11 @@ class ORRunDataTreeWriter : public ORBasicTreeWriter
 
     // overloaded from ORBasicTreeWriter
     virtual EReturnCode ProcessDataRecord(UInt_t* record);
+    // spans go record by record through ProcessDataRecord()
+    virtual EReturnCode ProcessDataRecords(UInt_t** records, size_t nRecords)
+      { return ORDataProcessor::ProcessDataRecords(records, nRecords); }
+    // counts the bytes of all records
+    virtual bool ProcessesAllRecords() { return true; }
     virtual EReturnCode ProcessMyDataRecord(UInt_t* record);
     virtual EReturnCode InitializeBranches();
 
@@ -33,7 +33,7 @@ ORDataProcessor::EReturnCode ORShaperShaperTreeWriter::InitializeBranches()
 ORDataProcessor::EReturnCode ORShaperShaperTreeWriter::ProcessMyDataRecord(UInt_t* record)
 {
   // check severity to improve speed
-  if(ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+  if(ORLogger::GetSeverity() <= ORLogger::kDebug) { 
     ORLog(kDebug) << "ProcessMyDataRecord(): got one: "
                   << "cr-ca-ch-adc = " 
 		  << fShaperShaperDecoder->CrateOf(record) << "-"
@@ -53,7 +53,7 @@ ORDataProcessor::EReturnCode ORTek754DScopeDataTreeWriter::InitializeBranches()
 ORDataProcessor::EReturnCode ORTek754DScopeDataTreeWriter::ProcessMyDataRecord(UInt_t* record)
 {
   // check severity to improve speed
-  if (ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+  if (ORLogger::GetSeverity() <= ORLogger::kDebug) { 
     ORLog(kDebug) << "ProcessMyDataRecord(): got one: "
                   << "gpibadd-ch-n = " 
 		  << fScopeDataDecoder->GPIBAddressOf(record) << "-"
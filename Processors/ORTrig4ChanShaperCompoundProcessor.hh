@@ -18,6 +18,9 @@ class ORTrig4ChanShaperCompoundProcessor : public ORCompoundDataProcessor
     virtual ~ ORTrig4ChanShaperCompoundProcessor();
     virtual EReturnCode StartRun();
     virtual EReturnCode ProcessDataRecord(UInt_t* record);
+    // spans go record by record through ProcessDataRecord()
+    virtual EReturnCode ProcessDataRecords(UInt_t** records, size_t nRecords)
+      { return ORDataProcessor::ProcessDataRecords(records, nRecords); }
     virtual EReturnCode EndRun();
 
   protected:
@@ -22,6 +22,9 @@ class ORTrig4ChanShaperFilter : public ORCompoundDataProcessor
     virtual ~ ORTrig4ChanShaperFilter();
     virtual EReturnCode StartRun();
     virtual EReturnCode ProcessDataRecord(UInt_t* record);
+    // spans go record by record through ProcessDataRecord()
+    virtual EReturnCode ProcessDataRecords(UInt_t** records, size_t nRecords)
+      { return ORDataProcessor::ProcessDataRecords(records, nRecords); }
     virtual EReturnCode EndRun();
     virtual EReturnCode EndProcessing();
 
@@ -33,7 +33,7 @@ ORDataProcessor::EReturnCode ORTrig4ChanTreeWriter::InitializeBranches()
 ORDataProcessor::EReturnCode ORTrig4ChanTreeWriter::ProcessMyDataRecord(UInt_t* record)
 {
   // check severity to improve speed
-  if(ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+  if(ORLogger::GetSeverity() <= ORLogger::kDebug) { 
     ORLog(kDebug) << "ProcessMyDataRecord(): got one: "
                   << "trig-up-low = " 
                   << fTrig4ChanDecoder->trigOf(record) << "-" 
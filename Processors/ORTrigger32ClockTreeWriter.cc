@@ -38,7 +38,7 @@ ORDataProcessor::EReturnCode ORTrigger32ClockTreeWriter::ProcessMyDataRecord(UIn
   fT_s = fTrigger32ClockDecoder->GetMacTime_s(record);
 
   // check severity to improve speed
-  if(ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+  if(ORLogger::GetSeverity() <= ORLogger::kDebug) { 
     ORLog(kDebug) << "ProcessMyDataRecord(): bits = " << fTriggerBits << ", t = " << fT_s << endl;
   }
 
@@ -27,7 +27,7 @@ ORDataProcessor::EReturnCode ORTrigger32GTIDTreeWriter::ProcessMyDataRecord(UInt
   fTriggerBits = fTrigger32GTIDDecoder->EventTriggerBitsOf(record);
 
   // check severity to improve speed
-  if(ORLogger::GetSeverity() >= ORLogger::kDebug) { 
+  if(ORLogger::GetSeverity() <= ORLogger::kDebug) { 
     ORLog(kDebug) << "ProcessMyDataRecord(): bits = " << fTriggerBits << ", gtid = " << fGTID << endl;
   }
 
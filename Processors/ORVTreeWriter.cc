@@ -44,12 +44,26 @@ ORDataProcessor::EReturnCode ORVTreeWriter::ProcessDataRecord(UInt_t* record)
 {
   if (!fDoProcess || !fDoProcessRun || !fRunContext) return kFailure;
   if (fDataDecoder->DataIdOf(record) != fDataId) return kSuccess;
-  if(fRunContext->MustSwap() && !fRunContext->IsRecordSwapped()) {
-    /* Swapping the record.  This only must be done once! */
-    fDataDecoder->Swap(record);
-    fRunContext->SetRecordSwapped();
+  return ProcessAndFill(record);
+}
+
+ORDataProcessor::EReturnCode ORVTreeWriter::ProcessDataRecords(UInt_t** records, 
+                                                               size_t nRecords)
+{
+  if (!fDoProcess || !fDoProcessRun || !fRunContext) return kFailure;
+  if (nRecords == 0 || fDataDecoder->DataIdOf(records[0]) != fDataId) return kSuccess;
+  EReturnCode spanRetCode = kSuccess;
+  for (size_t i=0; i<nRecords; i++) {
+    SelectRecordOfSpan(i);
+    EReturnCode retCode = ProcessAndFill(records[i]);
+    if (retCode >= kAlarm) return retCode;
+    if (retCode > spanRetCode) spanRetCode = retCode;
   }
+  return spanRetCode;
+}
 
+ORDataProcessor::EReturnCode ORVTreeWriter::ProcessAndFill(UInt_t* record)
+{
   if (fThisProcessorAutoFillsTree && 
       fFillMethod == kFillBeforeProcessDataRecord &&
       fLastProcessedRecordRetCode == kSuccess) {
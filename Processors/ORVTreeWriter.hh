@@ -27,6 +27,8 @@ class ORVTreeWriter : public ORDataProcessor
 
     virtual EReturnCode StartRun();
     virtual EReturnCode ProcessDataRecord(UInt_t* record);
+    // Decodes and fills the records of a span in one loop.
+    virtual EReturnCode ProcessDataRecords(UInt_t** records, size_t nRecords);
     virtual EReturnCode EndRun();
     virtual void SetTreeName(std::string treeName) { fTreeName = treeName; }
 
@@ -96,6 +98,8 @@ class ORVTreeWriter : public ORDataProcessor
      */
     virtual EReturnCode InitializeTree();
     virtual EReturnCode InitializeBranches() = 0;
+    // Processes a record in host byte order and fills the tree as set up.
+    virtual EReturnCode ProcessAndFill(UInt_t* record);
 
   protected:
     std::string fTreeName;
@@ -32,7 +32,7 @@ ORDataProcessor::EReturnCode ORVXMTreeWriter::InitializeBranches()
 ORDataProcessor::EReturnCode ORVXMTreeWriter::ProcessMyDataRecord(UInt_t* record)
 {
 
-	if(ORLogger::GetSeverity() >= ORLogger::kDebug) { fVXMDecoder->Dump(record); }
+	if(ORLogger::GetSeverity() <= ORLogger::kDebug) { fVXMDecoder->Dump(record); }
 	fNumberOfMotors = fVXMDecoder->GetNumberOfMotors();
 	fTime           = fVXMDecoder->GetTime(record);
 	fMotorID        = fVXMDecoder->GetMotorID(record);
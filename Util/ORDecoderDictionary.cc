@@ -1,5 +1,4 @@
 #include "ORDecoderDictionary.hh"
-#include <sstream>
 
 ORDecoderDictionary::ORDecoderDictionary(std::string name) : 
   ORDictionary(name)
@@ -8,7 +7,8 @@ ORDecoderDictionary::ORDecoderDictionary(std::string name) :
 
 const ORDictionary* ORDecoderDictionary::GetRecordDictWithCrateAndCard(int crate, int card) const
 {
-  std::ostringstream os;
-  os << crate << ":" << card;
-  return(dynamic_cast<const ORDictionary*>(LookUp(os.str()))); 
+  const ORDictionary* crateDict = 
+    dynamic_cast<const ORDictionary*>(Find(ORDictKey::OfNumber(crate)));
+  if (crateDict == NULL) return NULL;
+  return(dynamic_cast<const ORDictionary*>(crateDict->Find(ORDictKey::OfNumber(card)))); 
 }
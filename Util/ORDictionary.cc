@@ -2,15 +2,114 @@
 
 #include "ORDictionary.hh"
 #include "ORLogger.hh"
+#include "ORReadWriteLock.hh"
+#include <deque>
 #include <sstream> 
 
+/* The interned keys: their ids by string, and their strings by id - 1 */
+static ORReadWriteLock gKeyLock;
+static std::map<std::string, unsigned int> gKeyIds;
+static std::deque<std::string> gKeyStrings;
+
+/* Ids of the keys of small numbers, 0 until they are needed */
+static const int kNNumberKeys = 1024;
+static unsigned int gNumberKeyIds[kNNumberKeys];
+
+unsigned int ORDictKey::Intern(const std::string& key)
+{
+  gKeyLock.readLock();
+  std::map<std::string, unsigned int>::const_iterator keyIter = gKeyIds.find(key);
+  if (keyIter != gKeyIds.end()) {
+    unsigned int id = keyIter->second;
+    gKeyLock.unlock();
+    return id;
+  }
+  gKeyLock.unlock();
+  gKeyLock.writeLock();
+  /* It may have been interned since the read lock was released. */
+  unsigned int& id = gKeyIds[key];
+  if (id == 0) {
+    gKeyStrings.push_back(key);
+    id = gKeyStrings.size();
+  }
+  unsigned int theId = id;
+  gKeyLock.unlock();
+  return theId;
+}
+
+std::string ORDictKey::StringOf(unsigned int id)
+{
+  if (id == 0) return "";
+  gKeyLock.readLock();
+  std::string key = gKeyStrings[id-1];
+  gKeyLock.unlock();
+  return key;
+}
+
+ORDictKey ORDictKey::Find(const std::string& key)
+{
+  ORDictKey theKey;
+  gKeyLock.readLock();
+  std::map<std::string, unsigned int>::const_iterator keyIter = gKeyIds.find(key);
+  if (keyIter != gKeyIds.end()) theKey.fId = keyIter->second;
+  gKeyLock.unlock();
+  return theKey;
+}
+
+ORDictKey ORDictKey::OfNumber(int n)
+{
+  ORDictKey theKey;
+  if (n < 0 || n >= kNNumberKeys) {
+    std::ostringstream os;
+    os << n;
+    theKey.fId = Intern(os.str());
+    return theKey;
+  }
+  theKey.fId = __atomic_load_n(&gNumberKeyIds[n], __ATOMIC_RELAXED);
+  if (theKey.fId == 0) {
+    std::ostringstream os;
+    os << n;
+    theKey.fId = Intern(os.str());
+    __atomic_store_n(&gNumberKeyIds[n], theKey.fId, __ATOMIC_RELAXED);
+  }
+  return theKey;
+}
+
+void ORDictPath::SetPath(const std::string& path, char delimiter)
+{
+  fPath = path;
+  fKeys.clear();
+  if (path == "") return;
+  size_t start = 0;
+  while (1) {
+    size_t delimPos = path.find(delimiter, start);
+    fKeys.push_back(ORDictKey(path.substr(start, delimPos - start)));
+    if (delimPos == std::string::npos) break;
+    start = delimPos + 1;
+  }
+}
+
+void ORDictPath::Add(const ORDictKey& key)
+{
+  if (fKeys.size() > 0) fPath += ":";
+  fPath += key.GetString();
+  fKeys.push_back(key);
+}
+
 ORDictionary::ORDictionary(const ORDictionary& dict) : ORVDictValue(dict)
 {
   SetName(dict.fName);
+  fNIndexed = 0;
+  fIndexIsValid = true;
   /* Now the hard part, copying the dictionary map correctly calling 
      all the copy constructors. */ 
   DictMap::const_iterator dictIter;
   for (dictIter = dict.begin();dictIter!=dict.end();dictIter++) {
+    /* values of unsupported types are loaded as NULL, see ORPlistParser */
+    if (dictIter->second == NULL) {
+      LoadEntry(dictIter->first, NULL);
+      continue;
+    }
     EValType type = dictIter->second->GetValueType(); 
     ORVDictValue* insertDictValue = NULL;
     switch (type) {
@@ -41,6 +140,17 @@ ORDictionary::ORDictionary(const ORDictionary& dict) : ORVDictValue(dict)
   }
 }
 
+ORDictionary& ORDictionary::operator=(const ORDictionary& dict)
+{
+  if (&dict == this) return *this;
+  ORDictionary copy(dict);
+  SetName(copy.fName);
+  /* copy takes the old entries along, and deletes them. */
+  fDictMap.swap(copy.fDictMap);
+  Reindex();
+  return *this;
+}
+
 ORDictionary::~ORDictionary()
 {
   DictMap::iterator i;
@@ -50,65 +160,140 @@ ORDictionary::~ORDictionary()
   }
 }
 
-ORVDictValue* ORDictionary::LookUp(std::string key, char delimiter) 
+/* Multiplicative hash of the sequential key ids */
+static inline size_t HashOfKeyId(unsigned int id)
 {
-  DictMap::const_iterator dictIter;
-  size_t delimPos = key.find(delimiter); 
-  if (delimPos == std::string::npos) {
-    dictIter = fDictMap.find(key); 
-    if (dictIter==fDictMap.end()) {
-      ORLog(kDebug) << "ORDictionary::LookUp(): could not find key " << key
-                      << " in dictionary " << fName << std::endl;
+  return (size_t) (id * 2654435761U);
+}
+
+ORVDictValue* const* ORDictionary::FindSlot(const ORDictKey& key, 
+  const std::string* keyString) const
+{
+  if (!fIndexIsValid) {
+    /* The map may have been changed directly: search it instead. */
+    DictMap::const_iterator dictIter = 
+      fDictMap.find((keyString != NULL) ? *keyString : key.GetString()); 
+    return (dictIter == fDictMap.end()) ? NULL : &dictIter->second;
+  }
+  unsigned int id = key.GetId();
+  if (id == 0 || fNIndexed == 0) return NULL;
+  size_t mask = fIndexKeys.size() - 1;
+  for (size_t i = HashOfKeyId(id) & mask; ; i = (i+1) & mask) {
+    if (fIndexKeys[i] == id) return fIndexValues[i];
+    if (fIndexKeys[i] == 0) return NULL;
+  }
+}
+
+void ORDictionary::Index(unsigned int keyId, ORVDictValue** value)
+{
+  /* Keep the table at most half full. */
+  if (2*(fNIndexed+1) > fIndexKeys.size()) {
+    std::vector<unsigned int> oldKeys(fIndexKeys.size() < 4 ? 8 : 2*fIndexKeys.size(), 0);
+    std::vector<ORVDictValue**> oldValues(oldKeys.size(), (ORVDictValue**) NULL);
+    oldKeys.swap(fIndexKeys);
+    oldValues.swap(fIndexValues);
+    fNIndexed = 0;
+    for (size_t i = 0; i < oldKeys.size(); i++) {
+      if (oldKeys[i] != 0) Index(oldKeys[i], oldValues[i]);
+    }
+  }
+  size_t mask = fIndexKeys.size() - 1;
+  size_t i = HashOfKeyId(keyId) & mask;
+  while (fIndexKeys[i] != 0 && fIndexKeys[i] != keyId) i = (i+1) & mask;
+  if (fIndexKeys[i] == 0) fNIndexed++;
+  fIndexKeys[i] = keyId;
+  fIndexValues[i] = value;
+}
+
+void ORDictionary::Reindex()
+{
+  fIndexKeys.clear();
+  fIndexValues.clear();
+  fNIndexed = 0;
+  fIndexIsValid = true;
+  for (DictMap::iterator i = fDictMap.begin(); i != fDictMap.end(); i++) {
+    Index(ORDictKey(i->first).GetId(), &i->second);
+  }
+}
+
+const ORVDictValue* ORDictionary::Find(const ORDictKey& key) const
+{
+  ORVDictValue* const* value = FindSlot(key);
+  return (value == NULL) ? NULL : *value;
+}
+
+ORVDictValue* ORDictionary::Find(const ORDictKey& key)
+{
+  ORVDictValue* const* value = FindSlot(key);
+  return (value == NULL) ? NULL : *value;
+}
+
+ORVDictValue* ORDictionary::LookUp(const std::string& key, char delimiter) 
+{
+  return (ORVDictValue*) ((const ORDictionary*) this)->LookUp(key, delimiter);
+}
+
+const ORVDictValue* ORDictionary::LookUp(const std::string& key, char delimiter) const 
+{
+  /* Keys that were never interned are in no dictionary, so don't intern
+     them, just find them. */
+  const ORDictionary* dict = this;
+  size_t start = 0;
+  while (1) {
+    size_t delimPos = key.find(delimiter, start); 
+    std::string keyName = key.substr(start, delimPos - start);
+    ORVDictValue* const* value = dict->FindSlot(ORDictKey::Find(keyName), &keyName);
+    if (value == NULL) {
+      ORLog(kDebug) << "ORDictionary::LookUp(): could not find key " << keyName
+                    << " in dictionary " << dict->fName << std::endl;
       return NULL;
     }
-    return dictIter->second; 
-  } else {
-    std::string nextDictName = key.substr(0, delimPos);
-    std::string nextKeyName = key.substr(delimPos+1);
-    const ORVDictValue* nextDict = LookUp(nextDictName);
-    if (nextDict == NULL) return NULL;
-    if (nextDict->GetValueType() != kDict) {
-      ORLog(kDebug) << "ORDictionary::LookUp(): key " << nextDictName 
-                    << " in dictionary " << fName << " is not a dictionary (ValueType = " 
-		    << nextDict->GetValueType() << ")." << std::endl;
+    if (delimPos == std::string::npos) return *value;
+    if ((*value)->GetValueType() != kDict) {
+      ORLog(kDebug) << "ORDictionary::LookUp(): key " << keyName 
+                    << " in dictionary " << dict->fName << " is not a dictionary (ValueType = " 
+		    << (*value)->GetValueType() << ")." << std::endl;
       return NULL;
     }
-    return ((ORDictionary*) nextDict)->LookUp(nextKeyName);
+    dict = (const ORDictionary*) *value;
+    start = delimPos + 1;
   }
 }
 
-const ORVDictValue* ORDictionary::LookUp(std::string key, char delimiter) const 
+ORVDictValue* ORDictionary::LookUp(const ORDictPath& path) 
 {
-  DictMap::const_iterator dictIter;
-  size_t delimPos = key.find(delimiter); 
-  if (delimPos == std::string::npos) {
-    dictIter = fDictMap.find(key); 
-    if (dictIter==fDictMap.end()) {
-      ORLog(kDebug) << "ORDictionary::LookUp(): could not find key " << key
-                      << " in dictionary " << fName << std::endl;
+  return (ORVDictValue*) ((const ORDictionary*) this)->LookUp(path);
+}
+
+const ORVDictValue* ORDictionary::LookUp(const ORDictPath& path) const
+{
+  const ORDictionary* dict = this;
+  for (size_t i = 0; i < path.GetNKeys(); i++) {
+    const ORVDictValue* value = dict->Find(path.GetKey(i));
+    if (value == NULL) {
+      ORLog(kDebug) << "ORDictionary::LookUp(): could not find key " 
+                    << path.GetKey(i).GetString() << " in dictionary " 
+                    << dict->fName << std::endl;
       return NULL;
     }
-    return (const ORVDictValue*) dictIter->second; 
-  } else {
-    std::string nextDictName = key.substr(0, delimPos);
-    std::string nextKeyName = key.substr(delimPos+1);
-    const ORVDictValue* nextDict = LookUp(nextDictName);
-    if (nextDict == NULL) return NULL;
-    if (nextDict->GetValueType() != kDict) {
-      ORLog(kDebug) << "ORDictionary::LookUp(): key " << nextDictName 
-                    << " in dictionary " << fName << " is not a dictionary (ValueType = " 
-		    << nextDict->GetValueType() << ")." << std::endl;
+    if (i+1 == path.GetNKeys()) return value;
+    if (value->GetValueType() != kDict) {
+      ORLog(kDebug) << "ORDictionary::LookUp(): key " << path.GetKey(i).GetString()
+                    << " in dictionary " << dict->fName << " is not a dictionary (ValueType = " 
+		    << value->GetValueType() << ")." << std::endl;
       return NULL;
     }
-    return ((const ORDictionary*) nextDict)->LookUp(nextKeyName);
+    dict = (const ORDictionary*) value;
   }
+  return NULL;
 }
 
-void ORDictionary::LoadEntry(std::string key, ORVDictValue* value)
+void ORDictionary::LoadEntry(const std::string& key, ORVDictValue* value)
 {
   ORVDictValue*& entry = fDictMap[key];
   if(entry!=NULL) delete entry;
   entry = value;
+  if (fIndexIsValid) Index(ORDictKey(key).GetId(), &entry);
 }
 
 std::string ORDictValueA::GetStringOfValue() const
@@ -140,6 +325,10 @@ ORDictValueA::ORDictValueA(const ORDictValueA& dictA) : ORVDictValue(dictA)
   /* Now the hard part, copying the dictionary map correctly calling 
      all the copy constructors. */ 
   for (size_t i = 0; i<dictA.fDictVals.size();i++) { 
+    if (dictA.fDictVals[i] == NULL) {
+      LoadValue(NULL);
+      continue;
+    }
     EValType type = dictA.fDictVals[i]->GetValueType(); 
     ORVDictValue* insertDictValue = NULL;
     switch (type) {
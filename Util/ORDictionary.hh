@@ -40,27 +40,108 @@ class ORVDictValue
     virtual size_t GetNValues() const { return 1; } 
 };
 
+//! Interned dictionary key
+/*!
+    Each distinct key string is given a number once, so that keys can be
+    compared and hashed as numbers.  Keys made from strings that were never
+    interned are not found in any dictionary.
+ */
+class ORDictKey
+{
+  public:
+    ORDictKey() : fId(0) {}
+    //! Interns key.
+    ORDictKey(const std::string& key) : fId(Intern(key)) {}
+    ORDictKey(const char* key) : fId(Intern(key)) {}
+
+    //! 0 for no key
+    unsigned int GetId() const { return fId; }
+    std::string GetString() const { return StringOf(fId); }
+    bool operator==(const ORDictKey& key) const { return fId == key.fId; }
+    bool operator!=(const ORDictKey& key) const { return fId != key.fId; }
+
+    //! Key of the decimal number n, e.g. a crate or card number.
+    static ORDictKey OfNumber(int n);
+    //! Key of key if it was interned, else the empty key; interns nothing.
+    static ORDictKey Find(const std::string& key);
+
+  protected:
+    static unsigned int Intern(const std::string& key);
+    static std::string StringOf(unsigned int id);
+    unsigned int fId;
+};
+
+//! Path through nested dictionaries, resolved to keys once
+/*!
+    A path like "ORGretina4MModel:Card:3" is split and interned when the
+    ORDictPath is made, so that looking it up in a dictionary is a hash 
+    look-up per level:
+
+    \verbatim
+    static const ORDictPath path("Run Control:RunNumber");
+    const ORVDictValue* value = header->LookUp(path);
+    \endverbatim
+ */
+class ORDictPath
+{
+  public:
+    ORDictPath(const std::string& path = "", char delimiter = ':') 
+      { SetPath(path, delimiter); }
+    ORDictPath(const char* path, char delimiter = ':') 
+      { SetPath(path, delimiter); }
+    virtual ~ORDictPath() {}
+
+    virtual void SetPath(const std::string& path, char delimiter = ':');
+    //! Appends key to the path.
+    virtual void Add(const ORDictKey& key);
+    virtual const std::string& GetPath() const { return fPath; }
+    virtual size_t GetNKeys() const { return fKeys.size(); }
+    virtual const ORDictKey& GetKey(size_t i) const { return fKeys[i]; }
+
+  protected:
+    std::string fPath;
+    std::vector<ORDictKey> fKeys;
+};
+
 //! True dictionary class
 /*!
     Stores ORVDictValue data types accoring to a string
-    key.
+    key.  The entries are kept in a map ordered by key, for iterating over
+    them, and indexed by interned key in an open-addressing hash table,
+    for looking them up (see ORDictKey and ORDictPath).  Entries are to be 
+    added with LoadEntry().  Once the map is handed out to be changed
+    directly (the non-const GetDictMap()), entries are looked up in the
+    map, more slowly, until Reindex() is called.
  */
 class ORDictionary : public ORVDictValue
 {
   public:
     ORDictionary(std::string name = "") 
-      { SetName(name);}
+      { SetName(name); fNIndexed = 0; fIndexIsValid = true; }
 
     //! Copy constructor to handle making a new dictionary from another.
     ORDictionary(const ORDictionary& dict);
+    //! Replaces the entries with copies of those of dict.
+    ORDictionary& operator=(const ORDictionary& dict);
     virtual ~ORDictionary();
 
     virtual EValType GetValueType() const { return kDict; }
 
     virtual const std::string& GetName() const { return fName; }
-    virtual const ORVDictValue* LookUp(std::string key, char delimiter = ':') const;
-    virtual ORVDictValue* LookUp(std::string key, char delimiter = ':');
-    virtual void LoadEntry(std::string key, ORVDictValue* value);
+    virtual const ORVDictValue* LookUp(const std::string& key, char delimiter = ':') const;
+    virtual ORVDictValue* LookUp(const std::string& key, char delimiter = ':');
+    virtual const ORVDictValue* LookUp(const char* key, char delimiter = ':') const
+      { return LookUp(std::string(key), delimiter); }
+    virtual ORVDictValue* LookUp(const char* key, char delimiter = ':')
+      { return LookUp(std::string(key), delimiter); }
+    virtual const ORVDictValue* LookUp(const ORDictPath& path) const;
+    virtual ORVDictValue* LookUp(const ORDictPath& path);
+    //! The entry of key in this dictionary (not a path), or NULL.
+    virtual const ORVDictValue* Find(const ORDictKey& key) const;
+    virtual ORVDictValue* Find(const ORDictKey& key);
+    virtual void LoadEntry(const std::string& key, ORVDictValue* value);
+    //! Rebuilds the index after the map was changed directly.
+    virtual void Reindex();
     virtual void SetName(std::string name) { fName = name; }
     virtual std::string GetStringOfValue() const {return "";}
     virtual size_t GetNValues() const {return fDictMap.size();}
@@ -69,15 +150,33 @@ class ORDictionary : public ORVDictValue
     // the dictionary:
     typedef std::map<std::string, ORVDictValue*> DictMap;
     virtual const DictMap& GetDictMap() const { return fDictMap; }
-    virtual DictMap& GetDictMap() { return fDictMap; }
+    //! Entries may be inserted or erased through it: call Reindex() after.
+    virtual DictMap& GetDictMap() { fIndexIsValid = false; return fDictMap; }
+    // Iterators can only change the values, which the index follows.
     virtual DictMap::iterator begin() { return fDictMap.begin(); }
     virtual DictMap::const_iterator begin() const { return fDictMap.begin(); }
     virtual DictMap::iterator end() { return fDictMap.end(); }
     virtual DictMap::const_iterator end() const { return fDictMap.end(); }    
 
   protected:
+    //! Enters the value slot of an entry of fDictMap in the index.
+    virtual void Index(unsigned int keyId, ORVDictValue** value);
+    /*!
+       The value slot of key, or NULL.  keyString, if given, is the string
+       of key, for searching the map when it is not indexed.
+     */
+    virtual ORVDictValue* const* FindSlot(const ORDictKey& key, 
+      const std::string* keyString = NULL) const;
+
     std::string fName;
     DictMap fDictMap;
+    /* Open-addressing hash table of interned key ids (0 for empty slots)
+       and the value slots of their entries in fDictMap. */
+    std::vector<unsigned int> fIndexKeys; //!
+    std::vector<ORVDictValue**> fIndexValues; //!
+    size_t fNIndexed; //!
+    /* False once the map may have been changed directly; see GetDictMap(). */
+    bool fIndexIsValid; //!
 };
 
 //! Dictionary value for string
@@ -83,22 +83,21 @@ bool ORHardwareDictionary::LoadCratesAndCards(const ORDictionary* dict)
           int slotCrateNum = slotNumber->GetI(); 
           ORDecoderDictionary* decoderCrateDict = 0;
           
-          if ((fDictMap.find(className->GetS())) == fDictMap.end()) {
+          ORVDictValue* classDict = Find(ORDictKey(className->GetS()));
+          if (classDict == NULL) {
             decoderCrateDict = new ORDecoderDictionary(className->GetS());
-            fDictMap[className->GetS()] = decoderCrateDict; 
+            LoadEntry(className->GetS(), decoderCrateDict); 
           } else {
-            decoderCrateDict = 
-              dynamic_cast<ORDecoderDictionary*>(fDictMap[className->GetS()]);
+            decoderCrateDict = dynamic_cast<ORDecoderDictionary*>(classDict);
           }
           /* OK, now load it up with the card/crate info. */
           std::ostringstream os1, os2;
           os1 << crateNum->GetI();
-          decoderCrateDict->LookUp(os1.str()); 
           ORDictionary* crateDictForCard = 0;
 
           /* Insert crate if it doesn't exist. */
           if (!(crateDictForCard = dynamic_cast<ORDictionary*>(
-              decoderCrateDict->LookUp(os1.str())))) { 
+              decoderCrateDict->Find(ORDictKey::OfNumber(crateNum->GetI()))))) { 
             crateDictForCard = new ORDictionary(os1.str());
             decoderCrateDict->LoadEntry(os1.str(), crateDictForCard); 
           }
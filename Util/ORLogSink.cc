@@ -0,0 +1,382 @@
+// ORLogSink.cc
+
+#include "ORLogSink.hh"
+
+#include <set>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include "TString.h"
+
+using namespace std;
+
+bool ORLogSink::fgIsRunning = false;
+bool ORLogSink::fgStop = false;
+ORLogSink::EFormat ORLogSink::fgFormat = ORLogSink::kText;
+size_t ORLogSink::fgMaxRate = 1000;
+size_t ORLogSink::fgMaxQueued = 100000;
+pthread_t ORLogSink::fgThread;
+pthread_key_t ORLogSink::fgStreamKey;
+int ORLogSink::fgPid = 0;
+
+ORLogSink::Message ORLogSink::fgStub;
+ORLogSink::Message* ORLogSink::fgHead = &ORLogSink::fgStub;
+ORLogSink::Message* ORLogSink::fgTail = &ORLogSink::fgStub;
+size_t ORLogSink::fgNQueued = 0;
+size_t ORLogSink::fgNDroppedQueued = 0;
+
+map<string, ORLogSink::Repeat> ORLogSink::fgRepeats;
+long ORLogSink::fgRateSecond = 0;
+size_t ORLogSink::fgNWrittenThisSecond = 0;
+size_t ORLogSink::fgNDroppedRate = 0;
+
+/* where to report dropped messages: the output of the last one dropped */
+static ostream* gDroppedOutput = NULL;
+/* outputs written since they were last flushed; logger thread only */
+static set<ostream*> gWrittenOutputs;
+static pthread_once_t gSetUpOnce = PTHREAD_ONCE_INIT;
+/* held by the logger thread while it writes, so that a fork does not copy
+   output that is written but not flushed yet */
+static pthread_mutex_t gWriteMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void LockForFork() { pthread_mutex_lock(&gWriteMutex); }
+static void UnlockAfterFork() { pthread_mutex_unlock(&gWriteMutex); }
+
+static void SetUpOnce()
+{
+  atexit(ORLogSink::Stop);
+}
+
+static long ElapsedMicroseconds(const struct timeval& from, const struct timeval& to)
+{
+  return (to.tv_sec - from.tv_sec)*1000000L + (to.tv_usec - from.tv_usec);
+}
+
+bool ORLogSink::Start(EFormat format)
+{
+  if (IsRunning()) return true;
+  pthread_once(&gSetUpOnce, SetUpOnce);
+  static bool isKeyCreated = false;
+  if (!isKeyCreated) {
+    if (pthread_key_create(&fgStreamKey, DeleteThreadStream) != 0) return false;
+    pthread_atfork(LockForFork, UnlockAfterFork, ResetInChild);
+    isKeyCreated = true;
+  }
+  fgFormat = format;
+  fgPid = getpid();
+  __atomic_store_n(&fgStop, false, __ATOMIC_RELEASE);
+  if (pthread_create(&fgThread, NULL, LoggerThread, NULL) != 0) {
+    ORLog(kError) << "Could not start the logger thread; logging directly" << endl;
+    return false;
+  }
+  __atomic_store_n(&fgIsRunning, true, __ATOMIC_RELEASE);
+  return true;
+}
+
+void ORLogSink::Stop()
+{
+  if (!IsRunning()) return;
+  /* The text of a message of this thread that is not finished yet */
+  GetThreadStream().fBuffer.Send();
+  __atomic_store_n(&fgIsRunning, false, __ATOMIC_RELEASE);
+  __atomic_store_n(&fgStop, true, __ATOMIC_RELEASE);
+  pthread_join(fgThread, NULL);
+}
+
+void ORLogSink::ResetInChild()
+{
+  UnlockAfterFork();
+  /* The logger thread is not forked with the process: log directly. */
+  if (!IsRunning()) return;
+  fgIsRunning = false;
+  fgHead = fgTail = &fgStub;
+  fgStub.fNext = NULL;
+  fgNQueued = 0;
+  fgNDroppedQueued = 0;
+  fgRepeats.clear();
+  fgNWrittenThisSecond = 0;
+  fgNDroppedRate = 0;
+}
+
+ostream& ORLogSink::Begin(ORLogger::ESeverity severity, const char* location,
+                          ostream* output)
+{
+  MessageStream& theStream = GetThreadStream();
+  theStream.fBuffer.Begin(severity, location, output);
+  return theStream;
+}
+
+ORLogSink::MessageStream& ORLogSink::GetThreadStream()
+{
+  MessageStream* theStream = (MessageStream*) pthread_getspecific(fgStreamKey);
+  if (theStream == NULL) {
+    theStream = new MessageStream;
+    pthread_setspecific(fgStreamKey, theStream);
+  }
+  return *theStream;
+}
+
+void ORLogSink::DeleteThreadStream(void* stream)
+{
+  MessageStream* theStream = (MessageStream*) stream;
+  theStream->fBuffer.Send();
+  delete theStream;
+}
+
+ORLogSink::MessageBuffer::MessageBuffer() : fMessage(NULL)
+{
+#ifdef __linux__
+  fThread = syscall(SYS_gettid);
+#else
+  fThread = (long) pthread_self();
+#endif
+}
+
+void ORLogSink::MessageBuffer::Begin(ORLogger::ESeverity severity,
+                                     const char* location, ostream* output)
+{
+  Send();
+  if (fMessage == NULL) fMessage = new Message;
+  fMessage->fSeverity = severity;
+  fMessage->fLocation = location;
+  fMessage->fOutput = output;
+  gettimeofday(&fMessage->fTime, NULL);
+  fMessage->fThread = fThread;
+  fMessage->fIsContinued = false;
+  fMessage->fText.clear();
+}
+
+void ORLogSink::MessageBuffer::Send()
+{
+  if (fMessage == NULL || fMessage->fText.empty()) return;
+  /* More text for the same message goes in a continuation. */
+  Message* theNext = new Message;
+  theNext->fSeverity = fMessage->fSeverity;
+  theNext->fLocation = fMessage->fLocation;
+  theNext->fOutput = fMessage->fOutput;
+  theNext->fTime = fMessage->fTime;
+  theNext->fThread = fThread;
+  theNext->fIsContinued = true;
+  Push(fMessage);
+  fMessage = theNext;
+}
+
+int ORLogSink::MessageBuffer::overflow(int c)
+{
+  if (c == traits_type::eof() || fMessage == NULL) return traits_type::not_eof(c);
+  fMessage->fText += (char) c;
+  if (c == '\n') Send();
+  return c;
+}
+
+streamsize ORLogSink::MessageBuffer::xsputn(const char* s, streamsize n)
+{
+  if (fMessage == NULL || n <= 0) return n;
+  fMessage->fText.append(s, n);
+  if (s[n-1] == '\n') Send();
+  return n;
+}
+
+void ORLogSink::Push(Message* message)
+{
+  /* Drop rather than queue without end if the logger thread falls behind. */
+  if (message != &fgStub) {
+    if (__atomic_add_fetch(&fgNQueued, 1, __ATOMIC_RELAXED) > GetMaxQueued()) {
+      __atomic_sub_fetch(&fgNQueued, 1, __ATOMIC_RELAXED);
+      __atomic_add_fetch(&fgNDroppedQueued, 1, __ATOMIC_RELAXED);
+      __atomic_store_n(&gDroppedOutput, message->fOutput, __ATOMIC_RELAXED);
+      delete message;
+      return;
+    }
+  }
+  message->fNext = NULL;
+  Message* thePrevious = __atomic_exchange_n(&fgHead, message, __ATOMIC_ACQ_REL);
+  /* Until this store, the messages from here on are not visible to Pop(). */
+  __atomic_store_n(&thePrevious->fNext, message, __ATOMIC_RELEASE);
+}
+
+ORLogSink::Message* ORLogSink::Pop()
+{
+  Message* theTail = fgTail;
+  Message* theNext = __atomic_load_n(&theTail->fNext, __ATOMIC_ACQUIRE);
+  if (theTail == &fgStub) {
+    if (theNext == NULL) return NULL;
+    fgTail = theNext;
+    theTail = theNext;
+    theNext = __atomic_load_n(&theNext->fNext, __ATOMIC_ACQUIRE);
+  }
+  if (theNext == NULL) {
+    /* theTail is the last message, unless a push is under way */
+    if (theTail != __atomic_load_n(&fgHead, __ATOMIC_ACQUIRE)) return NULL;
+    Push(&fgStub);
+    theNext = __atomic_load_n(&theTail->fNext, __ATOMIC_ACQUIRE);
+    if (theNext == NULL) return NULL;
+  }
+  fgTail = theNext;
+  __atomic_sub_fetch(&fgNQueued, 1, __ATOMIC_RELAXED);
+  return theTail;
+}
+
+void* ORLogSink::LoggerThread(void*)
+{
+  struct timeval now;
+  while (1) {
+    bool isStopping = __atomic_load_n(&fgStop, __ATOMIC_ACQUIRE);
+    size_t nMessages = 0;
+    Message* theMessage;
+    pthread_mutex_lock(&gWriteMutex);
+    while ((theMessage = Pop()) != NULL) {
+      Handle(theMessage);
+      nMessages++;
+    }
+    gettimeofday(&now, NULL);
+    WriteSummaries(now, isStopping);
+    for (set<ostream*>::iterator anIter = gWrittenOutputs.begin();
+         anIter != gWrittenOutputs.end(); anIter++) {
+      (*anIter)->flush();
+    }
+    gWrittenOutputs.clear();
+    pthread_mutex_unlock(&gWriteMutex);
+    if (isStopping) break;
+    if (nMessages == 0) usleep(2000);
+  }
+  return NULL;
+}
+
+void ORLogSink::Handle(Message* message)
+{
+  if (message->fTime.tv_sec != fgRateSecond) {
+    struct timeval now = message->fTime;
+    WriteSummaries(now, false);
+    fgRateSecond = message->fTime.tv_sec;
+    fgNWrittenThisSecond = 0;
+  }
+
+  string theKey = ::Form("%d%d:", (int) message->fSeverity, (int) message->fIsContinued);
+  theKey += message->fLocation;
+  theKey += ":" + message->fText;
+  map<string, Repeat>::iterator anIter = fgRepeats.find(theKey);
+  if (anIter != fgRepeats.end()) {
+    Repeat& theRepeat = anIter->second;
+    if (theRepeat.fCount == 0) theRepeat.fFirst = message->fTime;
+    theRepeat.fLast = message->fTime;
+    theRepeat.fCount++;
+    delete message;
+    return;
+  }
+
+  size_t theMaxRate = GetMaxRate();
+  if (theMaxRate > 0 && fgNWrittenThisSecond >= theMaxRate &&
+      message->fSeverity < ORLogger::kError) {
+    fgNDroppedRate++;
+    __atomic_store_n(&gDroppedOutput, message->fOutput, __ATOMIC_RELAXED);
+    delete message;
+    return;
+  }
+
+  Write(*message, message->fText);
+  fgNWrittenThisSecond++;
+  Repeat& theRepeat = fgRepeats[theKey];
+  theRepeat.fWritten = message->fTime;
+  theRepeat.fCount = 0;
+  theRepeat.fMessage = message;
+}
+
+void ORLogSink::WriteSummaries(const struct timeval& now, bool all)
+{
+  map<string, Repeat>::iterator anIter = fgRepeats.begin();
+  while (anIter != fgRepeats.end()) {
+    Repeat& theRepeat = anIter->second;
+    if (!all && ElapsedMicroseconds(theRepeat.fWritten, now) < 1000000) {
+      anIter++;
+      continue;
+    }
+    if (theRepeat.fCount > 0) {
+      Message theMessage = *theRepeat.fMessage;
+      theMessage.fTime = theRepeat.fLast;
+      theMessage.fIsContinued = false;
+      Write(theMessage, ::Form("repeated %d times from %s to %s: ",
+                               (int) theRepeat.fCount,
+                               FormatTime(theRepeat.fFirst).c_str(),
+                               FormatTime(theRepeat.fLast).c_str())
+                        + theRepeat.fMessage->fText);
+    }
+    delete theRepeat.fMessage;
+    fgRepeats.erase(anIter++);
+  }
+
+  /* Dropped messages are reported once a second. */
+  if (!all && now.tv_sec == fgRateSecond) return;
+  size_t nDropped = fgNDroppedRate +
+    __atomic_exchange_n(&fgNDroppedQueued, 0, __ATOMIC_RELAXED);
+  fgNDroppedRate = 0;
+  ostream* theOutput = __atomic_load_n(&gDroppedOutput, __ATOMIC_RELAXED);
+  if (nDropped == 0 || theOutput == NULL) return;
+  Message theMessage;
+  theMessage.fSeverity = ORLogger::kWarning;
+  theMessage.fLocation = "ORLogSink";
+  theMessage.fOutput = theOutput;
+  theMessage.fTime = now;
+  theMessage.fThread = 0;
+  theMessage.fIsContinued = false;
+  Write(theMessage, ::Form("dropped %d messages above %d per second or %d queued\n",
+                           (int) nDropped, (int) GetMaxRate(), (int) GetMaxQueued()));
+}
+
+void ORLogSink::Write(const Message& message, const string& text)
+{
+  ostream& theOutput = *message.fOutput;
+  gWrittenOutputs.insert(message.fOutput);
+  if (fgFormat == kText) {
+    if (!message.fIsContinued) {
+      theOutput << ORLogger::toString(message.fSeverity) << ": " << "(pid: "
+                << fgPid << "): " << message.fLocation << ": ";
+    }
+    theOutput << text;
+    return;
+  }
+  string theText = text;
+  if (!theText.empty() && theText[theText.size()-1] == '\n') {
+    theText.erase(theText.size()-1);
+  }
+  theOutput << "{\"time\": \"" << FormatTime(message.fTime) << "\", "
+            << "\"severity\": \"" << ORLogger::toString(message.fSeverity) << "\", "
+            << "\"pid\": " << fgPid << ", "
+            << "\"thread\": " << message.fThread << ", "
+            << "\"location\": " << QuoteJSON(message.fLocation) << ", "
+            << "\"message\": " << QuoteJSON(theText);
+  if (message.fIsContinued) theOutput << ", \"continued\": true";
+  theOutput << "}\n";
+}
+
+string ORLogSink::FormatTime(const struct timeval& time)
+{
+  struct tm theTime;
+  time_t theSeconds = time.tv_sec;
+  localtime_r(&theSeconds, &theTime);
+  char theBuffer[32];
+  strftime(theBuffer, sizeof(theBuffer), "%Y-%m-%dT%H:%M:%S", &theTime);
+  return string(theBuffer) + ::Form(".%06d", (int) time.tv_usec);
+}
+
+string ORLogSink::QuoteJSON(const string& text)
+{
+  string theQuoted = "\"";
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    switch (c) {
+      case '"': theQuoted += "\\\""; break;
+      case '\\': theQuoted += "\\\\"; break;
+      case '\n': theQuoted += "\\n"; break;
+      case '\r': theQuoted += "\\r"; break;
+      case '\t': theQuoted += "\\t"; break;
+      default:
+        if ((unsigned char) c < 0x20) theQuoted += ::Form("\\u%04x", (int) c);
+        else theQuoted += c;
+    }
+  }
+  return theQuoted + "\"";
+}
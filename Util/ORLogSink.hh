@@ -0,0 +1,161 @@
+// ORLogSink.hh
+
+#ifndef _ORLogSink_hh_
+#define _ORLogSink_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <iostream>
+#include <map>
+#include <string>
+#include <pthread.h>
+#include <sys/time.h>
+#include "ORLogger.hh"
+
+//! Writes the messages of ORLogger from a thread of its own
+/*!
+   While the sink is running, ORLog hands each message to a lock-free
+   queue instead of writing it, and a logger thread writes it to the
+   ostream of the thread that logged it, so a slow terminal or pipe no
+   longer holds up the thread.  The logger thread also:
+
+   - folds repeated messages: a message that comes again (same severity,
+     location and text) within a second of being written is counted, and
+     written once more with the count and the times of the first and last
+     repeat;
+   - limits the messages written per second (see SetMaxRate()); warnings
+     and below above the limit are dropped and counted;
+   - writes the messages either as text like ORLogger, or as JSON lines
+     with the time, severity, pid, thread, location and message.
+
+   If the logger thread falls behind, messages beyond GetMaxQueued() are
+   dropped and counted rather than queued.  Usage:
+
+   \verbatim
+   ORLogSink::Start(ORLogSink::kJSONLines);
+   ...
+   ORLog(kWarning) << "This goes through the sink" << std::endl;
+   ...
+   ORLogSink::Stop();  // writes what is still queued
+   \endverbatim
+
+   The sink is stopped at exit.  A child process that is forked while it
+   is running logs directly, unless it starts the sink again.
+ */
+class ORLogSink
+{
+  public:
+    enum EFormat { kText, kJSONLines };
+
+    //! Starts the logger thread; false if it could not be started.
+    static bool Start(EFormat format = kText);
+    //! Writes the messages still queued and stops the logger thread.
+    static void Stop();
+    static inline bool IsRunning()
+    { return __atomic_load_n(&fgIsRunning, __ATOMIC_ACQUIRE); }
+
+    //! Messages written per second at most; 0 for no limit (default 1000).
+    static void SetMaxRate(size_t maxPerSecond)
+    { __atomic_store_n(&fgMaxRate, maxPerSecond, __ATOMIC_RELAXED); }
+    static size_t GetMaxRate()
+    { return __atomic_load_n(&fgMaxRate, __ATOMIC_RELAXED); }
+    //! Messages queued at most; more are dropped (default 100000).
+    static void SetMaxQueued(size_t maxQueued)
+    { __atomic_store_n(&fgMaxQueued, maxQueued, __ATOMIC_RELAXED); }
+    static size_t GetMaxQueued()
+    { return __atomic_load_n(&fgMaxQueued, __ATOMIC_RELAXED); }
+
+    /*!
+       Starts a message of the calling thread, to be written to output.
+       Returns the stream the message text goes to; the message is queued
+       when the stream is flushed or the text ends with a newline.
+     */
+    static std::ostream& Begin(ORLogger::ESeverity severity,
+                               const char* location, std::ostream* output);
+
+  protected:
+    struct Message {
+      Message* fNext;
+      ORLogger::ESeverity fSeverity;
+      const char* fLocation;
+      std::ostream* fOutput;
+      struct timeval fTime;
+      long fThread;
+      bool fIsContinued; //! rest of the message before it
+      std::string fText;
+    };
+
+    //! The stream of a thread, collecting the text of its message.
+    class MessageBuffer : public std::streambuf
+    {
+      public:
+        MessageBuffer();
+        void Begin(ORLogger::ESeverity severity, const char* location,
+                   std::ostream* output);
+        //! Queues the text so far, if any.
+        void Send();
+      protected:
+        virtual int overflow(int c);
+        virtual std::streamsize xsputn(const char* s, std::streamsize n);
+        virtual int sync() { Send(); return 0; }
+        Message* fMessage;
+        long fThread;
+    };
+    class MessageStream : public std::ostream
+    {
+      public:
+        MessageStream() : std::ostream(&fBuffer) {}
+        MessageBuffer fBuffer;
+    };
+    static MessageStream& GetThreadStream();
+    static void DeleteThreadStream(void* stream);
+
+    //! Lock-free multiple-producer single-consumer queue
+    static void Push(Message* message);
+    //! Next message, or NULL; only called by the logger thread.
+    static Message* Pop();
+
+    static void* LoggerThread(void*);
+    //! Writes, folds or drops message, and deletes it.
+    static void Handle(Message* message);
+    static void Write(const Message& message, const std::string& text);
+    //! Writes the counts of the repeats and dropped messages that are due.
+    static void WriteSummaries(const struct timeval& now, bool all);
+    static std::string FormatTime(const struct timeval& time);
+    static std::string QuoteJSON(const std::string& text);
+    static void ResetInChild();
+
+    struct Repeat {
+      struct timeval fWritten;
+      struct timeval fFirst;
+      struct timeval fLast;
+      size_t fCount;
+      Message* fMessage; //! as first written
+    };
+
+  protected:
+    static bool fgIsRunning;
+    static bool fgStop;
+    static EFormat fgFormat;
+    static size_t fgMaxRate;
+    static size_t fgMaxQueued;
+    static pthread_t fgThread;
+    static pthread_key_t fgStreamKey;
+    static int fgPid;
+
+    /* queue */
+    static Message* fgHead;
+    static Message* fgTail;
+    static Message fgStub;
+    static size_t fgNQueued;
+    static size_t fgNDroppedQueued;
+
+    /* owned by the logger thread */
+    static std::map<std::string, Repeat> fgRepeats;
+    static long fgRateSecond;
+    static size_t fgNWrittenThisSecond;
+    static size_t fgNDroppedRate;
+};
+
+#endif /* __CINT__ */
+#endif /* _ORLogSink_hh_ */
@@ -1,6 +1,7 @@
 // ORLogger.cc
 
 #include "ORLogger.hh"
+#include "ORLogSink.hh"
 
 #include <sstream>
 #include "TSystem.h"
@@ -21,24 +22,31 @@ bool ORLogger::fgIsInitialized = false;
 std::map<pthread_t, std::pair<ORLogger::ESeverity, std::ostream*> > ORLogger::fgLoggerMap;
 ORReadWriteLock ORLogger::fgRWLock;
 
+unsigned int ORLogger::fgGeneration = 1;
+__thread ORLogger::ThreadCache ORLogger::fgThreadCache = { ORLogger::kRoutine, NULL, 0 };
+
 std::ostream& ORLogger::msg(pthread_t thread, ORLogger::ESeverity severity, const char* location)
 {
   std::ostream* theThreadStream;
   ORLogger::ESeverity theThreadSeverity;
 
-  /* critical part */
-  fgRWLock.readLock();
-  std::map<pthread_t, std::pair<ORLogger::ESeverity, std::ostream* > >::iterator anIter = fgLoggerMap.find(thread);
-  if (anIter != fgLoggerMap.end()) {
-    theThreadStream = anIter->second.second;
-    theThreadSeverity = anIter->second.first;
-    fgRWLock.unlock();
+  if (pthread_equal(thread, pthread_self())) {
+    /* no lock needed for the calling thread */
+    const ThreadCache& theCache = GetThreadCache();
+    theThreadStream = theCache.fStream;
+    theThreadSeverity = theCache.fSeverity;
   } else {
-    fgRWLock.unlock();
-    theThreadSeverity = ORLogger::kRoutine;
-    theThreadStream = GetORLoggerOStream(thread); 
+    LookUp(thread, theThreadSeverity, theThreadStream);
+  }
+  if (severity >= theThreadSeverity && theThreadStream != fgMyNullstream &&
+      ORLogSink::IsRunning()) {
+    std::ostream& theSinkStream = ORLogSink::Begin(severity, location, theThreadStream);
+    if (severity == kFatal) {
+      theSinkStream << std::endl;
+      pthread_exit((void *) 0);
+    }
+    return theSinkStream;
   }
-  /* end critical part. */
   if (severity >= theThreadSeverity) {
     *theThreadStream << toString(severity) << ": " << "(pid: " << gSystem->GetPid() << "): " << location << ": ";
   } else {
@@ -54,61 +62,58 @@ std::ostream& ORLogger::msg(pthread_t thread, ORLogger::ESeverity severity, cons
   return *theThreadStream;
 }
 
-std::ostream* ORLogger::GetORLoggerOStream(pthread_t thread) 
+void ORLogger::UpdateThreadCache()
 {
-  std::ostream* theThreadStream;
+  /* Read the generation first: if it changes during the look-up, the cache
+     is refreshed again on the next call. */
+  unsigned int theGeneration = __atomic_load_n(&fgGeneration, __ATOMIC_ACQUIRE);
+  LookUp(pthread_self(), fgThreadCache.fSeverity, fgThreadCache.fStream);
+  fgThreadCache.fGeneration = theGeneration;
+}
+
+void ORLogger::LookUp(pthread_t thread, ORLogger::ESeverity& severity, std::ostream*& aStream)
+{
+  /* critical part */
   fgRWLock.readLock();
   std::map<pthread_t, std::pair<ORLogger::ESeverity, std::ostream* > >::iterator anIter = fgLoggerMap.find(thread);
-
   if ( anIter != fgLoggerMap.end() ) {
-    theThreadStream = anIter->second.second; 
-    fgRWLock.unlock();
-  } else {
-    /* Insert with default severity, ostream. */ 
-    fgRWLock.unlock();
-    fgRWLock.writeLock();
-    if (fgLoggerMap.size() > 0) {
-      /* If the map already has one, then the others get /dev/null */
-      fgLoggerMap.insert(
-        std::pair< pthread_t, std::pair<ORLogger::ESeverity, std::ostream*> >(thread, 
-        std::pair<ORLogger::ESeverity, std::ostream*>(ORLogger::kRoutine, fgMyNullstream)));
-      theThreadStream = fgMyNullstream;
-    } else {
-      fgLoggerMap.insert(
-        std::pair< pthread_t, std::pair<ORLogger::ESeverity, std::ostream*> >(thread, 
-        std::pair<ORLogger::ESeverity, std::ostream*>(ORLogger::kRoutine, fgMyOstream)));
-      theThreadStream = fgMyOstream;
-    }
+    severity = anIter->second.first; 
+    aStream = anIter->second.second; 
     fgRWLock.unlock();
+    return;
   } 
+  fgRWLock.unlock();
+
+  /* Insert with default severity, ostream. */ 
+  fgRWLock.writeLock();
+  anIter = fgLoggerMap.find(thread);
+  if ( anIter == fgLoggerMap.end() ) {
+    /* If the map already has one, then the others get /dev/null */
+    std::ostream* theStream = (fgLoggerMap.size() > 0) ? fgMyNullstream : fgMyOstream;
+    anIter = fgLoggerMap.insert(
+      std::pair< pthread_t, std::pair<ORLogger::ESeverity, std::ostream*> >(thread, 
+      std::pair<ORLogger::ESeverity, std::ostream*>(ORLogger::kRoutine, theStream))).first;
+  }
+  severity = anIter->second.first; 
+  aStream = anIter->second.second; 
+  fgRWLock.unlock();
+  /* end critical part. */
+}
+
+std::ostream* ORLogger::GetORLoggerOStream(pthread_t thread) 
+{
+  ORLogger::ESeverity theSeverity;
+  std::ostream* theThreadStream;
+  LookUp(thread, theSeverity, theThreadStream);
   return theThreadStream;
 }
 
 ORLogger::ESeverity ORLogger::GetORLoggerSeverity(pthread_t thread) 
 {
+  if (pthread_equal(thread, pthread_self())) return GetORLoggerSeverity();
   ORLogger::ESeverity theSeverity;
-  fgRWLock.readLock();
-  std::map<pthread_t, std::pair<ORLogger::ESeverity, std::ostream* > >::iterator anIter = fgLoggerMap.find(thread);
-  if ( anIter != fgLoggerMap.end() ) {
-    theSeverity = anIter->second.first; 
-    fgRWLock.unlock();
-  } else {
-    /* Insert with default severity, ostream. */ 
-    fgRWLock.unlock();
-    fgRWLock.writeLock();
-    if (fgLoggerMap.size() > 0) {
-      /* If the map already has one, then the others get /dev/null */
-      fgLoggerMap.insert(
-        std::pair< pthread_t, std::pair<ORLogger::ESeverity, std::ostream*> >(thread, 
-        std::pair<ORLogger::ESeverity, std::ostream*>(ORLogger::kRoutine, fgMyNullstream)));
-    } else {
-      fgLoggerMap.insert(
-        std::pair< pthread_t, std::pair<ORLogger::ESeverity, std::ostream*> >(thread, 
-        std::pair<ORLogger::ESeverity, std::ostream*>(ORLogger::kRoutine, fgMyOstream)));
-    }
-    fgRWLock.unlock();
-    theSeverity = ORLogger::kRoutine;
-  } 
+  std::ostream* theThreadStream;
+  LookUp(thread, theSeverity, theThreadStream);
   return theSeverity;
 }
 
@@ -125,6 +130,7 @@ void ORLogger::SetORLoggerOStream(pthread_t thread, std::ostream* aStream)
       std::pair< pthread_t, std::pair<ORLogger::ESeverity, std::ostream*> >(thread, 
       std::pair<ORLogger::ESeverity, std::ostream*>(ORLogger::kRoutine, aStream)));
   }
+  NewGeneration();
   fgRWLock.unlock();
 }
 
@@ -148,6 +154,7 @@ void ORLogger::SetORLoggerSeverity(pthread_t thread, ORLogger::ESeverity severit
         std::pair<ORLogger::ESeverity, std::ostream*>(severity, fgMyOstream)));
     }
   }
+  NewGeneration();
   fgRWLock.unlock();
 }
 
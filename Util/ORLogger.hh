@@ -17,11 +17,21 @@ typedef struct { private: char x[SIZEOF_PTHREAD_T]; } pthread_t;
 #ifdef ORLog
 #undef ORLog
 #endif
-#define ORLog(sev) ORLogger::msg( pthread_self(), ORLogger::sev, __FILE__ "(" ERRLINE_HACK_2(__LINE__) ")" )
-#define GetSeverity()     GetORLoggerSeverity( pthread_self() )
+/* The message is only put together if sev is enabled for this thread; an
+   expression rather than an if, so that it can be the body of an if. */
+#define ORLog(sev) !ORLogger::IsEnabled(ORLogger::sev) ? (void) 0 : \
+  ORLogger::Voidify() & \
+  ORLogger::msg( pthread_self(), ORLogger::sev, __FILE__ "(" ERRLINE_HACK_2(__LINE__) ")" )
+#define GetSeverity()     GetORLoggerSeverity()
 #define SetSeverity(sev)  SetORLoggerSeverity( pthread_self() , sev )
 #define SetOStream(str)   SetORLoggerOStream( pthread_self(), str)
 
+/* Messages below this severity are compiled out, e.g. with
+   -DORLOGGER_MIN_SEVERITY=kRoutine */
+#ifndef ORLOGGER_MIN_SEVERITY
+#define ORLOGGER_MIN_SEVERITY kDebug
+#endif
+
 #ifndef _ORReadWriteLock_hh
 #include "ORReadWriteLock.hh"
 #endif
@@ -46,6 +56,15 @@ typedef struct { private: char x[SIZEOF_PTHREAD_T]; } pthread_t;
     and all other threads will be piped to null output.  To avoid this, call
     ORLogger::SetOStream in each thread with a unique ostream for 
     each thread.   
+
+    Each thread keeps a copy of its severity and ostream, so checking
+    whether a message is enabled takes no lock.  The copy is refreshed when
+    a severity or ostream was set since it was made.  The arguments of
+    ORLog are not evaluated at all when its severity is disabled, so 
+    per-record debug output costs next to nothing in normal running.
+
+    With ORLogSink running, messages are written by a thread of its own
+    instead of by the thread logging them.
  */
 class ORLogger 
 {
@@ -70,6 +89,22 @@ class ORLogger
     enum ESeverity { kDebug, kTrace, kRoutine, kWarning, kError, kFatal };
 
 #ifndef __CINT__
+    //! Turns the stream of ORLog into the void of the other branch.
+    struct Voidify { void operator&(std::ostream&) {} };
+
+    //! True if messages of severity are printed in the calling thread.
+    static inline bool IsEnabled(ESeverity severity)
+    { 
+      return severity >= ORLOGGER_MIN_SEVERITY && 
+        severity >= GetThreadCache().fSeverity; 
+    }
+    //! Severity of the calling thread
+    static inline ESeverity GetORLoggerSeverity()
+    {
+      ESeverity severity = GetThreadCache().fSeverity;
+      return (severity < ORLOGGER_MIN_SEVERITY) ? 
+        ORLOGGER_MIN_SEVERITY : severity;
+    }
     static ESeverity GetORLoggerSeverity(pthread_t thread);
     static std::ostream& msg(pthread_t thread, ESeverity severity, 
       const char* location);
@@ -84,7 +119,31 @@ class ORLogger
     ~ORLogger() {}
     static std::ostream* GetORLoggerOStream(pthread_t thread);
 
+#ifndef __CINT__
+    struct ThreadCache {
+      ESeverity fSeverity;
+      std::ostream* fStream;
+      unsigned int fGeneration;
+    };
+    static inline const ThreadCache& GetThreadCache()
+    {
+      if (fgThreadCache.fGeneration != 
+          __atomic_load_n(&fgGeneration, __ATOMIC_ACQUIRE)) {
+        UpdateThreadCache();
+      }
+      return fgThreadCache;
+    }
+    static void UpdateThreadCache();
+    //! Severity and ostream of thread; adds the defaults if it has none
+    static void LookUp(pthread_t thread, ESeverity& severity, 
+      std::ostream*& aStream);
+    //! Makes every thread refresh its cache; call with the write lock held
+    static void NewGeneration() 
+    { __atomic_add_fetch(&fgGeneration, 1, __ATOMIC_RELEASE); }
+#endif
+
   private:
+    friend class ORLogSink;
     static bool fgIsInitialized;
     static std::string toString(ESeverity);
 
@@ -93,6 +152,10 @@ class ORLogger
 
     static std::map<pthread_t, std::pair<ESeverity, std::ostream*> > fgLoggerMap; //!
     static ORReadWriteLock fgRWLock; //!
+#ifndef __CINT__
+    static unsigned int fgGeneration; //!
+    static __thread ThreadCache fgThreadCache; //!
+#endif
 };
 
 #endif
@@ -0,0 +1,251 @@
+// ORPlistParser.cc
+
+#include "ORPlistParser.hh"
+#include "ORLogger.hh"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include "TString.h"
+
+ORPlistParser::ORPlistParser() :
+  fBegin(NULL), fPos(NULL), fEnd(NULL)
+{
+}
+
+bool ORPlistParser::Tag::Is(const char* name) const
+{
+  return strncmp(fName, name, fLength) == 0 && name[fLength] == '\0';
+}
+
+bool ORPlistParser::Fail(const std::string& reason)
+{
+  size_t line = 1;
+  for (const char* p = fBegin; p < fPos && p < fEnd; p++) if (*p == '\n') line++;
+  fError = ::Form("Parse(): %s at line %d", reason.c_str(), (int) line);
+  return false;
+}
+
+bool ORPlistParser::SkipPast(const char* end)
+{
+  size_t length = strlen(end);
+  for (; fPos + length <= fEnd; fPos++) {
+    if (memcmp(fPos, end, length) == 0) {
+      fPos += length;
+      return true;
+    }
+  }
+  fPos = fEnd;
+  return Fail(std::string("missing ") + end);
+}
+
+bool ORPlistParser::NextTag(Tag& tag)
+{
+  while (true) {
+    fPos = (const char*) memchr(fPos, '<', fEnd - fPos);
+    if (fPos == NULL) {
+      fPos = fEnd;
+      return Fail("unexpected end of plist");
+    }
+    size_t left = fEnd - fPos;
+    if (left >= 4 && memcmp(fPos, "<!--", 4) == 0) {
+      if (!SkipPast("-->")) return false;
+    }
+    else if (left >= 2 && fPos[1] == '?') {
+      if (!SkipPast("?>")) return false;
+    }
+    else if (left >= 2 && fPos[1] == '!') {
+      // <!DOCTYPE ...>, which may have declarations in [...]
+      int depth = 0;
+      for (fPos += 2; fPos < fEnd && (*fPos != '>' || depth > 0); fPos++) {
+        if (*fPos == '[') depth++;
+        else if (*fPos == ']') depth--;
+      }
+      if (fPos == fEnd) return Fail("unterminated declaration");
+      fPos++;
+    }
+    else break;
+  }
+
+  fPos++;
+  tag.fIsEnd = (fPos < fEnd && *fPos == '/');
+  if (tag.fIsEnd) fPos++;
+  tag.fName = fPos;
+  while (fPos < fEnd && *fPos != '>' && *fPos != '/' && !isspace((unsigned char) *fPos)) fPos++;
+  tag.fLength = fPos - tag.fName;
+  // skip the attributes
+  char quote = 0;
+  for (; fPos < fEnd && (quote || *fPos != '>'); fPos++) {
+    if (quote) { if (*fPos == quote) quote = 0; }
+    else if (*fPos == '"' || *fPos == '\'') quote = *fPos;
+  }
+  if (fPos == fEnd || tag.fLength == 0) return Fail("malformed tag");
+  tag.fIsEmpty = (fPos[-1] == '/');
+  fPos++;
+  return true;
+}
+
+bool ORPlistParser::ReadText(const Tag& tag)
+{
+  fText.clear();
+  if (tag.fIsEmpty) return true;
+  while (true) {
+    const char* start = fPos;
+    while (fPos < fEnd && *fPos != '<' && *fPos != '&') fPos++;
+    fText.append(start, fPos - start);
+    if (fPos == fEnd) return Fail("unexpected end of plist");
+
+    if (*fPos == '&') {
+      const char* semicolon = (const char*) memchr(fPos, ';', std::min<size_t>(fEnd - fPos, 12));
+      if (semicolon == NULL) return Fail("malformed character reference");
+      std::string name(fPos + 1, semicolon);
+      fPos = semicolon + 1;
+      if (name == "lt") fText += '<';
+      else if (name == "gt") fText += '>';
+      else if (name == "amp") fText += '&';
+      else if (name == "quot") fText += '"';
+      else if (name == "apos") fText += '\'';
+      else if (name.size() > 1 && name[0] == '#') {
+        unsigned long c = (name[1] == 'x') ? strtoul(name.c_str() + 2, NULL, 16)
+                                           : strtoul(name.c_str() + 1, NULL, 10);
+        // as UTF-8
+        if (c < 0x80) fText += char(c);
+        else if (c < 0x800) {
+          fText += char(0xc0 | (c >> 6));
+          fText += char(0x80 | (c & 0x3f));
+        }
+        else if (c < 0x10000) {
+          fText += char(0xe0 | (c >> 12));
+          fText += char(0x80 | ((c >> 6) & 0x3f));
+          fText += char(0x80 | (c & 0x3f));
+        }
+        else {
+          fText += char(0xf0 | ((c >> 18) & 0x07));
+          fText += char(0x80 | ((c >> 12) & 0x3f));
+          fText += char(0x80 | ((c >> 6) & 0x3f));
+          fText += char(0x80 | (c & 0x3f));
+        }
+      }
+      else return Fail("unknown entity &" + name + ";");
+      continue;
+    }
+
+    size_t left = fEnd - fPos;
+    if (left >= 9 && memcmp(fPos, "<![CDATA[", 9) == 0) {
+      const char* start = fPos + 9;
+      if (!SkipPast("]]>")) return false;
+      fText.append(start, fPos - 3 - start);
+      continue;
+    }
+    if (left >= 4 && memcmp(fPos, "<!--", 4) == 0) {
+      if (!SkipPast("-->")) return false;
+      continue;
+    }
+    Tag end;
+    if (!NextTag(end)) return false;
+    if (!end.fIsEnd || end.fLength != tag.fLength ||
+        strncmp(end.fName, tag.fName, tag.fLength) != 0) {
+      return Fail("unexpected element in <" + std::string(tag.fName, tag.fLength) + ">");
+    }
+    return true;
+  }
+}
+
+bool ORPlistParser::Parse(const char* buffer, size_t length, ORDictionary* dictionary)
+{
+  fBegin = fPos = buffer;
+  fEnd = buffer + length;
+  fError = "";
+
+  Tag tag;
+  if (!NextTag(tag)) return false;
+  if (tag.fIsEnd || !tag.Is("plist")) return Fail("root node was not a plist");
+  if (!NextTag(tag)) return false;
+  if (tag.fIsEnd || !tag.Is("dict")) return Fail("couldn't find root dictionary");
+  if (tag.fIsEmpty) return true;
+  return LoadDictionary(dictionary);
+}
+
+bool ORPlistParser::LoadDictionary(ORDictionary* dictionary)
+{
+  Tag tag;
+  while (true) {
+    if (!NextTag(tag)) return false;
+    if (tag.fIsEnd) {
+      if (!tag.Is("dict")) return Fail("mismatched </" + std::string(tag.fName, tag.fLength) + ">");
+      return true;
+    }
+    if (!tag.Is("key")) return Fail("expected <key> in <dict>");
+    if (!ReadText(tag)) return false;
+    std::string key = fText;
+    if (!NextTag(tag)) return false;
+    if (tag.fIsEnd) return Fail("no value for key " + key);
+    ORVDictValue* value = LoadValue(tag, key);
+    if (value == NULL && fError != "") return false;
+    dictionary->LoadEntry(key, value);
+  }
+}
+
+bool ORPlistParser::LoadArray(ORDictValueA* array)
+{
+  Tag tag;
+  while (true) {
+    if (!NextTag(tag)) return false;
+    if (tag.fIsEnd) {
+      if (!tag.Is("array")) return Fail("mismatched </" + std::string(tag.fName, tag.fLength) + ">");
+      return true;
+    }
+    ORVDictValue* value = LoadValue(tag, "");
+    if (value == NULL && fError != "") return false;
+    array->LoadValue(value);
+  }
+}
+
+ORVDictValue* ORPlistParser::LoadValue(const Tag& tag, const std::string& name)
+{
+  if (tag.Is("dict")) {
+    ORDictionary* dictionary = new ORDictionary(name);
+    if (!tag.fIsEmpty && !LoadDictionary(dictionary)) {
+      delete dictionary;
+      return NULL;
+    }
+    return dictionary;
+  }
+  if (tag.Is("array")) {
+    ORDictValueA* array = new ORDictValueA(name);
+    if (!tag.fIsEmpty && !LoadArray(array)) {
+      delete array;
+      return NULL;
+    }
+    return array;
+  }
+  if (tag.Is("true") || tag.Is("false")) {
+    if (!ReadText(tag)) return NULL;
+    return new ORDictValueB(tag.Is("true"));
+  }
+
+  if (tag.Is("string")) {
+    if (!ReadText(tag)) return NULL;
+    return new ORDictValueS(fText);
+  }
+  if (tag.Is("integer")) {
+    if (!ReadText(tag)) return NULL;
+    return new ORDictValueI((int) strtol(fText.c_str(), NULL, 10));
+  }
+  if (tag.Is("real")) {
+    if (!ReadText(tag)) return NULL;
+    return new ORDictValueR(strtod(fText.c_str(), NULL));
+  }
+
+  std::string type(tag.fName, tag.fLength);
+  ORLog(kWarning) << "Parse(): unsupported value type " << type << " with name "
+                  << name << std::endl;
+  // skip the element and whatever is in it; it is loaded as NULL
+  Tag inner;
+  for (int depth = tag.fIsEmpty ? 0 : 1; depth > 0; ) {
+    if (!NextTag(inner)) return NULL;
+    if (inner.fIsEnd) depth--;
+    else if (!inner.fIsEmpty) depth++;
+  }
+  return NULL;
+}
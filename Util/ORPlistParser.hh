@@ -0,0 +1,76 @@
+// ORPlistParser.hh
+
+#ifndef _ORPlistParser_hh_
+#define _ORPlistParser_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <string>
+#include "ORDictionary.hh"
+
+//! Single pass parser of xml plists into an ORDictionary
+/*!
+   Reads the buffer once, from the start to the end, and builds the
+   dictionary as it goes, without a DOM tree or a string per xml node.
+   It understands what Orca writes into plists: the elements dict, key,
+   array, string, integer, real, true and false, comments, CDATA sections
+   and the xml character references.  Other elements (date, data) are
+   loaded as NULL entries with a warning, as ORXmlPlist does, so that the
+   elements after them in an array keep their indices.  It does not
+   validate the plist against its DTD; use ORXmlPlist::ValidateXML() for
+   that.  Usage:
+
+   \verbatim
+   ORPlistParser parser;
+   ORDictionary dictionary("rootDict");
+   if (!parser.Parse(buffer, length, &dictionary)) {
+     ORLog(kError) << parser.GetError() << std::endl;
+   }
+   \endverbatim
+ */
+class ORPlistParser
+{
+  public:
+    ORPlistParser();
+    virtual ~ORPlistParser() {}
+
+    /*!
+       Loads the root dictionary of the plist in buffer into dictionary.
+       Returns false if the buffer is not a well formed plist, with the
+       reason and line in GetError().
+     */
+    virtual bool Parse(const char* buffer, size_t length, ORDictionary* dictionary);
+    virtual const std::string& GetError() const { return fError; }
+
+  protected:
+    //! An element tag; fName points into the buffer.
+    struct Tag {
+      const char* fName;
+      size_t fLength;
+      bool fIsEnd;   //! </name>
+      bool fIsEmpty; //! <name/>
+      bool Is(const char* name) const;
+    };
+
+    //! Reads the next tag, skipping text, comments and declarations.
+    bool NextTag(Tag& tag);
+    //! Reads the text of element tag up to its end tag into fText.
+    bool ReadText(const Tag& tag);
+    bool LoadDictionary(ORDictionary* dictionary);
+    bool LoadArray(ORDictValueA* array);
+    //! Returns the value of element tag, or NULL after an error (see
+    //! GetError()) or for an element of an unsupported type.
+    ORVDictValue* LoadValue(const Tag& tag, const std::string& name);
+    bool SkipPast(const char* end);
+    bool Fail(const std::string& reason);
+
+  protected:
+    const char* fBegin;
+    const char* fPos;
+    const char* fEnd;
+    std::string fText;
+    std::string fError;
+};
+
+#endif /* __CINT__ */
+#endif /* _ORPlistParser_hh_ */
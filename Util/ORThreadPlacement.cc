@@ -0,0 +1,351 @@
+// ORThreadPlacement.cc
+
+#include "ORThreadPlacement.hh"
+
+#include "ORLogger.hh"
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <limits.h>
+#include <sstream>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <ifaddrs.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#endif
+
+using namespace std;
+
+vector<int> ORThreadPlacement::fCPUs[ORThreadPlacement::kNRoles];
+int ORThreadPlacement::fNode[ORThreadPlacement::kNRoles] = { -1, -1, -1, -1 };
+bool ORThreadPlacement::fIsLocal[ORThreadPlacement::kNRoles] = { false, false, false, false };
+int ORThreadPlacement::fLocalNode = -1;
+
+static const char* gRoleNames[ORThreadPlacement::kNRoles] =
+  { "reader", "worker", "writer", "handler" };
+
+bool ORThreadPlacement::SetPlacement(ERole role, const string& placement)
+{
+  vector<int> cpus;
+  int node = -1;
+  bool isLocal = false;
+  if (placement == "local") {
+    isLocal = true;
+    node = fLocalNode;
+    if (node >= 0) cpus = GetCPUsOfNode(node);
+    // unknown or unusable, the threads simply aren't pinned
+    KeepAllowedCPUs(role, cpus);
+  }
+  else if (placement.compare(0, 4, "node") == 0) {
+    char* end = NULL;
+    node = strtol(placement.c_str() + 4, &end, 10);
+    if (placement.size() == 4 || *end != '\0' || node < 0) return false;
+    cpus = GetCPUsOfNode(node);
+    if (cpus.empty()) {
+      ORLog(kError) << "There is no NUMA node " << node << endl;
+      return false;
+    }
+    if (!KeepAllowedCPUs(role, cpus)) return false;
+  }
+  else if (placement != "" && placement != "none") {
+    if (!ParseCPUList(placement, cpus) || !KeepAllowedCPUs(role, cpus)) return false;
+    // the memory goes with the first CPU
+    node = GetNodeOfCPU(cpus[0]);
+    for (size_t i = 1; i < cpus.size() && node >= 0; i++) {
+      if (GetNodeOfCPU(cpus[i]) != node) {
+        ORLog(kWarning) << "The " << gRoleNames[role] << " CPUs " << placement
+                        << " are on more than one NUMA node" << endl;
+        break;
+      }
+    }
+  }
+#ifndef __linux__
+  if (!cpus.empty() || isLocal) {
+    ORLog(kWarning) << "Threads can't be pinned on this platform" << endl;
+    cpus.clear();
+  }
+#endif
+  fCPUs[role] = cpus;
+  fNode[role] = node;
+  fIsLocal[role] = isLocal;
+  return true;
+}
+
+bool ORThreadPlacement::SetPlacement(const string& roleAndPlacement)
+{
+  size_t iEquals = roleAndPlacement.find("=");
+  if (iEquals == string::npos) return false;
+  string roleName = roleAndPlacement.substr(0, iEquals);
+  for (int role = 0; role < kNRoles; role++) {
+    if (roleName == gRoleNames[role]) {
+      return SetPlacement((ERole) role, roleAndPlacement.substr(iEquals + 1));
+    }
+  }
+  return false;
+}
+
+bool ORThreadPlacement::HasLocalPlacement()
+{
+  for (int role = 0; role < kNRoles; role++) {
+    if (fIsLocal[role]) return true;
+  }
+  return false;
+}
+
+void ORThreadPlacement::SetLocalNode(int node)
+{
+  fLocalNode = node;
+  for (int role = 0; role < kNRoles; role++) {
+    if (fIsLocal[role]) SetPlacement((ERole) role, "local");
+  }
+}
+
+const vector<int>& ORThreadPlacement::GetCPUs(ERole role)
+{
+  return fCPUs[role];
+}
+
+int ORThreadPlacement::GetNode(ERole role)
+{
+  return fCPUs[role].empty() ? -1 : fNode[role];
+}
+
+const char* ORThreadPlacement::GetRoleName(ERole role)
+{
+  return gRoleNames[role];
+}
+
+bool ORThreadPlacement::SetUpAttributes(pthread_attr_t& attributes, ERole role,
+                                        size_t iThread)
+{
+  if (fCPUs[role].empty()) return false;
+#ifdef __linux__
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  if (role == kWorker) CPU_SET(fCPUs[role][iThread % fCPUs[role].size()], &cpuSet);
+  else {
+    for (size_t i = 0; i < fCPUs[role].size(); i++) CPU_SET(fCPUs[role][i], &cpuSet);
+  }
+  if (pthread_attr_setaffinity_np(&attributes, sizeof(cpuSet), &cpuSet) != 0) {
+    ORLog(kWarning) << "Could not pin the " << gRoleNames[role] << " thread" << endl;
+    return false;
+  }
+  ORLog(kDebug) << "Starting " << gRoleNames[role] << " thread " << iThread << " on CPU(s) "
+                << ((role == kWorker) ? FormatCPUList(vector<int>(1, fCPUs[role][iThread % fCPUs[role].size()])) :
+                                        FormatCPUList(fCPUs[role]))
+                << endl;
+  return true;
+#else
+  return false;
+#endif
+}
+
+int ORThreadPlacement::CreateThread(pthread_t* thread, ERole role, size_t iThread,
+                                    void* (*function)(void*), void* argument)
+{
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  bool isPinned = SetUpAttributes(attributes, role, iThread);
+  int retCode = pthread_create(thread, &attributes, function, argument);
+  pthread_attr_destroy(&attributes);
+  if (retCode != 0 && isPinned) {
+    ORLog(kWarning) << "Could not start the pinned " << gRoleNames[role] << " thread "
+                    << iThread << ": " << strerror(retCode) << "; not pinning it" << endl;
+    retCode = pthread_create(thread, NULL, function, argument);
+  }
+  return retCode;
+}
+
+void ORThreadPlacement::BindMemory(void* start, size_t nBytes, ERole role)
+{
+#ifdef __linux__
+  int node = GetNode(role);
+  if (node < 0 || start == NULL || nBytes == 0) return;
+  // mbind() takes whole pages: bind those that lie entirely in the region
+  size_t pageSize = sysconf(_SC_PAGESIZE);
+  size_t first = ((size_t) start + pageSize - 1)/pageSize*pageSize;
+  size_t end = ((size_t) start + nBytes)/pageSize*pageSize;
+  if (end <= first) return;
+  const int kPreferred = 1;   // MPOL_PREFERRED
+  const int kMove = 1 << 1;   // MPOL_MF_MOVE
+  const size_t kBitsPerMask = 8*sizeof(unsigned long);
+  vector<unsigned long> nodeMask(node/kBitsPerMask + 1, 0);
+  nodeMask[node/kBitsPerMask] |= 1UL << (node % kBitsPerMask);
+  if (syscall(SYS_mbind, first, end - first, kPreferred, &nodeMask[0],
+              nodeMask.size()*kBitsPerMask + 1, kMove) != 0) {
+    ORLog(kDebug) << "Could not bind " << nBytes << " bytes to node " << node
+                  << ": " << strerror(errno) << endl;
+  }
+#endif
+}
+
+int ORThreadPlacement::GetNodeOfFile(const string& fileName)
+{
+  struct stat attrib;
+  if (stat(fileName.c_str(), &attrib) != 0) return -1;
+#ifdef __linux__
+  ostringstream path;
+  path << "/sys/dev/block/" << major(attrib.st_dev) << ":" << minor(attrib.st_dev);
+  return GetNodeOfDevice(path.str());
+#else
+  return -1;
+#endif
+}
+
+int ORThreadPlacement::GetNodeOfSocket(int socketDescriptor)
+{
+  struct sockaddr_storage address;
+  socklen_t length = sizeof(address);
+  if (getsockname(socketDescriptor, (struct sockaddr*) &address, &length) != 0) return -1;
+  struct ifaddrs* interfaces = NULL;
+  if (getifaddrs(&interfaces) != 0) return -1;
+  string interfaceName = "";
+  for (struct ifaddrs* it = interfaces; it != NULL && interfaceName == ""; it = it->ifa_next) {
+    if (it->ifa_addr == NULL || it->ifa_addr->sa_family != address.ss_family) continue;
+    if (address.ss_family == AF_INET &&
+        ((struct sockaddr_in*) it->ifa_addr)->sin_addr.s_addr ==
+        ((struct sockaddr_in*) &address)->sin_addr.s_addr) {
+      interfaceName = it->ifa_name;
+    }
+    if (address.ss_family == AF_INET6 &&
+        memcmp(&((struct sockaddr_in6*) it->ifa_addr)->sin6_addr,
+               &((struct sockaddr_in6*) &address)->sin6_addr, sizeof(struct in6_addr)) == 0) {
+      interfaceName = it->ifa_name;
+    }
+  }
+  freeifaddrs(interfaces);
+  if (interfaceName == "") return -1;
+  return GetNodeOfDevice("/sys/class/net/" + interfaceName);
+}
+
+void ORThreadPlacement::LogPlacement()
+{
+  ostringstream placement;
+  for (int role = 0; role < kNRoles; role++) {
+    placement << endl << "  " << gRoleNames[role] << " threads: ";
+    if (fCPUs[role].empty()) {
+      placement << (fIsLocal[role] ? "not pinned (node of the input unknown)" : "not pinned");
+      continue;
+    }
+    placement << "CPU(s) " << FormatCPUList(fCPUs[role]);
+    if (fNode[role] >= 0) placement << " on node " << fNode[role];
+    if (fIsLocal[role]) placement << " (the node of the input)";
+  }
+  ORLog(kRoutine) << "Thread placement:" << placement.str() << endl;
+}
+
+bool ORThreadPlacement::ParseCPUList(const string& cpuList, vector<int>& cpus)
+{
+  // e.g. "0-3,8,10-11", as in /sys/devices/system/node/node0/cpulist
+  cpus.clear();
+  const char* next = cpuList.c_str();
+  while (*next != '\0' && *next != '\n') {
+    char* end = NULL;
+    long first = strtol(next, &end, 10);
+    if (end == next || first < 0) return false;
+    long last = first;
+    if (*end == '-') {
+      next = end + 1;
+      last = strtol(next, &end, 10);
+      if (end == next || last < first) return false;
+    }
+    for (long cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    if (*end == ',') end++;
+    else if (*end != '\0' && *end != '\n') return false;
+    next = end;
+  }
+  return !cpus.empty();
+}
+
+bool ORThreadPlacement::KeepAllowedCPUs(ERole role, vector<int>& cpus)
+{
+#ifdef __linux__
+  cpu_set_t allowed;
+  if (cpus.empty() || sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return true;
+  vector<int> kept;
+  vector<int> dropped;
+  for (size_t i = 0; i < cpus.size(); i++) {
+    if (cpus[i] < CPU_SETSIZE && CPU_ISSET(cpus[i], &allowed)) kept.push_back(cpus[i]);
+    else dropped.push_back(cpus[i]);
+  }
+  if (dropped.empty()) return true;
+  cpus = kept;
+  if (kept.empty()) {
+    ORLog(kError) << "None of the " << gRoleNames[role] << " CPUs " << FormatCPUList(dropped)
+                  << " are available to this process" << endl;
+    return false;
+  }
+  ORLog(kWarning) << "Leaving out the " << gRoleNames[role] << " CPUs " << FormatCPUList(dropped)
+                  << ", which aren't available to this process" << endl;
+#endif
+  return true;
+}
+
+string ORThreadPlacement::FormatCPUList(const vector<int>& cpus)
+{
+  ostringstream cpuList;
+  for (size_t i = 0; i < cpus.size(); i++) {
+    size_t iLast = i;
+    while (iLast + 1 < cpus.size() && cpus[iLast + 1] == cpus[iLast] + 1) iLast++;
+    if (i > 0) cpuList << ",";
+    cpuList << cpus[i];
+    if (iLast > i) cpuList << "-" << cpus[iLast];
+    i = iLast;
+  }
+  return cpuList.str();
+}
+
+vector<int> ORThreadPlacement::GetCPUsOfNode(int node)
+{
+  ostringstream path;
+  path << "/sys/devices/system/node/node" << node << "/cpulist";
+  ifstream file(path.str().c_str());
+  string cpuList;
+  vector<int> cpus;
+  if (file.is_open() && getline(file, cpuList)) ParseCPUList(cpuList, cpus);
+  return cpus;
+}
+
+int ORThreadPlacement::GetNodeOfCPU(int cpu)
+{
+  // the cpu directory has a link to its node
+  ostringstream path;
+  path << "/sys/devices/system/cpu/cpu" << cpu;
+  DIR* directory = opendir(path.str().c_str());
+  if (directory == NULL) return -1;
+  int node = -1;
+  while (struct dirent* entry = readdir(directory)) {
+    if (strncmp(entry->d_name, "node", 4) == 0 && isdigit(entry->d_name[4])) {
+      node = atoi(entry->d_name + 4);
+      break;
+    }
+  }
+  closedir(directory);
+  return node;
+}
+
+int ORThreadPlacement::GetNodeOfDevice(const string& sysfsPath)
+{
+  // e.g. /sys/devices/pci0000:00/0000:00:1d.0/0000:3d:00.0/nvme/nvme0/nvme0n1/nvme0n1p1:
+  // partitions and block devices have no node, the PCI device does
+  char resolved[PATH_MAX];
+  if (realpath(sysfsPath.c_str(), resolved) == NULL) return -1;
+  string path = resolved;
+  while (path.size() > 1 && path != "/sys/devices") {
+    ifstream file((path + "/numa_node").c_str());
+    int node = -1;
+    if (file >> node) return node;
+    path = path.substr(0, path.rfind("/"));
+  }
+  return -1;
+}
@@ -0,0 +1,107 @@
+// ORThreadPlacement.hh
+
+#ifndef _ORThreadPlacement_hh_
+#define _ORThreadPlacement_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+//! Where the threads of each kind run, and where their buffers live
+/*!
+   Threads are created with default attributes unless a placement was set
+   for their role, in which case they are pinned to its CPUs: the reader
+   threads (ORSocketReader, ORReadAheadBuffer) and the writer thread
+   (ORWriteBehindBuffer) to all of them, the worker threads
+   (ORStreamServer) each to one of them in turn.  The buffers that a
+   thread of the role fills are then bound to the NUMA node of its CPUs
+   with BindMemory().  A placement is a CPU list like "0-3,8", "node1" for
+   all CPUs of NUMA node 1, or "local" for those of the node of the device
+   the input comes from, set with SetLocalNode() (see GetNodeOfFile() and
+   GetNodeOfSocket()).  Usage:
+
+   \verbatim
+   ORThreadPlacement::SetPlacement("reader=local");
+   ORThreadPlacement::SetPlacement("worker=node1");
+   ORThreadPlacement::SetLocalNode(ORThreadPlacement::GetNodeOfFile(fileName));
+   ORThreadPlacement::LogPlacement();
+   ...
+   ORThreadPlacement::CreateThread(&thread, ORThreadPlacement::kWorker, iThread,
+                                   WorkerThread, this);
+   \endverbatim
+
+   Placements are set up before any threads are started, and only read
+   afterwards.  Only Linux is supported; elsewhere threads are not pinned.
+ */
+class ORThreadPlacement
+{
+  public:
+    enum ERole { kReader = 0, kWorker, kWriter, kHandler, kNRoles };
+
+    /*!
+       Sets the placement of the threads of role, e.g. "0-3,8", "node1" or
+       "local".  "" or "none" leaves them where the system puts them.
+       Returns false if placement can't be parsed.
+     */
+    static bool SetPlacement(ERole role, const std::string& placement);
+    //! Sets a placement given as role=placement, e.g. "worker=4-15".
+    static bool SetPlacement(const std::string& roleAndPlacement);
+    //! True if some role is to be placed on the local node.
+    static bool HasLocalPlacement();
+    /*!
+       Resolves the "local" placements to the CPUs of NUMA node node.
+       With node -1 (not known), those threads are not pinned.
+     */
+    static void SetLocalNode(int node);
+
+    //! The CPUs of role; empty if its threads are not pinned.
+    static const std::vector<int>& GetCPUs(ERole role);
+    //! The NUMA node of the CPUs of role, or -1 if unknown or not pinned.
+    static int GetNode(ERole role);
+    static const char* GetRoleName(ERole role);
+
+    /*!
+       Pins the threads created with attributes to the CPUs of role; a
+       worker thread to the iThread-th of them (modulo their number).
+       Returns false if threads of role are not pinned.
+     */
+    static bool SetUpAttributes(pthread_attr_t& attributes, ERole role,
+                                size_t iThread = 0);
+    //! pthread_create() with attributes set up for role.
+    static int CreateThread(pthread_t* thread, ERole role, size_t iThread,
+                            void* (*function)(void*), void* argument);
+    /*!
+       Asks for the pages of the nBytes at start to be on the node of role,
+       moving those already in use.  Only whole pages are bound.
+     */
+    static void BindMemory(void* start, size_t nBytes, ERole role);
+
+    //! NUMA node of the disk holding fileName, or -1 if unknown.
+    static int GetNodeOfFile(const std::string& fileName);
+    //! NUMA node of the network interface of a connected socket, or -1.
+    static int GetNodeOfSocket(int socketDescriptor);
+
+    //! Reports the placement of each role.
+    static void LogPlacement();
+
+  protected:
+    static bool ParseCPUList(const std::string& cpuList, std::vector<int>& cpus);
+    //! Drops the CPUs the process may not run on; false if none are left.
+    static bool KeepAllowedCPUs(ERole role, std::vector<int>& cpus);
+    static std::string FormatCPUList(const std::vector<int>& cpus);
+    static std::vector<int> GetCPUsOfNode(int node);
+    static int GetNodeOfCPU(int cpu);
+    //! Node of the device at sysfsPath or of the first parent that has one
+    static int GetNodeOfDevice(const std::string& sysfsPath);
+
+  protected:
+    static std::vector<int> fCPUs[kNRoles];
+    static int fNode[kNRoles];
+    static bool fIsLocal[kNRoles];
+    static int fLocalNode;
+};
+
+#endif /* __CINT__ */
+#endif /* _ORThreadPlacement_hh_ */
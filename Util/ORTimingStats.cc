@@ -0,0 +1,76 @@
+// ORTimingStats.cc
+
+#include "ORTimingStats.hh"
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "TString.h"
+
+static double gSecondsPerTick = 0;
+static pthread_once_t gCalibrateOnce = PTHREAD_ONCE_INIT;
+
+static double SecondsOf(const struct timespec& time)
+{
+  return time.tv_sec + 1.e-9*time.tv_nsec;
+}
+
+static void CalibrateTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  // count ticks over 20 ms of the clock
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ULong64_t startTicks = ORTimingStats::Now();
+  usleep(20000);
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  ULong64_t stopTicks = ORTimingStats::Now();
+  double seconds = SecondsOf(stop) - SecondsOf(start);
+  gSecondsPerTick = (stopTicks > startTicks) ? seconds/(stopTicks - startTicks) : 1.e-9;
+#else
+  gSecondsPerTick = 1.e-9;
+#endif
+}
+
+double ORTimingStats::GetSecondsPerTick()
+{
+  pthread_once(&gCalibrateOnce, CalibrateTicks);
+  return gSecondsPerTick;
+}
+
+void ORTimingStats::Reset()
+{
+  fNCalls = 0;
+  fTicks = 0;
+  memset(fHistogram, 0, sizeof(fHistogram));
+}
+
+ULong64_t ORTimingStats::LowEdgeOf(size_t bin)
+{
+  if (bin < kNSubBins) return bin;
+  size_t octave = bin/kNSubBins;
+  return ((ULong64_t) (kNSubBins + bin%kNSubBins)) << (octave - 2);
+}
+
+double ORTimingStats::GetPercentileSeconds(double fraction) const
+{
+  if (fNCalls == 0) return 0.;
+  ULong64_t nCalls = 0;
+  for (size_t bin = 0; bin < kNBins; bin++) {
+    nCalls += fHistogram[bin];
+    if (nCalls >= fraction*fNCalls) {
+      // the middle of the bin
+      ULong64_t low = LowEdgeOf(bin);
+      ULong64_t high = (bin + 1 < kNBins) ? LowEdgeOf(bin + 1) : low;
+      return 0.5*(low + high)*GetSecondsPerTick();
+    }
+  }
+  return LowEdgeOf(kNBins - 1)*GetSecondsPerTick();
+}
+
+std::string ORTimingStats::ToJSON() const
+{
+  return ::Form("\"calls\": %llu, \"seconds\": %.6g, \"p50\": %.3g, \"p90\": %.3g, \"p99\": %.3g",
+                (unsigned long long) fNCalls, GetSeconds(), GetPercentileSeconds(0.5),
+                GetPercentileSeconds(0.9), GetPercentileSeconds(0.99));
+}
@@ -0,0 +1,85 @@
+// ORTimingStats.hh
+
+#ifndef _ORTimingStats_hh_
+#define _ORTimingStats_hh_
+// This class can not have a dictionary made for it.
+
+#ifndef __CINT__
+#include <string>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "Rtypes.h"
+
+//! Call counts and a histogram of the durations of calls
+/*!
+   Durations are measured in ticks of the time stamp counter where there
+   is one (see Now()), which costs a few ns per reading, and in ns
+   elsewhere.  Add() only increments counters, so that timing each call
+   of a function is cheap.  The histogram has four bins per factor of
+   two, so percentiles are good to about 10%.
+
+   \verbatim
+   ULong64_t start = ORTimingStats::Now();
+   DoSomething();
+   stats.Add(ORTimingStats::Now() - start);
+   \endverbatim
+ */
+class ORTimingStats
+{
+  public:
+    ORTimingStats() { Reset(); }
+    virtual ~ORTimingStats() {}
+
+    //! Current time in ticks.
+    static inline ULong64_t Now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      return now.tv_sec*1000000000ULL + now.tv_nsec;
+#endif
+    }
+    //! Length of a tick, calibrated against the clock once.
+    static double GetSecondsPerTick();
+
+    virtual void Reset();
+    //! Counts nCalls calls that took ticks all together.
+    virtual inline void Add(ULong64_t ticks, ULong64_t nCalls = 1)
+    {
+      fNCalls += nCalls;
+      fTicks += ticks;
+      fHistogram[BinOf((nCalls > 1) ? ticks/nCalls : ticks)] += nCalls;
+    }
+
+    virtual ULong64_t GetNCalls() const { return fNCalls; }
+    virtual double GetSeconds() const { return fTicks*GetSecondsPerTick(); }
+    virtual double GetMeanSeconds() const
+      { return (fNCalls == 0) ? 0. : GetSeconds()/fNCalls; }
+    //! Duration of a call that fraction (0 to 1) of all calls took at most.
+    virtual double GetPercentileSeconds(double fraction) const;
+
+    //! The numbers as the members of a JSON object.
+    virtual std::string ToJSON() const;
+
+  protected:
+    enum { kNSubBins = 4, kNBins = 64*kNSubBins };
+    static inline size_t BinOf(ULong64_t ticks)
+    {
+      if (ticks < kNSubBins) return ticks;
+      size_t octave = 63 - __builtin_clzll(ticks);
+      return octave*kNSubBins + ((ticks >> (octave - 2)) & (kNSubBins - 1));
+    }
+    //! Smallest number of ticks in bin.
+    static ULong64_t LowEdgeOf(size_t bin);
+
+    ULong64_t fNCalls;
+    ULong64_t fTicks;
+    ULong64_t fHistogram[kNBins];
+};
+
+#endif /* __CINT__ */
+#endif /* _ORTimingStats_hh_ */
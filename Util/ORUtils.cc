@@ -0,0 +1,147 @@
+// ORUtils.cc
+
+#include "ORUtils.hh"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define ORUTILS_X86_SWAP
+#include <immintrin.h>
+#endif
+
+namespace ORUtils 
+{
+  typedef void (*SwapFunction)(const UInt_t* from, UInt_t* to, size_t nWords);
+
+  static void SwapScalar(const UInt_t* from, UInt_t* to, size_t nWords)
+  {
+    for (size_t i = 0; i < nWords; i++) {
+      UInt_t x = from[i];
+      to[i] = Swap(x);
+    }
+  }
+
+#ifdef ORUTILS_X86_SWAP
+  // pshufb reverses the bytes of each long word within 16-byte lanes
+  __attribute__((target("ssse3")))
+  static void SwapSSSE3(const UInt_t* from, UInt_t* to, size_t nWords)
+  {
+    const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 
+                                       11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for (; i + 4 <= nWords; i += 4) {
+      __m128i x = _mm_loadu_si128((const __m128i*) (from + i));
+      _mm_storeu_si128((__m128i*) (to + i), _mm_shuffle_epi8(x, mask));
+    }
+    SwapScalar(from + i, to + i, nWords - i);
+  }
+
+  __attribute__((target("avx2")))
+  static void SwapAVX2(const UInt_t* from, UInt_t* to, size_t nWords)
+  {
+    const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 
+                                          11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 
+                                          11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for (; i + 16 <= nWords; i += 16) {
+      __m256i x = _mm256_loadu_si256((const __m256i*) (from + i));
+      __m256i y = _mm256_loadu_si256((const __m256i*) (from + i + 8));
+      _mm256_storeu_si256((__m256i*) (to + i), _mm256_shuffle_epi8(x, mask));
+      _mm256_storeu_si256((__m256i*) (to + i + 8), _mm256_shuffle_epi8(y, mask));
+    }
+    for (; i + 8 <= nWords; i += 8) {
+      __m256i x = _mm256_loadu_si256((const __m256i*) (from + i));
+      _mm256_storeu_si256((__m256i*) (to + i), _mm256_shuffle_epi8(x, mask));
+    }
+    SwapScalar(from + i, to + i, nWords - i);
+  }
+
+  __attribute__((target("avx512f,avx512bw")))
+  static void SwapAVX512(const UInt_t* from, UInt_t* to, size_t nWords)
+  {
+    // bytes 3, 2, 1, 0, 7, 6, 5, 4, ... of each 128-bit lane
+    const __m512i mask = _mm512_set4_epi32(0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203);
+    size_t i = 0;
+    for (; i + 16 <= nWords; i += 16) {
+      __m512i x = _mm512_loadu_si512((const void*) (from + i));
+      _mm512_storeu_si512((void*) (to + i), _mm512_shuffle_epi8(x, mask));
+    }
+    // the rest with a masked load and store
+    if (i < nWords) {
+      __mmask16 rest = (__mmask16) ((1U << (nWords - i)) - 1);
+      __m512i x = _mm512_maskz_loadu_epi32(rest, from + i);
+      _mm512_mask_storeu_epi32(to + i, rest, _mm512_shuffle_epi8(x, mask));
+    }
+  }
+#endif
+
+  static const SwapFunction gSwapFunctions[kNSwapKernels] = {
+    SwapScalar,
+#ifdef ORUTILS_X86_SWAP
+    SwapSSSE3, SwapAVX2, SwapAVX512
+#else
+    SwapScalar, SwapScalar, SwapScalar
+#endif
+  };
+
+  bool IsSwapKernelSupported(ESwapKernel kernel)
+  {
+    switch (kernel) {
+      case kScalarSwap: return true;
+#ifdef ORUTILS_X86_SWAP
+      case kSSSE3Swap: 
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3");
+      case kAVX2Swap: 
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+      case kAVX512Swap: 
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+      default: return false;
+    }
+  }
+
+  static ESwapKernel ChooseSwapKernel()
+  {
+    /* AVX-512 is left to SetSwapKernel(): on many machines it lowers the
+       clock of the core for everyone, which costs more than it gains on
+       records of a few hundred bytes. */
+    if (IsSwapKernelSupported(kAVX2Swap)) return kAVX2Swap;
+    if (IsSwapKernelSupported(kSSSE3Swap)) return kSSSE3Swap;
+    return kScalarSwap;
+  }
+
+  /* Constant initialization, so that SwapBlock() works even if it is
+     called by static initializers that run before the kernel is chosen. */
+  static ESwapKernel gSwapKernel = kScalarSwap;
+  static SwapFunction gSwapFunction = SwapScalar;
+
+  ESwapKernel GetSwapKernel() { return gSwapKernel; }
+
+  const char* GetSwapKernelName(ESwapKernel kernel)
+  {
+    switch (kernel) {
+      case kScalarSwap: return "scalar";
+      case kSSSE3Swap: return "SSSE3";
+      case kAVX2Swap: return "AVX2";
+      case kAVX512Swap: return "AVX-512";
+      default: return "unknown";
+    }
+  }
+
+  bool SetSwapKernel(ESwapKernel kernel)
+  {
+    if (!IsSwapKernelSupported(kernel)) return false;
+    gSwapKernel = kernel;
+    gSwapFunction = gSwapFunctions[kernel];
+    return true;
+  }
+
+  static bool gSwapKernelIsChosen = SetSwapKernel(ChooseSwapKernel());
+
+  void SwapBlockWithKernel(const UInt_t* from, UInt_t* to, size_t nWords)
+  {
+    gSwapFunction(from, to, nWords);
+  }
+}
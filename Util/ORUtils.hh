@@ -39,6 +39,33 @@ namespace ORUtils
                   ((x & 0x00000000000000ffLL) << 56));
     }
 
+    //! Copies nWords long words from from to to, swapping them with the kernel.
+    void SwapBlockWithKernel(const UInt_t* from, UInt_t* to, size_t nWords);
+    /*!
+       Swaps the byte order of nWords long words, in place.  Blocks of 8
+       words and more are swapped by the fastest kernel the machine
+       supports (see GetSwapKernel()), chosen when the library is loaded;
+       shorter ones aren't worth the call.
+     */
+    inline void SwapBlock(UInt_t* words, size_t nWords)
+    {
+      if (nWords >= 8) SwapBlockWithKernel(words, words, nWords);
+      else for (size_t i = 0; i < nWords; i++) Swap(words[i]);
+    }
+    //! Copies nWords long words from from to to, swapping them on the way.
+    inline void SwapBlock(const UInt_t* from, UInt_t* to, size_t nWords)
+    {
+      if (nWords >= 8) SwapBlockWithKernel(from, to, nWords);
+      else for (size_t i = 0; i < nWords; i++) { to[i] = from[i]; Swap(to[i]); }
+    }
+
+    enum ESwapKernel { kScalarSwap, kSSSE3Swap, kAVX2Swap, kAVX512Swap, kNSwapKernels };
+    ESwapKernel GetSwapKernel();
+    const char* GetSwapKernelName(ESwapKernel kernel);
+    bool IsSwapKernelSupported(ESwapKernel kernel);
+    //! Makes SwapBlock() use kernel; returns false if the machine can't.
+    bool SetSwapKernel(ESwapKernel kernel);
+
     //Concatenates 32 bit high and low words to form a ULong64_t
     inline ULong64_t BitConcat(UInt_t lo, UInt_t hi)
     { 
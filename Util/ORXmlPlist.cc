@@ -5,6 +5,7 @@
 #include <fstream>
 #include <cstdlib>
 #include "ORLogger.hh"
+#include "ORPlistParser.hh"
 #include "TDOMParser.h"
 #include "TSocket.h"
 
@@ -12,6 +13,7 @@ ORXmlPlist::ORXmlPlist(const char* fullHeaderAsString, size_t lengthOfBuffer)
 { 
   fDictionary = NULL; 
   fDoValidate = false;
+  fUseDOMParser = false;
 
   if (fullHeaderAsString) LoadXmlPlist(fullHeaderAsString, lengthOfBuffer);
 }
@@ -53,7 +55,6 @@ bool ORXmlPlist::LoadXmlPlist(const char* fullHeaderAsString, size_t lengthOfBuf
   }
 
   ORLog(kDebug) << "LoadXmlPlist(): Parsing..." << std::endl;
-  TDOMParser domParser;
   if(!fDoValidate) {
       ORLog(kWarning) << "LoadXmlPlist(): xml plist validation is disabled.  "
                       << "If you are concerned about the integrity of your "
@@ -64,6 +65,37 @@ bool ORXmlPlist::LoadXmlPlist(const char* fullHeaderAsString, size_t lengthOfBuf
                       << "To use this option, you must be connected to the "
                       << "internet." << std::endl;
   }
+
+  bool isLoaded = false;
+  if(!fDoValidate && !fUseDOMParser) {
+    ORDictionary* dictionary = new ORDictionary("rootDict");
+    ORPlistParser parser;
+    isLoaded = parser.Parse(fullHeaderAsString, lengthOfBuffer, dictionary);
+    if(isLoaded) {
+      if (fDictionary != NULL) delete fDictionary;
+      fDictionary = dictionary; // deleted in deconstructor
+    }
+    else {
+      delete dictionary;
+      ORLog(kWarning) << "LoadXmlPlist(): " << parser.GetError() 
+                      << "; trying TDOMParser" << std::endl;
+    }
+  }
+  if(!isLoaded && !LoadWithDOMParser(fullHeaderAsString, lengthOfBuffer)) {
+    return false;
+  }
+
+  if(((size_t)fRawXML.Length()) != lengthOfBuffer) { 
+    //we have to copy to fRawXML.  Making sure we're not copying again.
+    fRawXML.Resize(lengthOfBuffer);
+  }
+  fRawXML.Replace(0, lengthOfBuffer, fullHeaderAsString, lengthOfBuffer);
+  return true;
+}
+
+bool ORXmlPlist::LoadWithDOMParser(const char* fullHeaderAsString, size_t lengthOfBuffer)
+{
+  TDOMParser domParser;
   domParser.SetValidate(fDoValidate);
   domParser.ParseBuffer(fullHeaderAsString, lengthOfBuffer);
   TXMLDocument* doc = domParser.GetXMLDocument();
@@ -72,11 +104,6 @@ bool ORXmlPlist::LoadXmlPlist(const char* fullHeaderAsString, size_t lengthOfBuf
                   << domParser.GetParseCode() << std::endl;
     return false;
   }
-  if(((size_t)fRawXML.Length()) != lengthOfBuffer) { 
-    //we have to copy to fRawXML.  Making sure we're not copying again.
-    fRawXML.Resize(lengthOfBuffer);
-  }
-  fRawXML.Replace(0, lengthOfBuffer, fullHeaderAsString, lengthOfBuffer);
 
   ORLog(kDebug) << "LoadXmlPlist(): Getting root node..." << std::endl;
   TXMLNode* rootNode = doc->GetRootNode();
@@ -105,7 +132,7 @@ bool ORXmlPlist::LoadXmlPlist(const char* fullHeaderAsString, size_t lengthOfBuf
   return LoadDictionary(rootDict, fDictionary); 
 }
 
-const ORVDictValue* ORXmlPlist::LookUp(std::string key, char delimiter) const 
+const ORVDictValue* ORXmlPlist::LookUp(const std::string& key, char delimiter) const 
 { 
   if(fDictionary == NULL) {
     ORLog(kError) << "LookUp(): dictionary not loaded" << std::endl;
@@ -114,6 +141,15 @@ const ORVDictValue* ORXmlPlist::LookUp(std::string key, char delimiter) const
   return fDictionary->LookUp(key, delimiter); 
 }
 
+const ORVDictValue* ORXmlPlist::LookUp(const ORDictPath& path) const 
+{ 
+  if(fDictionary == NULL) {
+    ORLog(kError) << "LookUp(): dictionary not loaded" << std::endl;
+    return 0;
+  }
+  return fDictionary->LookUp(path); 
+}
+
 bool ORXmlPlist::LoadDictionary(TXMLNode* dictNode, ORDictionary* dictionary)
 {
   ORLog(kDebug) << "LoadDictionary(): Loading dictionary " 
@@ -17,7 +17,9 @@
    
    http://www.apple.com/DTDs/PropertyList-1.0.dtd
 
-  
+   Plists are parsed in a single pass by ORPlistParser, unless they are
+   to be validated (see ValidateXML()) or UseDOMParser() is set; then,
+   or if ORPlistParser fails, they are parsed with ROOT's TDOMParser.
  */
 class TXMLNode;
 class ORXmlPlist
@@ -33,14 +35,20 @@ class ORXmlPlist
     //! Load a plist from a file* 
     virtual bool LoadXmlPlistFromFile(const char* fileName);
     virtual ORDictionary* GetDictionary() { return fDictionary; }
-    virtual const ORVDictValue* LookUp(std::string key, char delimiter = ':') const;
+    virtual const ORVDictValue* LookUp(const std::string& key, char delimiter = ':') const;
+    virtual const ORVDictValue* LookUp(const char* key, char delimiter = ':') const
+      { return LookUp(std::string(key), delimiter); }
+    virtual const ORVDictValue* LookUp(const ORDictPath& path) const;
     virtual TString& GetRawXML() { return fRawXML; }
     virtual const TString& GetRawXML() const { return fRawXML; }
 
     // Options
     virtual inline void ValidateXML(bool flag = true) { fDoValidate = flag; }
+    virtual inline void UseDOMParser(bool flag = true) { fUseDOMParser = flag; }
 
   protected:
+    virtual bool LoadWithDOMParser(const char* fullHeaderAsString, 
+                                   size_t lengthOfBuffer); //<returns true if successful
     virtual bool LoadDictionary(TXMLNode* dictNode, ORDictionary* dictionary); //<returns true if successful
     virtual bool LoadArray(TXMLNode* dictNode, ORDictValueA* dictValueA); //<returns true if successful
 
@@ -50,6 +58,7 @@ class ORXmlPlist
     ORDictionary* fDictionary;
     TString fRawXML;
     bool fDoValidate;
+    bool fUseDOMParser;
 };
 
 #endif